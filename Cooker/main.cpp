@@ -0,0 +1,264 @@
+// Headless asset cooker.
+//
+// Walks a resource directory and converts every source asset into the format the game loads at runtime:
+//   .fbx                    -> .cooked (SkinnedMesh), plus .baked (BakedAnimation) with 'bake_fps'
+//   .obj (+ .mtl)           -> .cooked (StaticMesh)
+//   .wav                    -> .cooked (Audio)
+//   .png .jpg .jpeg .bmp .tga -> .dds  (BC7 through texconv, stamped with the source hash)
+//
+// Conversions run on a work-stealing thread pool. An output is skipped when it was built from the same
+// source content with the same import parameters, so re-running after a small change only redoes that asset.
+//
+// Usage : Cooker [resource directory] [-force] [-threads N] [-texconv path]
+//
+// Import parameters that differ from the loaders' defaults are read from 'cook_settings.txt' in the
+// resource directory, one asset per line:
+//   Rock/rock.obj       flip_v
+//   AimTest/MNK.fbx     triangulate sampling_rate=30 compress_vertices
+// 'compress_vertices' stores the compact vertex layout; the game has to ask for it too (the
+// 'compressVertices' constructor argument), otherwise the import parameters differ and it re-imports.
+// 'bake_fps=30' also bakes every clip's bone palettes for instanced crowds (SkinnedMesh::render_baked).
+
+#include <windows.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <filesystem>
+
+#include "skinned_mesh.h"
+#include "static_mesh.h"
+#include "audio.h"
+#include "cooked_model.h"
+#include "thread_pool.h"
+#include "misc.h"
+
+struct ImportSettings {
+    bool triangulate = false;
+    float samplingRate = 0;
+    bool flipV = false;
+    bool compressVertices = false;
+    float bakeFramesPerSecond = 0;  // 0 : no .baked file
+};
+
+struct Job {
+    enum class Type {
+        MODEL,
+        MESH,
+        SOUND,
+        TEXTURE,
+    };
+    Type type;
+    std::filesystem::path filename;
+    ImportSettings settings;
+
+    cooked::CookResult result = cooked::CookResult::FAILED;
+    float seconds = 0;
+};
+
+// Matches the 'texconv.bat' files that used to be run by hand.
+constexpr uint32_t TEXTURE_FORMAT_BC7 = 1;
+
+static std::string lowercase(std::string string) {
+    std::transform(string.begin(), string.end(), string.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+    return string;
+}
+
+// Keys are generic (forward slash) paths relative to the resource directory, lower case.
+static std::map<std::string, ImportSettings> load_settings(const std::filesystem::path& directory) {
+    std::map<std::string, ImportSettings> settings;
+    std::ifstream ifs(directory / "cook_settings.txt");
+    std::string line;
+    while (std::getline(ifs, line)) {
+        std::istringstream tokens(line);
+        std::string filename;
+        if (!(tokens >> filename) || filename[0] == '#') {
+            continue;
+        }
+        ImportSettings& importSettings = settings[lowercase(std::filesystem::path(filename).generic_string())];
+        std::string option;
+        while (tokens >> option) {
+            if (option == "triangulate") {
+                importSettings.triangulate = true;
+            }
+            else if (option == "flip_v") {
+                importSettings.flipV = true;
+            }
+            else if (option == "compress_vertices") {
+                importSettings.compressVertices = true;
+            }
+            else if (option.compare(0, 14, "sampling_rate=") == 0) {
+                importSettings.samplingRate = std::stof(option.substr(14));
+            }
+            else if (option.compare(0, 9, "bake_fps=") == 0) {
+                importSettings.bakeFramesPerSecond = std::stof(option.substr(9));
+            }
+            else {
+                printf("cook_settings.txt : unknown option '%s' for %s\n", option.c_str(), filename.c_str());
+            }
+        }
+    }
+    return settings;
+}
+
+static cooked::CookResult cook_texture(const std::filesystem::path& filename, const std::filesystem::path& texconv, bool force) {
+    std::filesystem::path ddsFilename(filename);
+    ddsFilename.replace_extension("dds");
+
+    cooked::SourceKey sourceKey;
+    sourceKey.hash = cooked::hash_file(filename.c_str());
+    sourceKey.flags = TEXTURE_FORMAT_BC7;
+    if (sourceKey.hash == 0) {
+        return cooked::CookResult::FAILED;
+    }
+    cooked::SourceKey ddsKey;
+    if (!force && cooked::read_texture_key(ddsFilename.c_str(), ddsKey) &&
+        ddsKey.hash == sourceKey.hash && ddsKey.flags == sourceKey.flags) {
+        return cooked::CookResult::UP_TO_DATE;
+    }
+
+    // The pool already runs one texconv per core, so each texconv is kept single threaded.
+    std::wstring commandLine = L"\"" + texconv.wstring() + L"\" -nologo -singleproc -f BC7_UNORM -m 0 -y -ft dds -o \"" +
+        filename.parent_path().wstring() + L"\" \"" + filename.wstring() + L"\"";
+
+    STARTUPINFOW startupInfo = {};
+    startupInfo.cb = sizeof(startupInfo);
+    startupInfo.dwFlags = STARTF_USESTDHANDLES;
+    PROCESS_INFORMATION processInformation = {};
+    if (!CreateProcessW(texconv.c_str(), commandLine.data(), nullptr, nullptr, FALSE, CREATE_NO_WINDOW,
+        nullptr, nullptr, &startupInfo, &processInformation)) {
+        return cooked::CookResult::FAILED;
+    }
+    WaitForSingleObject(processInformation.hProcess, INFINITE);
+    DWORD exitCode = 1;
+    GetExitCodeProcess(processInformation.hProcess, &exitCode);
+    CloseHandle(processInformation.hThread);
+    CloseHandle(processInformation.hProcess);
+
+    if (exitCode != 0 || !cooked::write_texture_key(ddsFilename.c_str(), sourceKey)) {
+        return cooked::CookResult::FAILED;
+    }
+    return cooked::CookResult::COOKED;
+}
+
+static void cook(Job& job, const std::filesystem::path& texconv, bool force) {
+    benchmark timer;
+    switch (job.type) {
+    case Job::Type::MODEL:
+        job.result = SkinnedMesh::cook(job.filename.string().c_str(), job.settings.triangulate, job.settings.samplingRate,
+            job.settings.compressVertices, force);
+        if (job.result != cooked::CookResult::FAILED && job.settings.bakeFramesPerSecond > 0) {
+            // Reads the .cooked file just written
+            const cooked::CookResult bakeResult = SkinnedMesh::cook_baked_animations(job.filename.string().c_str(),
+                job.settings.triangulate, job.settings.samplingRate, job.settings.compressVertices, job.settings.bakeFramesPerSecond, force);
+            if (bakeResult != cooked::CookResult::UP_TO_DATE) {
+                job.result = bakeResult;
+            }
+        }
+        break;
+    case Job::Type::MESH:
+        job.result = StaticMesh::cook(job.filename.c_str(), job.settings.flipV, job.settings.compressVertices, force);
+        break;
+    case Job::Type::SOUND:
+        job.result = Audio::cook(job.filename.c_str(), force);
+        break;
+    case Job::Type::TEXTURE:
+        job.result = cook_texture(job.filename, texconv, force);
+        break;
+    }
+    job.seconds = timer.end();
+}
+
+int wmain(int argc, wchar_t* argv[]) {
+    std::filesystem::path directory = L".\\resources";
+    std::filesystem::path texconv;
+    bool force = false;
+    size_t threadCount = 0;
+    for (int argumentIndex = 1; argumentIndex < argc; ++argumentIndex) {
+        const std::wstring argument = argv[argumentIndex];
+        if (argument == L"-force") {
+            force = true;
+        }
+        else if (argument == L"-threads" && argumentIndex + 1 < argc) {
+            threadCount = static_cast<size_t>(_wtoi(argv[++argumentIndex]));
+        }
+        else if (argument == L"-texconv" && argumentIndex + 1 < argc) {
+            texconv = argv[++argumentIndex];
+        }
+        else {
+            directory = argument;
+        }
+    }
+    if (texconv.empty()) {
+        texconv = directory / L"texconv.exe";
+    }
+    if (!std::filesystem::is_directory(directory)) {
+        printf("Cooker : %s is not a directory\n", directory.u8string().c_str());
+        return 1;
+    }
+
+    const std::map<std::string, ImportSettings> settings = load_settings(directory);
+    const std::map<std::string, Job::Type> types = {
+        { ".fbx", Job::Type::MODEL },
+        { ".obj", Job::Type::MESH },
+        { ".wav", Job::Type::SOUND },
+        { ".png", Job::Type::TEXTURE },
+        { ".jpg", Job::Type::TEXTURE },
+        { ".jpeg", Job::Type::TEXTURE },
+        { ".bmp", Job::Type::TEXTURE },
+        { ".tga", Job::Type::TEXTURE },
+    };
+
+    std::vector<Job> jobs;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(directory)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        const auto type = types.find(lowercase(entry.path().extension().string()));
+        if (type == types.end()) {
+            continue;
+        }
+        Job& job = jobs.emplace_back();
+        job.type = type->second;
+        job.filename = entry.path();
+        const auto importSettings = settings.find(lowercase(entry.path().lexically_relative(directory).generic_string()));
+        if (importSettings != settings.end()) {
+            job.settings = importSettings->second;
+        }
+    }
+    // Largest files first, so a big FBX doesn't start last and keep the other threads idle at the end.
+    std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) {
+        return std::filesystem::file_size(a.filename) > std::filesystem::file_size(b.filename);
+    });
+
+    benchmark timer;
+    std::mutex printMutex;
+    ThreadPool threadPool(threadCount);
+    for (Job& job : jobs) {
+        threadPool.submit([&job, &texconv, force, &printMutex]() {
+            cook(job, texconv, force);
+
+            static const char* labels[] = { "up to date", "cooked", "FAILED" };
+            std::lock_guard<std::mutex> lock(printMutex);
+            printf("%-10s %8.1f ms  %s\n", labels[static_cast<int>(job.result)], job.seconds * 1000.0f,
+                job.filename.u8string().c_str());
+        });
+    }
+    threadPool.wait();
+    const float seconds = timer.end();
+
+    size_t counts[3] = {};
+    for (const Job& job : jobs) {
+        ++counts[static_cast<int>(job.result)];
+    }
+    printf("\n%zu assets on %zu threads in %.2f s : %zu cooked, %zu up to date, %zu failed\n",
+        jobs.size(), threadPool.thread_count(), seconds,
+        counts[static_cast<int>(cooked::CookResult::COOKED)],
+        counts[static_cast<int>(cooked::CookResult::UP_TO_DATE)],
+        counts[static_cast<int>(cooked::CookResult::FAILED)]);
+    return counts[static_cast<int>(cooked::CookResult::FAILED)] > 0 ? 1 : 0;
+}
@@ -7,14 +7,14 @@ void Character::UpdateTransform() {
     XMMATRIX R = XMMatrixScaling(angle.x, angle.y, angle.z);
     XMMATRIX T = XMMatrixScaling(position.x, position.y, position.z);
 
-    XMMATRIX W = S * R * T; // [hs쐬
+    XMMATRIX W = S * R * T; // ワールド行列を作成
 
     XMStoreFloat4x4(&transform, W);
 }
 
 void Character::BehaviorState(float elapsedTime) {
     if (battleFlag) {
-        //Battle(); //Ȋɍ肽ǂ܂ƈĂ@Kv ɂfindŐ퓬̃f[^Ă悤Ǝv
+        //Battle(); //こんな感じに作りたいけどうまいこと引数を取ってくる方法が必要 下にあるfindで戦闘相手のデータを取ってこようと思索中
     }
     if (!battleFlag) {
         Move(elapsedTime);
@@ -24,17 +24,17 @@ void Character::BehaviorState(float elapsedTime) {
 void Character::Move(float elapsedTime) {
     using namespace DirectX;
 
-    // L̈ړ
+    // キャラの移動
     XMVECTOR Position = XMVectorSet(position.x, position.y, position.z, 0.0f);
     XMVECTOR Forword = XMVectorSet(transform._31, transform._32, transform._33, transform._34);
     Forword = XMVector3Normalize(Forword);
     XMStoreFloat3(&position, XMVectorAdd(Position, XMVectorScale(Forword, velocity * elapsedTime)));
 
-    // G⌚Ƃ̏Փ˔
+    // 敵や建物との衝突判定
 }
 
 void Character::Battle(Character& dst) {
-    // 퓬̏
+    // 戦闘時の処理
     if (!dst.deathFlag) {
         Attack(dst);
     }
@@ -48,13 +48,13 @@ void Character::Attack(Character& dst) {
 
     dst.SetHP(afterHp);
 
-    // S
+    // 死亡処理
     if (dst.GetHP() <= 0) {
         FlagOn(dst.deathFlag);
     }
 }
 
-// ō񂩂
+// ここで作らんかも
 void Character::SetRecastTime(float second, bool& recastFlag,float elapsedTime) {
  //   if(second > )
 
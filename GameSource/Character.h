@@ -21,61 +21,61 @@ protected:
     int attack = 1;
     int hp = 0;
     int maxHp = 5;
-    bool deathFlag = false; // StO
-    bool battleFlag = false; // 퓬tO
-    bool attackRecast = false; // ItȂU\
+    bool deathFlag = false; // 死亡フラグ
+    bool battleFlag = false; // 戦闘フラグ
+    bool attackRecast = false; // オフなら攻撃可能
 
 public:
     Character(){}
     virtual ~Character(){}
 
-    // sXV
+    // 行列更新処理
     void UpdateTransform();
 
-    // ʒu擾
+    // 位置取得
     const DirectX::XMFLOAT3& GetPosition() const { return position; }
 
-    // ʒuݒ
+    // 位置設定
     void SetPosition(const DirectX::XMFLOAT3& position) { this->position = position; }
 
-    // ]擾
+    // 回転取得
     const DirectX::XMFLOAT3& GetAngle() const { return angle; }
 
-    // ]ݒ
+    // 回転設定
     void SetAngle(const DirectX::XMFLOAT3& angle) { this->angle = angle; }
 
-    // XP[擾
+    // スケール取得
     const DirectX::XMFLOAT3& GetScale() const { return scale; }
 
-    // XP[ݒ
+    // スケール設定
     void SetScale(const DirectX::XMFLOAT3& scale) { this->scale = scale; }
 
-    // HP擾
+    // HP取得
     const int GetHP() const { return hp; }
 
-    // HPݒ
+    // HP設定
     void SetHP(int& hp) { this->hp = hp; }
 
-    // U͎擾
+    // 攻撃力取得
     const int GetAttack() const { return attack; }
 
-    // U͐ݒ
+    // 攻撃力設定
     void SetAttack(int& attack) { this->attack = attack; }
 public:
-    // tOݒ
+    // フラグ設定
     void FlagOn(bool& flag) { if(flag == false) flag = true; }
     void FlagOff(bool& flag) { if(flag == true) flag = false; }
 
-    // N[^C
+    // クールタイム
     void SetRecastTime(float second,bool& recastFlag,float elapsedTime);
 protected:
-    // L̍sXe[g
+    // キャラの行動ステート
     virtual void BehaviorState(float elapsedTime);
 
-    // ړ
+    // 移動処理
     virtual void Move(float elapsedTime);
 
-    virtual void Battle(Character& dst); // Ƃtemplateɕς邩(ɂΉ邽)
+    virtual void Battle(Character& dst); // あとでtemplateに変えるかも(建物にも対応するため)
 
     virtual void Attack(Character& dst);
 
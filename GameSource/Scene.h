@@ -7,20 +7,20 @@ public:
     Scene() {}
     virtual ~Scene() {}
 
-    // 
+    // 初期化
     virtual void Initialize() = 0;
 
-    // I
+    // 終了化
     virtual void Finalize() = 0;
 
-    // XV
+    // 更新処理
     virtual void Update(float elapsedTime) = 0;
 
-    // `揈
+    // 描画処理
     virtual void Render() = 0;
 
     bool IsReady() const { return ready; }
 
-    // ݒ
+    // 準備完了設定
     void SetReady() { ready = true; }
 };
\ No newline at end of file
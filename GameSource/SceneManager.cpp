@@ -1,16 +1,16 @@
 #include "SceneManager.h"
 
-// XV
+// 更新処理
 void SceneManager::Update(float elapsedTime) {
     if (nextScene != nullptr) {
-        // ÂV[I
+        // 古いシーンを終了処理
         Clear();
 
-        // VV[ݒ
+        // 新しいシーンを設定
         currentScene = nextScene;
         nextScene = nullptr;
 
-        // V[
+        // シーン初期化処理
         if (!currentScene->IsReady()) {
             currentScene->Initialize();
         }
@@ -21,14 +21,14 @@ void SceneManager::Update(float elapsedTime) {
     }
 }
 
-// `揈
+// 描画処理
 void SceneManager::Render() {
     if (currentScene != nullptr) {
         currentScene->Render();
     }
 }
 
-// V[NA
+// シーンクリア
 void SceneManager::Clear() {
     if (currentScene != nullptr) {
         currentScene->Finalize();
@@ -37,8 +37,8 @@ void SceneManager::Clear() {
     }
 }
 
-// V[؂ւ
+// シーン切り替え
 void SceneManager::ChangeScene(Scene* scene) {
-    // VV[ݒ
+    // 新しいシーンを設定
     nextScene = scene;
 }
\ No newline at end of file
@@ -2,28 +2,28 @@
 
 #include "Scene.h"
 
-// V[}l[W[
+// シーンマネージャー
 class SceneManager {
 private:
     SceneManager() {}
     ~SceneManager() {}
 public:
-    // B̃CX^X擾
+    // 唯一のインスタンス取得
     static SceneManager& Instance() {
         static SceneManager instance;
         return instance;
     }
 
-    // XV
+    // 更新処理
     void Update(float elapsedTime);
 
-    // `揈
+    // 描画処理
     void Render();
 
-    // V[NA
+    // シーンクリア
     void Clear();
 
-    // V[؂ւ
+    // シーン切り替え
     void ChangeScene(Scene* scene);
 
 private:
@@ -1,25 +1,25 @@
 #include "SceneTitle.h"
 
-// 
+// 初期化
 void SceneTitle::Initialize() {
-    // XvCg
+    // スプライト初期化
 }
 
-// I
+// 終了化
 void SceneTitle::Finalize() {
-    // XvCgI
+    // スプライト終了化
     if (sprite != nullptr) {
         delete sprite;
         sprite = nullptr;
     }
 }
 
-// XV
+// 更新処理
 void SceneTitle::Update(float elapsedTime) {
 
 }
 
-// `揈
+// 描画処理
 void SceneTitle::Render() {
 
 }
\ No newline at end of file
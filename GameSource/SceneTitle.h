@@ -3,22 +3,22 @@
 #include "../Library/sprite.h"
 #include "Scene.h"
 
-// ^CgV[
+// タイトルシーン
 class SceneTitle : public Scene {
 public:
     SceneTitle() {}
     ~SceneTitle() override {}
 
-    // 
+    // 初期化
     void Initialize() override;
 
-    // I
+    // 終了化
     void Finalize() override;
 
-    // XV
+    // 更新処理
     void Update(float elapsedTime) override;
 
-    // `揈
+    // 描画処理
     void Render() override;
 
 private:
@@ -7,10 +7,10 @@ struct BoundingBox {
 };
 
 struct HitResult {
-    DirectX::XMFLOAT3   position = { 0,0,0 }; // Cƃ|Š_
-    DirectX::XMFLOAT3   normal = { 0,0,0 };   // Փ˂|S̖@xNg
-    float               distance = 0.0f;      // C̎n__܂ł̋
-    int                 materialIndex = -1;   // Փ˂|S̃}eAԍ
+    DirectX::XMFLOAT3   position = { 0,0,0 }; // レイとポリゴンの交点
+    DirectX::XMFLOAT3   normal = { 0,0,0 };   // 衝突したポリゴンの法線ベクトル
+    float               distance = 0.0f;      // レイの始点から交点までの距離
+    int                 materialIndex = -1;   // 衝突したポリゴンのマテリアル番号
 };
 
 class Collision {
@@ -2,31 +2,32 @@
 #include <memory>
 #include "Misc.h"
 #include "Graphics/DebugRenderer.h"
+#include "constant_ring.h"
 
 DebugRenderer::DebugRenderer(ID3D11Device* device)
 {
-	// _VF[_[
+	// 頂点シェーダー
 	{
-		// t@CJ
+		// ファイルを開く
 		FILE* fp = nullptr;
 		fopen_s(&fp, "Shader\\DebugVS.cso", "rb");
 		_ASSERT_EXPR_A(fp, "CSO File not found");
 
-		// t@C̃TCY߂
+		// ファイルのサイズを求める
 		fseek(fp, 0, SEEK_END);
 		long csoSize = ftell(fp);
 		fseek(fp, 0, SEEK_SET);
 
-		// ɒ_VF[_[f[^i[̈pӂ
+		// メモリ上に頂点シェーダーデータを格納する領域を用意する
 		std::unique_ptr<u_char[]> csoData = std::make_unique<u_char[]>(csoSize);
 		fread(csoData.get(), csoSize, 1, fp);
 		fclose(fp);
 
-		// _VF[_[
+		// 頂点シェーダー生成
 		HRESULT hr = device->CreateVertexShader(csoData.get(), csoSize, nullptr, vertexShader.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 
-		// ̓CAEg
+		// 入力レイアウト
 		D3D11_INPUT_ELEMENT_DESC inputElementDesc[] =
 		{
 			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
@@ -35,31 +36,31 @@ DebugRenderer::DebugRenderer(ID3D11Device* device)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// sNZVF[_[
+	// ピクセルシェーダー
 	{
-		// t@CJ
+		// ファイルを開く
 		FILE* fp = nullptr;
 		fopen_s(&fp, "Shader\\DebugPS.cso", "rb");
 		_ASSERT_EXPR_A(fp, "CSO File not found");
 
-		// t@C̃TCY߂
+		// ファイルのサイズを求める
 		fseek(fp, 0, SEEK_END);
 		long csoSize = ftell(fp);
 		fseek(fp, 0, SEEK_SET);
 
-		// ɒ_VF[_[f[^i[̈pӂ
+		// メモリ上に頂点シェーダーデータを格納する領域を用意する
 		std::unique_ptr<u_char[]> csoData = std::make_unique<u_char[]>(csoSize);
 		fread(csoData.get(), csoSize, 1, fp);
 		fclose(fp);
 
-		// sNZVF[_[
+		// ピクセルシェーダー生成
 		HRESULT hr = device->CreatePixelShader(csoData.get(), csoSize, nullptr, pixelShader.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// 萔obt@
+	// 定数バッファ
 	{
-		// V[pobt@
+		// シーン用バッファ
 		D3D11_BUFFER_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
 		desc.Usage = D3D11_USAGE_DEFAULT;
@@ -73,7 +74,7 @@ DebugRenderer::DebugRenderer(ID3D11Device* device)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// uhXe[g
+	// ブレンドステート
 	{
 		D3D11_BLEND_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -92,7 +93,7 @@ DebugRenderer::DebugRenderer(ID3D11Device* device)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// [xXeVXe[g
+	// 深度ステンシルステート
 	{
 		D3D11_DEPTH_STENCIL_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -104,7 +105,7 @@ DebugRenderer::DebugRenderer(ID3D11Device* device)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// X^CU[Xe[g
+	// ラスタライザーステート
 	{
 		D3D11_RASTERIZER_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -123,83 +124,79 @@ DebugRenderer::DebugRenderer(ID3D11Device* device)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// bV쐬
+	// 球メッシュ作成
 	CreateSphereMesh(device, 1.0f, 16, 16);
 
-	// ~bV쐬
+	// 円柱メッシュ作成
 	CreateCylinderMesh(device, 1.0f, 1.0f, 0.0f, 1.0f, 16, 1);
 }
 
-// `Jn
+// 描画開始
 void DebugRenderer::Render(ID3D11DeviceContext* context, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection)
 {
-	// VF[_[ݒ
+	// シェーダー設定
 	context->VSSetShader(vertexShader.Get(), nullptr, 0);
 	context->PSSetShader(pixelShader.Get(), nullptr, 0);
 	context->IASetInputLayout(inputLayout.Get());
 
-	// 萔obt@ݒ
-	context->VSSetConstantBuffers(0, 1, constantBuffer.GetAddressOf());
-	//context->PSSetConstantBuffers(0, 1, constantBuffer.GetAddressOf());
-
-	// _[Xe[gݒ
+	// レンダーステート設定
 	const float blendFactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
 	context->OMSetBlendState(blendState.Get(), blendFactor, 0xFFFFFFFF);
 	context->OMSetDepthStencilState(depthStencilState.Get(), 0);
 	context->RSSetState(rasterizerState.Get());
 
-	// r[vWFNVs쐬
+	// ビュープロジェクション行列作成
 	DirectX::XMMATRIX V = DirectX::XMLoadFloat4x4(&view);
 	DirectX::XMMATRIX P = DirectX::XMLoadFloat4x4(&projection);
 	DirectX::XMMATRIX VP = V * P;
 
-	// v~eBuݒ
+	// プリミティブ設定
 	UINT stride = sizeof(DirectX::XMFLOAT3);
 	UINT offset = 0;
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
 
-	// `
+	// 球描画
 	context->IASetVertexBuffers(0, 1, sphereVertexBuffer.GetAddressOf(), &stride, &offset);
 	for (const Sphere& sphere : spheres)
 	{
-		// [hr[vWFNVs쐬
+		// ワールドビュープロジェクション行列作成
 		DirectX::XMMATRIX S = DirectX::XMMatrixScaling(sphere.radius, sphere.radius, sphere.radius);
 		DirectX::XMMATRIX T = DirectX::XMMatrixTranslation(sphere.center.x, sphere.center.y, sphere.center.z);
 		DirectX::XMMATRIX W = S * T;
 		DirectX::XMMATRIX WVP = W * VP;
 
-		// 萔obt@XV
+		// 定数バッファ更新
 		CbMesh cbMesh;
 		cbMesh.color = sphere.color;
 		DirectX::XMStoreFloat4x4(&cbMesh.wvp, WVP);
 
-		context->UpdateSubresource(constantBuffer.Get(), 0, 0, &cbMesh, 0, 0);
+		upload_constants(context, 0, constantBuffer.Get(), &cbMesh, sizeof(cbMesh));
 		context->Draw(sphereVertexCount, 0);
 	}
 	spheres.clear();
 
-	// ~`
+	// 円柱描画
 	context->IASetVertexBuffers(0, 1, cylinderVertexBuffer.GetAddressOf(), &stride, &offset);
 	for (const Cylinder& cylinder : cylinders)
 	{
-		// [hr[vWFNVs쐬
+		// ワールドビュープロジェクション行列作成
 		DirectX::XMMATRIX S = DirectX::XMMatrixScaling(cylinder.radius, cylinder.height, cylinder.radius);
 		DirectX::XMMATRIX T = DirectX::XMMatrixTranslation(cylinder.position.x, cylinder.position.y, cylinder.position.z);
 		DirectX::XMMATRIX W = S * T;
 		DirectX::XMMATRIX WVP = W * VP;
 
-		// 萔obt@XV
+		// 定数バッファ更新
 		CbMesh cbMesh;
 		cbMesh.color = cylinder.color;
 		DirectX::XMStoreFloat4x4(&cbMesh.wvp, WVP);
 
-		context->UpdateSubresource(constantBuffer.Get(), 0, 0, &cbMesh, 0, 0);
+		upload_constants(context, 0, constantBuffer.Get(), &cbMesh, sizeof(cbMesh));
 		context->Draw(cylinderVertexCount, 0);
 	}
 	cylinders.clear();
 }
 
-// `
+// 球描画
 void DebugRenderer::DrawSphere(const DirectX::XMFLOAT3& center, float radius, const DirectX::XMFLOAT4& color)
 {
 	Sphere sphere;
@@ -209,7 +206,7 @@ void DebugRenderer::DrawSphere(const DirectX::XMFLOAT3& center, float radius, co
 	spheres.emplace_back(sphere);
 }
 
-// ~`
+// 円柱描画
 void DebugRenderer::DrawCylinder(const DirectX::XMFLOAT3& position, float radius, float height, const DirectX::XMFLOAT4& color)
 {
 	Cylinder cylinder;
@@ -220,7 +217,7 @@ void DebugRenderer::DrawCylinder(const DirectX::XMFLOAT3& position, float radius
 	cylinders.emplace_back(cylinder);
 }
 
-// bV쐬
+// 球メッシュ作成
 void DebugRenderer::CreateSphereMesh(ID3D11Device* device, float radius, int slices, int stacks)
 {
 	sphereVertexCount = stacks * slices * 2 + slices * stacks * 2;
@@ -274,7 +271,7 @@ void DebugRenderer::CreateSphereMesh(ID3D11Device* device, float radius, int sli
 		}
 	}
 
-	// _obt@
+	// 頂点バッファ
 	{
 		D3D11_BUFFER_DESC desc = {};
 		D3D11_SUBRESOURCE_DATA subresourceData = {};
@@ -294,7 +291,7 @@ void DebugRenderer::CreateSphereMesh(ID3D11Device* device, float radius, int sli
 	}
 }
 
-// ~bV쐬
+// 円柱メッシュ作成
 void DebugRenderer::CreateCylinderMesh(ID3D11Device* device, float radius1, float radius2, float start, float height, int slices, int stacks)
 {
 	cylinderVertexCount = 2 * slices * (stacks + 1) + 2 * slices;
@@ -345,7 +342,7 @@ void DebugRenderer::CreateCylinderMesh(ID3D11Device* device, float radius1, floa
 		p++;
 	}
 
-	// _obt@
+	// 頂点バッファ
 	{
 		D3D11_BUFFER_DESC desc = {};
 		D3D11_SUBRESOURCE_DATA subresourceData = {};
@@ -4,14 +4,14 @@
 
 Graphics* Graphics::instance = nullptr;
 
-// RXgN^
+// コンストラクタ
 Graphics::Graphics(HWND hWnd)
 {
-	// CX^Xݒ
-	_ASSERT_EXPR(instance == nullptr, "already instantiated");
+	// インスタンス設定
+	_ASSERT_EXPR_A(instance == nullptr, "already instantiated");
 	instance = this;
 
-	// ʂ̃TCY擾B
+	// 画面のサイズを取得する。
 	RECT rc;
 	GetClientRect(hWnd, &rc);
 	UINT screenWidth = rc.right - rc.left;
@@ -22,7 +22,7 @@ Graphics::Graphics(HWND hWnd)
 
 	HRESULT hr = S_OK;
 
-	// foCXXbv`F[̐
+	// デバイス＆スワップチェーンの生成
 	{
 		UINT createDeviceFlags = 0;
 #if defined(DEBUG) || defined(_DEBUG)
@@ -38,86 +38,86 @@ Graphics::Graphics(HWND hWnd)
 			D3D_FEATURE_LEVEL_9_1,
 		};
 
-		// Xbv`F[쐬邽߂̐ݒIvV
+		// スワップチェーンを作成するための設定オプション
 		DXGI_SWAP_CHAIN_DESC swapchainDesc;
 		{
 			swapchainDesc.BufferDesc.Width = screenWidth;
 			swapchainDesc.BufferDesc.Height = screenHeight;
 			swapchainDesc.BufferDesc.RefreshRate.Numerator = 60;
 			swapchainDesc.BufferDesc.RefreshRate.Denominator = 1;
-			swapchainDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;	// 1sNZ̊eF(RGBA)8bit(0`255)̃eNX`(obNobt@)쐬B
+			swapchainDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;	// 1ピクセルあたりの各色(RGBA)を8bit(0～255)のテクスチャ(バックバッファ)を作成する。
 			swapchainDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
 			swapchainDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
 
 			swapchainDesc.SampleDesc.Count = 1;
 			swapchainDesc.SampleDesc.Quality = 0;
 			swapchainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-			swapchainDesc.BufferCount = 1;		// obNobt@̐
-			swapchainDesc.OutputWindow = hWnd;	// DirectXŕ`\EChE
-			swapchainDesc.Windowed = TRUE;		// EChE[hAtXN[ɂ邩B
+			swapchainDesc.BufferCount = 1;		// バックバッファの数
+			swapchainDesc.OutputWindow = hWnd;	// DirectXで描いた画を表示するウインドウ
+			swapchainDesc.Windowed = TRUE;		// ウインドウモードか、フルスクリーンにするか。
 			swapchainDesc.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
 			swapchainDesc.Flags = 0; // DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH
 		}
 
 		D3D_FEATURE_LEVEL featureLevel;
 
-		// foCXXbv`F[̐
+		// デバイス＆スワップチェーンの生成
 		hr = D3D11CreateDeviceAndSwapChain(
-			nullptr,						// ǂ̃rfIA_v^gp邩HȂnullptrŁAIDXGIAdapter̃AhXnB
-			D3D_DRIVER_TYPE_HARDWARE,		// hCõ^CvnBD3D_DRIVER_TYPE_HARDWARE ȊO͊{IɃ\tgEFAŁAʂȂƂꍇɗpB
-			nullptr,						// LD3D_DRIVER_TYPE_SOFTWAREɐݒ肵ۂɁȀsDLL̃nhnBȊOw肵Ăۂɂ͕KnullptrnB
-			createDeviceFlags,				// 炩̃tOw肷BڂD3D11_CREATE_DEVICE񋓌^ŌB
-			featureLevels,					// D3D_FEATURE_LEVEL񋓌^̔z^Bnullptrɂ邱ƂłLfeatureƓ̓e̔z񂪎gpB
-			ARRAYSIZE(featureLevels),		// featureLevelsz̗vfnB
-			D3D11_SDK_VERSION,				// SDK̃o[WBK̒lB
-			&swapchainDesc,					// Őݒ肵\̂ɐݒ肳Ăp[^SwapChain쐬B
-			swapchain.GetAddressOf(),		// 쐬ꍇɁASwapChaiñAhXi[|C^ϐւ̃AhXBŎw肵|C^ϐoRSwapChain𑀍삷B
-			device.GetAddressOf(),			// 쐬ꍇɁADevicẽAhXi[|C^ϐւ̃AhXBŎw肵|C^ϐoRDevice𑀍삷B
-			&featureLevel,					// 쐬ɐD3D_FEATURE_LEVELi[邽߂D3D_FEATURE_LEVEL񋓌^ϐ̃AhXݒ肷B
-			immediateContext.GetAddressOf()	// 쐬ꍇɁAContext̃AhXi[|C^ϐւ̃AhXBŎw肵|C^ϐoRContext𑀍삷B
+			nullptr,						// どのビデオアダプタを使用するか？既定ならばnullptrで、IDXGIAdapterのアドレスを渡す。
+			D3D_DRIVER_TYPE_HARDWARE,		// ドライバのタイプを渡す。D3D_DRIVER_TYPE_HARDWARE 以外は基本的にソフトウェア実装で、特別なことをする場合に用いる。
+			nullptr,						// 上記をD3D_DRIVER_TYPE_SOFTWAREに設定した際に、その処理を行うDLLのハンドルを渡す。それ以外を指定している際には必ずnullptrを渡す。
+			createDeviceFlags,				// 何らかのフラグを指定する。詳しくはD3D11_CREATE_DEVICE列挙型で検索。
+			featureLevels,					// D3D_FEATURE_LEVEL列挙型の配列を与える。nullptrにすることでも上記featureと同等の内容の配列が使用される。
+			ARRAYSIZE(featureLevels),		// featureLevels配列の要素数を渡す。
+			D3D11_SDK_VERSION,				// SDKのバージョン。必ずこの値。
+			&swapchainDesc,					// ここで設定した構造体に設定されているパラメータでSwapChainが作成される。
+			swapchain.GetAddressOf(),		// 作成が成功した場合に、SwapChainのアドレスを格納するポインタ変数へのアドレス。ここで指定したポインタ変数経由でSwapChainを操作する。
+			device.GetAddressOf(),			// 作成が成功した場合に、Deviceのアドレスを格納するポインタ変数へのアドレス。ここで指定したポインタ変数経由でDeviceを操作する。
+			&featureLevel,					// 作成に成功したD3D_FEATURE_LEVELを格納するためのD3D_FEATURE_LEVEL列挙型変数のアドレスを設定する。
+			immediateContext.GetAddressOf()	// 作成が成功した場合に、Contextのアドレスを格納するポインタ変数へのアドレス。ここで指定したポインタ変数経由でContextを操作する。
 			);
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// _[^[Qbgr[̐
+	// レンダーターゲットビューの生成
 	{
-		// Xbv`F[obNobt@eNX`擾B
-		// Xbv`F[ɓĂobNobt@eNX`'F'ރeNX`B
+		// スワップチェーンからバックバッファテクスチャを取得する。
+		// ※スワップチェーンに内包されているバックバッファテクスチャは'色'を書き込むテクスチャ。
 		Microsoft::WRL::ComPtr<ID3D11Texture2D> backBuffer;
 		hr = swapchain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(backBuffer.GetAddressOf()));
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 
-		// obNobt@eNX`ւ݂̏̑ƂȂ郌_[^[Qbgr[𐶐B
+		// バックバッファテクスチャへの書き込みの窓口となるレンダーターゲットビューを生成する。
 		hr = device->CreateRenderTargetView(backBuffer.Get(), nullptr, renderTargetView.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// [xXeVr[̐
+	// 深度ステンシルビューの生成
 	{
-		// [xXeVނ߂̃eNX`쐬B
+		// 深度ステンシル情報を書き込むためのテクスチャを作成する。
 		D3D11_TEXTURE2D_DESC depthStencilBufferDesc;
 		depthStencilBufferDesc.Width = screenWidth;
 		depthStencilBufferDesc.Height = screenHeight;
 		depthStencilBufferDesc.MipLevels = 1;
 		depthStencilBufferDesc.ArraySize = 1;
-		depthStencilBufferDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;	// 1sNZA[x24Bit / XeV8bit̃eNX`쐬B
+		depthStencilBufferDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;	// 1ピクセルあたり、深度情報を24Bit / ステンシル情報を8bitのテクスチャを作成する。
 		depthStencilBufferDesc.SampleDesc.Count = 1;
 		depthStencilBufferDesc.SampleDesc.Quality = 0;
 		depthStencilBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-		depthStencilBufferDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;		// [xXeVp̃eNX`쐬B
+		depthStencilBufferDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;		// 深度ステンシル用のテクスチャを作成する。
 		depthStencilBufferDesc.CPUAccessFlags = 0;
 		depthStencilBufferDesc.MiscFlags = 0;
 		hr = device->CreateTexture2D(&depthStencilBufferDesc, nullptr, depthStencilBuffer.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 
-		// [xXeVeNX`ւ݂̏ɑɂȂ[xXeVr[쐬B
+		// 深度ステンシルテクスチャへの書き込みに窓口になる深度ステンシルビューを作成する。
 		hr = device->CreateDepthStencilView(depthStencilBuffer.Get(), nullptr, depthStencilView.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// r[|[g̐ݒ
+	// ビューポートの設定
 	{
-		// ʂ̂ǂ̗̈DirectXŕ`\邩̐ݒB
+		// 画面のどの領域にDirectXで描いた画を表示するかの設定。
 		D3D11_VIEWPORT viewport;
 		viewport.TopLeftX = 0;
 		viewport.TopLeftY = 0;
@@ -128,12 +128,13 @@ Graphics::Graphics(HWND hWnd)
 		immediateContext->RSSetViewports(1, &viewport);
 	}
 
-	// VF[_[
+	// シェーダー
 	{
-		shader = std::make_unique<LambertShader>(device.Get());
+		stateTracker = std::make_unique<StateTracker>(immediateContext.Get());
+		shader = std::make_unique<LambertShader>(device.Get(), stateTracker.get());
 	}
 
-	// _
+	// レンダラ
 	{
 		debugRenderer = std::make_unique<DebugRenderer>(device.Get());
 		lineRenderer = std::make_unique<LineRenderer>(device.Get(), 1024);
@@ -141,7 +142,32 @@ Graphics::Graphics(HWND hWnd)
 	}
 }
 
-// fXgN^
+// 作成済みのデバイスを使うコンストラクタ
+Graphics::Graphics(ID3D11Device* device, ID3D11DeviceContext* immediateContext, float screenWidth, float screenHeight)
+	: device(device)
+	, immediateContext(immediateContext)
+	, screenWidth(screenWidth)
+	, screenHeight(screenHeight)
+{
+	// インスタンス設定
+	_ASSERT_EXPR_A(instance == nullptr, "already instantiated");
+	instance = this;
+
+	// シェーダー
+	{
+		stateTracker = std::make_unique<StateTracker>(immediateContext);
+		shader = std::make_unique<LambertShader>(device, stateTracker.get());
+	}
+
+	// レンダラ
+	{
+		debugRenderer = std::make_unique<DebugRenderer>(device);
+		lineRenderer = std::make_unique<LineRenderer>(device, 1024);
+	}
+}
+
+// デストラクタ
 Graphics::~Graphics()
 {
+	instance = nullptr;
 }
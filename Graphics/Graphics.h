@@ -7,48 +7,55 @@
 #include "Graphics/DebugRenderer.h"
 #include "Graphics/LineRenderer.h"
 #include "Graphics/ImGuiRenderer.h"
+#include "state_tracker.h"
 
-// OtBbNX
+// グラフィックス
 class Graphics
 {
 public:
 	Graphics(HWND hWnd);
+	// 作成済みのデバイスを使う (frameworkから)
+	// スワップチェーン・レンダーターゲット・ImGuiRendererは作らないので、それらの取得はnullptrを返す
+	Graphics(ID3D11Device* device, ID3D11DeviceContext* immediateContext, float screenWidth, float screenHeight);
 	~Graphics();
 
-	// CX^X擾
+	// インスタンス取得
 	static Graphics& Instance() { return *instance; }
 
-	// foCX擾
+	// デバイス取得
 	ID3D11Device* GetDevice() const { return device.Get(); }
 
-	// foCXReLXg擾
+	// デバイスコンテキスト取得
 	ID3D11DeviceContext* GetDeviceContext() const { return immediateContext.Get(); }
 
-	// Xbv`F[擾
+	// スワップチェーン取得
 	IDXGISwapChain* GetSwapChain() const { return swapchain.Get(); }
 
-	// _[^[Qbgr[擾
+	// レンダーターゲットビュー取得
 	ID3D11RenderTargetView* GetRenderTargetView() const { return renderTargetView.Get(); }
 
-	// fvXXeVr[擾
+	// デプスステンシルビュー取得
 	ID3D11DepthStencilView* GetDepthStencilView() const { return depthStencilView.Get(); }
 
-	// VF[_[擾
+	// シェーダー取得
 	Shader* GetShader() const { return shader.get(); }
 
-	// XN[擾
+	// ステートトラッカー取得 (immediateContextへのステート設定はこれを通す。統計はフレーム毎にResetする)
+	StateTracker* GetStateTracker() const { return stateTracker.get(); }
+
+	// スクリーン幅取得
 	float GetScreenWidth() const { return screenWidth; }
 
-	// XN[擾
+	// スクリーン高さ取得
 	float GetScreenHeight() const { return screenHeight; }
 
-	// fobO_擾
+	// デバッグレンダラ取得
 	DebugRenderer* GetDebugRenderer() const { return debugRenderer.get(); }
 
-	// C_擾
+	// ラインレンダラ取得
 	LineRenderer* GetLineRenderer() const { return lineRenderer.get(); }
 
-	// ImGui_擾
+	// ImGuiレンダラ取得
 	ImGuiRenderer* GetImGuiRenderer() const { return imguiRenderer.get(); }
 
 private:
@@ -61,6 +68,7 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11Texture2D>			depthStencilBuffer;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView>	depthStencilView;
 
+	std::unique_ptr<StateTracker>					stateTracker;
 	std::unique_ptr<Shader>							shader;
 	std::unique_ptr<DebugRenderer>					debugRenderer;
 	std::unique_ptr<LineRenderer>					lineRenderer;
@@ -49,28 +49,28 @@ ImGuiRenderer::ImGuiRenderer(HWND hWnd, ID3D11Device* device)
 	io.KeyMap[ImGuiKey_Y] = 'Y';
 	io.KeyMap[ImGuiKey_Z] = 'Z';
 
-	// _VF[_[
+	// 頂点シェーダー
 	{
-		// t@CJ
+		// ファイルを開く
 		FILE* fp = nullptr;
 		fopen_s(&fp, "Shader\\ImGuiVS.cso", "rb");
 		_ASSERT_EXPR_A(fp, "CSO File not found");
 
-		// t@C̃TCY߂
+		// ファイルのサイズを求める
 		fseek(fp, 0, SEEK_END);
 		long csoSize = ftell(fp);
 		fseek(fp, 0, SEEK_SET);
 
-		// ɒ_VF[_[f[^i[̈pӂ
+		// メモリ上に頂点シェーダーデータを格納する領域を用意する
 		std::unique_ptr<u_char[]> csoData = std::make_unique<u_char[]>(csoSize);
 		fread(csoData.get(), csoSize, 1, fp);
 		fclose(fp);
 
-		// _VF[_[
+		// 頂点シェーダー生成
 		HRESULT hr = device->CreateVertexShader(csoData.get(), csoSize, nullptr, vertexShader.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 
-		// ̓CAEg
+		// 入力レイアウト
 		D3D11_INPUT_ELEMENT_DESC inputElementDesc[] =
 		{
 			{"POSITION",	0,	DXGI_FORMAT_R32G32_FLOAT,	0,	D3D11_APPEND_ALIGNED_ELEMENT,	D3D11_INPUT_PER_VERTEX_DATA,	0 },
@@ -81,29 +81,29 @@ ImGuiRenderer::ImGuiRenderer(HWND hWnd, ID3D11Device* device)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// sNZVF[_[
+	// ピクセルシェーダー
 	{
-		// t@CJ
+		// ファイルを開く
 		FILE* fp = nullptr;
 		fopen_s(&fp, "Shader\\ImGuiPS.cso", "rb");
 		_ASSERT_EXPR_A(fp, "CSO File not found");
 
-		// t@C̃TCY߂
+		// ファイルのサイズを求める
 		fseek(fp, 0, SEEK_END);
 		long csoSize = ftell(fp);
 		fseek(fp, 0, SEEK_SET);
 
-		// ɒ_VF[_[f[^i[̈pӂ
+		// メモリ上に頂点シェーダーデータを格納する領域を用意する
 		std::unique_ptr<u_char[]> csoData = std::make_unique<u_char[]>(csoSize);
 		fread(csoData.get(), csoSize, 1, fp);
 		fclose(fp);
 
-		// sNZVF[_[
+		// ピクセルシェーダー生成
 		HRESULT hr = device->CreatePixelShader(csoData.get(), csoSize, nullptr, pixelShader.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// 萔obt@
+	// 定数バッファ
 	{
 		D3D11_BUFFER_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -118,7 +118,7 @@ ImGuiRenderer::ImGuiRenderer(HWND hWnd, ID3D11Device* device)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// uhXe[g
+	// ブレンドステート
 	{
 		D3D11_BLEND_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -137,7 +137,7 @@ ImGuiRenderer::ImGuiRenderer(HWND hWnd, ID3D11Device* device)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// [xXeVXe[g
+	// 深度ステンシルステート
 	{
 		D3D11_DEPTH_STENCIL_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -149,7 +149,7 @@ ImGuiRenderer::ImGuiRenderer(HWND hWnd, ID3D11Device* device)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// X^CU[Xe[g
+	// ラスタライザーステート
 	{
 		D3D11_RASTERIZER_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -168,7 +168,7 @@ ImGuiRenderer::ImGuiRenderer(HWND hWnd, ID3D11Device* device)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// TvXe[g
+	// サンプラステート
 	{
 		D3D11_SAMPLER_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -190,14 +190,14 @@ ImGuiRenderer::ImGuiRenderer(HWND hWnd, ID3D11Device* device)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// tHgeNX`
+	// フォントテクスチャ
 	{
 		ImGuiIO& io = ImGui::GetIO();
 		unsigned char* pixels;
 		int width, height;
 		io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
 
-		// eNX`
+		// テクスチャ
 		Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
 		{
 			D3D11_TEXTURE2D_DESC desc;
@@ -220,7 +220,7 @@ ImGuiRenderer::ImGuiRenderer(HWND hWnd, ID3D11Device* device)
 			_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 		}
 
-		// VF[_[\[Xr[
+		// シェーダーリソースビュー
 		{
 			D3D11_SHADER_RESOURCE_VIEW_DESC desc;
 			::memset(&desc, 0, sizeof(desc));
@@ -232,18 +232,18 @@ ImGuiRenderer::ImGuiRenderer(HWND hWnd, ID3D11Device* device)
 			_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 		}
 
-		// eNX`n
+		// テクスチャを渡す
 		io.Fonts->TexID = (ImTextureID)shaderResourceView.Get();
 	}
 }
 
-// fXgN^
+// デストラクタ
 ImGuiRenderer::~ImGuiRenderer()
 {
 	ImGui::DestroyContext();
 }
 
-// t[Jn
+// フレーム開始処理
 void ImGuiRenderer::NewFrame()
 {
 	ImGuiIO& io = ImGui::GetIO();
@@ -279,7 +279,7 @@ void ImGuiRenderer::NewFrame()
 	ImGui::NewFrame();
 }
 
-// `
+// 描画
 void ImGuiRenderer::Render(ID3D11DeviceContext* context)
 {
 	ImGui::Render();
@@ -290,7 +290,7 @@ void ImGuiRenderer::Render(ID3D11DeviceContext* context)
 	//D3D11_RECT scissor_rects[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
 	//context->RSGetScissorRects(&scissor_rects_count, scissor_rects);
 
-	// _obt@\z
+	// 頂点バッファ構築
 	if (vertexBuffer == nullptr || vertexCount < drawData->TotalVtxCount)
 	{
 		vertexBuffer.Reset();
@@ -311,7 +311,7 @@ void ImGuiRenderer::Render(ID3D11DeviceContext* context)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// CfbNXobt@
+	// インデックスバッファ
 	if (indexBuffer == nullptr || indexCount < drawData->TotalIdxCount)
 	{
 		indexBuffer.Reset();
@@ -332,7 +332,7 @@ void ImGuiRenderer::Render(ID3D11DeviceContext* context)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// 萔obt@XV
+	// 定数バッファ更新
 	{
 		ConstantBuffer data;
 
@@ -360,7 +360,7 @@ void ImGuiRenderer::Render(ID3D11DeviceContext* context)
 		context->UpdateSubresource(constantBuffer.Get(), 0, 0, &data, 0, 0);
 	}
 
-	// `Xe[gݒ
+	// 描画ステート設定
 	{
 		// Setup viewport
 		D3D11_VIEWPORT viewPort;
@@ -372,12 +372,12 @@ void ImGuiRenderer::Render(ID3D11DeviceContext* context)
 		viewPort.TopLeftX = viewPort.TopLeftY = 0;
 		context->RSSetViewports(1, &viewPort);
 
-		// VF[_[
+		// シェーダー
 		context->VSSetShader(vertexShader.Get(), nullptr, 0);
 		context->PSSetShader(pixelShader.Get(), nullptr, 0);
 		context->VSSetConstantBuffers(0, 1, constantBuffer.GetAddressOf());
 
-		// _obt@
+		// 頂点バッファ
 		UINT stride = sizeof(ImDrawVert);
 		UINT offset = 0;
 		context->IASetInputLayout(inputLayout.Get());
@@ -385,7 +385,7 @@ void ImGuiRenderer::Render(ID3D11DeviceContext* context)
 		context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
 		context->IASetIndexBuffer(indexBuffer.Get(), sizeof(ImDrawIdx) == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
 
-		// Xe[g
+		// ステート
 		const float blend_factor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
 		context->OMSetBlendState(blendState.Get(), blend_factor, 0xFFFFFFFF);
 		context->OMSetDepthStencilState(depthStencilState.Get(), 0);
@@ -393,7 +393,7 @@ void ImGuiRenderer::Render(ID3D11DeviceContext* context)
 		context->PSSetSamplers(0, 1, samplerState.GetAddressOf());
 	}
 
-	// _f[^ςݍ
+	// 頂点データ積み込み
 	{
 		D3D11_MAPPED_SUBRESOURCE mappedVB, mappedIB;
 		HRESULT hr = context->Map(vertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedVB);
@@ -418,7 +418,7 @@ void ImGuiRenderer::Render(ID3D11DeviceContext* context)
 		context->Unmap(indexBuffer.Get(), 0);
 	}
 
-	// `
+	// 描画
 	{
 		int globalIdxOffset = 0;
 		int globalVtxOffset = 0;
@@ -462,7 +462,7 @@ void ImGuiRenderer::Render(ID3D11DeviceContext* context)
 	}
 }
 
-// }EXWXV
+// マウス座標更新
 void ImGuiRenderer::UpdateMousePos()
 {
 	ImGuiIO& io = ImGui::GetIO();
@@ -484,7 +484,7 @@ void ImGuiRenderer::UpdateMousePos()
 				io.MousePos = ImVec2((float)pos.x, (float)pos.y);
 }
 
-// WIN32bZ[Wnh[
+// WIN32メッセージハンドラー
 LRESULT ImGuiRenderer::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
 	if (ImGui::GetCurrentContext() == NULL)
@@ -552,7 +552,7 @@ LRESULT ImGuiRenderer::HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM
 	return 0;
 }
 
-// }EXJ[\XV
+// マウスカーソル更新
 bool ImGuiRenderer::UpdateMouseCursor()
 {
 	ImGuiIO& io = ImGui::GetIO();
@@ -13,20 +13,20 @@ public:
 	~ImGuiRenderer();
 
 public:
-	// t[Jn
+	// フレーム開始処理
 	void NewFrame();
 
-	// `s
+	// 描画実行
 	void Render(ID3D11DeviceContext* context);
 
-	// WIN32bZ[Wnh[
+	// WIN32メッセージハンドラー
 	LRESULT HandleMessage(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
 private:
-	// }EXJ[\XV
+	// マウスカーソル更新
 	bool UpdateMouseCursor();
 
-	// }EXWXV
+	// マウス座標更新
 	void UpdateMousePos();
 
 private:
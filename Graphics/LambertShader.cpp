@@ -1,30 +1,31 @@
 #include "Misc.h"
 #include "Graphics/LambertShader.h"
 
-LambertShader::LambertShader(ID3D11Device* device)
+LambertShader::LambertShader(ID3D11Device* device, StateTracker* stateTracker)
+	: stateTracker(stateTracker)
 {
-	// _VF[_[
+	// 頂点シェーダー
 	{
-		// t@CJ
+		// ファイルを開く
 		FILE* fp = nullptr;
 		fopen_s(&fp, "Shader\\LambertVS.cso", "rb");
 		_ASSERT_EXPR_A(fp, "CSO File not found");
 
-		// t@C̃TCY߂
+		// ファイルのサイズを求める
 		fseek(fp, 0, SEEK_END);
 		long csoSize = ftell(fp);
 		fseek(fp, 0, SEEK_SET);
 
-		// ɒ_VF[_[f[^i[̈pӂ
+		// メモリ上に頂点シェーダーデータを格納する領域を用意する
 		std::unique_ptr<u_char[]> csoData = std::make_unique<u_char[]>(csoSize);
 		fread(csoData.get(), csoSize, 1, fp);
 		fclose(fp);
 
-		// _VF[_[
+		// 頂点シェーダー生成
 		HRESULT hr = device->CreateVertexShader(csoData.get(), csoSize, nullptr, vertexShader.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 
-		// ̓CAEg
+		// 入力レイアウト
 		D3D11_INPUT_ELEMENT_DESC inputElementDesc[] =
 		{
 			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
@@ -39,31 +40,31 @@ LambertShader::LambertShader(ID3D11Device* device)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// sNZVF[_[
+	// ピクセルシェーダー
 	{
-		// t@CJ
+		// ファイルを開く
 		FILE* fp = nullptr;
 		fopen_s(&fp, "Shader\\LambertPS.cso", "rb");
 		_ASSERT_EXPR_A(fp, "CSO File not found");
 
-		// t@C̃TCY߂
+		// ファイルのサイズを求める
 		fseek(fp, 0, SEEK_END);
 		long csoSize = ftell(fp);
 		fseek(fp, 0, SEEK_SET);
 
-		// ɒ_VF[_[f[^i[̈pӂ
+		// メモリ上に頂点シェーダーデータを格納する領域を用意する
 		std::unique_ptr<u_char[]> csoData = std::make_unique<u_char[]>(csoSize);
 		fread(csoData.get(), csoSize, 1, fp);
 		fclose(fp);
 
-		// sNZVF[_[
+		// ピクセルシェーダー生成
 		HRESULT hr = device->CreatePixelShader(csoData.get(), csoSize, nullptr, pixelShader.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// 萔obt@
+	// 定数バッファ
 	{
-		// V[pobt@
+		// シーン用バッファ
 		D3D11_BUFFER_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
 		desc.Usage = D3D11_USAGE_DEFAULT;
@@ -76,20 +77,20 @@ LambertShader::LambertShader(ID3D11Device* device)
 		HRESULT hr = device->CreateBuffer(&desc, 0, sceneConstantBuffer.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 
-		// bVpobt@
+		// メッシュ用バッファ
 		desc.ByteWidth = sizeof(CbMesh);
 
 		hr = device->CreateBuffer(&desc, 0, meshConstantBuffer.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 
-		// TuZbgpobt@
+		// サブセット用バッファ
 		desc.ByteWidth = sizeof(CbSubset);
 
 		hr = device->CreateBuffer(&desc, 0, subsetConstantBuffer.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// uhXe[g
+	// ブレンドステート
 	{
 		D3D11_BLEND_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -108,7 +109,7 @@ LambertShader::LambertShader(ID3D11Device* device)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// [xXeVXe[g
+	// 深度ステンシルステート
 	{
 		D3D11_DEPTH_STENCIL_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -120,7 +121,7 @@ LambertShader::LambertShader(ID3D11Device* device)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// X^CU[Xe[g
+	// ラスタライザーステート
 	{
 		D3D11_RASTERIZER_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -139,7 +140,7 @@ LambertShader::LambertShader(ID3D11Device* device)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// TvXe[g
+	// サンプラステート
 	{
 		D3D11_SAMPLER_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -162,48 +163,63 @@ LambertShader::LambertShader(ID3D11Device* device)
 	}
 }
 
-// `Jn
+// 描画開始
 void LambertShader::Begin(ID3D11DeviceContext* dc, const RenderContext& rc)
 {
-	dc->VSSetShader(vertexShader.Get(), nullptr, 0);
-	dc->PSSetShader(pixelShader.Get(), nullptr, 0);
-	dc->IASetInputLayout(inputLayout.Get());
+	_ASSERT_EXPR_A(stateTracker->context() == dc, "The state tracker belongs to another context");
 
-	ID3D11Buffer* constantBuffers[] =
-	{
-		sceneConstantBuffer.Get(),
-		meshConstantBuffer.Get(),
-		subsetConstantBuffer.Get()
-	};
-	dc->VSSetConstantBuffers(0, ARRAYSIZE(constantBuffers), constantBuffers);
-	dc->PSSetConstantBuffers(0, ARRAYSIZE(constantBuffers), constantBuffers);
-
-	const float blend_factor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
-	dc->OMSetBlendState(blendState.Get(), blend_factor, 0xFFFFFFFF);
-	dc->OMSetDepthStencilState(depthStencilState.Get(), 0);
-	dc->RSSetState(rasterizerState.Get());
-	dc->PSSetSamplers(0, 1, samplerState.GetAddressOf());
-
-	// V[p萔obt@XV
+	// シェーダー・ステート・サブセット毎のバインドはEndでまとめて行う
+	renderQueue.clear();
+
+	// シーン用定数バッファ更新
 	CbScene cbScene;
 
 	DirectX::XMMATRIX V = DirectX::XMLoadFloat4x4(&rc.view);
 	DirectX::XMMATRIX P = DirectX::XMLoadFloat4x4(&rc.projection);
 	DirectX::XMStoreFloat4x4(&cbScene.viewProjection, V * P);
+	viewProjection = cbScene.viewProjection;
+	DirectX::XMStoreFloat3(&cameraPosition, DirectX::XMMatrixInverse(nullptr, V).r[3]);
 
 	cbScene.lightDirection = rc.lightDirection;
-	dc->UpdateSubresource(sceneConstantBuffer.Get(), 0, 0, &cbScene, 0, 0);
+	stateTracker->upload_constants(0, sceneConstantBuffer.Get(), &cbScene, sizeof(cbScene));
 }
 
-// `
+// 描画
 void LambertShader::Draw(ID3D11DeviceContext* dc, const Model* model)
 {
 	const ModelResource* resource = model->GetResource();
 	const std::vector<Model::Node>& nodes = model->GetNodes();
+	const DirectX::XMMATRIX VP = DirectX::XMLoadFloat4x4(&viewProjection);
+	const uint32_t shaderId = renderQueue.id(vertexShader.Get());
+	const std::vector<ModelResource::Mesh>& meshes = resource->GetMeshes();
+
+	// 剛体メッシュは視錐台カリングする (スキンメッシュの境界はバインドポーズなので常に描く)
+	visibleMeshes.clear();
+	rigidMeshes.clear();
+	frustumCuller.clear();
+	for (uint32_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex)
+	{
+		const ModelResource::Mesh& mesh = meshes.at(meshIndex);
+		if (mesh.nodeIndices.size() > 0)
+		{
+			visibleMeshes.push_back(meshIndex);
+		}
+		else
+		{
+			frustumCuller.add(mesh.boundsMin, mesh.boundsMax, nodes.at(mesh.nodeIndex).worldTransform);
+			rigidMeshes.push_back(meshIndex);
+		}
+	}
+	frustumCuller.cull(viewProjection, cameraPosition);
+	for (uint32_t culledIndex : frustumCuller.visible())
+	{
+		visibleMeshes.push_back(rigidMeshes.at(culledIndex));
+	}
 
-	for (const ModelResource::Mesh& mesh : resource->GetMeshes())
+	for (uint32_t meshIndex : visibleMeshes)
 	{
-		// bVp萔obt@XV
+		const ModelResource::Mesh& mesh = meshes.at(meshIndex);
+		// メッシュ用定数バッファ (サブセット全部で共有するので1回だけ積む)
 		CbMesh cbMesh;
 		::memset(&cbMesh, 0, sizeof(cbMesh));
 		if (mesh.nodeIndices.size() > 0)
@@ -220,31 +236,54 @@ void LambertShader::Draw(ID3D11DeviceContext* dc, const Model* model)
 		{
 			cbMesh.boneTransforms[0] = nodes.at(mesh.nodeIndex).worldTransform;
 		}
-		dc->UpdateSubresource(meshConstantBuffer.Get(), 0, 0, &cbMesh, 0, 0);
+		const uint32_t meshConstants = renderQueue.push_constants(meshConstantBuffer.Get(), 1, &cbMesh, sizeof(cbMesh));
 
-		UINT stride = sizeof(ModelResource::Vertex);
-		UINT offset = 0;
-		dc->IASetVertexBuffers(0, 1, mesh.vertexBuffer.GetAddressOf(), &stride, &offset);
-		dc->IASetIndexBuffer(mesh.indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-		dc->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		// ソートキーの深度 : バウンディングボックスの中心の正規化デバイス座標Z
+		DirectX::XMVECTOR center = DirectX::XMVectorScale(
+			DirectX::XMVectorAdd(DirectX::XMLoadFloat3(&mesh.boundsMin), DirectX::XMLoadFloat3(&mesh.boundsMax)), 0.5f);
+		center = DirectX::XMVector3Transform(center, DirectX::XMLoadFloat4x4(&nodes.at(mesh.nodeIndex).worldTransform));
+		const DirectX::XMVECTOR clip = DirectX::XMVector4Transform(DirectX::XMVectorSetW(center, 1.0f), VP);
+		const float w = DirectX::XMVectorGetW(clip);
+		const float depth = w > 0 ? DirectX::XMVectorGetZ(clip) / w : 0.0f;
 
 		for (const ModelResource::Subset& subset : mesh.subsets)
 		{
 			CbSubset cbSubset;
 			cbSubset.materialColor = subset.material->color;
-			dc->UpdateSubresource(subsetConstantBuffer.Get(), 0, 0, &cbSubset, 0, 0);
-			dc->PSSetShaderResources(0, 1, subset.material->shaderResourceView.GetAddressOf());
-			dc->PSSetSamplers(0, 1, samplerState.GetAddressOf());
-			dc->DrawIndexed(subset.indexCount, subset.startIndex, 0);
+
+			RenderQueue::DrawPacket packet;
+			packet.vertexShader = vertexShader.Get();
+			packet.pixelShader = pixelShader.Get();
+			packet.inputLayout = inputLayout.Get();
+			packet.blendState = blendState.Get();
+			packet.depthStencilState = depthStencilState.Get();
+			packet.rasterizerState = rasterizerState.Get();
+			packet.samplerState = samplerState.Get();
+			packet.shaderResourceView = subset.material->texture->view();
+			packet.vertexBuffer = mesh.vertexBuffer.Get();
+			packet.vertexStride = sizeof(ModelResource::Vertex);
+			packet.indexBuffer = mesh.indexBuffer.Get();
+			packet.constants[0] = meshConstants;
+			packet.constants[1] = renderQueue.push_constants(subsetConstantBuffer.Get(), 2, &cbSubset, sizeof(cbSubset));
+			packet.indexCount = subset.indexCount;
+			packet.startIndexLocation = subset.startIndex;
+
+			// 不透明はマテリアル・テクスチャ順 (同じ深度なら手前から)、半透明は後のパスで奥から
+			const bool translucent = cbSubset.materialColor.w < 1.0f;
+			packet.key = RenderQueue::make_key(translucent ? 1 : 0, shaderId, translucent ? 0 : renderQueue.id(subset.material),
+				translucent ? 0 : renderQueue.id(packet.shaderResourceView), translucent ? 1.0f - depth : depth);
+			renderQueue.push(packet);
 		}
 	}
 
 }
 
-// `I
+// 描画終了
 void LambertShader::End(ID3D11DeviceContext* dc)
 {
-	dc->VSSetShader(nullptr, nullptr, 0);
-	dc->PSSetShader(nullptr, nullptr, 0);
-	dc->IASetInputLayout(nullptr);
+	renderQueue.submit(*stateTracker);
+
+	stateTracker->set_vertex_shader(nullptr);
+	stateTracker->set_pixel_shader(nullptr);
+	stateTracker->set_input_layout(nullptr);
 }
@@ -3,11 +3,14 @@
 #include <memory>
 #include <wrl.h>
 #include "Graphics/Shader.h"
+#include "render_queue.h"
+#include "frustum_culler.h"
 
 class LambertShader : public Shader
 {
 public:
-	LambertShader(ID3D11Device* device);
+	// 'stateTracker' : 描画先コンテキストのステートトラッカー (Graphicsが持つ)
+	LambertShader(ID3D11Device* device, StateTracker* stateTracker);
 	~LambertShader() override {}
 
 	void Begin(ID3D11DeviceContext* dc, const RenderContext& rc) override;
@@ -47,4 +50,15 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilState>	depthStencilState;
 
 	Microsoft::WRL::ComPtr<ID3D11SamplerState>		samplerState;
+
+	// DrawでサブセットをパケットにしてEndでソートして描画する
+	StateTracker*									stateTracker;
+	RenderQueue										renderQueue;
+	DirectX::XMFLOAT4X4								viewProjection;
+	DirectX::XMFLOAT3								cameraPosition;
+
+	// Drawで使うカリングの作業領域 (rigidMeshesはカリングに渡したメッシュの番号)
+	FrustumCuller									frustumCuller;
+	std::vector<uint32_t>							rigidMeshes;
+	std::vector<uint32_t>							visibleMeshes;
 };
@@ -6,28 +6,28 @@
 LineRenderer::LineRenderer(ID3D11Device* device, UINT vertexCount)
 	: capacity(vertexCount)
 {
-	// _VF[_[
+	// 頂点シェーダー
 	{
-		// t@CJ
+		// ファイルを開く
 		FILE* fp = nullptr;
 		fopen_s(&fp, "Shader\\LineVS.cso", "rb");
 		_ASSERT_EXPR_A(fp, "CSO File not found");
 
-		// t@C̃TCY߂
+		// ファイルのサイズを求める
 		fseek(fp, 0, SEEK_END);
 		long csoSize = ftell(fp);
 		fseek(fp, 0, SEEK_SET);
 
-		// ɒ_VF[_[f[^i[̈pӂ
+		// メモリ上に頂点シェーダーデータを格納する領域を用意する
 		std::unique_ptr<u_char[]> csoData = std::make_unique<u_char[]>(csoSize);
 		fread(csoData.get(), csoSize, 1, fp);
 		fclose(fp);
 
-		// _VF[_[
+		// 頂点シェーダー生成
 		HRESULT hr = device->CreateVertexShader(csoData.get(), csoSize, nullptr, vertexShader.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 
-		// ̓CAEg
+		// 入力レイアウト
 		D3D11_INPUT_ELEMENT_DESC inputElementDesc[] =
 		{
 			{ "POSITION",	0, DXGI_FORMAT_R32G32B32_FLOAT,		0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
@@ -37,32 +37,32 @@ LineRenderer::LineRenderer(ID3D11Device* device, UINT vertexCount)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// sNZVF[_[
+	// ピクセルシェーダー
 	{
-		// t@CJ
+		// ファイルを開く
 		FILE* fp = nullptr;
 		fopen_s(&fp, "Shader\\LinePS.cso", "rb");
 		_ASSERT_EXPR_A(fp, "CSO File not found");
 
-		// t@C̃TCY߂
+		// ファイルのサイズを求める
 		fseek(fp, 0, SEEK_END);
 		long csoSize = ftell(fp);
 		fseek(fp, 0, SEEK_SET);
 
-		// ɒ_VF[_[f[^i[̈pӂ
+		// メモリ上に頂点シェーダーデータを格納する領域を用意する
 		std::unique_ptr<u_char[]> csoData = std::make_unique<u_char[]>(csoSize);
 		fread(csoData.get(), csoSize, 1, fp);
 		fclose(fp);
 
 
-		// sNZVF[_[
+		// ピクセルシェーダー生成
 		HRESULT hr = device->CreatePixelShader(csoData.get(), csoSize, nullptr, pixelShader.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// 萔obt@
+	// 定数バッファ
 	{
-		// V[pobt@
+		// シーン用バッファ
 		D3D11_BUFFER_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
 		desc.Usage = D3D11_USAGE_DEFAULT;
@@ -76,7 +76,7 @@ LineRenderer::LineRenderer(ID3D11Device* device, UINT vertexCount)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// uhXe[g
+	// ブレンドステート
 	{
 		D3D11_BLEND_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -95,7 +95,7 @@ LineRenderer::LineRenderer(ID3D11Device* device, UINT vertexCount)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// [xXeVXe[g
+	// 深度ステンシルステート
 	{
 		D3D11_DEPTH_STENCIL_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -107,7 +107,7 @@ LineRenderer::LineRenderer(ID3D11Device* device, UINT vertexCount)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// X^CU[Xe[g
+	// ラスタライザーステート
 	{
 		D3D11_RASTERIZER_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -126,7 +126,7 @@ LineRenderer::LineRenderer(ID3D11Device* device, UINT vertexCount)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// _obt@
+	// 頂点バッファ
 	{
 		D3D11_BUFFER_DESC desc;
 		desc.ByteWidth = sizeof(Vertex) * vertexCount;
@@ -141,31 +141,31 @@ LineRenderer::LineRenderer(ID3D11Device* device, UINT vertexCount)
 	}
 }
 
-// `Jn
+// 描画開始
 void LineRenderer::Render(ID3D11DeviceContext* context, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection)
 {
-	// VF[_[ݒ
+	// シェーダー設定
 	context->VSSetShader(vertexShader.Get(), nullptr, 0);
 	context->PSSetShader(pixelShader.Get(), nullptr, 0);
 	context->IASetInputLayout(inputLayout.Get());
 
-	// 萔obt@ݒ
+	// 定数バッファ設定
 	context->VSSetConstantBuffers(0, 1, constantBuffer.GetAddressOf());
 	//context->PSSetConstantBuffers(0, 1, constantBuffer.GetAddressOf());
 
-	// _[Xe[gݒ
+	// レンダーステート設定
 	const float blendFactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
 	context->OMSetBlendState(blendState.Get(), blendFactor, 0xFFFFFFFF);
 	context->OMSetDepthStencilState(depthStencilState.Get(), 0);
 	context->RSSetState(rasterizerState.Get());
 
-	// v~eBuݒ
+	// プリミティブ設定
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
 	context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
 
-	// 萔obt@XV
+	// 定数バッファ更新
 	DirectX::XMMATRIX V = DirectX::XMLoadFloat4x4(&view);
 	DirectX::XMMATRIX P = DirectX::XMLoadFloat4x4(&projection);
 	DirectX::XMMATRIX VP = V * P;
@@ -173,7 +173,7 @@ void LineRenderer::Render(ID3D11DeviceContext* context, const DirectX::XMFLOAT4X
 	DirectX::XMStoreFloat4x4(&data.wvp, VP);
 	context->UpdateSubresource(constantBuffer.Get(), 0, 0, &data, 0, 0);
 
-	// `
+	// 描画
 	UINT totalVertexCount = static_cast<UINT>(vertices.size());
 	UINT start = 0;
 	UINT count = (totalVertexCount < capacity) ? totalVertexCount : capacity;
@@ -199,7 +199,7 @@ void LineRenderer::Render(ID3D11DeviceContext* context, const DirectX::XMFLOAT4X
 	vertices.clear();
 }
 
-// _ǉ
+// 頂点追加
 void LineRenderer::AddVertex(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT4& color)
 {
 	Vertex v;
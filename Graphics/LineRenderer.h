@@ -12,10 +12,10 @@ public:
 	~LineRenderer() {}
 
 public:
-	// `s
+	// 描画実行
 	void Render(ID3D11DeviceContext* context, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection);
 
-	// _ǉ
+	// 頂点追加
 	void AddVertex(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT4& color);
 
 private:
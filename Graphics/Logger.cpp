@@ -0,0 +1,16 @@
+#include <windows.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include "Logger.h"
+
+// ログ出力
+void Logger::Print(const char* format, ...)
+{
+	char message[1024];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message, sizeof(message), format, args);
+	va_end(args);
+
+	::OutputDebugStringA(message);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// ログ出力 (Visual Studioの出力ウィンドウ)
+class Logger
+{
+public:
+	// printfと同じ書式で出力する
+	static void Print(const char* format, ...);
+};
+
+#if defined(_DEBUG)
+#define	LOG(...)	{ Logger::Print(__VA_ARGS__); }
+#else
+#define	LOG(...)	{}
+#endif
@@ -5,37 +5,97 @@
 #include <DirectXMath.h>
 #include "Graphics/ModelResource.h"
 
-// f
+// モデル
+// ノードは親が子より前に並ぶ配列で、親子関係はインデックスで持つ。
+// UpdateTransformは変更されたノードとその子孫だけ行列を計算し直し、変更のないサブツリーは飛ばす。
 class Model
 {
 public:
 	Model(const char* filename);
+	// 読み込み済みのリソースから (ResourceManager::LoadModelResourceAsyncのハンドルがreadyになった後など)
+	Model(std::shared_ptr<ModelResource> modelResource);
 	~Model() {}
 
 	struct Node
 	{
 		const char*			name;
-		Node*				parent;
+		int					parentIndex;		// ルートは-1
 		DirectX::XMFLOAT3	scale;
 		DirectX::XMFLOAT4	rotate;
 		DirectX::XMFLOAT3	translate;
 		DirectX::XMFLOAT4X4	localTransform;
+		DirectX::XMFLOAT4X4	modelTransform;		// ルートの行列を掛ける前
 		DirectX::XMFLOAT4X4	worldTransform;
-
-		std::vector<Node*>	children;
 	};
 
-	// svZ
+	// 行列計算
 	void UpdateTransform(const DirectX::XMFLOAT4X4& transform);
 
-	// m[hXg擾
+	// ノードの姿勢設定（次のUpdateTransformで子孫ごと計算し直す）
+	void SetNodeTransform(int nodeIndex, const DirectX::XMFLOAT3& scale, const DirectX::XMFLOAT4& rotate, const DirectX::XMFLOAT3& translate);
+	// GetNodes()で直接書き換えたノードを再計算対象にする
+	void SetNodeDirty(int nodeIndex);
+	void SetAllDirty();
+
+	// ノードリスト取得（書き換えたらSetNodeDirtyを呼ぶこと）
 	const std::vector<Node>& GetNodes() const { return nodes; }
 	std::vector<Node>& GetNodes() { return nodes; }
 
-	// \[X擾
+	// 直前のUpdateTransformでローカル行列・モデル行列を計算し直したノード数
+	int GetRecomputedNodeCount() const { return recomputedNodeCount; }
+	// 直前のUpdateTransformでワールド行列を書き換えたノード数（ルートの行列が変わった時は全ノード）
+	int GetRetransformedNodeCount() const { return retransformedNodeCount; }
+
+	// リソース取得
 	const ModelResource* GetResource() const { return resource.get(); }
 
+	// アニメーション再生（blendSecondsかけて今の姿勢から切り替える）
+	void PlayAnimation(int index, bool loop, float blendSeconds = 0.2f);
+	// アニメーション更新
+	// ノードの姿勢を書き換えるだけなので、このあとUpdateTransformを1回呼ぶこと。毎フレームのメモリ確保はない
+	void UpdateAnimation(float elapsedTime);
+	// アニメーション再生中か
+	bool IsPlayAnimation() const;
+	int GetCurrentAnimationIndex() const { return currentAnimationIndex; }
+	float GetCurrentAnimationSeconds() const { return currentAnimationSeconds; }
+
+	// filenameの全アニメーションをframesフレームずつ再生し、1フレームあたりの時間を出力ウィンドウに出す
+	static void BenchmarkAnimation(const char* filename, int frames = 600);
+	// UpdateTransformの1フレームあたりの時間と再計算したノード数を出力ウィンドウに出す
+	// (全ノード再計算・ルートだけ移動・末端のノード1つだけ変更)
+	static void BenchmarkTransform(const char* filename, int frames = 10000);
+
 private:
+	// secondsを含むキーフレーム区間 [index, index + 1] の先頭
+	// 前回の区間かその次なら二分探索しない（通常の再生）
+	int FindKeyframe(const ModelResource::Animation& animation, float seconds);
+
+	enum DirtyFlag : uint8_t
+	{
+		DirtyLocal		= 1 << 0,	// ノード自身の姿勢が変わった
+		DirtySubtree	= 1 << 1,	// 自身か子孫のどれかにDirtyLocalがある
+	};
+
 	std::shared_ptr<ModelResource>	resource;
 	std::vector<Node>				nodes;
+
+	// 階層の走査用（ノードと同じ並び）
+	std::vector<int>				parentIndices;
+	std::vector<int>				subtreeEnds;		// サブツリーが連続していればその終端、でなければ自身+1
+	std::vector<uint8_t>			dirtyFlags;
+	std::vector<uint8_t>			modelChanged;		// このUpdateTransformでモデル行列が変わった
+	DirectX::XMFLOAT4X4				rootTransform = {};
+	bool							rootTransformValid = false;
+	int								recomputedNodeCount = 0;
+	int								retransformedNodeCount = 0;
+
+	// アニメーション
+	int								currentAnimationIndex = -1;
+	float							currentAnimationSeconds = 0.0f;
+	bool							animationLoopFlag = false;
+	bool							animationEndFlag = false;
+	int								keyframeCursor = 0;
+	float							animationBlendTime = 0.0f;
+	float							animationBlendSecondsLength = 0.0f;
+	std::vector<ModelResource::NodeKeyData>	blendSourceKeys;	// 切り替えた時の姿勢（ノードと同じ並び）
 };
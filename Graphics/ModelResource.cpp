@@ -5,16 +5,12 @@
 #include <cereal/archives/binary.hpp>
 #include <cereal/types/string.hpp>
 #include <cereal/types/vector.hpp>
-#include <WICTextureLoader.h>
-
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
 
 #include "Misc.h"
 #include "Logger.h"
 #include "Graphics/ModelResource.h"
 
-// CEREALo[W`
+// CEREALバージョン定義
 CEREAL_CLASS_VERSION(ModelResource::Node, 1)
 CEREAL_CLASS_VERSION(ModelResource::Material, 1)
 CEREAL_CLASS_VERSION(ModelResource::Subset, 1)
@@ -25,7 +21,7 @@ CEREAL_CLASS_VERSION(ModelResource::Keyframe, 1)
 CEREAL_CLASS_VERSION(ModelResource::Animation, 1)
 CEREAL_CLASS_VERSION(ModelResource, 1)
 
-// VACY
+// シリアライズ
 namespace DirectX
 {
 	template<class Archive>
@@ -173,159 +169,199 @@ void ModelResource::Animation::serialize(Archive& archive, int version)
 	);
 }
 
-// ǂݍ
+// 読み込み
 void ModelResource::Load(ID3D11Device* device, const char* filename)
 {
-	// fBNgpX擾
+	// ディレクトリパス取得
 	char drive[32], dir[256], dirname[256];
 	::_splitpath_s(filename, drive, sizeof(drive), dir, sizeof(dir), nullptr, 0, nullptr, 0);
 	::_makepath_s(dirname, sizeof(dirname), drive, dir, nullptr, nullptr);
 
-	// fVACY
+	// デシリアライズ
 	Deserialize(filename);
 
-	// f\z
+	// モデル構築
 	BuildModel(device, dirname);
 }
 
-// f\z
-void ModelResource::BuildModel(ID3D11Device* device, const char* dirname)
+// 非同期読み込み
+AsyncHandle<ModelResource> ModelResource::LoadAsync(AsyncLoader& loader, ID3D11Device* device, const char* filename,
+	std::function<void(const std::shared_ptr<ModelResource>&)> onBuilt)
 {
-	for (Material& material : materials)
+	std::string path = filename;
+	return loader.load<ModelResource>([device, path, onBuilt](AsyncLoader::FinalizeSteps& finalizeSteps)
 	{
-		// ΃pX̉
-		char filename[256];
-		::_makepath_s(filename, 256, nullptr, dirname, material.textureFilename.c_str(), nullptr);
-
-		// }`oCg烏Ch֕ϊ
-		wchar_t wfilename[256];
-		::MultiByteToWideChar(CP_ACP, 0, filename, -1, wfilename, 256);
-
-		// eNX`ǂݍ
-		Microsoft::WRL::ComPtr<ID3D11Resource> resource;
-		HRESULT hr = DirectX::CreateWICTextureFromFile(device, wfilename, resource.GetAddressOf(), material.shaderResourceView.GetAddressOf());
-		if (FAILED(hr))
+		// ディレクトリパス取得
+		char drive[32], dir[256], dirname[256];
+		::_splitpath_s(path.c_str(), drive, sizeof(drive), dir, sizeof(dir), nullptr, 0, nullptr, 0);
+		::_makepath_s(dirname, sizeof(dirname), drive, dir, nullptr, nullptr);
+
+		// デシリアライズ（ワーカースレッド）
+		std::shared_ptr<ModelResource> resource = std::make_shared<ModelResource>();
+		if (!resource->Deserialize(path.c_str()))
+		{
+			return std::shared_ptr<ModelResource>();
+		}
+
+		// モデル構築（メインスレッド）
+		std::string directory = dirname;
+		for (size_t materialIndex = 0; materialIndex < resource->materials.size(); ++materialIndex)
 		{
-			// WICŃT|[gĂȂtH[}bg̏ꍇiTGAȂǁj
-			// STBŉ摜ǂݍ݂ăeNX`𐶐
-			int width, height, bpp;
-			unsigned char* pixels = stbi_load(filename, &width, &height, &bpp, STBI_rgb_alpha);
-			if (pixels != nullptr)
+			finalizeSteps.push_back([device, resource, directory, materialIndex]()
 			{
-				D3D11_TEXTURE2D_DESC desc = { 0 };
-				desc.Width = width;
-				desc.Height = height;
-				desc.MipLevels = 1;
-				desc.ArraySize = 1;
-				desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-				desc.SampleDesc.Count = 1;
-				desc.SampleDesc.Quality = 0;
-				desc.Usage = D3D11_USAGE_DEFAULT;
-				desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-				desc.CPUAccessFlags = 0;
-				desc.MiscFlags = 0;
-				D3D11_SUBRESOURCE_DATA data;
-				::memset(&data, 0, sizeof(data));
-				data.pSysMem = pixels;
-				data.SysMemPitch = width * 4;
-
-				Microsoft::WRL::ComPtr<ID3D11Texture2D>	texture;
-				HRESULT hr = device->CreateTexture2D(&desc, &data, texture.GetAddressOf());
-				_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
-
-				hr = device->CreateShaderResourceView(texture.Get(), nullptr, material.shaderResourceView.GetAddressOf());
-				_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
-
-				// n
-				stbi_image_free(pixels);
-			}
-			else
+				resource->BuildMaterial(device, directory.c_str(), resource->materials.at(materialIndex));
+			});
+		}
+		for (size_t meshIndex = 0; meshIndex < resource->meshes.size(); ++meshIndex)
+		{
+			finalizeSteps.push_back([device, resource, meshIndex]()
 			{
-				// ǂݍݎs_~[eNX`
-				LOG("load failed : %s\n", filename);
-
-				const int width = 8;
-				const int height = 8;
-				UINT pixels[width * height];
-				::memset(pixels, 0xFF, sizeof(pixels));
-
-				D3D11_TEXTURE2D_DESC desc = { 0 };
-				desc.Width = width;
-				desc.Height = height;
-				desc.MipLevels = 1;
-				desc.ArraySize = 1;
-				desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-				desc.SampleDesc.Count = 1;
-				desc.SampleDesc.Quality = 0;
-				desc.Usage = D3D11_USAGE_DEFAULT;
-				desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-				desc.CPUAccessFlags = 0;
-				desc.MiscFlags = 0;
-				D3D11_SUBRESOURCE_DATA data;
-				::memset(&data, 0, sizeof(data));
-				data.pSysMem = pixels;
-				data.SysMemPitch = width;
-
-				Microsoft::WRL::ComPtr<ID3D11Texture2D>	texture;
-				HRESULT hr = device->CreateTexture2D(&desc, &data, texture.GetAddressOf());
-				_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
-
-				hr = device->CreateShaderResourceView(texture.Get(), nullptr, material.shaderResourceView.GetAddressOf());
-				_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
-			}
+				resource->BuildMesh(device, resource->meshes.at(meshIndex));
+			});
 		}
-	}
-
-	for (Mesh& mesh : meshes)
-	{
-		// TuZbg
-		for (Subset& subset : mesh.subsets)
+		if (onBuilt)
 		{
-			subset.material = &materials.at(subset.materialIndex);
+			finalizeSteps.push_back([resource, onBuilt]()
+			{
+				onBuilt(resource);
+			});
 		}
+		return resource;
+	});
+}
 
-		// _obt@
+// CPU側のメモリ使用量取得
+size_t ModelResource::GetCpuMemorySize() const
+{
+	size_t size = sizeof(ModelResource);
+	size += nodes.capacity() * sizeof(Node);
+	for (const Node& node : nodes)
+	{
+		size += node.name.capacity() + node.path.capacity();
+	}
+	size += materials.capacity() * sizeof(Material);
+	for (const Mesh& mesh : meshes)
+	{
+		size += sizeof(Mesh);
+		size += mesh.vertices.capacity() * sizeof(Vertex);
+		size += mesh.indices.capacity() * sizeof(UINT);
+		size += mesh.subsets.capacity() * sizeof(Subset);
+		size += mesh.nodeIndices.capacity() * sizeof(int);
+		size += mesh.offsetTransforms.capacity() * sizeof(DirectX::XMFLOAT4X4);
+	}
+	for (const Animation& animation : animations)
+	{
+		size += sizeof(Animation);
+		for (const Keyframe& keyframe : animation.keyframes)
 		{
-			D3D11_BUFFER_DESC bufferDesc = {};
-			D3D11_SUBRESOURCE_DATA subresourceData = {};
-
-			bufferDesc.ByteWidth = static_cast<UINT>(sizeof(Vertex) * mesh.vertices.size());
-			//bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-			bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-			bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-			bufferDesc.CPUAccessFlags = 0;
-			bufferDesc.MiscFlags = 0;
-			bufferDesc.StructureByteStride = 0;
-			subresourceData.pSysMem = mesh.vertices.data();
-			subresourceData.SysMemPitch = 0;
-			subresourceData.SysMemSlicePitch = 0;
-
-			HRESULT hr = device->CreateBuffer(&bufferDesc, &subresourceData, mesh.vertexBuffer.GetAddressOf());
-			_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
+			size += sizeof(Keyframe) + keyframe.nodeKeys.capacity() * sizeof(NodeKeyData);
 		}
+	}
+	return size;
+}
+
+// GPU側のメモリ使用量取得
+size_t ModelResource::GetGpuMemorySize() const
+{
+	size_t size = 0;
 
-		// CfbNXobt@
+	// 頂点・インデックスバッファ
+	for (const Mesh& mesh : meshes)
+	{
+		for (ID3D11Buffer* buffer : { mesh.vertexBuffer.Get(), mesh.indexBuffer.Get() })
 		{
-			D3D11_BUFFER_DESC bufferDesc = {};
-			D3D11_SUBRESOURCE_DATA subresourceData = {};
-
-			bufferDesc.ByteWidth = static_cast<UINT>(sizeof(u_int) * mesh.indices.size());
-			//bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-			bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-			bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-			bufferDesc.CPUAccessFlags = 0;
-			bufferDesc.MiscFlags = 0;
-			bufferDesc.StructureByteStride = 0;
-			subresourceData.pSysMem = mesh.indices.data();
-			subresourceData.SysMemPitch = 0; //Not use for index buffers.
-			subresourceData.SysMemSlicePitch = 0; //Not use for index buffers.
-			HRESULT hr = device->CreateBuffer(&bufferDesc, &subresourceData, mesh.indexBuffer.GetAddressOf());
-			_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
+			if (buffer != nullptr)
+			{
+				D3D11_BUFFER_DESC desc;
+				buffer->GetDesc(&desc);
+				size += desc.ByteWidth;
+			}
 		}
 	}
+
+	return size;
 }
 
-// VACY
+// モデル構築
+void ModelResource::BuildModel(ID3D11Device* device, const char* dirname)
+{
+	for (Material& material : materials)
+	{
+		BuildMaterial(device, dirname, material);
+	}
+
+	for (Mesh& mesh : meshes)
+	{
+		BuildMesh(device, mesh);
+	}
+}
+
+// マテリアルセットアップ
+void ModelResource::BuildMaterial(ID3D11Device* device, const char* dirname, Material& material)
+{
+	// 相対パスの解決
+	char filename[256];
+	::_makepath_s(filename, 256, nullptr, dirname, material.textureFilename.c_str(), nullptr);
+
+	// マルチバイト文字からワイド文字へ変換
+	wchar_t wfilename[256];
+	::MultiByteToWideChar(CP_ACP, 0, filename, -1, wfilename, 256);
+
+	// テクスチャキャッシュで非同期に読み込む。読み込みが終わるまでは白いテクスチャが表示される
+	// WICで読めない形式 (TGAなど) はキャッシュのワーカースレッドがstb_imageで読み込む
+	material.texture = request_texture(device, wfilename);
+}
+
+// メッシュセットアップ
+void ModelResource::BuildMesh(ID3D11Device* device, Mesh& mesh)
+{
+	// サブセット
+	for (Subset& subset : mesh.subsets)
+	{
+		subset.material = &materials.at(subset.materialIndex);
+	}
+
+	// 頂点バッファ
+	{
+		D3D11_BUFFER_DESC bufferDesc = {};
+		D3D11_SUBRESOURCE_DATA subresourceData = {};
+
+		bufferDesc.ByteWidth = static_cast<UINT>(sizeof(Vertex) * mesh.vertices.size());
+		//bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		bufferDesc.CPUAccessFlags = 0;
+		bufferDesc.MiscFlags = 0;
+		bufferDesc.StructureByteStride = 0;
+		subresourceData.pSysMem = mesh.vertices.data();
+		subresourceData.SysMemPitch = 0;
+		subresourceData.SysMemSlicePitch = 0;
+
+		HRESULT hr = device->CreateBuffer(&bufferDesc, &subresourceData, mesh.vertexBuffer.GetAddressOf());
+		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
+	}
+
+	// インデックスバッファ
+	{
+		D3D11_BUFFER_DESC bufferDesc = {};
+		D3D11_SUBRESOURCE_DATA subresourceData = {};
+
+		bufferDesc.ByteWidth = static_cast<UINT>(sizeof(u_int) * mesh.indices.size());
+		//bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		bufferDesc.CPUAccessFlags = 0;
+		bufferDesc.MiscFlags = 0;
+		bufferDesc.StructureByteStride = 0;
+		subresourceData.pSysMem = mesh.indices.data();
+		subresourceData.SysMemPitch = 0; //Not use for index buffers.
+		subresourceData.SysMemSlicePitch = 0; //Not use for index buffers.
+		HRESULT hr = device->CreateBuffer(&bufferDesc, &subresourceData, mesh.indexBuffer.GetAddressOf());
+		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
+	}
+}
+
+// シリアライズ
 void ModelResource::Serialize(const char* filename)
 {
 	std::ofstream ostream(filename, std::ios::binary);
@@ -350,8 +386,8 @@ void ModelResource::Serialize(const char* filename)
 	}
 }
 
-// fVACY
-void ModelResource::Deserialize(const char* filename)
+// デシリアライズ
+bool ModelResource::Deserialize(const char* filename)
 {
 	std::ifstream istream(filename, std::ios::binary);
 	if (istream.is_open())
@@ -370,7 +406,7 @@ void ModelResource::Deserialize(const char* filename)
 		catch (...)
 		{
 			LOG("model deserialize failed.\n%s\n", filename);
-			return;
+			return false;
 		}
 	}
 	else
@@ -378,10 +414,12 @@ void ModelResource::Deserialize(const char* filename)
 		char buffer[256];
 		sprintf_s(buffer, sizeof(buffer), "File not found > %s", filename);
 		_ASSERT_EXPR_A(false, buffer);
+		return false;
 	}
+	return true;
 }
 
-// m[hCfbNX擾
+// ノードインデックスを取得する
 int ModelResource::FindNodeIndex(NodeId nodeId) const
 {
 	int nodeCount = static_cast<int>(nodes.size());
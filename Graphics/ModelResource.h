@@ -2,9 +2,13 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <functional>
 #include <wrl.h>
 #include <d3d11.h>
 #include <DirectXMath.h>
+#include "async_loader.h"
+#include "texture.h"
 
 class ModelResource
 {
@@ -34,7 +38,7 @@ public:
 		std::string			textureFilename;
 		DirectX::XMFLOAT4	color = { 0.8f, 0.8f, 0.8f, 1.0f };
 
-		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResourceView;
+		std::shared_ptr<Texture>	texture;	// テクスチャキャッシュで共有、描画時はview()を使う
 
 		template<class Archive>
 		void serialize(Archive& archive, int version);
@@ -114,26 +118,45 @@ public:
 		void serialize(Archive& archive, int version);
 	};
 
-	// ef[^擾
+	// 各種データ取得
 	const std::vector<Mesh>& GetMeshes() const { return meshes; }
 	const std::vector<Node>& GetNodes() const { return nodes; }
 	const std::vector<Animation>& GetAnimations() const { return animations; }
 	const std::vector<Material>& GetMaterials() const { return materials; }
 
-	// ǂݍ
+	// 読み込み
 	void Load(ID3D11Device* device, const char* filename);
 
+	// メモリ使用量取得（バイト数）
+	// テクスチャはテクスチャキャッシュ側で計上するのでGPU側はバッファのみ
+	size_t GetCpuMemorySize() const;
+	size_t GetGpuMemorySize() const;
+
+	// 非同期読み込み
+	// デシリアライズはワーカースレッドで行い、バッファの生成とテクスチャの要求は
+	// AsyncLoader::finalize()からメインスレッドでマテリアル・メッシュ単位に行う
+	// onBuiltは全て構築し終えた時にメインスレッドで、ハンドルがreadyになる直前に呼ばれる
+	// キャッシュを通す場合はResourceManager::LoadModelResourceAsyncを使う
+	static AsyncHandle<ModelResource> LoadAsync(AsyncLoader& loader, ID3D11Device* device, const char* filename,
+		std::function<void(const std::shared_ptr<ModelResource>&)> onBuilt = nullptr);
+
 protected:
-	// fZbgAbv
+	// モデルセットアップ
 	void BuildModel(ID3D11Device* device, const char* dirname);
 
-	// VACY
+	// マテリアルセットアップ
+	void BuildMaterial(ID3D11Device* device, const char* dirname, Material& material);
+
+	// メッシュセットアップ
+	void BuildMesh(ID3D11Device* device, Mesh& mesh);
+
+	// シリアライズ
 	void Serialize(const char* filename);
 
-	// fVACY
-	void Deserialize(const char* filename);
+	// デシリアライズ
+	bool Deserialize(const char* filename);
 
-	// m[hCfbNX擾
+	// ノードインデックスを取得する
 	int FindNodeIndex(NodeId nodeId) const;
 
 protected:
@@ -2,7 +2,7 @@
 
 #include <DirectXMath.h>
 
-// _[ReLXg
+// レンダーコンテキスト
 struct RenderContext
 {
 	DirectX::XMFLOAT4X4		view;
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <vector>
+#include <imgui.h>
+#include "Graphics/Graphics.h"
+#include "Graphics/ResourceManager.h"
+
+// パスの正規化
+std::string ResourceManager::NormalizePath(const char* filename)
+{
+	// "./a/../b\c.mdl" と "B/C.mdl" を同じキーにする（Windowsのパスは大文字小文字を区別しない）
+	std::string path = std::filesystem::path(filename).lexically_normal().generic_string();
+	std::transform(path.begin(), path.end(), path.begin(),
+		[](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+	return path;
+}
+
+// モデルリソース読み込み
+std::shared_ptr<ModelResource> ResourceManager::LoadModelResource(const char* filename)
+{
+	const std::string key = NormalizePath(filename);
+
+	auto it = entries.find(key);
+	if (it != entries.end() && !it->second.resource && !it->second.load.failed())
+	{
+		// 非同期で読み込み中なので終わるまで待つ（finishの中で構築されてRegisterされる）
+		it->second.loader->finish();
+		it = entries.find(key);
+	}
+	if (it != entries.end() && !it->second.resource)
+	{
+		// 非同期読み込みに失敗していたので読み込み直す
+		entries.erase(it);
+		it = entries.end();
+	}
+	if (it != entries.end())
+	{
+		// 読み込み済み
+		++hitCount;
+		it->second.lastUsed = ++useCounter;
+		++it->second.requestCount;
+		return it->second.resource;
+	}
+
+	// 新規読み込み
+	++missCount;
+	std::shared_ptr<ModelResource> resource = std::make_shared<ModelResource>();
+	resource->Load(Graphics::Instance().GetDevice(), filename);
+
+	Entry& entry = entries[key];
+	entry.requestCount = 1;
+	Register(entry, resource);
+
+	return resource;
+}
+
+// モデルリソース非同期読み込み
+AsyncHandle<ModelResource> ResourceManager::LoadModelResourceAsync(AsyncLoader& loader, const char* filename)
+{
+	const std::string key = NormalizePath(filename);
+
+	auto it = entries.find(key);
+	if (it != entries.end() && !it->second.resource && it->second.load.failed())
+	{
+		// 前回の読み込みに失敗していたので読み込み直す
+		entries.erase(it);
+		it = entries.end();
+	}
+	if (it != entries.end())
+	{
+		// 読み込み済みか読み込み中
+		++hitCount;
+		it->second.lastUsed = ++useCounter;
+		++it->second.requestCount;
+		return it->second.resource ? AsyncLoader::loaded(it->second.resource) : it->second.load;
+	}
+
+	// 新規読み込み（構築し終えたらメインスレッドで登録する）
+	++missCount;
+	Entry& entry = entries[key];
+	entry.requestCount = 1;
+	entry.lastUsed = ++useCounter;
+	entry.loader = &loader;
+	entry.load = ModelResource::LoadAsync(loader, Graphics::Instance().GetDevice(), filename,
+		[this, key](const std::shared_ptr<ModelResource>& resource)
+		{
+			auto loading = entries.find(key);
+			if (loading != entries.end() && !loading->second.resource)
+			{
+				Register(loading->second, resource);
+			}
+		});
+	return entry.load;
+}
+
+// 読み込み終わったリソースの登録
+void ResourceManager::Register(Entry& entry, const std::shared_ptr<ModelResource>& resource)
+{
+	entry.resource = resource;
+	// マネージャーがハンドルを持ったままだと参照数に数えられてしまうので手放す
+	entry.load = {};
+	entry.loader = nullptr;
+	entry.cpuMemorySize = resource->GetCpuMemorySize();
+	entry.gpuMemorySize = resource->GetGpuMemorySize();
+	entry.lastUsed = ++useCounter;
+
+	cpuMemorySize += entry.cpuMemorySize;
+	gpuMemorySize += entry.gpuMemorySize;
+
+	// 予算を超えたら古いものから解放
+	Trim();
+}
+
+// 予算を超えている間、参照されていないリソースを古い順に解放する
+void ResourceManager::Trim()
+{
+	while (GetMemorySize() > budget)
+	{
+		// マネージャーだけが保持しているリソースのうち最も古いもの
+		auto oldest = entries.end();
+		for (auto it = entries.begin(); it != entries.end(); ++it)
+		{
+			// 読み込み中のものと使用中のものは解放しない
+			if (!it->second.resource || it->second.resource.use_count() > 1) continue;
+			if (oldest == entries.end() || it->second.lastUsed < oldest->second.lastUsed)
+			{
+				oldest = it;
+			}
+		}
+
+		// 全て使用中なら予算超過のままにする
+		if (oldest == entries.end()) break;
+
+		cpuMemorySize -= oldest->second.cpuMemorySize;
+		gpuMemorySize -= oldest->second.gpuMemorySize;
+		entries.erase(oldest);
+		++evictCount;
+	}
+}
+
+// 参照されていないリソースを全て解放する
+void ResourceManager::Clear()
+{
+	for (auto it = entries.begin(); it != entries.end(); )
+	{
+		if (!it->second.resource || it->second.resource.use_count() > 1)
+		{
+			++it;
+			continue;
+		}
+		cpuMemorySize -= it->second.cpuMemorySize;
+		gpuMemorySize -= it->second.gpuMemorySize;
+		it = entries.erase(it);
+		++evictCount;
+	}
+}
+
+// デバッグ用GUI描画
+void ResourceManager::DrawDebugGUI()
+{
+	const float MB = 1024.0f * 1024.0f;
+
+	// 予算
+	int budgetMB = static_cast<int>(budget / (1024 * 1024));
+	if (ImGui::SliderInt("Budget (MB)", &budgetMB, 1, 2048))
+	{
+		SetBudget(static_cast<size_t>(budgetMB) * 1024 * 1024);
+	}
+	ImGui::Text("Resident : %.2f MB (CPU %.2f MB / GPU %.2f MB)",
+		GetMemorySize() / MB, cpuMemorySize / MB, gpuMemorySize / MB);
+
+	// ヒット率
+	const UINT requestCount = hitCount + missCount;
+	ImGui::Text("Requests : %u  Hit : %u  Miss : %u  Hit rate : %.1f%%",
+		requestCount, hitCount, missCount, requestCount > 0 ? 100.0f * hitCount / requestCount : 0.0f);
+	ImGui::Text("Evicted : %u", evictCount);
+
+	if (ImGui::Button("Clear unused"))
+	{
+		Clear();
+	}
+
+	// リソース一覧（最近使われた順）
+	std::vector<const std::pair<const std::string, Entry>*> sorted;
+	for (const auto& pair : entries)
+	{
+		sorted.emplace_back(&pair);
+	}
+	std::sort(sorted.begin(), sorted.end(),
+		[](const auto* a, const auto* b) { return a->second.lastUsed > b->second.lastUsed; });
+
+	ImGui::Separator();
+	ImGui::Columns(5, "Resources");
+	ImGui::Text("Path"); ImGui::NextColumn();
+	ImGui::Text("Refs"); ImGui::NextColumn();
+	ImGui::Text("Requests"); ImGui::NextColumn();
+	ImGui::Text("CPU (KB)"); ImGui::NextColumn();
+	ImGui::Text("GPU (KB)"); ImGui::NextColumn();
+	ImGui::Separator();
+	for (const auto* pair : sorted)
+	{
+		const Entry& entry = pair->second;
+		ImGui::Text("%s", pair->first.c_str()); ImGui::NextColumn();
+		if (entry.resource)
+		{
+			// マネージャー自身の参照は除く
+			ImGui::Text("%ld", entry.resource.use_count() - 1); ImGui::NextColumn();
+		}
+		else
+		{
+			ImGui::Text(entry.load.failed() ? "failed" : "loading"); ImGui::NextColumn();
+		}
+		ImGui::Text("%u", entry.requestCount); ImGui::NextColumn();
+		ImGui::Text("%.1f", entry.cpuMemorySize / 1024.0f); ImGui::NextColumn();
+		ImGui::Text("%.1f", entry.gpuMemorySize / 1024.0f); ImGui::NextColumn();
+	}
+	ImGui::Columns(1);
+}
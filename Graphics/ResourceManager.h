@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "Graphics/ModelResource.h"
+
+// リソースマネージャー
+// 正規化したパスをキーにModelResourceを共有する。
+// どこからも参照されていないリソースはすぐには解放せず、使用量が予算を超えたときに
+// 最後に使われたのが古い順（LRU）で解放する。
+class ResourceManager
+{
+private:
+	ResourceManager() {}
+	~ResourceManager() {}
+
+public:
+	// 唯一のインスタンス取得
+	static ResourceManager& Instance()
+	{
+		static ResourceManager instance;
+		return instance;
+	}
+
+	// モデルリソース読み込み（読み込み済みなら共有）
+	// 非同期で読み込み中のものはAsyncLoader::finish()で読み込み終わるまで待つ
+	std::shared_ptr<ModelResource> LoadModelResource(const char* filename);
+
+	// モデルリソース非同期読み込み（読み込み済み・読み込み中なら共有）
+	// デシリアライズはloaderのワーカースレッドで行い、構築はloader.finalize()でメインスレッドが少しずつ行う
+	// 同じファイルを読み込み中に要求すると同じ読み込みを指すハンドルを返す
+	AsyncHandle<ModelResource> LoadModelResourceAsync(AsyncLoader& loader, const char* filename);
+
+	// 予算設定（CPU+GPUのバイト数）
+	void SetBudget(size_t bytes) { budget = bytes; Trim(); }
+
+	// 予算取得
+	size_t GetBudget() const { return budget; }
+
+	// 使用量取得
+	size_t GetMemorySize() const { return cpuMemorySize + gpuMemorySize; }
+
+	// 予算を超えている間、参照されていないリソースを古い順に解放する
+	void Trim();
+
+	// 参照されていないリソースを全て解放する
+	void Clear();
+
+	// デバッグ用GUI描画 (ウィンドウは作らないので、呼び出し側のImGuiのウィンドウやツリーの中で呼ぶ)
+	void DrawDebugGUI();
+
+private:
+	// パスの正規化（区切り文字と大文字小文字の違いを吸収する）
+	static std::string NormalizePath(const char* filename);
+
+	struct Entry
+	{
+		std::shared_ptr<ModelResource>	resource;			// 読み込み中はnull
+		AsyncHandle<ModelResource>		load;				// 読み込み中だけ有効
+		AsyncLoader*					loader = nullptr;	// 読み込み中だけ有効
+		size_t							cpuMemorySize = 0;
+		size_t							gpuMemorySize = 0;
+		UINT64							lastUsed = 0;	// 最後に要求された時のuseCounter
+		UINT							requestCount = 0;
+	};
+
+	// 読み込み終わったリソースを登録してメモリ使用量に計上する
+	void Register(Entry& entry, const std::shared_ptr<ModelResource>& resource);
+
+	std::unordered_map<std::string, Entry>	entries;
+
+	size_t	budget = 256 * 1024 * 1024;
+	size_t	cpuMemorySize = 0;
+	size_t	gpuMemorySize = 0;
+	UINT64	useCounter = 0;
+
+	// 統計
+	UINT	hitCount = 0;
+	UINT	missCount = 0;
+	UINT	evictCount = 0;
+};
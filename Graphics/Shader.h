@@ -12,12 +12,12 @@ public:
 	Shader() {}
 	virtual ~Shader() {}
 
-	// `Jn
+	// 描画開始
 	virtual void Begin(ID3D11DeviceContext* dc, const RenderContext& rc) = 0;
 
-	// `
+	// 描画
 	virtual void Draw(ID3D11DeviceContext* dc, const Model* model) = 0;
 
-	// `I
+	// 描画終了
 	virtual void End(ID3D11DeviceContext* context) = 0;
 };
@@ -4,20 +4,20 @@
 #include "Misc.h"
 #include "Graphics/Graphics.h"
 
-// RXgN^
+// コンストラクタ
 Sprite::Sprite()
 	: Sprite(nullptr)
 {
 }
 
-// RXgN^
+// コンストラクタ
 Sprite::Sprite(const char* filename)
 {
 	ID3D11Device* device = Graphics::Instance().GetDevice();
 
 	HRESULT hr = S_OK;
 
-	// _f[^̒`
+	// 頂点データの定義
 	// 0           1
 	// +-----------+
 	// |           |
@@ -31,51 +31,51 @@ Sprite::Sprite(const char* filename)
 		{ DirectX::XMFLOAT3(+0.5, -0.5, 0), DirectX::XMFLOAT4(0, 0, 1, 1) },
 	};
 
-	// |S`悷ɂGPUɒ_f[^VF[_[Ȃǂ̃f[^nKvB
-	// GPUɃf[^nɂID3D11***̃IuWFNgăf[^n܂B
+	// ポリゴンを描画するにはGPUに頂点データやシェーダーなどのデータを渡す必要がある。
+	// GPUにデータを渡すにはID3D11***のオブジェクトを介してデータを渡します。
 
-	// _obt@̐
+	// 頂点バッファの生成
 	{
-		// _obt@쐬邽߂̐ݒIvV
+		// 頂点バッファを作成するための設定オプション
 		D3D11_BUFFER_DESC buffer_desc = {};
-		buffer_desc.ByteWidth = sizeof(vertices);	// obt@if[^i[ꕨj̃TCY
+		buffer_desc.ByteWidth = sizeof(vertices);	// バッファ（データを格納する入れ物）のサイズ
 		buffer_desc.Usage = D3D11_USAGE_DYNAMIC;	// UNIT.03
-		buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;	// _obt@Ƃăobt@쐬B
+		buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;	// 頂点バッファとしてバッファを作成する。
 		buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;	// UNIT.03
 		buffer_desc.MiscFlags = 0;
 		buffer_desc.StructureByteStride = 0;
-		// _obt@ɒ_f[^邽߂̐ݒ
+		// 頂点バッファに頂点データを入れるための設定
 		D3D11_SUBRESOURCE_DATA subresource_data = {};
-		subresource_data.pSysMem = vertices;	// Ɋi[_f[^̃AhXnƂCreateBuffer()Ƀf[^邱ƂłB
+		subresource_data.pSysMem = vertices;	// ここに格納したい頂点データのアドレスを渡すことでCreateBuffer()時にデータを入れることができる。
 		subresource_data.SysMemPitch = 0; //Not use for vertex buffers.
 		subresource_data.SysMemSlicePitch = 0; //Not use for vertex buffers.
-		// _obt@IuWFNg̐
+		// 頂点バッファオブジェクトの生成
 		hr = device->CreateBuffer(&buffer_desc, &subresource_data, &vertexBuffer);
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// _VF[_[
+	// 頂点シェーダー
 	{
-		// t@CJ
+		// ファイルを開く
 		FILE* fp = nullptr;
 		fopen_s(&fp, "Shader\\SpriteVS.cso", "rb");
 		_ASSERT_EXPR_A(fp, "CSO File not found");
 
-		// t@C̃TCY߂
+		// ファイルのサイズを求める
 		fseek(fp, 0, SEEK_END);
 		long csoSize = ftell(fp);
 		fseek(fp, 0, SEEK_SET);
 
-		// ɒ_VF[_[f[^i[̈pӂ
+		// メモリ上に頂点シェーダーデータを格納する領域を用意する
 		std::unique_ptr<u_char[]> csoData = std::make_unique<u_char[]>(csoSize);
 		fread(csoData.get(), csoSize, 1, fp);
 		fclose(fp);
 
-		// _VF[_[
+		// 頂点シェーダー生成
 		HRESULT hr = device->CreateVertexShader(csoData.get(), csoSize, nullptr, vertexShader.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 
-		// ̓CAEg
+		// 入力レイアウト
 		D3D11_INPUT_ELEMENT_DESC inputElementDesc[] =
 		{
 			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
@@ -86,29 +86,29 @@ Sprite::Sprite(const char* filename)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// sNZVF[_[
+	// ピクセルシェーダー
 	{
-		// t@CJ
+		// ファイルを開く
 		FILE* fp = nullptr;
 		fopen_s(&fp, "Shader\\SpritePS.cso", "rb");
 		_ASSERT_EXPR_A(fp, "CSO File not found");
 
-		// t@C̃TCY߂
+		// ファイルのサイズを求める
 		fseek(fp, 0, SEEK_END);
 		long csoSize = ftell(fp);
 		fseek(fp, 0, SEEK_SET);
 
-		// ɒ_VF[_[f[^i[̈pӂ
+		// メモリ上に頂点シェーダーデータを格納する領域を用意する
 		std::unique_ptr<u_char[]> csoData = std::make_unique<u_char[]>(csoSize);
 		fread(csoData.get(), csoSize, 1, fp);
 		fclose(fp);
 
-		// sNZVF[_[
+		// ピクセルシェーダー生成
 		HRESULT hr = device->CreatePixelShader(csoData.get(), csoSize, nullptr, pixelShader.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// uhXe[g
+	// ブレンドステート
 	{
 		D3D11_BLEND_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -127,7 +127,7 @@ Sprite::Sprite(const char* filename)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// [xXeVXe[g
+	// 深度ステンシルステート
 	{
 		D3D11_DEPTH_STENCIL_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -139,7 +139,7 @@ Sprite::Sprite(const char* filename)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// X^CU[Xe[g
+	// ラスタライザーステート
 	{
 		D3D11_RASTERIZER_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -158,7 +158,7 @@ Sprite::Sprite(const char* filename)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// TvXe[g
+	// サンプラステート
 	{
 		D3D11_SAMPLER_DESC desc;
 		::memset(&desc, 0, sizeof(desc));
@@ -180,20 +180,20 @@ Sprite::Sprite(const char* filename)
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 	}
 
-	// eNX`̐
+	// テクスチャの生成
 	if (filename != nullptr)
 	{
-		// }`oCg烏Ch֕ϊ
+		// マルチバイト文字からワイド文字へ変換
 		wchar_t wfilename[256];
 		::MultiByteToWideChar(CP_ACP, 0, filename, -1, wfilename, 256);
 
-		// eNX`t@Cǂݍ
-		// eNX`ǂݍ
+		// テクスチャファイル読み込み
+		// テクスチャ読み込み
 		Microsoft::WRL::ComPtr<ID3D11Resource> resource;
 		HRESULT hr = DirectX::CreateWICTextureFromFile(device, wfilename, resource.GetAddressOf(), shaderResourceView.GetAddressOf());
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 
-		// eNX`̎擾
+		// テクスチャ情報の取得
 		D3D11_TEXTURE2D_DESC desc;
 		Microsoft::WRL::ComPtr<ID3D11Texture2D> texture2d;
 		hr = resource->QueryInterface<ID3D11Texture2D>(texture2d.GetAddressOf());
@@ -239,7 +239,7 @@ Sprite::Sprite(const char* filename)
 	}
 }
 
-// `s
+// 描画実行
 void Sprite::Render(ID3D11DeviceContext *immediate_context,
 	float dx, float dy,
 	float dw, float dh,
@@ -249,31 +249,31 @@ void Sprite::Render(ID3D11DeviceContext *immediate_context,
 	float r, float g, float b, float a) const
 {
 	{
-		// ݐݒ肳Ăr[|[gXN[TCY擾B
+		// 現在設定されているビューポートからスクリーンサイズを取得する。
 		D3D11_VIEWPORT viewport;
 		UINT numViewports = 1;
 		immediate_context->RSGetViewports(&numViewports, &viewport);
 		float screen_width = viewport.Width;
 		float screen_height = viewport.Height;
 
-		// XvCg\S_̃XN[WvZ
+		// スプライトを構成する４頂点のスクリーン座標を計算する
 		DirectX::XMFLOAT2 positions[] = {
-			DirectX::XMFLOAT2(dx,      dy),			// 
-			DirectX::XMFLOAT2(dx + dw, dy),			// E
-			DirectX::XMFLOAT2(dx,      dy + dh),	// 
-			DirectX::XMFLOAT2(dx + dw, dy + dh),	// E
+			DirectX::XMFLOAT2(dx,      dy),			// 左上
+			DirectX::XMFLOAT2(dx + dw, dy),			// 右上
+			DirectX::XMFLOAT2(dx,      dy + dh),	// 左下
+			DirectX::XMFLOAT2(dx + dw, dy + dh),	// 右下
 		};
 
-		// XvCg\S_̃eNX`WvZ
+		// スプライトを構成する４頂点のテクスチャ座標を計算する
 		DirectX::XMFLOAT2 texcoords[] = {
-			DirectX::XMFLOAT2(sx,      sy),			// 
-			DirectX::XMFLOAT2(sx + sw, sy),			// E
-			DirectX::XMFLOAT2(sx,      sy + sh),	// 
-			DirectX::XMFLOAT2(sx + sw, sy + sh),	// E
+			DirectX::XMFLOAT2(sx,      sy),			// 左上
+			DirectX::XMFLOAT2(sx + sw, sy),			// 右上
+			DirectX::XMFLOAT2(sx,      sy + sh),	// 左下
+			DirectX::XMFLOAT2(sx + sw, sy + sh),	// 右下
 		};
 
-		// XvCg̒Sŉ]邽߂ɂS_̒Sʒu
-		// _(0, 0)ɂȂ悤ɈU_ړB
+		// スプライトの中心で回転させるために４頂点の中心位置が
+		// 原点(0, 0)になるように一旦頂点を移動させる。
 		float mx = dx + dw * 0.5f;
 		float my = dy + dh * 0.5f;
 		for (auto& p : positions)
@@ -282,9 +282,9 @@ void Sprite::Render(ID3D11DeviceContext *immediate_context,
 			p.y -= my;
 		}
 
-		// _]
+		// 頂点を回転させる
 		const float PI = 3.141592653589793f;
-		float theta = angle * (PI / 180.0f);	// pxWA()ɕϊ
+		float theta = angle * (PI / 180.0f);	// 角度をラジアン(θ)に変換
 		float c = cosf(theta);
 		float s = sinf(theta);
 		for (auto& p : positions)
@@ -294,26 +294,26 @@ void Sprite::Render(ID3D11DeviceContext *immediate_context,
 			p.y = s * r.x + c * r.y;
 		}
 
-		// ]̂߂Ɉړ_̈ʒuɖ߂
+		// 回転のために移動させた頂点を元の位置に戻す
 		for (auto& p : positions)
 		{
 			p.x += mx;
 			p.y += my;
 		}
 
-		// XN[WnNDCWn֕ϊB
+		// スクリーン座標系からNDC座標系へ変換する。
 		for (auto& p : positions)
 		{
 			p.x = 2.0f*p.x / screen_width - 1.0f;
 			p.y = 1.0f - 2.0f*p.y / screen_height;
 		}
 
-		// _obt@̓e̕ҏWJnB
+		// 頂点バッファの内容の編集を開始する。
 		D3D11_MAPPED_SUBRESOURCE mappedBuffer;
 		HRESULT hr = immediate_context->Map(vertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBuffer);
 		_ASSERT_EXPR(SUCCEEDED(hr), HRTrace(hr));
 
-		// pDataҏW邱ƂŒ_f[^̓e邱ƂłB
+		// pDataを編集することで頂点データの内容を書き換えることができる。
 		Vertex* v = static_cast<Vertex*>(mappedBuffer.pData);
 		for (int i = 0; i < 4; ++i)
 		{
@@ -330,12 +330,12 @@ void Sprite::Render(ID3D11DeviceContext *immediate_context,
 			v[i].texcoord.y = texcoords[i].y / textureHeight;
 		}
 
-		// _obt@̓e̕ҏWIB
+		// 頂点バッファの内容の編集を終了する。
 		immediate_context->Unmap(vertexBuffer.Get(), 0);
 	}
 
 	{
-		// pCvCݒ
+		// パイプライン設定
 		UINT stride = sizeof(Vertex);
 		UINT offset = 0;
 		immediate_context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
@@ -350,7 +350,7 @@ void Sprite::Render(ID3D11DeviceContext *immediate_context,
 		immediate_context->PSSetShaderResources(0, 1, shaderResourceView.GetAddressOf());
 		immediate_context->PSSetSamplers(0, 1, samplerState.GetAddressOf());
 
-		// `
+		// 描画
 		immediate_context->Draw(4, 0);
 	}
 }
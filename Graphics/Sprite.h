@@ -4,7 +4,7 @@
 #include <d3d11.h>
 #include <DirectXMath.h>
 
-// XvCg
+// スプライト
 class Sprite
 {
 public:
@@ -19,7 +19,7 @@ public:
 		DirectX::XMFLOAT2	texcoord;
 	};
 
-	// `s
+	// 描画実行
 	void Render(ID3D11DeviceContext *dc,
 		float dx, float dy,
 		float dw, float dh,
@@ -28,10 +28,10 @@ public:
 		float angle,
 		float r, float g, float b, float a) const;
 
-	// eNX`擾
+	// テクスチャ幅取得
 	int GetTextureWidth() const { return textureWidth; }
 
-	// eNX`擾
+	// テクスチャ高さ取得
 	int GetTextureHeight() const { return textureHeight; }
 
 private:
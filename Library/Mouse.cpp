@@ -4,12 +4,12 @@ Mouse* Mouse::instance = nullptr;
 
 static const int KeyMap[] =
 {
-    VK_LBUTTON,     // {^
-    VK_MBUTTON,     // {^
-    VK_RBUTTON,     // E{^
+    VK_LBUTTON,     // 左ボタン
+    VK_MBUTTON,     // 中ボタン
+    VK_RBUTTON,     // 右ボタン
 };
 
-// RXgN^
+// コンストラクタ
 Mouse::Mouse(HWND hWnd) : hWnd(hWnd)
 {
     instance = this;
@@ -20,10 +20,10 @@ Mouse::Mouse(HWND hWnd) : hWnd(hWnd)
     screenHeight = rc.bottom - rc.top;
 }
 
-// XV
+// 更新
 void Mouse::Update()
 {
-    // XCb`
+    // スイッチ情報
     MouseButton newButtonState = 0;
 
     for (int i = 0; i < ARRAYSIZE(KeyMap); ++i)
@@ -34,23 +34,23 @@ void Mouse::Update()
         }
     }
 
-    // zC[
+    // ホイール
     wheel[1] = wheel[0];
     wheel[0] = 0;
 
-    // {^XV
-    buttonState[1] = buttonState[0];    // XCb`
+    // ボタン情報更新
+    buttonState[1] = buttonState[0];    // スイッチ履歴
     buttonState[0] = newButtonState;
 
-    buttonDown = ~buttonState[1] & newButtonState;  // u
-    buttonUp = ~newButtonState & buttonState[1];    // u
+    buttonDown = ~buttonState[1] & newButtonState;  // 押した瞬間
+    buttonUp = ~newButtonState & buttonState[1];    // 離した瞬間
 
-    // J[\ʒu̎擾
+    // カーソル位置の取得
     POINT cursor;
     ::GetCursorPos(&cursor);
     ::ScreenToClient(hWnd, &cursor);
 
-    // ʂ̃TCY擾
+    // 画面のサイズを取得する
     RECT rc;
     GetClientRect(hWnd, &rc);
     UINT screenW = rc.right - rc.left;
@@ -58,7 +58,7 @@ void Mouse::Update()
     UINT viewportW = screenWidth;
     UINT viewportH = screenHeight;
 
-    // ʕ␳
+    // 画面補正
     positionX[1] = positionX[0];
     positionY[1] = positionY[0];
     positionX[0] = (LONG)(cursor.x / static_cast<float>(viewportW) * static_cast<float>(screenW));
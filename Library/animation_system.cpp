@@ -0,0 +1,316 @@
+#include "animation_system.h"
+#include "misc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+
+using namespace DirectX;
+
+namespace {
+    int tier_period(AnimationSystem::Tier tier) {
+        switch (tier) {
+        case AnimationSystem::Tier::HALF_RATE: return 2;
+        case AnimationSystem::Tier::QUARTER_RATE: return 4;
+        case AnimationSystem::Tier::REDUCED: return 4;
+        default: return 1;
+        }
+    }
+}
+
+AnimationSystem::InstanceId AnimationSystem::add_instance(const SkinnedMesh& model, const SkinnedMesh::Animation& clip,
+    ClipSampler::WrapMode wrapMode, float startSeconds) {
+    std::unique_ptr<Instance> instance = std::make_unique<Instance>();
+    instance->model = &model;
+    instance->sampler = SkinnedMesh::clip_sampler(clip, wrapMode);
+    instance->time = startSeconds;
+    instances.push_back(std::move(instance));
+    return static_cast<InstanceId>(instances.size() - 1);
+}
+
+AnimationSystem::InstanceId AnimationSystem::add_instance(const SkinnedMesh& model, std::unique_ptr<BlendTree> blendTree) {
+    _ASSERT_EXPR(blendTree, L"The blend tree is null");
+    std::unique_ptr<Instance> instance = std::make_unique<Instance>();
+    instance->model = &model;
+    model.prepare_blend_tree(*blendTree);
+    instance->blendTree = std::move(blendTree);
+    instances.push_back(std::move(instance));
+    return static_cast<InstanceId>(instances.size() - 1);
+}
+
+void AnimationSystem::set_gameplay_joints(InstanceId instance, const std::vector<uint32_t>& nodes) {
+    Instance& target = *instances.at(instance);
+    if (nodes.empty()) {
+        target.gameplayMask.clear();
+        target.gameplayJointCount = 0;
+        return;
+    }
+    target.model->joint_mask(nodes.data(), nodes.size(), target.gameplayMask);
+    target.gameplayJointCount = static_cast<size_t>(std::count(target.gameplayMask.begin(), target.gameplayMask.end(), uint8_t(1)));
+}
+
+void AnimationSystem::set_camera(const XMFLOAT4X4& view, const XMFLOAT4X4& projection, float viewportHeight) {
+    this->view = view;
+    this->projection = projection;
+    this->viewportHeight = viewportHeight;
+    hasCamera = viewportHeight > 0;
+
+    // Planes of the view-projection's clip volume (row vectors, 0 <= z <= w), inside when dot(plane, p) >= 0
+    XMFLOAT4X4 M;
+    XMStoreFloat4x4(&M, XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection));
+    const XMVECTOR x = XMVectorSet(M._11, M._21, M._31, M._41);
+    const XMVECTOR y = XMVectorSet(M._12, M._22, M._32, M._42);
+    const XMVECTOR z = XMVectorSet(M._13, M._23, M._33, M._43);
+    const XMVECTOR w = XMVectorSet(M._14, M._24, M._34, M._44);
+    const XMVECTOR planes[6] = { w + x, w - x, w + y, w - y, z, w - z };
+    for (size_t i = 0; i < 6; ++i) {
+        XMStoreFloat4(&frustumPlanes[i], XMPlaneNormalize(planes[i]));
+    }
+}
+
+const char* AnimationSystem::tier_name(Tier tier) {
+    switch (tier) {
+    case Tier::FULL: return "FULL";
+    case Tier::HALF_RATE: return "1/2";
+    case Tier::QUARTER_RATE: return "1/4";
+    case Tier::REDUCED: return "REDUCED";
+    case Tier::OFF_SCREEN: return "OFF SCREEN";
+    default: return "?";
+    }
+}
+
+size_t AnimationSystem::average_joints(const Instance& instance, Tier tier) const {
+    switch (tier) {
+    case Tier::OFF_SCREEN: return instance.gameplayJointCount;
+    case Tier::REDUCED: return instance.model->reduced_joint_count() / tier_period(tier);
+    default: return instance.model->pose_hierarchy().node_count() / tier_period(tier);
+    }
+}
+
+void AnimationSystem::assign_tiers() {
+    ++frameIndex;
+    lodStatistics = {};
+
+    const bool lod = lodPolicy.enabled && hasCamera;
+    for (std::unique_ptr<Instance>& instance : instances) {
+        Tier tier = Tier::FULL;
+        instance->projectedSize = 0;
+        if (lod) {
+            XMFLOAT3 center;
+            float radius;
+            instance->model->bounding_sphere(instance->world, center, radius);
+            const XMVECTOR C = XMVectorSetW(XMLoadFloat3(&center), 1.0f);
+            bool visible = true;
+            for (const XMFLOAT4& plane : frustumPlanes) {
+                if (XMVectorGetX(XMVector4Dot(XMLoadFloat4(&plane), C)) < -radius) {
+                    visible = false;
+                    break;
+                }
+            }
+            if (!visible) {
+                tier = Tier::OFF_SCREEN;
+            }
+            else {
+                const float size = instance->model->projected_size(instance->world, view, projection, viewportHeight);
+                instance->projectedSize = size;
+                tier = size >= lodPolicy.halfRateSize ? Tier::FULL : size >= lodPolicy.quarterRateSize ? Tier::HALF_RATE :
+                    size >= lodPolicy.reducedSize ? Tier::QUARTER_RATE : Tier::REDUCED;
+            }
+        }
+        // Back on screen : the pose and palettes are as old as the instance was hidden
+        if (instance->tier == Tier::OFF_SCREEN && tier != Tier::OFF_SCREEN) {
+            instance->stale = true;
+        }
+        instance->tier = tier;
+    }
+
+    size_t averageJoints = 0;
+    for (const std::unique_ptr<Instance>& instance : instances) {
+        averageJoints += average_joints(*instance, instance->tier);
+    }
+    if (lod && lodPolicy.jointBudget > 0 && averageJoints > lodPolicy.jointBudget) {
+        // Demotes the smallest instances first, one tier at a time, until the budget holds or everything is REDUCED
+        budgetOrder.clear();
+        for (std::unique_ptr<Instance>& instance : instances) {
+            if (instance->tier != Tier::OFF_SCREEN) {
+                budgetOrder.push_back(instance.get());
+            }
+        }
+        std::sort(budgetOrder.begin(), budgetOrder.end(), [](const Instance* a, const Instance* b) {
+            return a->projectedSize < b->projectedSize;
+        });
+        bool demoted = true;
+        while (demoted && averageJoints > lodPolicy.jointBudget) {
+            demoted = false;
+            for (Instance* instance : budgetOrder) {
+                if (instance->tier == Tier::REDUCED) {
+                    continue;
+                }
+                const Tier tier = static_cast<Tier>(static_cast<int>(instance->tier) + 1);
+                averageJoints = averageJoints - average_joints(*instance, instance->tier) + average_joints(*instance, tier);
+                instance->tier = tier;
+                demoted = true;
+                if (averageJoints <= lodPolicy.jointBudget) {
+                    break;
+                }
+            }
+        }
+    }
+    lodStatistics.averageJoints = averageJoints;
+
+    for (size_t instanceIndex = 0; instanceIndex < instances.size(); ++instanceIndex) {
+        Instance& instance = *instances[instanceIndex];
+        const int period = tier_period(instance.tier);
+        // Staggered by index, so a quarter of the QUARTER_RATE instances are evaluated each frame
+        instance.due = instance.stale || instance.framesSinceEvaluation + 1 >= period * 2 ||
+            (frameIndex + instanceIndex) % period == 0;
+        ++lodStatistics.instances[static_cast<size_t>(instance.tier)];
+        if (instance.tier == Tier::OFF_SCREEN) {
+            lodStatistics.evaluatedJoints += instance.gameplayJointCount;
+        }
+        else if (instance.due) {
+            lodStatistics.evaluatedJoints += instance.tier == Tier::REDUCED ? instance.model->reduced_joint_count() :
+                instance.model->pose_hierarchy().node_count();
+        }
+    }
+}
+
+void AnimationSystem::evaluate_instance(Instance& instance, float elapsedSeconds, const uint8_t* nodeMask,
+    SkinnedMesh::Palette& palette) const {
+    if (instance.blendTree) {
+        // Blend trees have no per-node sampling : REDUCED only lowers their rate
+        instance.blendTree->evaluate(elapsedSeconds, instance.pose);
+    }
+    else {
+        // Keep looping time within one cycle so it doesn't lose precision over a long session
+        instance.time += elapsedSeconds;
+        const float duration = instance.sampler.duration();
+        if (duration > 0 && instance.sampler.wrap_mode() == ClipSampler::WrapMode::LOOP) {
+            instance.time = fmodf(instance.time, duration);
+        }
+        instance.model->sample_animation(instance.sampler, instance.time, instance.pose, nodeMask);
+    }
+    instance.model->update_pose(instance.pose);
+    instance.model->build_palette(instance.pose, palette);
+}
+
+void AnimationSystem::advance_instance(Instance& instance, float elapsedSeconds) const {
+    if (!instance.gameplayMask.empty()) {
+        // Only the gameplay joints (and their ancestors) are decoded; global transforms of the rest go stale
+        if (instance.blendTree) {
+            instance.blendTree->evaluate(elapsedSeconds, instance.pose);
+        }
+        else {
+            instance.time += elapsedSeconds;
+            const float duration = instance.sampler.duration();
+            if (duration > 0 && instance.sampler.wrap_mode() == ClipSampler::WrapMode::LOOP) {
+                instance.time = fmodf(instance.time, duration);
+            }
+            instance.model->sample_animation(instance.sampler, instance.time, instance.pose, instance.gameplayMask.data());
+        }
+        instance.model->update_pose(instance.pose);
+    }
+    else if (instance.blendTree) {
+        instance.blendTree->advance(elapsedSeconds);
+    }
+    else {
+        instance.time += elapsedSeconds;
+    }
+}
+
+void AnimationSystem::update_instance(Instance& instance, float elapsedSeconds) const {
+    instance.pendingSeconds += elapsedSeconds * instance.speed;
+    if (instance.tier == Tier::OFF_SCREEN) {
+        advance_instance(instance, instance.pendingSeconds);
+        instance.pendingSeconds = 0;
+        return;
+    }
+
+    const int period = tier_period(instance.tier);
+    const bool interpolate = period > 1 && lodPolicy.interpolatePalettes;
+    if (instance.due) {
+        const uint8_t* nodeMask = instance.tier == Tier::REDUCED && !instance.stale ? instance.model->reduced_joint_mask() : nullptr;
+        if (interpolate) {
+            std::swap(instance.previousPalette, instance.targetPalette);
+            evaluate_instance(instance, instance.pendingSeconds, nodeMask, instance.targetPalette);
+            if (instance.stale || instance.previousPalette.version == 0) {
+                instance.previousPalette = instance.targetPalette;
+            }
+        }
+        else {
+            evaluate_instance(instance, instance.pendingSeconds, nodeMask, instance.palette);
+            instance.targetPalette.version = 0; // out of date if interpolation resumes
+        }
+        instance.pendingSeconds = 0;
+        instance.framesSinceEvaluation = 0;
+        instance.stale = false;
+    }
+    else {
+        ++instance.framesSinceEvaluation;
+    }
+
+    // Lags one evaluation behind : from the previous palette at 1/period to the latest at 1
+    if (interpolate && instance.framesSinceEvaluation < period) {
+        const float factor = static_cast<float>(instance.framesSinceEvaluation + 1) / period;
+        SkinnedMesh::blend_palettes(instance.previousPalette, instance.targetPalette, factor, instance.palette);
+    }
+}
+
+void AnimationSystem::update(float elapsedSeconds, bool parallel) {
+    assign_tiers();
+
+    const size_t instanceCount = instances.size();
+    if (!parallel || instanceCount < 2 || threadPool.thread_count() == 0) {
+        for (std::unique_ptr<Instance>& instance : instances) {
+            update_instance(*instance, elapsedSeconds);
+        }
+        return;
+    }
+
+    // The calling thread works through the queue too while it waits
+    const size_t batchCount = std::min<size_t>(instanceCount, (threadPool.thread_count() + 1) * BATCHES_PER_THREAD);
+    const size_t batchSize = (instanceCount + batchCount - 1) / batchCount;
+    for (size_t first = 0; first < instanceCount; first += batchSize) {
+        const size_t last = std::min<size_t>(first + batchSize, instanceCount);
+        threadPool.submit([this, first, last, elapsedSeconds]() {
+            for (size_t instanceIndex = first; instanceIndex < last; ++instanceIndex) {
+                update_instance(*instances[instanceIndex], elapsedSeconds);
+            }
+        });
+    }
+    threadPool.wait();
+}
+
+void AnimationSystem::benchmark_update(const SkinnedMesh& model, size_t instanceCount, int frames) {
+    if (model.animationClips.empty() || instanceCount == 0 || frames <= 0) {
+        return;
+    }
+
+    AnimationSystem system;
+    const SkinnedMesh::Animation& clip = model.animationClips.at(0);
+    for (size_t instanceIndex = 0; instanceIndex < instanceCount; ++instanceIndex) {
+        // Spread over the clip, so the instances don't all decode the same keys
+        system.add_instance(model, clip, ClipSampler::WrapMode::LOOP, instanceIndex * 0.37f);
+    }
+    system.update(0, false); // first touch of every buffer
+
+    benchmark timer;
+    auto instances_per_second = [&](bool parallel) {
+        timer.begin();
+        for (int frame = 0; frame < frames; ++frame) {
+            system.update(1.0f / 60, parallel);
+        }
+        const float seconds = timer.end();
+        return seconds > 0 ? static_cast<float>(instanceCount) * frames / seconds : 0.0f;
+    };
+    const float serial = instances_per_second(false);
+    const float parallel = instances_per_second(true);
+
+    std::stringstream message;
+    message << std::fixed << std::setprecision(1)
+        << "AnimationSystem : " << instanceCount << " instances, " << system.thread_count() + 1 << " threads\n"
+        << "  1 thread : " << serial << " instances/s, all threads : " << parallel << " instances/s (x"
+        << (serial > 0 ? parallel / serial : 0.0f) << ")\n";
+    OutputDebugStringA(message.str().c_str());
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+
+#include "thread_pool.h"
+#include "skinned_mesh.h"
+
+// Evaluates the animation of many SkinnedMesh instances in parallel.
+//
+// Every instance owns its playback state (a ClipSampler or a BlendTree), its Pose and its SkinnedMesh::Palette.
+// update splits the instances into contiguous batches, one task per batch on the thread pool, and each task
+// samples, blends, walks the hierarchy and builds the palette of its instances without touching anything
+// shared but the (read only) models. update returns once every batch is done : that is the sync point, after
+// which render only reads the palettes.
+//
+// Instances are added and changed on the main thread between updates.
+//
+// Animation LOD : before the batches go out, every instance gets a tier from its projected size (set_camera /
+// set_world). Far instances are evaluated every 2nd or 4th frame, staggered so the work stays level from frame
+// to frame, and either keep their palette in between (no upload) or lerp from the previous palette to the
+// latest, which shows them one evaluation late but smooth. The smallest also freeze their leaf joints, and
+// instances outside the frustum only advance their time, decoding just the joints gameplay asked for.
+class AnimationSystem {
+public:
+    using InstanceId = uint32_t;
+
+    enum class Tier {
+        FULL,           // every frame
+        HALF_RATE,      // every 2nd frame
+        QUARTER_RATE,   // every 4th frame
+        REDUCED,        // every 4th frame, leaf joints frozen
+        OFF_SCREEN,     // time only, plus the gameplay joints; no palette
+        COUNT,
+    };
+    struct LodPolicy {
+        bool enabled = true;
+        // Projected sizes in pixels (SkinnedMesh::projected_size) below which an instance drops to the tier
+        float halfRateSize = 200.0f;
+        float quarterRateSize = 80.0f;
+        float reducedSize = 30.0f;
+        // false : throttled instances hold their palette between evaluations
+        bool interpolatePalettes = true;
+        // Joints evaluated per frame on average. Over it, the smallest instances are demoted further. 0 : no limit.
+        size_t jointBudget = 0;
+    };
+    struct LodStatistics {
+        size_t instances[static_cast<size_t>(Tier::COUNT)] = {};
+        size_t evaluatedJoints = 0;     // this frame
+        size_t averageJoints = 0;       // per frame at the current tiers, what jointBudget is checked against
+    };
+
+    // 0 : one thread per hardware thread
+    AnimationSystem(size_t threadCount = 0) : threadPool(threadCount) {}
+    virtual ~AnimationSystem() = default;
+
+    AnimationSystem(const AnimationSystem&) = delete;
+    AnimationSystem& operator=(const AnimationSystem&) = delete;
+
+    // Plays 'clip' of 'model' from 'startSeconds'. 'model' and 'clip' must outlive the instance.
+    InstanceId add_instance(const SkinnedMesh& model, const SkinnedMesh::Animation& clip,
+        ClipSampler::WrapMode wrapMode = ClipSampler::WrapMode::LOOP, float startSeconds = 0);
+    // Plays a built (not yet prepared) blend tree, which the instance takes over and prepares for 'model'.
+    InstanceId add_instance(const SkinnedMesh& model, std::unique_ptr<BlendTree> blendTree);
+    void clear() { instances.clear(); }
+    size_t instance_count() const { return instances.size(); }
+
+    // Playback rate, 1 by default. 0 pauses the instance.
+    void set_speed(InstanceId instance, float speed) { instances.at(instance)->speed = speed; }
+    // Parameters and layer weights can be changed between updates. Null for clip instances.
+    BlendTree* blend_tree(InstanceId instance) { return instances.at(instance)->blendTree.get(); }
+
+    // Animation LOD inputs. Without a camera every instance is FULL.
+    void set_lod_policy(const LodPolicy& policy) { lodPolicy = policy; }
+    const LodPolicy& lod_policy() const { return lodPolicy; }
+    void set_camera(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, float viewportHeight);
+    void set_world(InstanceId instance, const DirectX::XMFLOAT4X4& world) { instances.at(instance)->world = world; }
+    // Nodes whose global transforms gameplay reads (hands for attachments, the head for aiming...). They and
+    // their ancestors are kept up to date in the pose even while the instance is off screen.
+    void set_gameplay_joints(InstanceId instance, const std::vector<uint32_t>& nodes);
+
+    // Advances every instance by 'elapsedSeconds' and rebuilds its pose and palette. Blocks until all of them are
+    // done, helping the workers meanwhile. 'parallel' = false evaluates everything on the calling thread (benchmarks).
+    void update(float elapsedSeconds, bool parallel = true);
+
+    // Valid after update
+    const Pose& pose(InstanceId instance) const { return instances.at(instance)->pose; }
+    const SkinnedMesh::Palette& palette(InstanceId instance) const { return instances.at(instance)->palette; }
+    Tier tier(InstanceId instance) const { return instances.at(instance)->tier; }
+    float projected_size(InstanceId instance) const { return instances.at(instance)->projectedSize; }
+    const LodStatistics& lod_statistics() const { return lodStatistics; }
+    static const char* tier_name(Tier tier);
+
+    size_t thread_count() const { return threadPool.thread_count(); }
+
+    // Instances per second updating 'instanceCount' copies of 'model's first clip on the calling thread alone and
+    // on the pool. Results go to the output window.
+    static void benchmark_update(const SkinnedMesh& model, size_t instanceCount = 1000, int frames = 60);
+
+private:
+    // Batches per thread : enough for the pool to balance uneven instances, few enough that tasks stay cheap
+    static const size_t BATCHES_PER_THREAD = 4;
+
+    // Cache line aligned, so instances updated by different threads never share a line
+    struct alignas(64) Instance {
+        const SkinnedMesh* model = nullptr;
+        ClipSampler sampler;
+        std::unique_ptr<BlendTree> blendTree;
+        float time = 0;
+        float speed = 1.0f;
+        Pose pose;
+        SkinnedMesh::Palette palette;   // the one rendered
+        // Animation LOD
+        DirectX::XMFLOAT4X4 world = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+        std::vector<uint8_t> gameplayMask;
+        size_t gameplayJointCount = 0;
+        Tier tier = Tier::FULL;
+        float projectedSize = 0;
+        bool due = true;                // evaluated this frame
+        bool stale = true;              // the pose has to be sampled in full before anything reuses it
+        int framesSinceEvaluation = 0;
+        float pendingSeconds = 0;       // elapsed time not yet applied to the pose
+        SkinnedMesh::Palette previousPalette, targetPalette; // interpolated between, for throttled tiers
+    };
+    void update_instance(Instance& instance, float elapsedSeconds) const;
+    void evaluate_instance(Instance& instance, float elapsedSeconds, const uint8_t* nodeMask, SkinnedMesh::Palette& palette) const;
+    void advance_instance(Instance& instance, float elapsedSeconds) const;
+    // Main thread, before the batches : tiers, budget and which instances are due
+    void assign_tiers();
+    size_t average_joints(const Instance& instance, Tier tier) const;
+
+    std::vector<std::unique_ptr<Instance>> instances;
+
+    LodPolicy lodPolicy;
+    LodStatistics lodStatistics;
+    bool hasCamera = false;
+    DirectX::XMFLOAT4X4 view = {}, projection = {};
+    DirectX::XMFLOAT4 frustumPlanes[6] = {};
+    float viewportHeight = 0;
+    uint64_t frameIndex = 0;
+    std::vector<Instance*> budgetOrder;
+
+    // Last, so the workers are joined before the instances they update are destroyed.
+    ThreadPool threadPool;
+};
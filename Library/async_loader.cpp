@@ -0,0 +1,38 @@
+#include "async_loader.h"
+#include "misc.h"
+#include <cfloat>
+
+AsyncLoader::~AsyncLoader() {
+    // Workers still reference this loader. Let them finish; whatever they queued is dropped unfinalized.
+    threadPool.wait();
+}
+
+void AsyncLoader::enqueue(FinalizeSteps&& finalizeSteps) {
+    std::lock_guard<std::mutex> lock(finalizeMutex);
+    for (std::function<void()>& step : finalizeSteps) {
+        finalizeQueue.push_back(std::move(step));
+    }
+}
+
+void AsyncLoader::finalize(float budgetSeconds) {
+    benchmark timer;
+    do {
+        std::function<void()> step;
+        {
+            std::lock_guard<std::mutex> lock(finalizeMutex);
+            if (finalizeQueue.empty()) {
+                return;
+            }
+            step = std::move(finalizeQueue.front());
+            finalizeQueue.pop_front();
+        }
+        step();
+    } while (timer.end() < budgetSeconds);
+}
+
+void AsyncLoader::finish() {
+    while (pendingLoads > 0) {
+        threadPool.wait();
+        finalize(FLT_MAX);
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <atomic>
+
+#include "thread_pool.h"
+
+enum class LoadState {
+    LOADING,    // CPU work queued or running on a worker thread
+    FINALIZING, // waiting for its D3D objects to be created on the main thread
+    READY,
+    FAILED,
+};
+
+// Result of AsyncLoader::load. Cheap to copy; every copy refers to the same load.
+template<class T>
+class AsyncHandle {
+public:
+    AsyncHandle() = default;
+
+    bool valid() const { return status != nullptr; }
+    LoadState state() const { return status ? status->state.load() : LoadState::FAILED; }
+    bool ready() const { return state() == LoadState::READY; }
+    bool failed() const { return state() == LoadState::FAILED; }
+
+    // nullptr until ready()
+    T* get() const { return ready() ? status->object.get() : nullptr; }
+    std::shared_ptr<T> share() const { return ready() ? status->object : nullptr; }
+
+private:
+    struct Status {
+        std::atomic<LoadState> state = LoadState::LOADING;
+        std::shared_ptr<T> object; // only touched on the main thread, once 'state' is FINALIZING
+    };
+    std::shared_ptr<Status> status;
+    friend class AsyncLoader;
+};
+
+// Loads resources without stalling the frame.
+// The CPU side of a load (file reads, parsing, decoding) runs on a thread pool. The D3D side is handed back
+// as a list of small finalize steps, which the main thread runs from finalize() a few at a time, under a
+// per-frame time budget. The device is therefore only used by the thread that renders.
+class AsyncLoader {
+public:
+    using FinalizeSteps = std::vector<std::function<void()>>;
+
+    // 0 : one thread per hardware thread
+    AsyncLoader(size_t threadCount = 0) : threadPool(threadCount) {}
+    virtual ~AsyncLoader();
+
+    AsyncLoader(const AsyncLoader&) = delete;
+    AsyncLoader& operator=(const AsyncLoader&) = delete;
+
+    // 'load' runs on a worker thread. It returns the object, or nullptr if loading failed, and appends the
+    // D3D work to 'finalizeSteps'. The steps run on the main thread in order; the handle is ready after the last one.
+    template<class T>
+    AsyncHandle<T> load(std::function<std::shared_ptr<T>(FinalizeSteps& finalizeSteps)> load) {
+        AsyncHandle<T> handle;
+        handle.status = std::make_shared<typename AsyncHandle<T>::Status>();
+        std::shared_ptr<typename AsyncHandle<T>::Status> status = handle.status;
+        ++pendingLoads;
+        threadPool.submit([this, status, load]() {
+            FinalizeSteps finalizeSteps;
+            std::shared_ptr<T> object = load(finalizeSteps);
+            if (!object) {
+                status->state = LoadState::FAILED;
+                --pendingLoads;
+                return;
+            }
+            status->state = LoadState::FINALIZING;
+            finalizeSteps.push_back([this, status, object]() {
+                status->object = object;
+                status->state = LoadState::READY;
+                --pendingLoads;
+            });
+            enqueue(std::move(finalizeSteps));
+        });
+        return handle;
+    }
+
+    // A handle that is ready from the start, for caches handing out what they already hold.
+    template<class T>
+    static AsyncHandle<T> loaded(std::shared_ptr<T> object) {
+        AsyncHandle<T> handle;
+        handle.status = std::make_shared<typename AsyncHandle<T>::Status>();
+        handle.status->object = std::move(object);
+        handle.status->state = handle.status->object ? LoadState::READY : LoadState::FAILED;
+        return handle;
+    }
+
+    // Main thread, once per frame. Runs finalize steps until 'budgetSeconds' is spent. At least one step runs
+    // per call, so a step longer than the budget still makes progress.
+    void finalize(float budgetSeconds);
+
+    // Main thread. Blocks until every load has finished, running worker tasks and finalize steps itself
+    // (loading screens, shutdown).
+    void finish();
+
+    // Loads that are neither ready nor failed yet.
+    size_t pending() const { return pendingLoads; }
+
+private:
+    void enqueue(FinalizeSteps&& finalizeSteps);
+
+    std::mutex finalizeMutex;
+    std::deque<std::function<void()>> finalizeQueue;
+    std::atomic<size_t> pendingLoads = 0;
+
+    // Last, so the workers are joined before the queue they push to is destroyed.
+    ThreadPool threadPool;
+};
@@ -2,6 +2,7 @@
 
 #include <windows.h>
 #include <winerror.h>
+#include <filesystem>
 
 HRESULT find_chunk(HANDLE hfile, DWORD fourcc, DWORD& chunkSize, DWORD& chunkDataPosition) {
     HRESULT hr = S_OK;
@@ -83,21 +84,22 @@ HRESULT readChunkData(HANDLE hFile, LPVOID buffer, DWORD bufferSize, DWORD buffe
 	return hr;
 }
 
-Audio::Audio(IXAudio2* xaudio2, const wchar_t* filename) {
-	HRESULT hr;
+HRESULT Audio::read_wave(const wchar_t* filename, WAVEFORMATEXTENSIBLE& wfx, std::vector<BYTE>& samples)
+{
+	HRESULT hr = S_OK;
 
 	// Open the file
 	HANDLE hfile = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
 	if (INVALID_HANDLE_VALUE == hfile)
 	{
-		hr = HRESULT_FROM_WIN32(GetLastError());
-		_ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+		return HRESULT_FROM_WIN32(GetLastError());
 	}
 
 	if (INVALID_SET_FILE_POINTER == SetFilePointer(hfile, 0, NULL, FILE_BEGIN))
 	{
 		hr = HRESULT_FROM_WIN32(GetLastError());
-		_ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+		CloseHandle(hfile);
+		return hr;
 	}
 
 	DWORD chunkSize;
@@ -113,11 +115,79 @@ Audio::Audio(IXAudio2* xaudio2, const wchar_t* filename) {
 
 	//fill out the audio data buffer with the contents of the fourccDATA chunk
 	find_chunk(hfile, 'atad'/*DATA*/, chunkSize, chunkPosition);
-	BYTE* data = new BYTE[chunkSize];
-	readChunkData(hfile, data, chunkSize, chunkPosition);
+	samples.resize(chunkSize);
+	hr = readChunkData(hfile, samples.data(), chunkSize, chunkPosition);
+
+	CloseHandle(hfile);
+	return hr;
+}
+
+cooked::SourceKey Audio::source_key(const wchar_t* filename)
+{
+	cooked::SourceKey sourceKey;
+	sourceKey.hash = cooked::hash_file(filename);
+	return sourceKey;
+}
 
-	buffer.AudioBytes = chunkSize;  //size of the audio buffer in bytes
-	buffer.pAudioData = data;  //buffer containing audio data
+cooked::CookResult Audio::cook(const wchar_t* filename, bool force)
+{
+	std::filesystem::path cookedFilename(filename);
+	cookedFilename.replace_extension("cooked");
+
+	const cooked::SourceKey sourceKey = source_key(filename);
+	if (sourceKey.hash == 0)
+	{
+		return cooked::CookResult::FAILED;
+	}
+	if (!force && cooked::is_up_to_date(cookedFilename.c_str(), sourceKey, cookedFilename.parent_path()))
+	{
+		return cooked::CookResult::UP_TO_DATE;
+	}
+
+	WAVEFORMATEXTENSIBLE wfx = {};
+	std::vector<BYTE> samples;
+	if (FAILED(read_wave(filename, wfx, samples)) || samples.empty())
+	{
+		return cooked::CookResult::FAILED;
+	}
+
+	cooked::Writer writer;
+	writer.set_source(sourceKey);
+	writer.add(cooked::BlobType::WAVE_FORMAT, &wfx, 1);
+	writer.add(cooked::BlobType::SAMPLES, samples.data(), samples.size());
+	return writer.save(cookedFilename.c_str()) ? cooked::CookResult::COOKED : cooked::CookResult::FAILED;
+}
+
+Audio::Audio(IXAudio2* xaudio2, const wchar_t* filename) {
+	HRESULT hr;
+
+	std::filesystem::path cookedFilename(filename);
+	cookedFilename.replace_extension("cooked");
+
+	// A cooked file is played straight from the mapping, which stays open as long as this Audio.
+	cooked::Reader cookedReader;
+	const WAVEFORMATEXTENSIBLE* cookedFormat = nullptr;
+	const BYTE* cookedSamples = nullptr;
+	size_t formatCount = 0;
+	size_t sampleCount = 0;
+	if (cookedFile.open(cookedFilename.c_str()) && cookedReader.open(cookedFile) &&
+		cookedReader.up_to_date(source_key(filename), cookedFilename.parent_path()) &&
+		(cookedFormat = cookedReader.get<WAVEFORMATEXTENSIBLE>(cooked::BlobType::WAVE_FORMAT, formatCount)) != nullptr &&
+		(cookedSamples = cookedReader.get<BYTE>(cooked::BlobType::SAMPLES, sampleCount)) != nullptr)
+	{
+		wfx = *cookedFormat;
+		buffer.AudioBytes = static_cast<UINT32>(sampleCount);
+		buffer.pAudioData = cookedSamples;
+	}
+	else
+	{
+		cookedFile.close();
+		hr = read_wave(filename, wfx, samples);
+		_ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+
+		buffer.AudioBytes = static_cast<UINT32>(samples.size());  //size of the audio buffer in bytes
+		buffer.pAudioData = samples.data();  //buffer containing audio data
+	}
 	buffer.Flags = XAUDIO2_END_OF_STREAM; // tell the source voice not to expect any data after this buffer
 
 	hr = xaudio2->CreateSourceVoice(&sourceVoice, (WAVEFORMATEX*)&wfx);
@@ -127,7 +197,6 @@ Audio::Audio(IXAudio2* xaudio2, const wchar_t* filename) {
 Audio::~Audio()
 {
 	sourceVoice->DestroyVoice();
-	delete[] buffer.pAudioData;
 }
 
 void Audio::play(int loopCount)
@@ -3,7 +3,10 @@
 #include <xaudio2.h>
 #include <mmreg.h>
 
+#include <vector>
+
 #include "misc.h"
+#include "cooked_model.h"
 
 class Audio {
     WAVEFORMATEXTENSIBLE wfx = { 0 };
@@ -11,9 +14,20 @@ class Audio {
 
     IXAudio2SourceVoice* sourceVoice;
 
+    // Samples either live in 'samples' or in the cooked file's mapping.
+    std::vector<BYTE> samples;
+    MappedFile cookedFile;
+
+    static HRESULT read_wave(const wchar_t* filename, WAVEFORMATEXTENSIBLE& wfx, std::vector<BYTE>& samples);
+
 public:
     Audio(IXAudio2* xaudio2, const wchar_t* filename);
     virtual ~Audio();
+
+    static cooked::SourceKey source_key(const wchar_t* filename);
+
+    // Headless conversion for the asset cooker: writes a '.cooked' file holding the format and the PCM samples.
+    static cooked::CookResult cook(const wchar_t* filename, bool force = false);
     void play(int loopCount = 0/*255 : XAUDIO2_LOOP_INFINITE*/);
     void stop(bool playTails = true, bool waitForBufferToUnqueue = true);
     void volume(float volume);
@@ -0,0 +1,170 @@
+#include "baked_animation.h"
+#include "misc.h"
+
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/vector.hpp>
+
+using namespace DirectX;
+
+namespace {
+    // Bumped whenever the layout of the file or the texture changes
+    constexpr uint32_t BAKED_VERSION = 1;
+}
+
+void BakedAnimation::reset(uint32_t paletteSize, float framesPerSecond) {
+    _ASSERT_EXPR(paletteSize * TEXELS_PER_BONE <= MAX_TEXTURE_SIZE, L"The palette is too wide for a texture");
+    _ASSERT_EXPR(framesPerSecond > 0, L"The bake rate must be positive");
+    this->paletteSize = paletteSize;
+    this->framesPerSecond = framesPerSecond;
+    clips.clear();
+    texels.clear();
+    textureView.Reset();
+}
+
+uint32_t BakedAnimation::add_clip(float duration, ClipSampler::WrapMode wrapMode) {
+    Clip clip;
+    clip.firstRow = height();
+    // Frames at every 1 / framesPerSecond, plus one at the very end when the duration isn't a whole number of them
+    clip.frameCount = static_cast<uint32_t>(std::ceil(duration * framesPerSecond - 1e-4f)) + 1;
+    clip.duration = duration;
+    clip.wrapMode = wrapMode;
+    _ASSERT_EXPR(clip.firstRow + clip.frameCount <= MAX_TEXTURE_SIZE, L"Too many frames for a texture; bake at a lower rate");
+    texels.resize(texels.size() + static_cast<size_t>(width()) * clip.frameCount);
+    clips.push_back(clip);
+    return static_cast<uint32_t>(clips.size() - 1);
+}
+
+void BakedAnimation::set_frame(uint32_t row, const XMFLOAT4X4* boneTransforms) {
+    XMFLOAT4* rowTexels = texels.data() + static_cast<size_t>(row) * width();
+    for (uint32_t bone = 0; bone < paletteSize; ++bone) {
+        const XMFLOAT4X4& M = boneTransforms[bone];
+        // Columns, so the shader transforms with three dot products
+        rowTexels[bone * TEXELS_PER_BONE + 0] = { M._11, M._21, M._31, M._41 };
+        rowTexels[bone * TEXELS_PER_BONE + 1] = { M._12, M._22, M._32, M._42 };
+        rowTexels[bone * TEXELS_PER_BONE + 2] = { M._13, M._23, M._33, M._43 };
+    }
+}
+
+BakedAnimation::FrameAddress BakedAnimation::address(uint32_t clipIndex, float seconds) const {
+    const Clip& clip = clips.at(clipIndex);
+    FrameAddress address;
+    address.rows[0] = address.rows[1] = clip.firstRow;
+    if (clip.frameCount < 2 || clip.duration <= 0) {
+        return address;
+    }
+
+    // Same wrapping as ClipSampler
+    float time = seconds;
+    switch (clip.wrapMode) {
+    case ClipSampler::WrapMode::LOOP:
+        time = fmodf(time, clip.duration);
+        if (time < 0) {
+            time += clip.duration;
+        }
+        break;
+    case ClipSampler::WrapMode::CLAMP:
+        time = std::min<float>(std::max<float>(time, 0), clip.duration);
+        break;
+    case ClipSampler::WrapMode::PING_PONG:
+        time = fmodf(fabsf(time), clip.duration * 2);
+        if (time > clip.duration) {
+            time = clip.duration * 2 - time;
+        }
+        break;
+    }
+
+    const uint32_t frame = std::min<uint32_t>(static_cast<uint32_t>(time * framesPerSecond), clip.frameCount - 2);
+    const float frameTime = frame / framesPerSecond;
+    const float nextFrameTime = std::min<float>((frame + 1) / framesPerSecond, clip.duration);
+    address.rows[0] = clip.firstRow + frame;
+    address.rows[1] = address.rows[0] + 1;
+    address.blend = nextFrameTime > frameTime ?
+        std::min<float>(std::max<float>((time - frameTime) / (nextFrameTime - frameTime), 0), 1) : 0;
+    return address;
+}
+
+XMFLOAT4X4 BakedAnimation::bone_transform(const FrameAddress& address, uint32_t bone) const {
+    XMVECTOR columns[TEXELS_PER_BONE];
+    for (uint32_t column = 0; column < TEXELS_PER_BONE; ++column) {
+        const size_t texel = static_cast<size_t>(bone) * TEXELS_PER_BONE + column;
+        const XMVECTOR C0 = XMLoadFloat4(&texels.at(static_cast<size_t>(address.rows[0]) * width() + texel));
+        const XMVECTOR C1 = XMLoadFloat4(&texels.at(static_cast<size_t>(address.rows[1]) * width() + texel));
+        columns[column] = XMVectorLerp(C0, C1, address.blend);
+    }
+    XMFLOAT4X4 transform;
+    XMStoreFloat4x4(&transform, XMMatrixTranspose(XMMATRIX(columns[0], columns[1], columns[2], XMVectorSet(0, 0, 0, 1))));
+    return transform;
+}
+
+bool BakedAnimation::save(const std::filesystem::path& filename, const cooked::SourceKey& sourceKey) const {
+    std::ofstream ofs(filename.c_str(), std::ios::binary);
+    if (!ofs) {
+        return false;
+    }
+    cereal::BinaryOutputArchive serialization(ofs);
+    serialization(BAKED_VERSION, sourceKey.hash, sourceKey.flags, sourceKey.samplingRate, paletteSize, framesPerSecond, clips,
+        cereal::make_size_tag(static_cast<cereal::size_type>(texels.size())));
+    serialization(cereal::binary_data(texels.data(), size_in_bytes()));
+    return static_cast<bool>(ofs);
+}
+
+bool BakedAnimation::load(const std::filesystem::path& filename, const cooked::SourceKey& sourceKey, float framesPerSecond) {
+    std::ifstream ifs(filename.c_str(), std::ios::binary);
+    if (!ifs) {
+        return false;
+    }
+    try {
+        uint32_t version = 0;
+        cooked::SourceKey bakedKey;
+        uint32_t bakedPaletteSize = 0;
+        float bakedFramesPerSecond = 0;
+        std::vector<Clip> bakedClips;
+        cereal::size_type texelCount = 0;
+        cereal::BinaryInputArchive deserialization(ifs);
+        deserialization(version, bakedKey.hash, bakedKey.flags, bakedKey.samplingRate);
+        if (version != BAKED_VERSION || (sourceKey.hash != 0 && bakedKey.hash != sourceKey.hash) ||
+            bakedKey.flags != sourceKey.flags || bakedKey.samplingRate != sourceKey.samplingRate) {
+            return false;
+        }
+        deserialization(bakedPaletteSize, bakedFramesPerSecond, bakedClips, cereal::make_size_tag(texelCount));
+        if (bakedFramesPerSecond != framesPerSecond) {
+            return false;
+        }
+        reset(bakedPaletteSize, bakedFramesPerSecond);
+        texels.resize(static_cast<size_t>(texelCount));
+        deserialization(cereal::binary_data(texels.data(), size_in_bytes()));
+        clips = std::move(bakedClips);
+    }
+    catch (const cereal::Exception&) {
+        clips.clear();
+        texels.clear();
+        return false;
+    }
+    return true;
+}
+
+void BakedAnimation::create_texture(ID3D11Device* device) {
+    _ASSERT_EXPR(!empty(), L"Nothing has been baked");
+    D3D11_TEXTURE2D_DESC texture2dDesc = {};
+    texture2dDesc.Width = width();
+    texture2dDesc.Height = height();
+    texture2dDesc.MipLevels = 1;
+    texture2dDesc.ArraySize = 1;
+    texture2dDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    texture2dDesc.SampleDesc.Count = 1;
+    texture2dDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    texture2dDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    D3D11_SUBRESOURCE_DATA subresourceData = {};
+    subresourceData.pSysMem = texels.data();
+    subresourceData.SysMemPitch = static_cast<UINT>(sizeof(XMFLOAT4) * width());
+
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> texture2d;
+    HRESULT hr = device->CreateTexture2D(&texture2dDesc, &subresourceData, texture2d.GetAddressOf());
+    _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+    hr = device->CreateShaderResourceView(texture2d.Get(), nullptr, textureView.ReleaseAndGetAddressOf());
+    _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl.h>
+#include <directxmath.h>
+#include <cstdint>
+#include <vector>
+#include <filesystem>
+
+#include "clip_sampler.h"
+#include "cooked_model.h"
+
+// Bone palettes of every clip of a SkinnedMesh, sampled ahead of time at a fixed rate (SkinnedMesh::bake_animations)
+// and stored in one RGBA32F texture : one row per frame, the clips one after another, and a block of TEXELS_PER_BONE
+// texels per palette bone. A bone's texels are the first three columns of its skinning matrix with the mesh's node
+// transform folded in; the fourth column of an affine matrix is always (0, 0, 0, 1).
+//
+// Instances then only supply a clip, a time and a world matrix. address turns the first two into the two rows
+// to blend, and SkinnedMesh::render_baked draws any number of instances with one instanced call per subset.
+// Everything but create_texture works without a device.
+class BakedAnimation {
+public:
+    static const uint32_t TEXELS_PER_BONE = 3;
+    static const uint32_t MAX_TEXTURE_SIZE = D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION;
+
+    struct Clip {
+        uint32_t firstRow = 0;
+        uint32_t frameCount = 0;    // frame i at min(i / framesPerSecond, duration)
+        float duration = 0;
+        ClipSampler::WrapMode wrapMode = ClipSampler::WrapMode::LOOP;
+        template<class T>
+        void serialize(T& archive) {
+            archive(firstRow, frameCount, duration, wrapMode);
+        }
+    };
+    // The two rows around a point of a clip and how far it is from the first to the second
+    struct FrameAddress {
+        uint32_t rows[2] = {};
+        float blend = 0;
+    };
+
+    // Building, see SkinnedMesh::bake_animations : reset, then add_clip and set_frame for each of its rows.
+    void reset(uint32_t paletteSize, float framesPerSecond);
+    // Returns the clip index
+    uint32_t add_clip(float duration, ClipSampler::WrapMode wrapMode);
+    // 'boneTransforms' : palette_size() skinning matrices
+    void set_frame(uint32_t row, const DirectX::XMFLOAT4X4* boneTransforms);
+
+    // 'seconds' into 'clip', wrapped with the clip's wrap mode
+    FrameAddress address(uint32_t clip, float seconds) const;
+    // The skinning matrix the vertex shader reconstructs at 'address' (checks and CPU fallbacks)
+    DirectX::XMFLOAT4X4 bone_transform(const FrameAddress& address, uint32_t bone) const;
+
+    bool empty() const { return clips.empty(); }
+    uint32_t palette_size() const { return paletteSize; }
+    float frames_per_second() const { return framesPerSecond; }
+    size_t clip_count() const { return clips.size(); }
+    const Clip& clip(size_t clip) const { return clips.at(clip); }
+    uint32_t width() const { return paletteSize * TEXELS_PER_BONE; }
+    uint32_t height() const { return static_cast<uint32_t>(width() > 0 ? texels.size() / width() : 0); }
+    size_t size_in_bytes() const { return sizeof(DirectX::XMFLOAT4) * texels.size(); }
+
+    // Binary file stamped with the key the model was imported with. load returns false if the file is missing,
+    // was baked from another import or at another rate.
+    bool save(const std::filesystem::path& filename, const cooked::SourceKey& sourceKey) const;
+    bool load(const std::filesystem::path& filename, const cooked::SourceKey& sourceKey, float framesPerSecond);
+
+    void create_texture(ID3D11Device* device);
+    // register(t10) of skinned_mesh_baked.hlsli
+    ID3D11ShaderResourceView* view() const { return textureView.Get(); }
+
+private:
+    uint32_t paletteSize = 0;
+    float framesPerSecond = 0;
+    std::vector<Clip> clips;
+    std::vector<DirectX::XMFLOAT4> texels; // width() per row
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> textureView;
+};
@@ -0,0 +1,432 @@
+#include "blend_tree.h"
+
+#include <crtdbg.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace {
+    // Streams of one pose, looked up once per blend instead of once per node
+    struct Streams {
+        float* values[Pose::STREAM_COUNT];
+
+        explicit Streams(Pose& pose) {
+            for (int streamIndex = 0; streamIndex < Pose::STREAM_COUNT; ++streamIndex) {
+                values[streamIndex] = pose.stream(static_cast<Pose::Stream>(streamIndex));
+            }
+        }
+    };
+    struct ConstStreams {
+        const float* values[Pose::STREAM_COUNT];
+
+        explicit ConstStreams(const Pose& pose) {
+            for (int streamIndex = 0; streamIndex < Pose::STREAM_COUNT; ++streamIndex) {
+                values[streamIndex] = pose.stream(static_cast<Pose::Stream>(streamIndex));
+            }
+        }
+    };
+
+    inline XMVECTOR load_rotation(const float* const values[Pose::STREAM_COUNT], size_t nodeIndex) {
+        return XMVectorSet(values[Pose::ROTATION_X][nodeIndex], values[Pose::ROTATION_Y][nodeIndex],
+            values[Pose::ROTATION_Z][nodeIndex], values[Pose::ROTATION_W][nodeIndex]);
+    }
+
+    inline void store_rotation(float* const values[Pose::STREAM_COUNT], size_t nodeIndex, FXMVECTOR rotation) {
+        values[Pose::ROTATION_X][nodeIndex] = XMVectorGetX(rotation);
+        values[Pose::ROTATION_Y][nodeIndex] = XMVectorGetY(rotation);
+        values[Pose::ROTATION_Z][nodeIndex] = XMVectorGetZ(rotation);
+        values[Pose::ROTATION_W][nodeIndex] = XMVectorGetW(rotation);
+    }
+
+    // Shortest-arc nlerp from 'from' to 'to'
+    inline XMVECTOR nlerp(FXMVECTOR from, FXMVECTOR to, float factor) {
+        const XMVECTOR aligned = XMVectorGetX(XMVector4Dot(from, to)) < 0 ? XMVectorNegate(to) : to;
+        return XMQuaternionNormalize(XMVectorLerp(from, aligned, factor));
+    }
+
+    // Lerp / nlerp of one node from its current values towards 'layer's by 'factor'
+    inline void override_node(float* const values[Pose::STREAM_COUNT], const float* const layer[Pose::STREAM_COUNT],
+        size_t nodeIndex, float factor) {
+        for (int streamIndex : { Pose::SCALING_X, Pose::SCALING_Y, Pose::SCALING_Z,
+            Pose::TRANSLATION_X, Pose::TRANSLATION_Y, Pose::TRANSLATION_Z }) {
+            float& value = values[streamIndex][nodeIndex];
+            value += (layer[streamIndex][nodeIndex] - value) * factor;
+        }
+        store_rotation(values, nodeIndex, nlerp(load_rotation(values, nodeIndex), load_rotation(layer, nodeIndex), factor));
+    }
+
+    // Adds 'factor' times the difference of 'layer' from 'reference' to one node. Rotation : the layer's rotation
+    // relative to the reference is applied in the node's local space, before the base rotation.
+    inline void add_node(float* const values[Pose::STREAM_COUNT], const float* const layer[Pose::STREAM_COUNT],
+        const float* const reference[Pose::STREAM_COUNT], size_t nodeIndex, float factor) {
+        for (int streamIndex : { Pose::TRANSLATION_X, Pose::TRANSLATION_Y, Pose::TRANSLATION_Z }) {
+            values[streamIndex][nodeIndex] += (layer[streamIndex][nodeIndex] - reference[streamIndex][nodeIndex]) * factor;
+        }
+        for (int streamIndex : { Pose::SCALING_X, Pose::SCALING_Y, Pose::SCALING_Z }) {
+            const float base = reference[streamIndex][nodeIndex];
+            const float ratio = base != 0 ? layer[streamIndex][nodeIndex] / base : 1.0f;
+            values[streamIndex][nodeIndex] *= 1.0f + (ratio - 1.0f) * factor;
+        }
+        const XMVECTOR delta = XMQuaternionMultiply(load_rotation(layer, nodeIndex),
+            XMQuaternionConjugate(load_rotation(reference, nodeIndex)));
+        const XMVECTOR scaled = nlerp(XMQuaternionIdentity(), delta, factor);
+        store_rotation(values, nodeIndex, XMQuaternionNormalize(XMQuaternionMultiply(scaled, load_rotation(values, nodeIndex))));
+    }
+}
+
+BoneMask BoneMask::subtree(const Pose::Hierarchy& hierarchy, uint32_t rootNode, float weight) {
+    BoneMask mask;
+    std::vector<bool> inside(hierarchy.node_count(), false);
+    for (size_t i = 0; i < hierarchy.order.size(); ++i) {
+        const uint32_t nodeIndex = hierarchy.order.at(i);
+        const int32_t parent = hierarchy.parents.at(i);
+        if (nodeIndex == rootNode || (parent >= 0 && inside.at(parent))) {
+            inside.at(nodeIndex) = true;
+            mask.add(nodeIndex, weight);
+        }
+    }
+    return mask;
+}
+
+uint32_t BlendTree::add_parameter(float value) {
+    parameters.push_back(value);
+    return static_cast<uint32_t>(parameters.size() - 1);
+}
+
+BlendTree::NodeId BlendTree::add_clip(const CompressedAnimation& clip, float samplingRate, ClipSampler::WrapMode wrapMode, float speed) {
+    Node node;
+    node.type = NodeType::CLIP;
+    node.sampler = ClipSampler(clip, samplingRate, wrapMode);
+    node.speed = speed;
+    nodes.push_back(std::move(node));
+    return static_cast<NodeId>(nodes.size() - 1);
+}
+
+BlendTree::NodeId BlendTree::add_blend_1d(uint32_t parameter, const std::vector<NodeId>& children, const std::vector<float>& thresholds) {
+    _ASSERT_EXPR(parameter < parameters.size(), L"Unknown blend parameter");
+    _ASSERT_EXPR(!children.empty() && children.size() == thresholds.size(), L"Each child needs a threshold");
+    _ASSERT_EXPR(std::is_sorted(thresholds.begin(), thresholds.end()), L"Thresholds must be ascending");
+    Node node;
+    node.type = NodeType::BLEND_1D;
+    node.parameters[0] = parameter;
+    node.children = children;
+    for (float threshold : thresholds) {
+        node.positions.push_back({ threshold, 0 });
+    }
+    node.childWeights.resize(children.size());
+    nodes.push_back(std::move(node));
+    const NodeId id = static_cast<NodeId>(nodes.size() - 1);
+    for (NodeId child : children) {
+        _ASSERT_EXPR(child < id, L"Children must be added before their blend node");
+    }
+    return id;
+}
+
+BlendTree::NodeId BlendTree::add_blend_2d(uint32_t parameterX, uint32_t parameterY, const std::vector<NodeId>& children,
+    const std::vector<XMFLOAT2>& positions) {
+    _ASSERT_EXPR(parameterX < parameters.size() && parameterY < parameters.size(), L"Unknown blend parameter");
+    _ASSERT_EXPR(!children.empty() && children.size() == positions.size(), L"Each child needs a position");
+    Node node;
+    node.type = NodeType::BLEND_2D;
+    node.parameters[0] = parameterX;
+    node.parameters[1] = parameterY;
+    node.children = children;
+    node.positions = positions;
+    node.childWeights.resize(children.size());
+    nodes.push_back(std::move(node));
+    const NodeId id = static_cast<NodeId>(nodes.size() - 1);
+    for (NodeId child : children) {
+        _ASSERT_EXPR(child < id, L"Children must be added before their blend node");
+    }
+    return id;
+}
+
+size_t BlendTree::add_layer(NodeId node, LayerMode mode, float weight, BoneMask mask, NodeId reference) {
+    _ASSERT_EXPR(node < nodes.size(), L"Unknown blend tree node");
+    _ASSERT_EXPR(mode != LayerMode::ADDITIVE || reference < nodes.size(), L"Additive layers need a reference pose");
+    Layer layer;
+    layer.node = node;
+    layer.reference = reference;
+    layer.mode = mode;
+    layer.weight = weight;
+    layer.mask = std::move(mask);
+    layers.push_back(std::move(layer));
+    return layers.size() - 1;
+}
+
+void BlendTree::prepare(size_t count) {
+    nodeCount = count;
+    poses.resize(nodes.size());
+    size_t largestClip = 0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        poses.at(i).resize(nodeCount);
+        if (nodes.at(i).type == NodeType::CLIP) {
+            largestClip = std::max<size_t>(largestClip, nodes.at(i).sampler.sequence()->node_count());
+        }
+    }
+    transforms.resize(largestClip);
+    // The first sample sizes each sampler's key cursor
+    for (Node& node : nodes) {
+        if (node.type == NodeType::CLIP) {
+            node.sampler.sample(node.time, transforms.data());
+        }
+    }
+    for (const Layer& layer : layers) {
+        for (uint32_t nodeIndex : layer.mask.nodes) {
+            _ASSERT_EXPR(nodeIndex < nodeCount, L"Bone mask node out of range");
+        }
+    }
+
+    // Which scene nodes each tree node is needed for : all of them below the root and unmasked layers, the union of
+    // the masks below masked layers. Parents come after their children, so one backward pass hands them down.
+    for (Node& node : nodes) {
+        node.allSceneNodes = false;
+        node.sceneNodeMask.assign(node.type == NodeType::CLIP ? std::max<size_t>(nodeCount, node.sampler.sequence()->node_count()) :
+            nodeCount, 0);
+    }
+    auto use = [&](NodeId id, const BoneMask& mask) {
+        Node& node = nodes.at(id);
+        if (mask.empty()) {
+            node.allSceneNodes = true;
+            return;
+        }
+        for (size_t i = 0; i < mask.nodes.size(); ++i) {
+            if (mask.weights.at(i) > 0) {
+                node.sceneNodeMask.at(mask.nodes.at(i)) = 1;
+            }
+        }
+    };
+    if (root < nodes.size()) {
+        use(root, BoneMask());
+    }
+    for (const Layer& layer : layers) {
+        use(layer.node, layer.mask);
+        if (layer.mode == LayerMode::ADDITIVE) {
+            use(layer.reference, layer.mask);
+        }
+    }
+    for (size_t id = nodes.size(); id-- > 0;) {
+        const Node& node = nodes.at(id);
+        for (NodeId childId : node.children) {
+            Node& child = nodes.at(childId);
+            child.allSceneNodes = child.allSceneNodes || node.allSceneNodes;
+            for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+                child.sceneNodeMask.at(nodeIndex) |= node.sceneNodeMask.at(nodeIndex);
+            }
+        }
+    }
+}
+
+void BlendTree::compute_child_weights(Node& node) {
+    std::fill(node.childWeights.begin(), node.childWeights.end(), 0.0f);
+    const size_t childCount = node.children.size();
+    if (node.type == NodeType::BLEND_1D) {
+        const float value = parameters.at(node.parameters[0]);
+        if (value <= node.positions.front().x) {
+            node.childWeights.front() = 1;
+            return;
+        }
+        if (value >= node.positions.back().x) {
+            node.childWeights.back() = 1;
+            return;
+        }
+        size_t upper = 1;
+        while (node.positions.at(upper).x < value) {
+            ++upper;
+        }
+        const float lower = node.positions.at(upper - 1).x;
+        const float span = node.positions.at(upper).x - lower;
+        const float factor = span > 0 ? (value - lower) / span : 1.0f;
+        node.childWeights.at(upper - 1) = 1 - factor;
+        node.childWeights.at(upper) = factor;
+        return;
+    }
+
+    // Inverse squared distance; a child sitting on the parameter point takes it all
+    const float x = parameters.at(node.parameters[0]);
+    const float y = parameters.at(node.parameters[1]);
+    constexpr float EPSILON = 1e-6f;
+    float total = 0;
+    for (size_t i = 0; i < childCount; ++i) {
+        const float dx = node.positions.at(i).x - x;
+        const float dy = node.positions.at(i).y - y;
+        const float distanceSquared = dx * dx + dy * dy;
+        if (distanceSquared < EPSILON) {
+            std::fill(node.childWeights.begin(), node.childWeights.end(), 0.0f);
+            node.childWeights.at(i) = 1;
+            return;
+        }
+        node.childWeights.at(i) = 1 / distanceSquared;
+        total += node.childWeights.at(i);
+    }
+    for (float& weight : node.childWeights) {
+        weight /= total;
+    }
+}
+
+void BlendTree::blend_children(const Node& node, Pose& output) const {
+    Streams out(output);
+    bool first = true;
+    for (size_t i = 0; i < node.children.size(); ++i) {
+        const float weight = node.childWeights.at(i);
+        if (weight <= 0) {
+            continue;
+        }
+        ConstStreams in(poses.at(node.children.at(i)));
+        if (first) {
+            for (int streamIndex = 0; streamIndex < Pose::STREAM_COUNT; ++streamIndex) {
+                const float* source = in.values[streamIndex];
+                float* destination = out.values[streamIndex];
+                for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+                    destination[nodeIndex] = source[nodeIndex] * weight;
+                }
+            }
+            first = false;
+            continue;
+        }
+        for (int streamIndex : { Pose::SCALING_X, Pose::SCALING_Y, Pose::SCALING_Z,
+            Pose::TRANSLATION_X, Pose::TRANSLATION_Y, Pose::TRANSLATION_Z }) {
+            const float* source = in.values[streamIndex];
+            float* destination = out.values[streamIndex];
+            for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+                destination[nodeIndex] += source[nodeIndex] * weight;
+            }
+        }
+        // Quaternions are summed on the accumulated one's side of the sphere, then normalized below
+        for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+            float dot = 0;
+            for (int component = Pose::ROTATION_X; component <= Pose::ROTATION_W; ++component) {
+                dot += out.values[component][nodeIndex] * in.values[component][nodeIndex];
+            }
+            const float signedWeight = dot < 0 ? -weight : weight;
+            for (int component = Pose::ROTATION_X; component <= Pose::ROTATION_W; ++component) {
+                out.values[component][nodeIndex] += in.values[component][nodeIndex] * signedWeight;
+            }
+        }
+    }
+    for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+        float lengthSquared = 0;
+        for (int component = Pose::ROTATION_X; component <= Pose::ROTATION_W; ++component) {
+            lengthSquared += out.values[component][nodeIndex] * out.values[component][nodeIndex];
+        }
+        const float scale = lengthSquared > 0 ? 1 / sqrtf(lengthSquared) : 0.0f;
+        for (int component = Pose::ROTATION_X; component <= Pose::ROTATION_W; ++component) {
+            out.values[component][nodeIndex] *= scale;
+        }
+        if (lengthSquared <= 0) {
+            out.values[Pose::ROTATION_W][nodeIndex] = 1;
+        }
+    }
+}
+
+void BlendTree::apply_layer(const Layer& layer, Pose& output) const {
+    Streams out(output);
+    ConstStreams in(poses.at(layer.node));
+    const bool additive = layer.mode == LayerMode::ADDITIVE;
+    ConstStreams reference(poses.at(additive ? layer.reference : layer.node));
+    auto apply = [&](size_t nodeIndex, float factor) {
+        if (additive) {
+            add_node(out.values, in.values, reference.values, nodeIndex, factor);
+        }
+        else {
+            override_node(out.values, in.values, nodeIndex, factor);
+        }
+    };
+
+    if (layer.mask.empty()) {
+        for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+            apply(nodeIndex, layer.weight);
+        }
+        return;
+    }
+    for (size_t i = 0; i < layer.mask.nodes.size(); ++i) {
+        const float factor = layer.weight * layer.mask.weights.at(i);
+        if (factor > 0) {
+            apply(layer.mask.nodes.at(i), factor);
+        }
+    }
+}
+
+void BlendTree::advance(float elapsedSeconds) {
+    for (Node& node : nodes) {
+        if (node.type == NodeType::CLIP) {
+            node.time += elapsedSeconds * node.speed;
+        }
+    }
+}
+
+void BlendTree::evaluate(float elapsedSeconds, Pose& pose) {
+    _ASSERT_EXPR(root < nodes.size(), L"The blend tree has no root");
+    _ASSERT_EXPR(poses.size() == nodes.size(), L"prepare the blend tree after building it");
+    pose.resize(nodeCount);
+
+    // Weights flow from the root and the layers down to the clips. Parents come after their children, so one
+    // backward pass sees every parent's final weight before its children.
+    for (Node& node : nodes) {
+        node.weight = 0;
+        if (node.type == NodeType::CLIP) {
+            node.time += elapsedSeconds * node.speed;
+        }
+    }
+    nodes.at(root).weight = 1;
+    for (const Layer& layer : layers) {
+        if (layer.weight > 0) {
+            nodes.at(layer.node).weight += layer.weight;
+            if (layer.mode == LayerMode::ADDITIVE) {
+                nodes.at(layer.reference).weight += layer.weight;
+            }
+        }
+    }
+    for (size_t id = nodes.size(); id-- > 0;) {
+        Node& node = nodes.at(id);
+        if (node.type == NodeType::CLIP || node.weight <= 0) {
+            continue;
+        }
+        compute_child_weights(node);
+        for (size_t i = 0; i < node.children.size(); ++i) {
+            nodes.at(node.children.at(i)).weight += node.weight * node.childWeights.at(i);
+        }
+    }
+
+    for (size_t id = 0; id < nodes.size(); ++id) {
+        Node& node = nodes.at(id);
+        if (node.weight <= 0) {
+            continue;
+        }
+        Pose& output = poses.at(id);
+        if (node.type != NodeType::CLIP) {
+            blend_children(node, output);
+            continue;
+        }
+        // The nodes outside the mask get the clip's rest pose, which nothing reads
+        node.sampler.sample(node.time, transforms.data(), node.allSceneNodes ? nullptr : node.sceneNodeMask.data());
+        const size_t count = std::min<size_t>(nodeCount, node.sampler.sequence()->node_count());
+        Streams out(output);
+        for (size_t nodeIndex = 0; nodeIndex < count; ++nodeIndex) {
+            const CompressedAnimation::Transform& transform = transforms.at(nodeIndex);
+            out.values[Pose::SCALING_X][nodeIndex] = transform.scaling.x;
+            out.values[Pose::SCALING_Y][nodeIndex] = transform.scaling.y;
+            out.values[Pose::SCALING_Z][nodeIndex] = transform.scaling.z;
+            out.values[Pose::ROTATION_X][nodeIndex] = transform.rotation.x;
+            out.values[Pose::ROTATION_Y][nodeIndex] = transform.rotation.y;
+            out.values[Pose::ROTATION_Z][nodeIndex] = transform.rotation.z;
+            out.values[Pose::ROTATION_W][nodeIndex] = transform.rotation.w;
+            out.values[Pose::TRANSLATION_X][nodeIndex] = transform.translation.x;
+            out.values[Pose::TRANSLATION_Y][nodeIndex] = transform.translation.y;
+            out.values[Pose::TRANSLATION_Z][nodeIndex] = transform.translation.z;
+        }
+    }
+
+    const Pose& base = poses.at(root);
+    for (int streamIndex = 0; streamIndex < Pose::STREAM_COUNT; ++streamIndex) {
+        const Pose::Stream stream = static_cast<Pose::Stream>(streamIndex);
+        memcpy(pose.stream(stream), base.stream(stream), nodeCount * sizeof(float));
+    }
+    for (const Layer& layer : layers) {
+        if (layer.weight > 0) {
+            apply_layer(layer, pose);
+        }
+    }
+}
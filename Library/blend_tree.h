@@ -0,0 +1,113 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "pose.h"
+#include "clip_sampler.h"
+
+// Per-node weights of a blend layer. Only the listed nodes are blended; the rest keep what the layers
+// below produced.
+struct BoneMask {
+    std::vector<uint32_t> nodes;
+    std::vector<float> weights;
+
+    void add(uint32_t nodeIndex, float weight = 1.0f) {
+        nodes.push_back(nodeIndex);
+        weights.push_back(weight);
+    }
+    // 'rootNode' and everything below it, e.g. the spine for an upper body layer
+    static BoneMask subtree(const Pose::Hierarchy& hierarchy, uint32_t rootNode, float weight = 1.0f);
+    bool empty() const { return nodes.empty(); }
+};
+
+// Blend tree evaluator over SoA poses (see pose.h).
+//
+// Nodes are clips, 1D blend spaces and 2D blend spaces; a node's children have to be added before it, so
+// evaluating in creation order always finds the inputs ready. The root node's pose is the base, then every
+// layer is applied in order, overriding or adding onto the masked nodes only.
+//
+// Every buffer is allocated by prepare; evaluate doesn't touch the heap, and the result depends only on the
+// tree, its parameters and the elapsed times, so it can be checked without a device.
+class BlendTree {
+public:
+    using NodeId = uint32_t;
+    static const NodeId INVALID_NODE = UINT32_MAX;
+
+    enum class LayerMode {
+        OVERRIDE,   // lerp towards the layer's pose by the layer weight
+        ADDITIVE,   // adds the layer's difference from its reference pose, scaled by the layer weight
+    };
+
+    // Parameters drive the blend spaces. Returns the parameter index.
+    uint32_t add_parameter(float value = 0);
+    void set_parameter(uint32_t parameter, float value) { parameters.at(parameter) = value; }
+    float parameter(uint32_t parameter) const { return parameters.at(parameter); }
+
+    // 'clip' must outlive the tree. 'speed' scales the elapsed time; 0 holds the first frame (additive references).
+    NodeId add_clip(const CompressedAnimation& clip, float samplingRate, ClipSampler::WrapMode wrapMode = ClipSampler::WrapMode::LOOP,
+        float speed = 1.0f);
+    // Children placed on the parameter's axis at 'thresholds' (ascending). The two around the parameter are blended.
+    NodeId add_blend_1d(uint32_t parameter, const std::vector<NodeId>& children, const std::vector<float>& thresholds);
+    // Children placed at 'positions' in the plane of two parameters, weighted by inverse squared distance.
+    NodeId add_blend_2d(uint32_t parameterX, uint32_t parameterY, const std::vector<NodeId>& children,
+        const std::vector<DirectX::XMFLOAT2>& positions);
+    void set_root(NodeId node) { root = node; }
+
+    // 'mask' empty : every node. 'reference' : the pose ADDITIVE layers are relative to, typically the same clip held
+    // at its first frame. Returns the layer index.
+    size_t add_layer(NodeId node, LayerMode mode, float weight = 1.0f, BoneMask mask = {}, NodeId reference = INVALID_NODE);
+    void set_layer_weight(size_t layer, float weight) { layers.at(layer).weight = weight; }
+
+    // Allocates the pose buffers for 'nodeCount' scene nodes. Call once after building the tree.
+    void prepare(size_t nodeCount);
+
+    // Advances every clip by 'elapsedSeconds' and writes the blended local transforms into 'pose' (resized to the
+    // prepared node count). Nodes that end up with no weight are not sampled, and a clip that only feeds masked
+    // layers only decodes the tracks of the nodes in their masks.
+    void evaluate(float elapsedSeconds, Pose& pose);
+    // Advances every clip like evaluate without sampling or blending anything (instances nobody sees).
+    void advance(float elapsedSeconds);
+
+private:
+    enum class NodeType { CLIP, BLEND_1D, BLEND_2D };
+    struct Node {
+        NodeType type = NodeType::CLIP;
+        // CLIP
+        ClipSampler sampler;
+        float speed = 1.0f;
+        float time = 0;
+        // BLEND_1D / BLEND_2D
+        uint32_t parameters[2] = {};
+        std::vector<NodeId> children;
+        std::vector<DirectX::XMFLOAT2> positions;   // 1D : x only
+        std::vector<float> childWeights;            // this frame's
+        // Evaluation
+        float weight = 0;                           // this frame's influence on the output; 0 skips the node
+        // Scene nodes the output uses this node's pose for (prepare) : all of them, or the flagged ones only
+        bool allSceneNodes = false;
+        std::vector<uint8_t> sceneNodeMask;         // CLIP : node_count() of the clip, for ClipSampler::sample
+    };
+    struct Layer {
+        NodeId node = INVALID_NODE;
+        NodeId reference = INVALID_NODE;
+        LayerMode mode = LayerMode::OVERRIDE;
+        float weight = 1.0f;
+        BoneMask mask;
+    };
+
+    void compute_child_weights(Node& node);
+    void blend_children(const Node& node, Pose& output) const;
+    void apply_layer(const Layer& layer, Pose& output) const;
+
+    std::vector<float> parameters;
+    std::vector<Node> nodes;
+    std::vector<Layer> layers;
+    NodeId root = INVALID_NODE;
+
+    size_t nodeCount = 0;
+    std::vector<Pose> poses; // one per tree node
+    std::vector<CompressedAnimation::Transform> transforms;
+};
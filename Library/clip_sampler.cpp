@@ -0,0 +1,50 @@
+#include "clip_sampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+ClipSampler::ClipSampler(const CompressedAnimation& sequence, float samplingRate, WrapMode wrapMode,
+    CompressedAnimation::RotationInterpolation rotationInterpolation) :
+    clip(&sequence), samplingRate(samplingRate), wrapMode(wrapMode), rotationInterpolation(rotationInterpolation) {
+}
+
+float ClipSampler::duration() const {
+    return clip && samplingRate > 0 ? clip->frame_count() / samplingRate : 0.0f;
+}
+
+float ClipSampler::frame_at(float seconds) const {
+    if (!clip || clip->frame_count() == 0 || samplingRate <= 0) {
+        return 0;
+    }
+    const float frame = seconds * samplingRate;
+    const float lastFrame = static_cast<float>(clip->frame_count() - 1);
+    switch (wrapMode) {
+    case WrapMode::LOOP: {
+        // One cycle also covers the span from the last frame back to the first
+        const float period = lastFrame + 1;
+        const float wrapped = fmodf(frame, period);
+        return wrapped < 0 ? wrapped + period : wrapped;
+    }
+    case WrapMode::PING_PONG: {
+        if (lastFrame <= 0) {
+            return 0;
+        }
+        const float period = lastFrame * 2;
+        float wrapped = fmodf(frame, period);
+        if (wrapped < 0) {
+            wrapped += period;
+        }
+        return wrapped > lastFrame ? period - wrapped : wrapped;
+    }
+    case WrapMode::CLAMP:
+    default:
+        return std::clamp(frame, 0.0f, lastFrame);
+    }
+}
+
+void ClipSampler::sample(float seconds, CompressedAnimation::Transform* pose, const uint8_t* nodeMask) {
+    if (!clip) {
+        return;
+    }
+    clip->sample(frame_at(seconds), pose, cursor, wrapMode == WrapMode::LOOP, rotationInterpolation, nodeMask);
+}
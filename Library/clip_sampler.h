@@ -0,0 +1,41 @@
+#pragma once
+
+#include "compressed_animation.h"
+
+// Plays a CompressedAnimation by time instead of by baked frame. Poses between two frames are interpolated
+// (lerp for scaling/translation, nlerp or slerp for rotation), so a clip baked at a low rate such as 15 Hz
+// still plays smoothly at any frame rate. Keeps a CompressedAnimation::Cursor, which makes sequential
+// playback O(1) per track : use one sampler per playing instance.
+class ClipSampler {
+public:
+    enum class WrapMode {
+        LOOP,       // wraps to the start, blending the last frame into the first
+        CLAMP,      // holds the first/last frame outside the clip
+        PING_PONG,  // plays forward, then backward
+    };
+
+    ClipSampler() = default;
+    // 'sequence' must outlive the sampler. 'samplingRate' : frames per second the clip was baked at.
+    ClipSampler(const CompressedAnimation& sequence, float samplingRate, WrapMode wrapMode = WrapMode::LOOP,
+        CompressedAnimation::RotationInterpolation rotationInterpolation = CompressedAnimation::RotationInterpolation::NLERP);
+
+    // Seconds of one pass through the clip : frame_count() / samplingRate, the clip's end time.
+    float duration() const;
+
+    // Frame (fractional) that 'seconds' of playback lands on after wrapping.
+    float frame_at(float seconds) const;
+
+    // Decodes the local transforms 'seconds' into playback into 'pose' (node_count() elements).
+    // 'nodeMask' : see CompressedAnimation::sample.
+    void sample(float seconds, CompressedAnimation::Transform* pose, const uint8_t* nodeMask = nullptr);
+
+    const CompressedAnimation* sequence() const { return clip; }
+    WrapMode wrap_mode() const { return wrapMode; }
+
+private:
+    const CompressedAnimation* clip = nullptr;
+    float samplingRate = 0;
+    WrapMode wrapMode = WrapMode::LOOP;
+    CompressedAnimation::RotationInterpolation rotationInterpolation = CompressedAnimation::RotationInterpolation::NLERP;
+    CompressedAnimation::Cursor cursor;
+};
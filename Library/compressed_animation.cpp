@@ -0,0 +1,372 @@
+#include "compressed_animation.h"
+#include "misc.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace {
+    constexpr float SQRT2 = 1.41421356f;
+    constexpr float ROTATION_SCALE = 32767.0f; // 15 bits
+    constexpr float RANGE_SCALE = 65535.0f;    // 16 bits
+    // Longest run of frames a single pair of keys may span. Bounds the cost of the reduction pass,
+    // which re-checks every covered frame each time a segment is extended.
+    constexpr uint32_t MAX_KEY_GAP = 255;
+    // Keys a Cursor may walk before the lookup falls back to a binary search
+    constexpr uint32_t MAX_CURSOR_STEPS = 4;
+
+    // Smallest three : drop the largest component (recovered from the unit length), store which one it was
+    // in the top bits of the first two values.
+    void quantize_rotation(const XMFLOAT4& rotation, uint16_t values[3]) {
+        const float components[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+        int largest = 0;
+        for (int component = 1; component < 4; ++component) {
+            if (fabsf(components[component]) > fabsf(components[largest])) {
+                largest = component;
+            }
+        }
+        // q and -q are the same rotation; make the dropped component positive.
+        const float sign = components[largest] < 0 ? -1.0f : 1.0f;
+        int valueIndex = 0;
+        for (int component = 0; component < 4; ++component) {
+            if (component == largest) {
+                continue;
+            }
+            const float value = std::clamp(components[component] * sign * SQRT2, -1.0f, 1.0f);
+            values[valueIndex++] = static_cast<uint16_t>(lroundf((value * 0.5f + 0.5f) * ROTATION_SCALE));
+        }
+        values[0] |= static_cast<uint16_t>((largest & 1) << 15);
+        values[1] |= static_cast<uint16_t>((largest >> 1) << 15);
+    }
+
+    XMFLOAT4 dequantize_rotation(const uint16_t values[3]) {
+        const int largest = (values[0] >> 15) | ((values[1] >> 15) << 1);
+        float components[4];
+        float lengthSquared = 0;
+        int valueIndex = 0;
+        for (int component = 0; component < 4; ++component) {
+            if (component == largest) {
+                continue;
+            }
+            const float value = ((values[valueIndex++] & 0x7FFF) / ROTATION_SCALE * 2.0f - 1.0f) / SQRT2;
+            components[component] = value;
+            lengthSquared += value * value;
+        }
+        components[largest] = sqrtf(std::max(0.0f, 1.0f - lengthSquared));
+        return { components[0], components[1], components[2], components[3] };
+    }
+
+    void quantize_range(const XMFLOAT4& value, const CompressedAnimation::Track& track, uint16_t values[3]) {
+        const float v[3] = { value.x, value.y, value.z };
+        const float minimum[3] = { track.rangeMin.x, track.rangeMin.y, track.rangeMin.z };
+        const float extent[3] = { track.rangeExtent.x, track.rangeExtent.y, track.rangeExtent.z };
+        for (int component = 0; component < 3; ++component) {
+            values[component] = extent[component] > 0 ?
+                static_cast<uint16_t>(lroundf(std::clamp((v[component] - minimum[component]) / extent[component], 0.0f, 1.0f) * RANGE_SCALE)) : 0;
+        }
+    }
+
+    XMFLOAT4 dequantize_range(const uint16_t values[3], const CompressedAnimation::Track& track) {
+        return {
+            track.rangeMin.x + values[0] / RANGE_SCALE * track.rangeExtent.x,
+            track.rangeMin.y + values[1] / RANGE_SCALE * track.rangeExtent.y,
+            track.rangeMin.z + values[2] / RANGE_SCALE * track.rangeExtent.z,
+            0,
+        };
+    }
+
+    inline float dot4(const XMFLOAT4& a, const XMFLOAT4& b) {
+        return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    }
+
+    // Normalized lerp along the shorter arc. Used both when measuring the reduction error and when sampling,
+    // so the error bound holds for what is actually played back.
+    XMFLOAT4 nlerp(const XMFLOAT4& a, const XMFLOAT4& b, float t) {
+        const float sign = dot4(a, b) < 0 ? -1.0f : 1.0f;
+        XMFLOAT4 result = {
+            a.x + (b.x * sign - a.x) * t,
+            a.y + (b.y * sign - a.y) * t,
+            a.z + (b.z * sign - a.z) * t,
+            a.w + (b.w * sign - a.w) * t,
+        };
+        const float length = sqrtf(dot4(result, result));
+        if (length > 0) {
+            result.x /= length;
+            result.y /= length;
+            result.z /= length;
+            result.w /= length;
+        }
+        return result;
+    }
+
+    inline XMFLOAT4 lerp(const XMFLOAT4& a, const XMFLOAT4& b, float t) {
+        return { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, 0 };
+    }
+
+    // Angle of the rotation between two unit quaternions. 4 * asin(|a - b| / 2) instead of 2 * acos(dot),
+    // which loses all precision for the tiny angles the tolerance is about.
+    float rotation_error(const XMFLOAT4& a, const XMFLOAT4& b) {
+        const float sign = dot4(a, b) < 0 ? -1.0f : 1.0f;
+        const XMFLOAT4 difference = { a.x - b.x * sign, a.y - b.y * sign, a.z - b.z * sign, a.w - b.w * sign };
+        return 4.0f * asinf(std::min(1.0f, sqrtf(dot4(difference, difference)) * 0.5f));
+    }
+
+    inline float distance_error(const XMFLOAT4& a, const XMFLOAT4& b) {
+        const float x = a.x - b.x, y = a.y - b.y, z = a.z - b.z;
+        return sqrtf(x * x + y * y + z * z);
+    }
+
+    inline XMFLOAT4 to_xmfloat4(const XMFLOAT3& v) {
+        return { v.x, v.y, v.z, 0 };
+    }
+}
+
+void CompressedAnimation::compress(const Transform* frames, uint32_t frameCount, uint32_t nodeCount, const Tolerance& tolerance) {
+    _ASSERT_EXPR_A(frameCount <= 65536, "Key frames are stored as 16 bit indices");
+
+    this->frameCount = frameCount;
+    restPose.clear();
+    trackList.clear();
+    keyFrames.clear();
+    keyValues.clear();
+    mapped = false;
+    stats = {};
+    if (frameCount == 0) {
+        restPose.resize(nodeCount);
+        return;
+    }
+    restPose.assign(frames, frames + nodeCount);
+
+    std::vector<XMFLOAT4> source(frameCount);
+    std::vector<XMFLOAT4> decoded(frameCount);
+    std::vector<uint16_t> quantized(frameCount * 3LL);
+    std::vector<uint32_t> keptFrames;
+    for (uint32_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+        for (Channel channel : { Channel::SCALING, Channel::ROTATION, Channel::TRANSLATION }) {
+            const bool isRotation = channel == Channel::ROTATION;
+            const float channelTolerance = isRotation ? tolerance.rotation :
+                channel == Channel::SCALING ? tolerance.scaling : tolerance.translation;
+            auto error = [isRotation](const XMFLOAT4& a, const XMFLOAT4& b) {
+                return isRotation ? rotation_error(a, b) : distance_error(a, b);
+            };
+
+            for (uint32_t frame = 0; frame < frameCount; ++frame) {
+                const Transform& transform = frames[static_cast<size_t>(frame) * nodeCount + nodeIndex];
+                if (isRotation) {
+                    XMStoreFloat4(&source.at(frame), XMQuaternionNormalize(XMLoadFloat4(&transform.rotation)));
+                    // Keep neighbouring quaternions in the same hemisphere so the track is continuous.
+                    if (frame > 0 && dot4(source.at(frame), source.at(frame - 1)) < 0) {
+                        XMStoreFloat4(&source.at(frame), XMVectorNegate(XMLoadFloat4(&source.at(frame))));
+                    }
+                }
+                else {
+                    source.at(frame) = to_xmfloat4(channel == Channel::SCALING ? transform.scaling : transform.translation);
+                }
+            }
+
+            bool constant = true;
+            for (uint32_t frame = 1; frame < frameCount && constant; ++frame) {
+                constant = error(source.at(frame), source.at(0)) <= channelTolerance;
+            }
+            if (constant) {
+                ++stats.constantChannels;
+                continue;
+            }
+            ++stats.animatedChannels;
+            stats.sourceKeyCount += frameCount;
+
+            Track& track = trackList.emplace_back();
+            track.nodeIndex = nodeIndex;
+            track.channel = channel;
+            track.firstKey = static_cast<uint32_t>(keyFrames.size());
+            if (!isRotation) {
+                XMVECTOR minimum = XMLoadFloat4(&source.at(0));
+                XMVECTOR maximum = minimum;
+                for (const XMFLOAT4& value : source) {
+                    minimum = XMVectorMin(minimum, XMLoadFloat4(&value));
+                    maximum = XMVectorMax(maximum, XMLoadFloat4(&value));
+                }
+                XMStoreFloat3(&track.rangeMin, minimum);
+                XMStoreFloat3(&track.rangeExtent, XMVectorSubtract(maximum, minimum));
+            }
+
+            for (uint32_t frame = 0; frame < frameCount; ++frame) {
+                uint16_t* values = &quantized.at(frame * 3LL);
+                if (isRotation) {
+                    quantize_rotation(source.at(frame), values);
+                    decoded.at(frame) = dequantize_rotation(values);
+                }
+                else {
+                    quantize_range(source.at(frame), track, values);
+                    decoded.at(frame) = dequantize_range(values, track);
+                }
+            }
+
+            // Greedy reduction : stretch each segment as far as interpolating its two (quantized) end keys
+            // still reproduces every source frame it covers.
+            auto fits = [&](uint32_t first, uint32_t last) {
+                for (uint32_t frame = first + 1; frame < last; ++frame) {
+                    const float t = static_cast<float>(frame - first) / (last - first);
+                    const XMFLOAT4 value = isRotation ?
+                        nlerp(decoded.at(first), decoded.at(last), t) : lerp(decoded.at(first), decoded.at(last), t);
+                    if (error(value, source.at(frame)) > channelTolerance) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            keptFrames.assign(1, 0);
+            uint32_t segmentStart = 0;
+            while (segmentStart + 1 < frameCount) {
+                uint32_t segmentEnd = segmentStart + 1;
+                while (segmentEnd + 1 < frameCount && segmentEnd + 1 - segmentStart <= MAX_KEY_GAP &&
+                    fits(segmentStart, segmentEnd + 1)) {
+                    ++segmentEnd;
+                }
+                keptFrames.push_back(segmentEnd);
+                segmentStart = segmentEnd;
+            }
+
+            for (uint32_t frame : keptFrames) {
+                keyFrames.push_back(static_cast<uint16_t>(frame));
+                keyValues.insert(keyValues.end(), &quantized.at(frame * 3LL), &quantized.at(frame * 3LL) + 3);
+            }
+            track.keyCount = static_cast<uint32_t>(keptFrames.size());
+        }
+    }
+    stats.keyCount = static_cast<uint32_t>(keyFrames.size());
+
+    // Measure what playback actually produces, constant channels included.
+    std::vector<Transform> pose(nodeCount);
+    for (uint32_t frame = 0; frame < frameCount; ++frame) {
+        sample(static_cast<float>(frame), pose.data());
+        const Transform* expected = frames + static_cast<size_t>(frame) * nodeCount;
+        for (uint32_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+            XMFLOAT4 rotation;
+            XMStoreFloat4(&rotation, XMQuaternionNormalize(XMLoadFloat4(&expected[nodeIndex].rotation)));
+            stats.maxRotationError = std::max(stats.maxRotationError, rotation_error(pose.at(nodeIndex).rotation, rotation));
+            stats.maxTranslationError = std::max(stats.maxTranslationError,
+                distance_error(to_xmfloat4(pose.at(nodeIndex).translation), to_xmfloat4(expected[nodeIndex].translation)));
+            stats.maxScalingError = std::max(stats.maxScalingError,
+                distance_error(to_xmfloat4(pose.at(nodeIndex).scaling), to_xmfloat4(expected[nodeIndex].scaling)));
+        }
+    }
+}
+
+void CompressedAnimation::sample(float frame, Transform* pose) const {
+    sample(frame, pose, nullptr, false, RotationInterpolation::NLERP, nullptr);
+}
+
+void CompressedAnimation::sample(float frame, Transform* pose, Cursor& cursor, bool loop,
+    RotationInterpolation rotationInterpolation, const uint8_t* nodeMask) const {
+    const size_t trackCount = tracks().size();
+    if (cursor.keys.size() != trackCount) {
+        cursor.keys.assign(trackCount, 0);
+    }
+    sample(frame, pose, &cursor, loop, rotationInterpolation, nodeMask);
+}
+
+void CompressedAnimation::sample(float frame, Transform* pose, Cursor* cursor, bool loop,
+    RotationInterpolation rotationInterpolation, const uint8_t* nodeMask) const {
+    const ArrayView<Transform> restPose = rest_pose();
+    std::copy(restPose.begin(), restPose.end(), pose);
+    if (frameCount == 0) {
+        return;
+    }
+    const float lastFrame = static_cast<float>(frameCount - 1);
+    frame = std::clamp(frame, 0.0f, loop ? static_cast<float>(frameCount) : lastFrame);
+
+    const ArrayView<Track> trackList = tracks();
+    const uint16_t* keyFrames = key_frames().data();
+    const uint16_t* keyValues = key_values().data();
+    for (size_t trackIndex = 0; trackIndex < trackList.size(); ++trackIndex) {
+        const Track& track = trackList[trackIndex];
+        if (nodeMask && !nodeMask[track.nodeIndex]) {
+            continue;
+        }
+        const uint16_t* frames = keyFrames + track.firstKey;
+        const uint16_t* values = keyValues + track.firstKey * 3LL;
+
+        // Key at or before 'frame'. The first key is always frame 0 and the last key the last frame.
+        auto search = [&]() {
+            const uint32_t next = static_cast<uint32_t>(std::upper_bound(frames, frames + track.keyCount, frame,
+                [](float value, uint16_t key) { return value < key; }) - frames);
+            return next > 0 ? next - 1 : 0;
+        };
+        uint32_t key0 = 0;
+        if (cursor) {
+            key0 = std::min(cursor->keys[trackIndex], track.keyCount - 1);
+            uint32_t steps = 0;
+            while (key0 > 0 && frames[key0] > frame && steps++ < MAX_CURSOR_STEPS) {
+                --key0;
+            }
+            while (key0 + 1 < track.keyCount && frames[key0 + 1] <= frame && steps++ < MAX_CURSOR_STEPS) {
+                ++key0;
+            }
+            if (steps > MAX_CURSOR_STEPS) {
+                key0 = search(); // jumped too far
+            }
+            cursor->keys[trackIndex] = key0;
+        }
+        else {
+            key0 = search();
+        }
+        uint32_t key1 = std::min(key0 + 1, track.keyCount - 1);
+        float t = key1 > key0 ? (frame - frames[key0]) / (frames[key1] - frames[key0]) : 0.0f;
+        if (loop && frame > lastFrame) {
+            // Between the last frame and the first one of the next cycle
+            key0 = track.keyCount - 1;
+            key1 = 0;
+            t = frame - lastFrame;
+        }
+
+        Transform& transform = pose[track.nodeIndex];
+        if (track.channel == Channel::ROTATION) {
+            const XMFLOAT4 rotation0 = dequantize_rotation(values + key0 * 3LL);
+            const XMFLOAT4 rotation1 = dequantize_rotation(values + key1 * 3LL);
+            if (rotationInterpolation == RotationInterpolation::SLERP) {
+                // XMQuaternionSlerp takes the short way round by itself
+                XMStoreFloat4(&transform.rotation, XMQuaternionSlerp(XMLoadFloat4(&rotation0), XMLoadFloat4(&rotation1), t));
+            }
+            else {
+                transform.rotation = nlerp(rotation0, rotation1, t);
+            }
+        }
+        else {
+            const XMFLOAT4 value = lerp(dequantize_range(values + key0 * 3LL, track), dequantize_range(values + key1 * 3LL, track), t);
+            XMFLOAT3& destination = track.channel == Channel::SCALING ? transform.scaling : transform.translation;
+            destination = { value.x, value.y, value.z };
+        }
+    }
+}
+
+bool CompressedAnimation::assign_view(uint32_t frameCount, const Transform* restPose, uint32_t nodeCount, const Track* tracks, uint32_t trackCount,
+    const uint16_t* keyFrames, const uint16_t* keyValues, uint32_t keyCount, const Statistics& statistics) {
+    for (uint32_t trackIndex = 0; trackIndex < trackCount; ++trackIndex) {
+        const Track& track = tracks[trackIndex];
+        if (track.nodeIndex >= nodeCount || track.keyCount == 0 ||
+            static_cast<uint64_t>(track.firstKey) + track.keyCount > keyCount) {
+            return false;
+        }
+    }
+    this->frameCount = frameCount;
+    this->restPose.clear();
+    trackList.clear();
+    this->keyFrames.clear();
+    this->keyValues.clear();
+    mapped = true;
+    mappedRestPose = { restPose, nodeCount };
+    mappedTracks = { tracks, trackCount };
+    mappedKeyFrames = { keyFrames, keyCount };
+    mappedKeyValues = { keyValues, static_cast<size_t>(keyCount) * 3 };
+    stats = statistics;
+    return true;
+}
+
+size_t CompressedAnimation::memory_size() const {
+    return sizeof(*this) +
+        rest_pose().size() * sizeof(Transform) +
+        tracks().size() * sizeof(Track) +
+        key_frames().size() * sizeof(uint16_t) +
+        key_values().size() * sizeof(uint16_t);
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Compressed storage for a sampled animation clip.
+//
+// Each node has a rest transform taken from frame 0. Channels (scaling, rotation, translation) that stay
+// within tolerance of it for the whole clip are dropped, the others become tracks. Track keys are quantized
+// to 48 bits, and keys that linear interpolation between their neighbours reproduces within tolerance are removed.
+//   rotation    : smallest three, 15 bits per component + 2 bits for the dropped component
+//   translation : 16 bits per component over the track's [min, max] range
+//   scaling     : 16 bits per component over the track's [min, max] range
+// Only local transforms are stored. Global matrices are rebuilt by the caller after sampling.
+class CompressedAnimation {
+public:
+    struct Transform {
+        DirectX::XMFLOAT3 scaling = { 1,1,1 };
+        DirectX::XMFLOAT4 rotation = { 0,0,0,1 }; // Rotation quaternion
+        DirectX::XMFLOAT3 translation = { 0,0,0 };
+        template<class T>
+        void serialize(T& archive) {
+            archive(scaling.x, scaling.y, scaling.z, rotation.x, rotation.y, rotation.z, rotation.w,
+                translation.x, translation.y, translation.z);
+        }
+    };
+
+    // Largest error a removed key or a quantized value may introduce, per channel.
+    struct Tolerance {
+        float rotation = 0.0005f;       // radians
+        float translation = 0.0005f;    // scene units
+        float scaling = 0.0001f;
+    };
+
+    enum class Channel : uint32_t {
+        SCALING,
+        ROTATION,
+        TRANSLATION,
+    };
+
+    struct Track {
+        uint32_t nodeIndex = 0;
+        Channel channel = Channel::ROTATION;
+        uint32_t firstKey = 0;  // into keyFrames and keyValues (3 values per key)
+        uint32_t keyCount = 0;
+        // Dequantization of translation/scaling keys : rangeMin + value / 65535 * rangeExtent
+        DirectX::XMFLOAT3 rangeMin = { 0,0,0 };
+        DirectX::XMFLOAT3 rangeExtent = { 0,0,0 };
+        template<class T>
+        void serialize(T& archive) {
+            archive(nodeIndex, channel, firstKey, keyCount, rangeMin.x, rangeMin.y, rangeMin.z,
+                rangeExtent.x, rangeExtent.y, rangeExtent.z);
+        }
+    };
+
+    struct Statistics {
+        uint32_t constantChannels = 0;
+        uint32_t animatedChannels = 0;
+        uint32_t sourceKeyCount = 0;    // animated channels * frame count
+        uint32_t keyCount = 0;          // keys left after reduction
+        // Measured against the source frames at compression time.
+        float maxRotationError = 0;     // radians
+        float maxTranslationError = 0;
+        float maxScalingError = 0;
+        template<class T>
+        void serialize(T& archive) {
+            archive(constantChannels, animatedChannels, sourceKeyCount, keyCount,
+                maxRotationError, maxTranslationError, maxScalingError);
+        }
+    };
+
+    // 'frames' holds frameCount * nodeCount local transforms, all nodes of frame 0 first.
+    void compress(const Transform* frames, uint32_t frameCount, uint32_t nodeCount, const Tolerance& tolerance);
+    void compress(const Transform* frames, uint32_t frameCount, uint32_t nodeCount) {
+        compress(frames, frameCount, nodeCount, Tolerance());
+    }
+
+    // Decodes the local transforms at 'frame' into 'pose' (node_count() elements). Fractional frames are
+    // interpolated, frames outside the clip are clamped.
+    void sample(float frame, Transform* pose) const;
+
+    enum class RotationInterpolation {
+        NLERP,  // cheaper, the angular speed varies slightly within a key span
+        SLERP,
+    };
+    // Key each track was on at the last sample. Playback moving a few keys either way from there finds its
+    // keys without a search. Reset it (or use a new one) when switching clips.
+    struct Cursor {
+        std::vector<uint32_t> keys;
+    };
+    // Same as above, starting the key lookup at 'cursor'. 'loop' : frames between the last one and frame_count()
+    // blend from the last frame back into frame 0, as a clip sampled up to (not including) its end time loops.
+    // 'nodeMask' : node_count() flags, null for all. The tracks of nodes whose flag is 0 aren't decoded; those
+    // nodes get the rest pose.
+    void sample(float frame, Transform* pose, Cursor& cursor, bool loop = false,
+        RotationInterpolation rotationInterpolation = RotationInterpolation::NLERP, const uint8_t* nodeMask = nullptr) const;
+
+    // Points the clip at its raw arrays in a cooked file's mapping instead of copying them. The arrays must
+    // outlive the clip and every copy of it. Returns false if they are inconsistent.
+    bool assign_view(uint32_t frameCount, const Transform* restPose, uint32_t nodeCount, const Track* tracks, uint32_t trackCount,
+        const uint16_t* keyFrames, const uint16_t* keyValues, uint32_t keyCount, const Statistics& statistics);
+
+    template<class T>
+    struct ArrayView {
+        const T* elements = nullptr;
+        size_t count = 0;
+        const T* data() const { return elements; }
+        size_t size() const { return count; }
+        const T* begin() const { return elements; }
+        const T* end() const { return elements + count; }
+        const T& operator[](size_t index) const { return elements[index]; }
+    };
+
+    uint32_t frame_count() const { return frameCount; }
+    uint32_t node_count() const { return static_cast<uint32_t>(rest_pose().size()); }
+    const Statistics& statistics() const { return stats; }
+    // Bytes of this clip, its arrays included wherever they live.
+    size_t memory_size() const;
+
+    // The clip's own arrays, or the mapping's after assign_view
+    ArrayView<Transform> rest_pose() const { return mapped ? mappedRestPose : ArrayView<Transform>{ restPose.data(), restPose.size() }; }
+    ArrayView<Track> tracks() const { return mapped ? mappedTracks : ArrayView<Track>{ trackList.data(), trackList.size() }; }
+    ArrayView<uint16_t> key_frames() const { return mapped ? mappedKeyFrames : ArrayView<uint16_t>{ keyFrames.data(), keyFrames.size() }; }
+    ArrayView<uint16_t> key_values() const { return mapped ? mappedKeyValues : ArrayView<uint16_t>{ keyValues.data(), keyValues.size() }; }
+
+    // A clip viewing a mapping is written with the same layout as one owning its arrays, and always read back owning them.
+    template<class T>
+    void save(T& archive) const {
+        if (!mapped) {
+            archive(frameCount, restPose, trackList, keyFrames, keyValues, stats);
+            return;
+        }
+        archive(frameCount, std::vector<Transform>(mappedRestPose.begin(), mappedRestPose.end()),
+            std::vector<Track>(mappedTracks.begin(), mappedTracks.end()),
+            std::vector<uint16_t>(mappedKeyFrames.begin(), mappedKeyFrames.end()),
+            std::vector<uint16_t>(mappedKeyValues.begin(), mappedKeyValues.end()), stats);
+    }
+    template<class T>
+    void load(T& archive) {
+        archive(frameCount, restPose, trackList, keyFrames, keyValues, stats);
+        mapped = false;
+    }
+
+private:
+    void sample(float frame, Transform* pose, Cursor* cursor, bool loop, RotationInterpolation rotationInterpolation,
+        const uint8_t* nodeMask) const;
+
+    uint32_t frameCount = 0;
+    std::vector<Transform> restPose;
+    std::vector<Track> trackList;
+    std::vector<uint16_t> keyFrames;
+    std::vector<uint16_t> keyValues;
+    // Set by assign_view, in place of the vectors above
+    bool mapped = false;
+    ArrayView<Transform> mappedRestPose;
+    ArrayView<Track> mappedTracks;
+    ArrayView<uint16_t> mappedKeyFrames;
+    ArrayView<uint16_t> mappedKeyValues;
+    Statistics stats;
+};
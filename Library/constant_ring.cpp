@@ -0,0 +1,195 @@
+#include "constant_ring.h"
+#include "misc.h"
+
+#include <thread>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+namespace {
+    size_t align(size_t size) {
+        return (size + ConstantRing::ALIGNMENT - 1) / ConstantRing::ALIGNMENT * ConstantRing::ALIGNMENT;
+    }
+
+    std::vector<ConstantRing*> sharedRings;
+}
+
+ConstantRing::ConstantRing(ID3D11Device* device, ID3D11DeviceContext* context, size_t bytes, UINT framesInFlight)
+    : ringContext(context), deferred(context->GetType() == D3D11_DEVICE_CONTEXT_DEFERRED), capacity(align(bytes)),
+    framesInFlight(framesInFlight) {
+    _ASSERT_EXPR(framesInFlight > 0, L"At least one frame must be in flight");
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+    HRESULT hr = device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+    if (FAILED(hr) || !options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer) {
+        return;
+    }
+    hr = ringContext->QueryInterface<ID3D11DeviceContext1>(ringContext1.GetAddressOf());
+    if (FAILED(hr)) {
+        ringContext1.Reset();
+        return;
+    }
+
+    D3D11_BUFFER_DESC bufferDesc = {};
+    bufferDesc.ByteWidth = static_cast<UINT>(capacity);
+    bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+    bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    hr = device->CreateBuffer(&bufferDesc, nullptr, buffer.GetAddressOf());
+    _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+    if (deferred) {
+        return;
+    }
+
+    // end_frame keeps at most 'framesInFlight' fenced frames, plus the one it is adding
+    D3D11_QUERY_DESC queryDesc = {};
+    queryDesc.Query = D3D11_QUERY_EVENT;
+    freeFences.resize(framesInFlight + 1);
+    for (Microsoft::WRL::ComPtr<ID3D11Query>& fence : freeFences) {
+        hr = device->CreateQuery(&queryDesc, fence.GetAddressOf());
+        _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+    }
+}
+
+ConstantRing::Slice ConstantRing::allocate(const void* data, size_t size) {
+    _ASSERT_EXPR(supported(), L"The device can't bind constant buffer offsets : check supported()");
+    _ASSERT_EXPR(size > 0 && size <= D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT * 16, L"A slice binds 1 to 4096 constants");
+    const size_t alignedSize = align(size);
+
+    // A slice doesn't wrap : the rest of the ring is skipped and counts as used until its frame retires
+    size_t offset = head;
+    size_t padding = 0;
+    if (head + alignedSize > capacity) {
+        offset = 0;
+        padding = capacity - head;
+    }
+    while (usedBytes + padding + alignedSize > capacity && !frames.empty()) {
+        retire_oldest(true);
+    }
+
+    D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+    if (!mapped || usedBytes + padding + alignedSize > capacity) {
+        // First use (of the command list), or this frame alone fills the ring : start over on a new buffer from
+        // the driver. The frame's earlier slices stay valid in the old one.
+        if (mapped) {
+            ++ringStatistics.discards;
+        }
+        mapType = D3D11_MAP_WRITE_DISCARD;
+        mapped = true;
+        offset = 0;
+        padding = 0;
+        usedBytes = 0;
+        frameBytes = 0;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mappedSubresource;
+    HRESULT hr = ringContext->Map(buffer.Get(), 0, mapType, 0, &mappedSubresource);
+    _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+    memcpy(static_cast<uint8_t*>(mappedSubresource.pData) + offset, data, size);
+    ringContext->Unmap(buffer.Get(), 0);
+
+    head = offset + alignedSize;
+    usedBytes += padding + alignedSize;
+    frameBytes += padding + alignedSize;
+    ++ringStatistics.allocations;
+    ringStatistics.bytes += alignedSize;
+
+    Slice slice;
+    slice.buffer = buffer.Get();
+    slice.firstConstant = static_cast<UINT>(offset / 16);
+    slice.constantCount = static_cast<UINT>(alignedSize / 16);
+    return slice;
+}
+
+void ConstantRing::bind_vs(UINT slot, const Slice& slice) {
+    ringContext1->VSSetConstantBuffers1(slot, 1, &slice.buffer, &slice.firstConstant, &slice.constantCount);
+}
+
+void ConstantRing::bind_ps(UINT slot, const Slice& slice) {
+    ringContext1->PSSetConstantBuffers1(slot, 1, &slice.buffer, &slice.firstConstant, &slice.constantCount);
+}
+
+void ConstantRing::end_frame() {
+    if (!supported()) {
+        return;
+    }
+    if (deferred) {
+        // The next command list gets a buffer of its own with DISCARD : the ring is empty again
+        mapped = false;
+        head = 0;
+        usedBytes = 0;
+        frameBytes = 0;
+        return;
+    }
+    _ASSERT_EXPR(!freeFences.empty(), L"No fence left for the frame");
+    Frame frame = { freeFences.back(), frameBytes };
+    freeFences.pop_back();
+    ringContext->End(frame.fence.Get());
+    frames.push_back(frame);
+    frameBytes = 0;
+
+    // Give back what the GPU is done with, and don't let the CPU get more than 'framesInFlight' frames ahead
+    while (!frames.empty() && retire_oldest(false)) {
+    }
+    while (frames.size() > framesInFlight) {
+        retire_oldest(true);
+    }
+}
+
+bool ConstantRing::retire_oldest(bool wait) {
+    Frame& frame = frames.front();
+    HRESULT hr = ringContext->GetData(frame.fence.Get(), nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH);
+    if (hr == S_FALSE) {
+        if (!wait) {
+            return false;
+        }
+        ++ringStatistics.waits;
+        // Flushes once so the fence gets to the GPU, then spins
+        while ((hr = ringContext->GetData(frame.fence.Get(), nullptr, 0, 0)) == S_FALSE) {
+            std::this_thread::yield();
+        }
+    }
+    _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+    usedBytes -= frame.bytes;
+    freeFences.push_back(frame.fence);
+    frames.pop_front();
+    return true;
+}
+
+void add_shared_constant_ring(ConstantRing* ring) {
+    _ASSERT_EXPR(!shared_constant_ring(ring->context()), L"The context already has a ring");
+    sharedRings.push_back(ring);
+}
+
+void remove_shared_constant_ring(ConstantRing* ring) {
+    sharedRings.erase(std::remove(sharedRings.begin(), sharedRings.end(), ring), sharedRings.end());
+}
+
+// Looked up from the workers recording passes too : sharedRings only changes while nothing is recorded
+ConstantRing* shared_constant_ring(ID3D11DeviceContext* context) {
+    for (ConstantRing* ring : sharedRings) {
+        if (ring->supported() && ring->context() == context) {
+            return ring;
+        }
+    }
+    return nullptr;
+}
+
+void upload_constants(ID3D11DeviceContext* context, UINT slot, ID3D11Buffer* buffer, const void* data, size_t size, UINT stages) {
+    if (ConstantRing* ring = shared_constant_ring(context)) {
+        const ConstantRing::Slice slice = ring->allocate(data, size);
+        if (stages & CONSTANT_STAGE_VS) {
+            ring->bind_vs(slot, slice);
+        }
+        if (stages & CONSTANT_STAGE_PS) {
+            ring->bind_ps(slot, slice);
+        }
+        return;
+    }
+    context->UpdateSubresource(buffer, 0, 0, data, 0, 0);
+    if (stages & CONSTANT_STAGE_VS) {
+        context->VSSetConstantBuffers(slot, 1, &buffer);
+    }
+    if (stages & CONSTANT_STAGE_PS) {
+        context->PSSetConstantBuffers(slot, 1, &buffer);
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <d3d11_1.h>
+#include <wrl.h>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+// One large dynamic constant buffer that draws sub-allocate their constants from, instead of each renderer
+// versioning its own D3D11_USAGE_DEFAULT buffer with an UpdateSubresource per draw.
+//
+// allocate copies the constants to the ring's head with MAP_WRITE_NO_OVERWRITE and returns a 256 byte aligned
+// slice, which is bound with the D3D11.1 VSSetConstantBuffers1/PSSetConstantBuffers1 offsets. end_frame fences
+// the frame with an event query : the head only runs over a frame's slices once the GPU is past that frame,
+// waiting for it if the ring is full. A frame that alone needs more than the ring restarts it with
+// MAP_WRITE_DISCARD (the driver renames the buffer).
+//
+// A ring on a deferred context works per command list instead : a command list has to map the buffer with
+// DISCARD first, which gives it a buffer of its own, so there is nothing to fence. end_frame, after
+// FinishCommandList, makes the next command list start over with DISCARD.
+//
+// Needs ConstantBufferOffsetting and MapNoOverwriteOnDynamicConstantBuffer (D3D11_FEATURE_D3D11_OPTIONS, Windows 8
+// and later); supported() is false otherwise and upload_constants keeps using the renderers' own buffers.
+// One thread at a time : the one recording into the ring's context.
+class ConstantRing {
+public:
+    // VSSetConstantBuffers1 offsets and sizes are in 16 byte constants, multiples of 16 of them
+    static const UINT ALIGNMENT = 256;
+
+    struct Slice {
+        ID3D11Buffer* buffer = nullptr;
+        UINT firstConstant = 0;
+        UINT constantCount = 0;
+        bool operator==(const Slice& rhs) const {
+            return buffer == rhs.buffer && firstConstant == rhs.firstConstant && constantCount == rhs.constantCount;
+        }
+    };
+
+    // Since the last reset_statistics
+    struct Statistics {
+        uint32_t allocations = 0;
+        uint64_t bytes = 0;         // aligned
+        uint32_t waits = 0;         // the ring was full and end_frame's fence wasn't signaled yet
+        uint32_t discards = 0;      // a frame outgrew the ring
+    };
+
+    // 'context' : immediate or deferred. 'framesInFlight' : frames end_frame lets the CPU run ahead of the GPU
+    // before it waits (immediate context only)
+    ConstantRing(ID3D11Device* device, ID3D11DeviceContext* context, size_t bytes = 4 * 1024 * 1024, UINT framesInFlight = 3);
+    virtual ~ConstantRing() = default;
+
+    ConstantRing(const ConstantRing&) = delete;
+    ConstantRing& operator=(const ConstantRing&) = delete;
+
+    bool supported() const { return ringContext1.Get() != nullptr; }
+    ID3D11DeviceContext* context() const { return ringContext; }
+
+    // 'size' : at most 64 KB, the most a slice can bind
+    Slice allocate(const void* data, size_t size);
+    void bind_vs(UINT slot, const Slice& slice);
+    void bind_ps(UINT slot, const Slice& slice);
+
+    // After the frame's last draw, before Present. On a deferred context, after FinishCommandList.
+    void end_frame();
+
+    const Statistics& statistics() const { return ringStatistics; }
+    void reset_statistics() { ringStatistics = Statistics(); }
+
+private:
+    ID3D11DeviceContext* ringContext;
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext1> ringContext1;
+    bool deferred;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+    size_t capacity;
+    UINT framesInFlight;
+
+    size_t head = 0;            // next write
+    size_t usedBytes = 0;       // from the oldest frame in flight's first slice to head, wrap padding included
+    size_t frameBytes = 0;      // of the frame being recorded
+    bool mapped = false;        // the buffer was mapped with DISCARD once (in this command list); NO_OVERWRITE needs that first
+
+    struct Frame {
+        Microsoft::WRL::ComPtr<ID3D11Query> fence;
+        size_t bytes;
+    };
+    std::deque<Frame> frames;                                   // in flight, oldest first
+    std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> freeFences;
+
+    // Retires the oldest frame in flight, waiting for its fence when 'wait'. False if it isn't done yet.
+    bool retire_oldest(bool wait);
+
+    Statistics ringStatistics;
+};
+
+// The ring upload_constants uses for 'context', or null. The framework registers its ring after creating it,
+// DeferredContextBackend one per deferred context. Register and unregister while nothing is being recorded.
+void add_shared_constant_ring(ConstantRing* ring);
+void remove_shared_constant_ring(ConstantRing* ring);
+ConstantRing* shared_constant_ring(ID3D11DeviceContext* context);
+
+// Shader stages upload_constants binds to
+enum CONSTANT_STAGE : UINT {
+    CONSTANT_STAGE_VS = 1,
+    CONSTANT_STAGE_PS = 2,
+};
+// Binds 'size' bytes of constants to 'slot' of 'stages' : a slice of the shared ring when 'context' has one,
+// else UpdateSubresource into 'buffer' ('size' must then be its ByteWidth) and the whole buffer bound.
+void upload_constants(ID3D11DeviceContext* context, UINT slot, ID3D11Buffer* buffer, const void* data, size_t size,
+    UINT stages = CONSTANT_STAGE_VS);
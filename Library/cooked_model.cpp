@@ -0,0 +1,302 @@
+#include "cooked_model.h"
+#include "misc.h"
+#include <fstream>
+
+bool MappedFile::open(const wchar_t* filename) {
+    close();
+
+    file = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return false;
+    }
+    bytes = static_cast<size_t>(fileSize.QuadPart);
+
+    mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        close();
+        return false;
+    }
+
+    // MapViewOfFile returns an address aligned to the allocation granularity (64KB),
+    // so blob offsets aligned in the file are aligned in memory as well.
+    view = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!view) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (view) {
+        UnmapViewOfFile(view);
+        view = nullptr;
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+        mapping = nullptr;
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+    bytes = 0;
+}
+
+namespace cooked {
+    inline uint64_t align_up(uint64_t value) {
+        return (value + (ALIGNMENT - 1)) & ~static_cast<uint64_t>(ALIGNMENT - 1);
+    }
+
+    uint64_t hash_bytes(const void* data, size_t size, uint64_t hash) {
+        constexpr uint64_t PRIME = 0x100000001b3;
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        size_t position = 0;
+        for (; position + sizeof(uint64_t) <= size; position += sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, bytes + position, sizeof(word));
+            hash = (hash ^ word) * PRIME;
+            hash ^= hash >> 32;
+        }
+        for (; position < size; ++position) {
+            hash = (hash ^ bytes[position]) * PRIME;
+        }
+        return hash ^ size;
+    }
+
+    uint64_t hash_file(const wchar_t* filename) {
+        MappedFile file;
+        if (!file.open(filename)) {
+            return 0;
+        }
+        return hash_bytes(file.data(), file.size());
+    }
+
+    Writer::Blob& Writer::find_or_create(BlobType type, size_t elementSize) {
+        for (Blob& blob : blobs) {
+            if (blob.type == type) {
+                _ASSERT_EXPR_A(blob.elementSize == elementSize, "Cooked blob element size mismatch");
+                return blob;
+            }
+        }
+        Blob& blob = blobs.emplace_back();
+        blob.type = type;
+        blob.elementSize = static_cast<uint32_t>(elementSize);
+        return blob;
+    }
+
+    uint64_t Writer::add(BlobType type, const void* elements, size_t elementSize, size_t count) {
+        Blob& blob = find_or_create(type, elementSize);
+        const uint64_t first = blob.bytes.size() / elementSize;
+        const uint8_t* begin = static_cast<const uint8_t*>(elements);
+        blob.bytes.insert(blob.bytes.end(), begin, begin + elementSize * count);
+        return first;
+    }
+
+    StringRef Writer::add_string(const std::string& string) {
+        StringRef ref;
+        ref.offset = static_cast<uint32_t>(strings.size());
+        ref.length = static_cast<uint32_t>(string.size());
+        strings.insert(strings.end(), string.begin(), string.end());
+        return ref;
+    }
+
+    StringRef Writer::add_string(const std::wstring& string) {
+        StringRef ref;
+        ref.offset = static_cast<uint32_t>(strings.size());
+        ref.length = static_cast<uint32_t>(string.size() * sizeof(wchar_t));
+        const char* begin = reinterpret_cast<const char*>(string.data());
+        strings.insert(strings.end(), begin, begin + ref.length);
+        return ref;
+    }
+
+    void Writer::add_dependency(const std::wstring& filename, uint64_t hash) {
+        Dependency dependency;
+        dependency.filename = add_string(filename);
+        dependency.hash = hash;
+        add(BlobType::DEPENDENCIES, &dependency, 1);
+    }
+
+    bool Writer::save(const wchar_t* filename) const {
+        const uint32_t blobCount = static_cast<uint32_t>(blobs.size()) + (strings.empty() ? 0 : 1);
+
+        Header header;
+        header.blobCount = blobCount;
+        header.source = source;
+
+        std::vector<BlobEntry> entries;
+        entries.reserve(blobCount);
+        uint64_t offset = align_up(sizeof(Header) + sizeof(BlobEntry) * blobCount);
+        for (const Blob& blob : blobs) {
+            entries.push_back({ blob.type, blob.elementSize, offset, blob.bytes.size() / blob.elementSize });
+            offset = align_up(offset + blob.bytes.size());
+        }
+        if (!strings.empty()) {
+            entries.push_back({ BlobType::STRINGS, 1, offset, strings.size() });
+        }
+
+        std::ofstream ofs(filename, std::ios::binary);
+        if (!ofs) {
+            return false;
+        }
+        const char padding[ALIGNMENT] = {};
+        auto pad_to = [&](uint64_t position) {
+            const uint64_t current = static_cast<uint64_t>(ofs.tellp());
+            ofs.write(padding, static_cast<std::streamsize>(position - current));
+        };
+
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        ofs.write(reinterpret_cast<const char*>(entries.data()), sizeof(BlobEntry) * entries.size());
+        for (size_t blobIndex = 0; blobIndex < blobs.size(); ++blobIndex) {
+            pad_to(entries.at(blobIndex).offset);
+            ofs.write(reinterpret_cast<const char*>(blobs.at(blobIndex).bytes.data()), blobs.at(blobIndex).bytes.size());
+        }
+        if (!strings.empty()) {
+            pad_to(entries.back().offset);
+            ofs.write(strings.data(), strings.size());
+        }
+        return static_cast<bool>(ofs);
+    }
+
+    bool Reader::open(const MappedFile& mappedFile) {
+        file = nullptr;
+        header = nullptr;
+        if (!mappedFile.is_open() || mappedFile.size() < sizeof(Header)) {
+            return false;
+        }
+        const Header* fileHeader = reinterpret_cast<const Header*>(mappedFile.data());
+        if (fileHeader->magic != MAGIC || fileHeader->version != VERSION) {
+            return false;
+        }
+        if (mappedFile.size() < sizeof(Header) + sizeof(BlobEntry) * static_cast<uint64_t>(fileHeader->blobCount)) {
+            return false;
+        }
+        const BlobEntry* table = reinterpret_cast<const BlobEntry*>(mappedFile.data() + sizeof(Header));
+        for (uint32_t entryIndex = 0; entryIndex < fileHeader->blobCount; ++entryIndex) {
+            const BlobEntry& entry = table[entryIndex];
+            // Compared by division : offset + count * elementSize can wrap around with a corrupt entry
+            if (entry.offset % ALIGNMENT != 0 || entry.elementSize == 0 || entry.offset > mappedFile.size() ||
+                entry.count > (mappedFile.size() - entry.offset) / entry.elementSize) {
+                return false;
+            }
+        }
+
+        file = &mappedFile;
+        header = fileHeader;
+        entries = table;
+        entryCount = header->blobCount;
+        strings = static_cast<const char*>(get(BlobType::STRINGS, 1, stringsSize));
+        return true;
+    }
+
+    const void* Reader::get(BlobType type, size_t elementSize, size_t& count) const {
+        count = 0;
+        if (!file) {
+            return nullptr;
+        }
+        for (uint32_t entryIndex = 0; entryIndex < entryCount; ++entryIndex) {
+            const BlobEntry& entry = entries[entryIndex];
+            if (entry.type == type) {
+                if (entry.elementSize != elementSize) {
+                    return nullptr;
+                }
+                count = static_cast<size_t>(entry.count);
+                return file->data() + entry.offset;
+            }
+        }
+        return nullptr;
+    }
+
+    std::string Reader::string(const StringRef& ref) const {
+        if (!strings || static_cast<size_t>(ref.offset) + ref.length > stringsSize) {
+            return {};
+        }
+        return std::string(strings + ref.offset, ref.length);
+    }
+
+    std::wstring Reader::wstring(const StringRef& ref) const {
+        if (!strings || static_cast<size_t>(ref.offset) + ref.length > stringsSize || ref.length % sizeof(wchar_t) != 0) {
+            return {};
+        }
+        std::wstring string(ref.length / sizeof(wchar_t), L'\0');
+        memcpy(string.data(), strings + ref.offset, ref.length);
+        return string;
+    }
+
+    bool Reader::up_to_date(const SourceKey& expected, const std::filesystem::path& directory) const {
+        if (!header) {
+            return false;
+        }
+        if (header->source.flags != expected.flags || header->source.samplingRate != expected.samplingRate) {
+            return false;
+        }
+        if (expected.hash == 0) {
+            return true;
+        }
+        if (header->source.hash != expected.hash) {
+            return false;
+        }
+        size_t dependencyCount = 0;
+        const Dependency* dependencies = get<Dependency>(BlobType::DEPENDENCIES, dependencyCount);
+        for (size_t dependencyIndex = 0; dependencyIndex < dependencyCount; ++dependencyIndex) {
+            const std::filesystem::path filename = directory / wstring(dependencies[dependencyIndex].filename);
+            if (hash_file(filename.c_str()) != dependencies[dependencyIndex].hash) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool is_up_to_date(const wchar_t* cookedFilename, const SourceKey& expected, const std::filesystem::path& directory) {
+        MappedFile file;
+        Reader reader;
+        return file.open(cookedFilename) && reader.open(file) && reader.up_to_date(expected, directory);
+    }
+
+    // DDS_HEADER::dwReserved1 starts 32 bytes into the file ('DDS ' + 7 DWORDs) and is 11 DWORDs long.
+    constexpr size_t DDS_RESERVED1_OFFSET = 32;
+    constexpr uint32_t DDS_MAGIC = 0x20534444; // 'DDS '
+    constexpr uint32_t TEXTURE_KEY_TAG = 0x58544B43; // 'CKTX'
+
+    struct TextureKey {
+        uint32_t tag;
+        uint32_t flags;
+        uint64_t hash;
+    };
+
+    bool read_texture_key(const wchar_t* ddsFilename, SourceKey& key) {
+        std::ifstream ifs(ddsFilename, std::ios::binary);
+        uint32_t magic = 0;
+        TextureKey textureKey = {};
+        ifs.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        ifs.seekg(DDS_RESERVED1_OFFSET);
+        ifs.read(reinterpret_cast<char*>(&textureKey), sizeof(textureKey));
+        if (!ifs || magic != DDS_MAGIC || textureKey.tag != TEXTURE_KEY_TAG) {
+            return false;
+        }
+        key = {};
+        key.hash = textureKey.hash;
+        key.flags = textureKey.flags;
+        return true;
+    }
+
+    bool write_texture_key(const wchar_t* ddsFilename, const SourceKey& key) {
+        std::fstream fs(ddsFilename, std::ios::binary | std::ios::in | std::ios::out);
+        uint32_t magic = 0;
+        fs.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        if (!fs || magic != DDS_MAGIC) {
+            return false;
+        }
+        const TextureKey textureKey = { TEXTURE_KEY_TAG, key.flags, key.hash };
+        fs.seekp(DDS_RESERVED1_OFFSET);
+        fs.write(reinterpret_cast<const char*>(&textureKey), sizeof(textureKey));
+        return static_cast<bool>(fs);
+    }
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <string>
+#include <filesystem>
+
+// Read-only view of a whole file mapped into the address space.
+// The pointers handed out by data() stay valid until close() or destruction.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const wchar_t* filename) { open(filename); }
+    virtual ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const wchar_t* filename);
+    void close();
+
+    bool is_open() const { return view != nullptr; }
+    const uint8_t* data() const { return view; }
+    size_t size() const { return bytes; }
+
+private:
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    const uint8_t* view = nullptr;
+    size_t bytes = 0;
+};
+
+// Cooked binary layout used by SkinnedMesh, StaticMesh and Audio.
+//
+// [Header][BlobEntry x blobCount][blob 0][blob 1]...
+//
+// Every blob starts on a 16 byte boundary, so arrays of vertices, indices and
+// animation keys can be handed to D3D or read by the CPU straight from the mapping.
+namespace cooked {
+    constexpr uint32_t MAGIC = 0x434D4B53; // 'SKMC'
+    constexpr uint32_t VERSION = 5;
+    constexpr size_t ALIGNMENT = 16;
+
+    enum class BlobType : uint32_t {
+        NODES,
+        MESHES,
+        SUBSETS,
+        BONES,
+        VERTICES,
+        INDICES,
+        MATERIALS,
+        CLIPS,
+        CLIP_REST_POSE,
+        STRINGS,
+        DEPENDENCIES,
+        WAVE_FORMAT,
+        SAMPLES,
+        CLIP_TRACKS,
+        CLIP_KEY_FRAMES,
+        CLIP_KEY_VALUES,
+        COMPRESSED_VERTICES,
+        LODS,
+    };
+
+    // What a cooked file was built from. A cache is only used when this matches the current source.
+    struct SourceKey {
+        uint64_t hash = 0;          // content hash of the source file, 0 if the source isn't available
+        uint32_t flags = 0;         // importer switches (triangulate, flip v, ...), meaning depends on the loader
+        float samplingRate = 0;     // FBX animation sampling rate, 0 for everything else
+    };
+
+    struct Header {
+        uint32_t magic = MAGIC;
+        uint32_t version = VERSION;
+        uint32_t blobCount = 0;
+        uint32_t reserved = 0;
+        SourceKey source;
+    };
+
+    struct BlobEntry {
+        BlobType type;
+        uint32_t elementSize;   // sizeof one element, checked on load against the running build
+        uint64_t offset;        // from the beginning of the file
+        uint64_t count;         // number of elements
+    };
+
+    // Strings live in the STRINGS blob; records only keep where to find them.
+    struct StringRef {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    // Secondary file the source pulls in (an OBJ's MTL for example), relative to the source's directory.
+    struct Dependency {
+        StringRef filename;
+        uint64_t hash;
+    };
+
+    enum class CookResult {
+        UP_TO_DATE,
+        COOKED,
+        FAILED,
+    };
+
+    // Fast 64 bit content hash (FNV-1a over 8 byte words). Only meant to detect changes, not to be secure.
+    uint64_t hash_bytes(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325);
+    // Returns 0 if the file can't be opened.
+    uint64_t hash_file(const wchar_t* filename);
+
+    class Writer {
+    public:
+        // Append 'count' elements of 'elementSize' bytes. Returns the index of the first element.
+        template<class T>
+        uint64_t add(BlobType type, const T* elements, size_t count) {
+            return add(type, elements, sizeof(T), count);
+        }
+        uint64_t add(BlobType type, const void* elements, size_t elementSize, size_t count);
+        StringRef add_string(const std::string& string);
+        StringRef add_string(const std::wstring& string);
+
+        void set_source(const SourceKey& key) { source = key; }
+        void add_dependency(const std::wstring& filename, uint64_t hash);
+
+        bool save(const wchar_t* filename) const;
+
+    private:
+        struct Blob {
+            BlobType type;
+            uint32_t elementSize = 0;
+            std::vector<uint8_t> bytes;
+        };
+        Blob& find_or_create(BlobType type, size_t elementSize);
+        std::vector<Blob> blobs;
+        std::vector<char> strings;
+        SourceKey source;
+    };
+
+    class Reader {
+    public:
+        // Validates the header and the offset table against the mapped file size.
+        bool open(const MappedFile& file);
+
+        // Returns nullptr (and count 0) if the blob is missing or its element size doesn't match.
+        template<class T>
+        const T* get(BlobType type, size_t& count) const {
+            return reinterpret_cast<const T*>(get(type, sizeof(T), count));
+        }
+        const void* get(BlobType type, size_t elementSize, size_t& count) const;
+        std::string string(const StringRef& ref) const;
+        std::wstring wstring(const StringRef& ref) const;
+
+        const SourceKey& source() const { return header->source; }
+
+        // True if the file was cooked from 'expected' with the same import settings and every recorded
+        // dependency (relative to 'directory') still hashes the same. A zero expected hash means the
+        // source isn't shipped, in which case only the import settings are compared.
+        bool up_to_date(const SourceKey& expected, const std::filesystem::path& directory) const;
+
+    private:
+        const MappedFile* file = nullptr;
+        const Header* header = nullptr;
+        const BlobEntry* entries = nullptr;
+        uint32_t entryCount = 0;
+        const char* strings = nullptr;
+        size_t stringsSize = 0;
+    };
+
+    // Opens 'cookedFilename' and checks it against 'expected' without reading the contents.
+    bool is_up_to_date(const wchar_t* cookedFilename, const SourceKey& expected, const std::filesystem::path& directory);
+
+    // Textures are cooked to DDS by texconv. The source hash is stamped into the otherwise unused
+    // dwReserved1 words of the DDS header, so a DDS can be checked against the image it came from.
+    bool read_texture_key(const wchar_t* ddsFilename, SourceKey& key);
+    bool write_texture_key(const wchar_t* ddsFilename, const SourceKey& key);
+}
@@ -0,0 +1,231 @@
+#include "cpu_skinning.h"
+#include "pose.h"
+#include "thread_pool.h"
+#include "misc.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+
+using namespace DirectX;
+
+namespace {
+    // Read by influences that don't count, so the kernels have no branch on the weights
+    const float zeroMatrix[16] = {};
+
+    void store3(float* destination, __m128 v) {
+        _mm_storel_pi(reinterpret_cast<__m64*>(destination), v);
+        _mm_store_ss(destination + 2, _mm_movehl_ps(v, v));
+    }
+
+    // Rows of the weighted sum of a vertex's bone matrices, then one transform of each attribute
+    void skin_sse(const cpu_skinning::SourceVertex* vertices, size_t vertexCount, const XMFLOAT4X4* bones, size_t boneCount,
+        cpu_skinning::SkinnedVertex* output) {
+        for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+            const cpu_skinning::SourceVertex& vertex = vertices[vertexIndex];
+            __m128 row0 = _mm_setzero_ps();
+            __m128 row1 = _mm_setzero_ps();
+            __m128 row2 = _mm_setzero_ps();
+            __m128 row3 = _mm_setzero_ps();
+            for (int influence = 0; influence < cpu_skinning::MAX_BONE_INFLUENCES; ++influence) {
+                const bool used = vertex.boneWeights[influence] != 0 && vertex.boneIndices[influence] < boneCount;
+                const float* m = used ? &bones[vertex.boneIndices[influence]]._11 : zeroMatrix;
+                const __m128 w = _mm_set1_ps(used ? vertex.boneWeights[influence] : 0.0f);
+                row0 = _mm_add_ps(row0, _mm_mul_ps(w, _mm_loadu_ps(m + 0)));
+                row1 = _mm_add_ps(row1, _mm_mul_ps(w, _mm_loadu_ps(m + 4)));
+                row2 = _mm_add_ps(row2, _mm_mul_ps(w, _mm_loadu_ps(m + 8)));
+                row3 = _mm_add_ps(row3, _mm_mul_ps(w, _mm_loadu_ps(m + 12)));
+            }
+            auto transform = [&](const float* v) {
+                return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(v[0]), row0), _mm_mul_ps(_mm_set1_ps(v[1]), row1)),
+                    _mm_mul_ps(_mm_set1_ps(v[2]), row2));
+            };
+            cpu_skinning::SkinnedVertex& skinned = output[vertexIndex];
+            store3(&skinned.position.x, _mm_add_ps(transform(&vertex.position.x), row3));
+            store3(&skinned.normal.x, transform(&vertex.normal.x));
+            store3(&skinned.tangent.x, transform(&vertex.tangent.x));
+            skinned.tangent.w = vertex.tangent.w;
+        }
+    }
+
+    // Two vertices per iteration, one in each 128 bit lane, so the matrix blend and the transforms are the SSE
+    // kernel's at twice the width
+    void skin_avx(const cpu_skinning::SourceVertex* vertices, size_t vertexCount, const XMFLOAT4X4* bones, size_t boneCount,
+        cpu_skinning::SkinnedVertex* output) {
+        size_t vertexIndex = 0;
+        for (; vertexIndex + 1 < vertexCount; vertexIndex += 2) {
+            const cpu_skinning::SourceVertex& a = vertices[vertexIndex];
+            const cpu_skinning::SourceVertex& b = vertices[vertexIndex + 1];
+            __m256 rows[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+            for (int influence = 0; influence < cpu_skinning::MAX_BONE_INFLUENCES; ++influence) {
+                const bool useA = a.boneWeights[influence] != 0 && a.boneIndices[influence] < boneCount;
+                const bool useB = b.boneWeights[influence] != 0 && b.boneIndices[influence] < boneCount;
+                const float* ma = useA ? &bones[a.boneIndices[influence]]._11 : zeroMatrix;
+                const float* mb = useB ? &bones[b.boneIndices[influence]]._11 : zeroMatrix;
+                const __m256 w = _mm256_setr_m128(_mm_set1_ps(useA ? a.boneWeights[influence] : 0.0f),
+                    _mm_set1_ps(useB ? b.boneWeights[influence] : 0.0f));
+                rows[0] = _mm256_add_ps(rows[0], _mm256_mul_ps(w, _mm256_loadu2_m128(mb + 0, ma + 0)));
+                rows[1] = _mm256_add_ps(rows[1], _mm256_mul_ps(w, _mm256_loadu2_m128(mb + 4, ma + 4)));
+                rows[2] = _mm256_add_ps(rows[2], _mm256_mul_ps(w, _mm256_loadu2_m128(mb + 8, ma + 8)));
+                rows[3] = _mm256_add_ps(rows[3], _mm256_mul_ps(w, _mm256_loadu2_m128(mb + 12, ma + 12)));
+            }
+            auto transform = [&](const float* va, const float* vb) {
+                const __m256 x = _mm256_setr_m128(_mm_set1_ps(va[0]), _mm_set1_ps(vb[0]));
+                const __m256 y = _mm256_setr_m128(_mm_set1_ps(va[1]), _mm_set1_ps(vb[1]));
+                const __m256 z = _mm256_setr_m128(_mm_set1_ps(va[2]), _mm_set1_ps(vb[2]));
+                return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, rows[0]), _mm256_mul_ps(y, rows[1])), _mm256_mul_ps(z, rows[2]));
+            };
+            auto store = [&](float* da, float* db, __m256 v) {
+                store3(da, _mm256_castps256_ps128(v));
+                store3(db, _mm256_extractf128_ps(v, 1));
+            };
+            cpu_skinning::SkinnedVertex& skinnedA = output[vertexIndex];
+            cpu_skinning::SkinnedVertex& skinnedB = output[vertexIndex + 1];
+            store(&skinnedA.position.x, &skinnedB.position.x, _mm256_add_ps(transform(&a.position.x, &b.position.x), rows[3]));
+            store(&skinnedA.normal.x, &skinnedB.normal.x, transform(&a.normal.x, &b.normal.x));
+            store(&skinnedA.tangent.x, &skinnedB.tangent.x, transform(&a.tangent.x, &b.tangent.x));
+            skinnedA.tangent.w = a.tangent.w;
+            skinnedB.tangent.w = b.tangent.w;
+        }
+        if (vertexIndex < vertexCount) {
+            skin_sse(vertices + vertexIndex, 1, bones, boneCount, output + vertexIndex);
+        }
+        _mm256_zeroupper(); // no AVX to SSE transition penalty in the caller
+    }
+}
+
+void cpu_skinning::skin(const SourceVertex* vertices, size_t vertexCount, const XMFLOAT4X4* bones, size_t boneCount,
+    SkinnedVertex* output, bool allowAvx) {
+    static const bool avx = Pose::avx_supported();
+    if (allowAvx && avx) {
+        skin_avx(vertices, vertexCount, bones, boneCount, output);
+    }
+    else {
+        skin_sse(vertices, vertexCount, bones, boneCount, output);
+    }
+}
+
+void cpu_skinning::skin(ThreadPool& threadPool, const SourceVertex* vertices, size_t vertexCount, const XMFLOAT4X4* bones,
+    size_t boneCount, SkinnedVertex* output) {
+    if (vertexCount <= VERTICES_PER_TASK || threadPool.thread_count() == 0) {
+        skin(vertices, vertexCount, bones, boneCount, output);
+        return;
+    }
+    // Ranges write disjoint parts of 'output'
+    for (size_t first = 0; first < vertexCount; first += VERTICES_PER_TASK) {
+        const size_t count = std::min<size_t>(VERTICES_PER_TASK, vertexCount - first);
+        threadPool.submit([=]() {
+            skin(vertices + first, count, bones, boneCount, output + first);
+        });
+    }
+    threadPool.wait();
+}
+
+void cpu_skinning::skin_reference(const SourceVertex* vertices, size_t vertexCount, const XMFLOAT4X4* bones, size_t boneCount,
+    SkinnedVertex* output) {
+    for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+        const SourceVertex& vertex = vertices[vertexIndex];
+        // skin_vertex : blended += weight * mul(v, boneTransforms[index])
+        XMVECTOR position = XMVectorZero();
+        XMVECTOR normal = XMVectorZero();
+        XMVECTOR tangent = XMVectorZero();
+        for (int influence = 0; influence < MAX_BONE_INFLUENCES; ++influence) {
+            const uint32_t boneIndex = vertex.boneIndices[influence];
+            if (boneIndex >= boneCount) {
+                continue;
+            }
+            const XMMATRIX M = XMLoadFloat4x4(&bones[boneIndex]);
+            const float weight = vertex.boneWeights[influence];
+            position += weight * XMVector4Transform(XMVectorSetW(XMLoadFloat3(&vertex.position), 1), M);
+            normal += weight * XMVector4Transform(XMVectorSetW(XMLoadFloat3(&vertex.normal), 0), M);
+            tangent += weight * XMVector4Transform(XMVectorSetW(XMLoadFloat4(&vertex.tangent), 0), M);
+        }
+        SkinnedVertex& skinned = output[vertexIndex];
+        XMStoreFloat3(&skinned.position, position);
+        XMStoreFloat3(&skinned.normal, normal);
+        XMStoreFloat4(&skinned.tangent, XMVectorSetW(tangent, vertex.tangent.w));
+    }
+}
+
+void cpu_skinning::benchmark_skinning(size_t vertexCount, size_t boneCount, int iterations) {
+    if (vertexCount == 0 || boneCount == 0 || iterations <= 0) {
+        return;
+    }
+
+    // Random rigid bones and vertices with 1 to 4 influences, fixed seed so runs compare
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<XMFLOAT4X4> bones(boneCount);
+    for (XMFLOAT4X4& bone : bones) {
+        const XMVECTOR axis = XMVector3Normalize(XMVectorSet(unit(random), unit(random), unit(random) + 2.0f, 0));
+        XMStoreFloat4x4(&bone, XMMatrixRotationAxis(axis, unit(random) * XM_PI) *
+            XMMatrixTranslation(unit(random), unit(random), unit(random)));
+    }
+    std::vector<SourceVertex> vertices(vertexCount);
+    for (SourceVertex& vertex : vertices) {
+        vertex.position = { unit(random), unit(random), unit(random) };
+        vertex.normal = { 0, 1, 0 };
+        vertex.tangent = { 1, 0, 0, 1 };
+        vertex.texcoord = { 0, 0 };
+        const int influences = 1 + static_cast<int>(random() % MAX_BONE_INFLUENCES);
+        float sum = 0;
+        for (int influence = 0; influence < MAX_BONE_INFLUENCES; ++influence) {
+            vertex.boneIndices[influence] = static_cast<uint32_t>(random() % boneCount);
+            vertex.boneWeights[influence] = influence < influences ? unit(random) + 1.0f : 0.0f;
+            sum += vertex.boneWeights[influence];
+        }
+        for (float& weight : vertex.boneWeights) {
+            weight = sum > 0 ? weight / sum : 0;
+        }
+    }
+    std::vector<SkinnedVertex> reference(vertexCount);
+    std::vector<SkinnedVertex> skinned(vertexCount);
+    ThreadPool threadPool;
+
+    benchmark timer;
+    auto vertices_per_second = [&](auto kernel) {
+        kernel(); // warm up
+        timer.begin();
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            kernel();
+        }
+        const float seconds = timer.end();
+        return seconds > 0 ? static_cast<float>(vertexCount) * iterations / seconds : 0.0f;
+    };
+    auto largest_error = [&]() {
+        float error = 0;
+        for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+            const float* a = &reference[vertexIndex].position.x;
+            const float* b = &skinned[vertexIndex].position.x;
+            for (size_t component = 0; component < sizeof(SkinnedVertex) / sizeof(float); ++component) {
+                error = std::max<float>(error, fabsf(a[component] - b[component]));
+            }
+        }
+        return error;
+    };
+
+    const float scalar = vertices_per_second([&]() { skin_reference(vertices.data(), vertexCount, bones.data(), boneCount, reference.data()); });
+    const float sse = vertices_per_second([&]() { skin(vertices.data(), vertexCount, bones.data(), boneCount, skinned.data(), false); });
+    const float sseError = largest_error();
+    const bool avx = Pose::avx_supported();
+    const float avx1 = avx ? vertices_per_second([&]() { skin(vertices.data(), vertexCount, bones.data(), boneCount, skinned.data(), true); }) : 0.0f;
+    const float avxError = avx ? largest_error() : 0.0f;
+    const float threaded = vertices_per_second([&]() { skin(threadPool, vertices.data(), vertexCount, bones.data(), boneCount, skinned.data()); });
+    const float threadedError = largest_error();
+
+    std::stringstream message;
+    message << std::fixed << std::setprecision(1)
+        << "CPU skinning : " << vertexCount << " vertices, " << boneCount << " bones (Mvertices/s, largest difference from the reference)\n"
+        << "  scalar : " << scalar / 1e6f << "\n"
+        << "  SSE : " << sse / 1e6f << " (" << std::scientific << std::setprecision(2) << sseError << std::fixed << std::setprecision(1) << ")\n";
+    if (avx) {
+        message << "  AVX : " << avx1 / 1e6f << " (" << std::scientific << std::setprecision(2) << avxError << std::fixed << std::setprecision(1) << ")\n";
+    }
+    message << "  " << threadPool.thread_count() + 1 << " threads : " << threaded / 1e6f << " (" << std::scientific << std::setprecision(2)
+        << threadedError << ")\n";
+    OutputDebugStringA(message.str().c_str());
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+#include <cstddef>
+
+class ThreadPool;
+
+// CPU counterpart of skin_vertex in Shader/skinned_mesh.hlsli : the same 4-influence blend of positions, normals and
+// tangents, for hit tests, animated bounds and headless checks of animation. Nothing here needs a device.
+//
+// The shader transforms by each bone and sums the weighted results; the SIMD kernels sum the weighted matrices
+// first and transform once, which is the same up to rounding (AVX when the CPU has it, SSE otherwise).
+// Bone indices past the palette contribute nothing, like out of range structured buffer reads.
+namespace cpu_skinning {
+    static const int MAX_BONE_INFLUENCES = 4;
+
+    // Inputs of one vertex, laid out like SkinnedMesh::Vertex so a mesh's vertex array can be passed as is
+    struct SourceVertex {
+        DirectX::XMFLOAT3 position;
+        DirectX::XMFLOAT3 normal;
+        DirectX::XMFLOAT4 tangent;      // w : bitangent sign, passed through
+        DirectX::XMFLOAT2 texcoord;
+        float boneWeights[MAX_BONE_INFLUENCES];
+        uint32_t boneIndices[MAX_BONE_INFLUENCES];
+    };
+    // Model space, before the world transform. Normals and tangents are not normalized, like the shader's
+    // blended vectors.
+    struct SkinnedVertex {
+        DirectX::XMFLOAT3 position;
+        DirectX::XMFLOAT3 normal;
+        DirectX::XMFLOAT4 tangent;
+    };
+
+    // 'bones' : 'boneCount' affine skinning matrices (row vectors), e.g. a SkinnedMesh::Palette's. 'allowAvx' = false
+    // forces the SSE path (benchmarks).
+    void skin(const SourceVertex* vertices, size_t vertexCount, const DirectX::XMFLOAT4X4* bones, size_t boneCount,
+        SkinnedVertex* output, bool allowAvx = true);
+    // Same, in ranges of VERTICES_PER_TASK on 'threadPool'. Returns when every range is done; the calling thread helps.
+    static const size_t VERTICES_PER_TASK = 4096;
+    void skin(ThreadPool& threadPool, const SourceVertex* vertices, size_t vertexCount, const DirectX::XMFLOAT4X4* bones,
+        size_t boneCount, SkinnedVertex* output);
+    // Scalar, one bone at a time in the shader's order. The reference the SIMD kernels are checked against.
+    void skin_reference(const SourceVertex* vertices, size_t vertexCount, const DirectX::XMFLOAT4X4* bones, size_t boneCount,
+        SkinnedVertex* output);
+
+    // Vertices per second of the scalar, SSE, AVX and multithreaded kernels on 'vertexCount' random vertices over
+    // 'boneCount' bones, and the largest difference from the reference. Results go to the output window.
+    void benchmark_skinning(size_t vertexCount = 1 << 20, size_t boneCount = 64, int iterations = 10);
+}
@@ -0,0 +1,70 @@
+#include "deferred_context_backend.h"
+#include "misc.h"
+
+DeferredContextBackend::DeferredContextBackend(ID3D11Device* device, ID3D11DeviceContext* immediateContext)
+    : device(device), immediateContext(immediateContext) {
+    D3D11_FEATURE_DATA_THREADING threading = {};
+    HRESULT hr = device->CheckFeatureSupport(D3D11_FEATURE_THREADING, &threading, sizeof(threading));
+    driverCommandLists = SUCCEEDED(hr) && threading.DriverCommandLists;
+}
+
+DeferredContextBackend::~DeferredContextBackend() {
+    for (std::unique_ptr<ConstantRing>& constantRing : constantRings) {
+        remove_shared_constant_ring(constantRing.get());
+    }
+}
+
+void DeferredContextBackend::begin(size_t passCount) {
+    // Contexts are made here on the main thread; the workers only record into them
+    while (deferredContexts.size() < passCount) {
+        Microsoft::WRL::ComPtr<ID3D11DeviceContext> deferredContext;
+        HRESULT hr = device->CreateDeferredContext(0, deferredContext.GetAddressOf());
+        _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+        deferredContexts.push_back(deferredContext);
+
+        constantRings.push_back(std::make_unique<ConstantRing>(device, deferredContext.Get(), CONSTANT_RING_BYTES));
+        if (constantRings.back()->supported()) {
+            add_shared_constant_ring(constantRings.back().get());
+        }
+    }
+    commandLists.resize(deferredContexts.size());
+}
+
+void DeferredContextBackend::record(uint32_t pass, const PassRecord& passRecord) {
+    ID3D11DeviceContext* deferredContext = deferredContexts.at(pass).Get();
+    passRecord(deferredContext);
+    HRESULT hr = deferredContext->FinishCommandList(FALSE, commandLists.at(pass).ReleaseAndGetAddressOf());
+    _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+    constantRings.at(pass)->end_frame();
+}
+
+void DeferredContextBackend::execute(uint32_t pass) {
+    immediateContext->ExecuteCommandList(commandLists.at(pass).Get(), FALSE);
+    // The immediate context holds on to the commands until the GPU is done with them
+    commandLists.at(pass).Reset();
+    ++backendStatistics.commandLists;
+}
+
+void DeferredContextBackend::record_immediate(uint32_t pass, const PassRecord& passRecord) {
+    passRecord(immediateContext);
+    ++backendStatistics.immediatePasses;
+}
+
+ConstantRing::Statistics DeferredContextBackend::constant_ring_statistics() const {
+    ConstantRing::Statistics ringStatistics;
+    for (const std::unique_ptr<ConstantRing>& constantRing : constantRings) {
+        const ConstantRing::Statistics& statistics = constantRing->statistics();
+        ringStatistics.allocations += statistics.allocations;
+        ringStatistics.bytes += statistics.bytes;
+        ringStatistics.waits += statistics.waits;
+        ringStatistics.discards += statistics.discards;
+    }
+    return ringStatistics;
+}
+
+void DeferredContextBackend::reset_statistics() {
+    backendStatistics = Statistics();
+    for (std::unique_ptr<ConstantRing>& constantRing : constantRings) {
+        constantRing->reset_statistics();
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "frame_graph.h"
+#include "constant_ring.h"
+
+// FrameGraph backend on D3D11 deferred contexts : every pass gets a deferred context of its own (kept from frame
+// to frame), which a worker records the pass into and closes with FinishCommandList. The command lists are then
+// executed on the immediate context in the graph's order. Each deferred context has a ConstantRing of its own too,
+// registered for upload_constants, which starts over with every command list.
+//
+// A command list starts from the default pipeline state and leaves the immediate context's state cleared
+// (ExecuteCommandList with RestoreContextState FALSE) : passes bind all they need, and whatever shadows the
+// immediate context's state (StateTracker) has to be invalidated after FrameGraph::execute.
+class DeferredContextBackend : public FrameGraphBackend {
+public:
+    // Since the last reset_statistics
+    struct Statistics {
+        uint32_t commandLists = 0;
+        uint32_t immediatePasses = 0;
+    };
+
+    // Of each deferred context's ConstantRing. A command list that needs more maps a new buffer with DISCARD.
+    static const size_t CONSTANT_RING_BYTES = 1024 * 1024;
+
+    DeferredContextBackend(ID3D11Device* device, ID3D11DeviceContext* immediateContext);
+    virtual ~DeferredContextBackend();
+
+    DeferredContextBackend(const DeferredContextBackend&) = delete;
+    DeferredContextBackend& operator=(const DeferredContextBackend&) = delete;
+
+    // False when the driver doesn't build command lists itself and the runtime emulates them : recording on
+    // workers still works, with less to gain
+    bool driver_command_lists() const { return driverCommandLists; }
+
+    void begin(size_t passCount) override;
+    void record(uint32_t pass, const PassRecord& passRecord) override;
+    void execute(uint32_t pass) override;
+    void record_immediate(uint32_t pass, const PassRecord& passRecord) override;
+
+    const Statistics& statistics() const { return backendStatistics; }
+    // The deferred contexts' rings together; supported() of the immediate context's ring tells if they are used
+    ConstantRing::Statistics constant_ring_statistics() const;
+    void reset_statistics();
+
+private:
+    ID3D11Device* device;
+    ID3D11DeviceContext* immediateContext;
+    bool driverCommandLists = false;
+
+    std::vector<Microsoft::WRL::ComPtr<ID3D11DeviceContext>> deferredContexts;  // by pass
+    std::vector<Microsoft::WRL::ComPtr<ID3D11CommandList>> commandLists;        // by pass, between record and execute
+    std::vector<std::unique_ptr<ConstantRing>> constantRings;                   // by pass
+
+    Statistics backendStatistics;
+};
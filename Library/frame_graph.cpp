@@ -0,0 +1,230 @@
+#include "frame_graph.h"
+#include "thread_pool.h"
+#include "misc.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+void FrameGraph::clear() {
+    resources.clear();
+    passes.clear();
+    executionOrder.clear();
+    compiled = false;
+}
+
+FrameGraph::ResourceId FrameGraph::create_resource(const char* name) {
+    resources.push_back({ name, false, {} });
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+FrameGraph::ResourceId FrameGraph::import_resource(const char* name) {
+    resources.push_back({ name, true, {} });
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+FrameGraph::PassId FrameGraph::add_pass(const char* name, PassRecord passRecord, bool deferred) {
+    Pass pass;
+    pass.name = name;
+    pass.record = std::move(passRecord);
+    pass.deferred = deferred;
+    passes.push_back(std::move(pass));
+    compiled = false;
+    return static_cast<PassId>(passes.size() - 1);
+}
+
+void FrameGraph::read(PassId pass, ResourceId resource) {
+    _ASSERT_EXPR(resource < resources.size(), L"Unknown resource");
+    passes.at(pass).reads.push_back(resource);
+    compiled = false;
+}
+
+void FrameGraph::write(PassId pass, ResourceId resource) {
+    _ASSERT_EXPR(pass < passes.size(), L"Unknown pass");
+    // Kept in add order (pass ids), whatever order the passes call write in
+    std::vector<PassId>& writers = resources.at(resource).writers;
+    const std::vector<PassId>::iterator writer = std::lower_bound(writers.begin(), writers.end(), pass);
+    if (writer == writers.end() || *writer != pass) {
+        passes.at(pass).writes.push_back(resource);
+        writers.insert(writer, pass);
+    }
+    compiled = false;
+}
+
+void FrameGraph::compile() {
+    graphStatistics = Statistics();
+    graphStatistics.passes = static_cast<uint32_t>(passes.size());
+
+    // Dependencies : writers of a resource one after the other, readers after all of them
+    for (Pass& pass : passes) {
+        pass.dependencies.clear();
+    }
+    auto depend = [&](PassId pass, PassId before) {
+        std::vector<PassId>& dependencies = passes.at(pass).dependencies;
+        if (pass != before && std::find(dependencies.begin(), dependencies.end(), before) == dependencies.end()) {
+            dependencies.push_back(before);
+        }
+    };
+    for (const Resource& resource : resources) {
+        for (size_t writerIndex = 1; writerIndex < resource.writers.size(); ++writerIndex) {
+            depend(resource.writers.at(writerIndex), resource.writers.at(writerIndex - 1));
+        }
+    }
+    for (PassId pass = 0; pass < passes.size(); ++pass) {
+        for (ResourceId resource : passes.at(pass).reads) {
+            // A pass reading what it writes only sees the writers added before it
+            const std::vector<PassId>& writers = resources.at(resource).writers;
+            for (std::vector<PassId>::const_iterator writer = writers.begin(); writer != writers.end() && *writer != pass; ++writer) {
+                depend(pass, *writer);
+            }
+        }
+    }
+
+    // Culling : what the imported resources need, walking the dependencies back from their writers
+    for (Pass& pass : passes) {
+        pass.culled = true;
+    }
+    std::vector<PassId> needed;
+    for (const Resource& resource : resources) {
+        if (resource.imported) {
+            needed.insert(needed.end(), resource.writers.begin(), resource.writers.end());
+        }
+    }
+    while (!needed.empty()) {
+        Pass& pass = passes.at(needed.back());
+        needed.pop_back();
+        if (pass.culled) {
+            pass.culled = false;
+            needed.insert(needed.end(), pass.dependencies.begin(), pass.dependencies.end());
+        }
+    }
+
+    // Topological order of what is left (Kahn), the earliest added ready pass first
+    std::vector<uint32_t> pendingDependencies(passes.size(), 0);
+    std::vector<std::vector<PassId>> dependents(passes.size());
+    std::priority_queue<PassId, std::vector<PassId>, std::greater<PassId>> ready;
+    uint32_t livePasses = 0;
+    for (PassId pass = 0; pass < passes.size(); ++pass) {
+        const Pass& livePass = passes.at(pass);
+        if (livePass.culled) {
+            ++graphStatistics.culledPasses;
+            continue;
+        }
+        ++livePasses;
+        if (livePass.deferred) {
+            ++graphStatistics.deferredPasses;
+        }
+        // A live pass only depends on live passes
+        for (PassId before : livePass.dependencies) {
+            dependents.at(before).push_back(pass);
+        }
+        pendingDependencies.at(pass) = static_cast<uint32_t>(livePass.dependencies.size());
+        graphStatistics.dependencies += pendingDependencies.at(pass);
+        if (pendingDependencies.at(pass) == 0) {
+            ready.push(pass);
+        }
+    }
+    executionOrder.clear();
+    while (!ready.empty()) {
+        const PassId pass = ready.top();
+        ready.pop();
+        executionOrder.push_back(pass);
+        for (PassId dependent : dependents.at(pass)) {
+            if (--pendingDependencies.at(dependent) == 0) {
+                ready.push(dependent);
+            }
+        }
+    }
+    _ASSERT_EXPR(executionOrder.size() == livePasses, L"The passes depend on each other in a cycle");
+    compiled = true;
+}
+
+void FrameGraph::execute(FrameGraphBackend& backend, ThreadPool* threadPool) {
+    _ASSERT_EXPR(compiled, L"Compile the frame graph before executing it");
+    backend.begin(passes.size());
+    if (!threadPool) {
+        for (PassId pass : executionOrder) {
+            backend.record_immediate(pass, passes.at(pass).record);
+        }
+        return;
+    }
+
+    recordedPasses.assign(passes.size(), 0);
+    for (PassId pass : executionOrder) {
+        if (!passes.at(pass).deferred) {
+            continue;
+        }
+        threadPool->submit([this, &backend, pass]() {
+            backend.record(pass, passes.at(pass).record);
+            {
+                std::lock_guard<std::mutex> lock(recordedMutex);
+                recordedPasses.at(pass) = 1;
+            }
+            passRecorded.notify_all();
+        });
+    }
+    for (PassId pass : executionOrder) {
+        if (passes.at(pass).deferred) {
+            std::unique_lock<std::mutex> lock(recordedMutex);
+            passRecorded.wait(lock, [&]() { return recordedPasses.at(pass) != 0; });
+            lock.unlock();
+            backend.execute(pass);
+        }
+        else {
+            backend.record_immediate(pass, passes.at(pass).record);
+        }
+    }
+    // The tasks may still be inside notify_all
+    threadPool->wait();
+}
+
+void RecordingFrameGraphBackend::begin(size_t passCount) {
+    recordedEvents.clear();
+    recordedEvents.reserve(passCount * 2);
+    mainThread = std::this_thread::get_id();
+}
+
+void RecordingFrameGraphBackend::record(uint32_t pass, const PassRecord& passRecord) {
+    passRecord(nullptr);
+    std::lock_guard<std::mutex> lock(eventMutex);
+    recordedEvents.push_back({ EventType::RECORD, pass, std::this_thread::get_id() });
+}
+
+void RecordingFrameGraphBackend::execute(uint32_t pass) {
+    std::lock_guard<std::mutex> lock(eventMutex);
+    recordedEvents.push_back({ EventType::EXECUTE, pass, std::this_thread::get_id() });
+}
+
+void RecordingFrameGraphBackend::record_immediate(uint32_t pass, const PassRecord& passRecord) {
+    passRecord(nullptr);
+    std::lock_guard<std::mutex> lock(eventMutex);
+    recordedEvents.push_back({ EventType::RECORD_IMMEDIATE, pass, std::this_thread::get_id() });
+}
+
+bool RecordingFrameGraphBackend::played_in(const std::vector<uint32_t>& order) const {
+    std::vector<uint32_t> played;
+    std::vector<uint32_t> recorded;
+    for (const Event& event : recordedEvents) {
+        switch (event.type) {
+        case EventType::RECORD:
+            if (std::find(recorded.begin(), recorded.end(), event.pass) != recorded.end()) {
+                return false;
+            }
+            recorded.push_back(event.pass);
+            break;
+        case EventType::EXECUTE:
+            if (event.thread != mainThread || std::find(recorded.begin(), recorded.end(), event.pass) == recorded.end()) {
+                return false;
+            }
+            played.push_back(event.pass);
+            break;
+        case EventType::RECORD_IMMEDIATE:
+            if (event.thread != mainThread) {
+                return false;
+            }
+            played.push_back(event.pass);
+            break;
+        }
+    }
+    return played == order;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+struct ID3D11DeviceContext;
+class ThreadPool;
+
+// Records a pass's commands into 'context'
+using PassRecord = std::function<void(ID3D11DeviceContext* context)>;
+
+// Where a FrameGraph's passes get recorded and played. DeferredContextBackend is the D3D11 one;
+// RecordingFrameGraphBackend only logs, to check the graph's ordering without a device.
+class FrameGraphBackend {
+public:
+    virtual ~FrameGraphBackend() = default;
+
+    // Main thread, before anything of the frame is recorded
+    virtual void begin(size_t passCount) = 0;
+    // Worker thread : records a deferred pass. Passes are recorded concurrently, each only once per frame.
+    virtual void record(uint32_t pass, const PassRecord& passRecord) = 0;
+    // Main thread, in execution order : plays what record left for 'pass'
+    virtual void execute(uint32_t pass) = 0;
+    // Main thread, in execution order : records a pass straight into the immediate context
+    virtual void record_immediate(uint32_t pass, const PassRecord& passRecord) = 0;
+};
+
+// The passes of a frame and the resources they read and write, rebuilt every frame.
+//
+// A pass reading a resource runs after every pass that writes it, and the passes writing one resource run in
+// the order they were added. A pass may read what it writes (drawing over the back buffer...) : it then runs
+// after the writers added before it. compile turns
+// that into an execution order, passes added earlier first when nothing orders them, and culls the passes none
+// of the imported resources (the back buffer...) depends on.
+//
+// execute then records the deferred passes on worker threads, all at once, while the calling thread plays them
+// in execution order as they come in. Passes that can't be deferred (ImGui only draws on the context it was
+// initialized with) are recorded on the calling thread when their turn comes. Without a thread pool everything
+// is recorded on the immediate context, in order.
+class FrameGraph {
+public:
+    using ResourceId = uint32_t;
+    using PassId = uint32_t;
+
+    // Of the last compile
+    struct Statistics {
+        uint32_t passes = 0;
+        uint32_t culledPasses = 0;
+        uint32_t deferredPasses = 0;    // not culled
+        uint32_t dependencies = 0;
+    };
+
+    FrameGraph() = default;
+    virtual ~FrameGraph() = default;
+
+    FrameGraph(const FrameGraph&) = delete;
+    FrameGraph& operator=(const FrameGraph&) = delete;
+
+    void clear();
+
+    // Made and consumed within the frame
+    ResourceId create_resource(const char* name);
+    // Outlives the frame : the passes writing it are never culled
+    ResourceId import_resource(const char* name);
+
+    // 'deferred' : the pass may be recorded on a worker thread into a deferred context
+    PassId add_pass(const char* name, PassRecord passRecord, bool deferred = true);
+    void read(PassId pass, ResourceId resource);
+    void write(PassId pass, ResourceId resource);
+
+    void compile();
+    // Valid after compile, until the next add_pass, read, write or clear
+    const std::vector<PassId>& order() const { return executionOrder; }
+    bool culled(PassId pass) const { return passes.at(pass).culled; }
+    bool deferred(PassId pass) const { return passes.at(pass).deferred; }
+    const std::string& pass_name(PassId pass) const { return passes.at(pass).name; }
+    const Statistics& statistics() const { return graphStatistics; }
+
+    // 'threadPool' : records the deferred passes; null records every pass on the immediate context
+    void execute(FrameGraphBackend& backend, ThreadPool* threadPool);
+
+private:
+    struct Resource {
+        std::string name;
+        bool imported;
+        std::vector<PassId> writers;    // in add order
+    };
+    struct Pass {
+        std::string name;
+        PassRecord record;
+        bool deferred;
+        std::vector<ResourceId> reads;
+        std::vector<ResourceId> writes;
+        std::vector<PassId> dependencies;   // passes that run before this one
+        bool culled = false;
+    };
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<PassId> executionOrder;
+    bool compiled = false;
+    Statistics graphStatistics;
+
+    // Deferred passes that finished recording during execute
+    std::mutex recordedMutex;
+    std::condition_variable passRecorded;
+    std::vector<uint8_t> recordedPasses;
+};
+
+// Logs what a FrameGraph asks of its backend, from which thread. Deferred passes are recorded with a null
+// context, so their PassRecord can log too.
+class RecordingFrameGraphBackend : public FrameGraphBackend {
+public:
+    enum class EventType {
+        RECORD,
+        EXECUTE,
+        RECORD_IMMEDIATE,
+    };
+    struct Event {
+        EventType type;
+        uint32_t pass;
+        std::thread::id thread;
+    };
+
+    void begin(size_t passCount) override;
+    void record(uint32_t pass, const PassRecord& passRecord) override;
+    void execute(uint32_t pass) override;
+    void record_immediate(uint32_t pass, const PassRecord& passRecord) override;
+
+    // Since the last begin. Read it after execute has returned.
+    const std::vector<Event>& events() const { return recordedEvents; }
+    // True when the passes were played in 'order' on the thread that called begin, each once : recorded straight
+    // into the immediate context, or executed after it was recorded
+    bool played_in(const std::vector<uint32_t>& order) const;
+
+private:
+    std::mutex eventMutex;
+    std::vector<Event> recordedEvents;
+    std::thread::id mainThread;
+};
@@ -16,7 +16,7 @@ Framebuffer::Framebuffer(ID3D11Device* device, uint32_t width, uint32_t height)
     texture2dDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
     texture2dDesc.CPUAccessFlags = 0;
     texture2dDesc.MiscFlags = 0;
-    hr = device->CreateTexture2D(&texture2dDesc, 0, renderTargetBuffer.GetAddressOf()); // RenderTargetBuffertexture2dDescœ͂eBuffer̐(ႦȂi̎MĂ)
+    hr = device->CreateTexture2D(&texture2dDesc, 0, renderTargetBuffer.GetAddressOf()); // RenderTargetBufferにtexture2dDescで入力した内容でBufferの生成(例えるなら特注品の皿を作ってもらった感じ)
     _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
 
     D3D11_RENDER_TARGET_VIEW_DESC renderTargetViewDesc = {};
@@ -71,7 +71,7 @@ void Framebuffer::activate(ID3D11DeviceContext* immediateContext) {
     immediateContext->OMGetRenderTargets(1, cachedRenderTargetView.ReleaseAndGetAddressOf(), cachedDepthStencilView.ReleaseAndGetAddressOf());
 
     immediateContext->RSSetViewports(1, &viewport);
-    immediateContext->OMSetRenderTargets(1, renderTargetView.GetAddressOf(), depthStencilView.Get()); // renderTargetViewdepthStencilViewZbg
+    immediateContext->OMSetRenderTargets(1, renderTargetView.GetAddressOf(), depthStencilView.Get()); // renderTargetViewにdepthStencilViewをセット
 }
 
 void Framebuffer::deactivate(ID3D11DeviceContext* immediateContext) {
@@ -81,7 +81,8 @@ bool framework::initialize()
 	depthStencilBuffer->Release();
 
 	// ビューポートの設定
-	D3D11_VIEWPORT viewport = {};
+	// renderのパスもこれを使う
+	viewport = {};
 	viewport.TopLeftX = 0;
 	viewport.TopLeftY = 0;
 	viewport.Width = static_cast<float>(SCREEN_WIDTH);
@@ -255,17 +256,31 @@ bool framework::initialize()
 
 	// スキンドメッシュの生成
 	spriteBatches[0] = std::make_unique<SpriteBatch>(device.Get(), L".\\resources\\screenshot.jpg", 1);
-	skinnedMeshes[0] = std::make_unique<SkinnedMesh>(device.Get(), ".\\resources\\nico.fbx");
+	asyncLoader = std::make_unique<AsyncLoader>();
+	stateTracker = std::make_unique<StateTracker>(immediateContext.Get());
+	// 定数はこのリングから割り当てる (D3D11.1のオフセット指定が使えない環境では各自のバッファのまま)
+	constantRing = std::make_unique<ConstantRing>(device.Get(), immediateContext.Get());
+	add_shared_constant_ring(constantRing.get());
+	// 遅延コンテキストに記録するパスは多くても3つ (UIはimmediateContext)
+	deferredContextBackend = std::make_unique<DeferredContextBackend>(device.Get(), immediateContext.Get());
+	recordThreadPool = std::make_unique<ThreadPool>(3);
+	animationSystem = std::make_unique<AnimationSystem>();
+	skinnedMeshLoads[0] = SkinnedMesh::load_async(*asyncLoader, device.Get(), ".\\resources\\nico.fbx");
+	graphics = std::make_unique<Graphics>(device.Get(), immediateContext.Get(), static_cast<float>(SCREEN_WIDTH), static_cast<float>(SCREEN_HEIGHT));
+	// ResourceManagerを通して非同期で読み込み、updateでreadyになったらModelを作る
+	modelLoads[0] = ResourceManager::Instance().LoadModelResourceAsync(*asyncLoader, ".\\resources\\Jummo\\Jummo.mdl");
 
 	// framebufferオブジェクトの生成
 	framebuffers[0] = std::make_unique<Framebuffer>(device.Get(), 1280, 720);
 	framebuffers[1] = std::make_unique<Framebuffer>(device.Get(), 1280 / 2, 720 / 2);
+	framebuffers[2] = std::make_unique<Framebuffer>(device.Get(), 1280 / 2, 720 / 2);
 
 	// fullscreenQuadオブジェクトの生成
 	bitBlockTransfer = std::make_unique<FullscreenQuad>(device.Get());
 
 	create_ps_from_cso(device.Get(), "./Shader/luminance_extraction_ps.cso", pixelShaders[0].GetAddressOf());
 	create_ps_from_cso(device.Get(), "./Shader/blur_ps.cso", pixelShaders[1].GetAddressOf());
+	create_ps_from_cso(device.Get(), "./Shader/composite_ps.cso", pixelShaders[2].GetAddressOf());
 
 	hr = XAudio2Create(xaudio2.GetAddressOf(), 0, XAUDIO2_DEFAULT_PROCESSOR);
 	_ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
@@ -280,6 +295,38 @@ bool framework::initialize()
 
 void framework::update(float elapsed_time/*Elapsed seconds from last frame*/)
 {
+	// Device objects of the models loaded in the background, at most about 2ms per frame
+	asyncLoader->finalize(0.002f);
+	// Evict textures nobody uses any more once the texture budget is exceeded
+	trim_textures();
+	for (size_t meshIndex = 0; meshIndex < _countof(skinnedMeshLoads); ++meshIndex) {
+		if (skinnedMeshLoads[meshIndex].ready()) {
+			skinnedMeshes[meshIndex] = skinnedMeshLoads[meshIndex].share();
+			skinnedMeshLoads[meshIndex] = {};
+#ifdef _DEBUG
+			skinnedMeshes[meshIndex]->report_animations();
+#endif
+		}
+	}
+	for (size_t modelIndex = 0; modelIndex < _countof(modelLoads); ++modelIndex) {
+		if (modelLoads[modelIndex].ready()) {
+			models[modelIndex] = std::make_unique<Model>(modelLoads[modelIndex].share());
+			modelLoads[modelIndex] = {};
+		}
+	}
+
+	// 前フレームのrenderで送ったスキニング用データ
+	const SkinnedMesh::UploadStatistics skinningUploads = SkinnedMesh::upload_statistics();
+	SkinnedMesh::reset_upload_statistics();
+	// 前フレームのrenderでstateTrackerと各パスのStateTrackerを通した設定
+	const StateTracker::Statistics stateStatistics = stateTracker->statistics();
+	stateTracker->reset_statistics();
+	const ConstantRing::Statistics ringStatistics = constantRing->statistics();
+	constantRing->reset_statistics();
+	const DeferredContextBackend::Statistics passStatistics = deferredContextBackend->statistics();
+	const ConstantRing::Statistics deferredRingStatistics = deferredContextBackend->constant_ring_statistics();
+	deferredContextBackend->reset_statistics();
+	const FrameGraph::Statistics graphStatistics = frameGraph.statistics();
 
 #ifdef USE_IMGUI
 	ImGui_ImplDX11_NewFrame();
@@ -331,7 +378,65 @@ void framework::update(float elapsed_time/*Elapsed seconds from last frame*/)
 			ImGui::ColorEdit4("color", &materialColor.x);
 			ImGui::TreePop();
 		}
+		if (ImGui::TreeNode("LOD")) {
+			ImGui::InputFloat("PixelError", &lodPixelError);
+			ImGui::SliderInt("ForcedLod", &forcedLod, -1, SkinnedMesh::MAX_LODS - 1);
+			if (skinnedMeshes[0]) {
+				ImGui::Text("LOD : %zu / %zu", skinnedMeshLod, skinnedMeshes[0]->lod_count());
+			}
+			ImGui::TreePop();
+		}
+		if (ImGui::TreeNode("Lambert")) {
+			ImGui::Checkbox("Draw", &lambertModels);
+			ImGui::SliderFloat3("position", &modelTranslation.x, -10.0f, +10.0f);
+			ImGui::InputFloat("scale", &modelScale);
+			if (models[0] && !models[0]->GetResource()->GetAnimations().empty()) {
+				const int animationCount = static_cast<int>(models[0]->GetResource()->GetAnimations().size());
+				if (ImGui::SliderInt("animation", &modelAnimation, 0, animationCount - 1)) {
+					models[0]->PlayAnimation(modelAnimation, true);
+				}
+			}
+			ImGui::TreePop();
+		}
 		if (ImGui::TreeNode("Animation")) {
+			ImGui::SliderInt("Crowd", &crowdSize, 1, 1000);
+			ImGui::InputFloat("CrowdSpacing", &crowdSpacing);
+			ImGui::Checkbox("BakedCrowd", &bakedCrowd);
+			ImGui::Checkbox("InstancedCrowd", &instancedCrowd);
+			ImGui::Checkbox("CrowdCulling", &crowdCulling);
+			ImGui::SliderFloat("MaxDrawDistance", &maxDrawDistance, 1.0f, 200.0f);
+			if (bakedAnimation) {
+				ImGui::Text("Baked : %u x %u texels (%.1f KB)", bakedAnimation->width(), bakedAnimation->height(),
+					bakedAnimation->size_in_bytes() / 1024.0f);
+			}
+			ImGui::Text("Animation threads : %zu", animationSystem->thread_count() + 1);
+			if (ImGui::TreeNode("Animation LOD")) {
+				AnimationSystem::LodPolicy policy = animationSystem->lod_policy();
+				int jointBudget = static_cast<int>(policy.jointBudget);
+				ImGui::Checkbox("Enabled", &policy.enabled);
+				ImGui::Checkbox("InterpolatePalettes", &policy.interpolatePalettes);
+				ImGui::InputFloat("HalfRateSize", &policy.halfRateSize);
+				ImGui::InputFloat("QuarterRateSize", &policy.quarterRateSize);
+				ImGui::InputFloat("ReducedSize", &policy.reducedSize);
+				ImGui::InputInt("JointBudget", &jointBudget);
+				policy.jointBudget = static_cast<size_t>(std::max<int>(jointBudget, 0));
+				animationSystem->set_lod_policy(policy);
+
+				const AnimationSystem::LodStatistics& statistics = animationSystem->lod_statistics();
+				for (size_t tier = 0; tier < static_cast<size_t>(AnimationSystem::Tier::COUNT); ++tier) {
+					ImGui::Text("%-10s : %zu", AnimationSystem::tier_name(static_cast<AnimationSystem::Tier>(tier)), statistics.instances[tier]);
+				}
+				ImGui::Text("Joints : %zu this frame, %zu / %zu per frame", statistics.evaluatedJoints, statistics.averageJoints, policy.jointBudget);
+				// インスタンスごとのティア
+				ImGui::BeginChild("Tiers", ImVec2(0, 150), true);
+				for (size_t instanceIndex = 0; instanceIndex < animationSystem->instance_count(); ++instanceIndex) {
+					const AnimationSystem::InstanceId id = static_cast<AnimationSystem::InstanceId>(instanceIndex);
+					ImGui::Text("%4zu : %-10s %.0f px", instanceIndex, AnimationSystem::tier_name(animationSystem->tier(id)),
+						animationSystem->projected_size(id));
+				}
+				ImGui::EndChild();
+				ImGui::TreePop();
+			}
 			ImGui::InputInt("keyFrameIndex", &keyframeIndex);
 			ImGui::InputFloat4("setTestTranslation", &setTestTranslation.x);
 
@@ -341,9 +446,120 @@ void framework::update(float elapsed_time/*Elapsed seconds from last frame*/)
 		}
 		ImGui::TreePop();
 	}
+	if (ImGui::TreeNode(u8"プロファイラ")) {
+		ImGui::Text("Bone upload : %.1f KB (%u meshes, %u skipped)", skinningUploads.boneBytes / 1024.0f,
+			skinningUploads.boneUploads, skinningUploads.skippedBoneUploads);
+		ImGui::Text("Skinning constants : %.1f KB", skinningUploads.constantBytes / 1024.0f);
+		ImGui::Text("State changes : %u (%u skipped)", stateStatistics.stateChanges, stateStatistics.skippedBinds);
+		ImGui::Text("Culling : %u visible / %u (%u outside the frustum, %u too far)", cullStatistics.visible, cullStatistics.tested,
+			cullStatistics.outsideFrustum, cullStatistics.beyondDistance);
+		if (constantRing->supported()) {
+			ImGui::Text("Constant ring : %.1f KB (%u slices, %u waits, %u discards)", ringStatistics.bytes / 1024.0f,
+				ringStatistics.allocations, ringStatistics.waits, ringStatistics.discards);
+			ImGui::Text("Deferred constant rings : %.1f KB (%u slices, %u discards)", deferredRingStatistics.bytes / 1024.0f,
+				deferredRingStatistics.allocations, deferredRingStatistics.discards);
+		}
+		else {
+			ImGui::Text("Constant ring : not supported (UpdateSubresource)");
+		}
+		ImGui::Checkbox("DeferredPasses", &deferredPasses);
+		ImGui::Text("Passes : %u (%u deferred, %u culled), %u command lists, %u immediate", graphStatistics.passes,
+			graphStatistics.deferredPasses, graphStatistics.culledPasses, passStatistics.commandLists, passStatistics.immediatePasses);
+		if (!deferredContextBackend->driver_command_lists()) {
+			ImGui::Text("Command lists : emulated by the runtime");
+		}
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode(u8"モデルリソース")) {
+		ResourceManager::Instance().DrawDebugGUI();
+		ImGui::TreePop();
+	}
+	if (ImGui::TreeNode(u8"テクスチャキャッシュ")) {
+		const TextureCacheStatistics statistics = texture_cache_statistics();
+		int budgetMB = static_cast<int>(statistics.budget / (1024 * 1024));
+		if (ImGui::SliderInt("Budget (MB)", &budgetMB, 1, 2048)) {
+			set_texture_budget(static_cast<size_t>(budgetMB) * 1024 * 1024);
+		}
+		const uint64_t requests = statistics.hits + statistics.misses;
+		ImGui::Text("Resident : %.2f MB", statistics.residentBytes / (1024.0f * 1024.0f));
+		ImGui::Text("Textures : %zu (%zu loading)", statistics.textureCount, statistics.loadingCount);
+		ImGui::Text("Hit rate : %.1f%% (%llu / %llu)", requests > 0 ? 100.0f * statistics.hits / requests : 0.0f, statistics.hits, requests);
+		ImGui::Text("Evicted : %llu", statistics.evictions);
+		ImGui::TreePop();
+	}
+	// 結果は出力ウィンドウに出る (押したフレームは計測の間止まる)
+	if (ImGui::TreeNode(u8"ベンチマーク")) {
+		if (ImGui::Button("SkinnedMesh load : cereal vs cooked")) {
+			for (const char* fbxFilename : { ".\\resources\\nico.fbx", ".\\resources\\AimTest\\MNK_Mesh.fbx", ".\\resources\\danbo_fbx\\danbo_taiki.fbx" }) {
+				SkinnedMesh(device.Get(), fbxFilename); // キャッシュがなければ作る
+				SkinnedMesh::benchmark_load(fbxFilename);
+			}
+		}
+		if (ImGui::Button("OBJ parse : wifstream vs obj::parse_obj")) {
+			for (const wchar_t* objFilename : { L".\\resources\\Bison\\Bison.obj", L".\\resources\\F-14A_Tomcat\\F-14A_Tomcat.obj" }) {
+				StaticMesh::benchmark_parse(objFilename);
+			}
+		}
+		if (ImGui::Button("Pose : AoS update_animation vs SoA Pose::update")) {
+			SkinnedMesh(device.Get(), ".\\resources\\nico.fbx").benchmark_pose();
+		}
+		if (ImGui::Button("AnimationSystem::update : 1 thread vs every thread")) {
+			AnimationSystem::benchmark_update(SkinnedMesh(device.Get(), ".\\resources\\nico.fbx"));
+		}
+		if (ImGui::Button("Model::UpdateTransform : every node vs dirty subtrees")) {
+			Model::BenchmarkTransform(".\\resources\\Jummo\\Jummo.mdl");
+		}
+		if (ImGui::Button("Model::UpdateAnimation")) {
+			Model::BenchmarkAnimation(".\\resources\\Jummo\\Jummo.mdl");
+		}
+		if (ImGui::Button("CPU skinning : scalar vs SSE/AVX vs threads")) {
+			cpu_skinning::benchmark_skinning();
+		}
+		if (ImGui::Button("Culling : scalar vs SSE")) {
+			FrustumCuller::benchmark_culling();
+		}
+		ImGui::TreePop();
+	}
 	ImGui::End();
 #endif
 
+	// ベイク済みのパレットはクリップと時間を渡すだけなのでポーズの計算はいらない
+	if (bakedCrowd && skinnedMeshes[0] && skinnedMeshes[0]->animationClips.size() > 0) {
+		if (!bakedAnimation) {
+			// Cookerが書いた.bakedがなければここでベイクする
+			const char* fbxFilename = ".\\resources\\nico.fbx";
+			bakedAnimation = std::make_unique<BakedAnimation>();
+			if (!bakedAnimation->load(SkinnedMesh::baked_filename(fbxFilename), SkinnedMesh::source_key(fbxFilename, false, 0), 30.0f)) {
+				skinnedMeshes[0]->bake_animations(*bakedAnimation, 30.0f);
+			}
+			bakedAnimation->create_texture(device.Get());
+		}
+		bakedCrowdTime += elapsed_time;
+	}
+	// 全インスタンスのポーズとパレットをワーカースレッドで計算し、ここで待ち合わせる (renderは読むだけ)
+	else if (skinnedMeshes[0] && skinnedMeshes[0]->animationClips.size() > 0) {
+		if (animationSystem->instance_count() != static_cast<size_t>(crowdSize)) {
+			animationSystem->clear();
+			for (int instanceIndex = 0; instanceIndex < crowdSize; ++instanceIndex) {
+				// 同じ動きにならないよう開始時間をずらす
+				animationSystem->add_instance(*skinnedMeshes[0], skinnedMeshes[0]->animationClips.at(0),
+					ClipSampler::WrapMode::LOOP, instanceIndex * 0.37f);
+			}
+		}
+		animationSystem->update(elapsed_time);
+	}
+
+	if (models[0]) {
+		if (!models[0]->IsPlayAnimation() && !models[0]->GetResource()->GetAnimations().empty()) {
+			models[0]->PlayAnimation(modelAnimation, true, 0.0f);
+		}
+		models[0]->UpdateAnimation(elapsed_time);
+		DirectX::XMFLOAT4X4 transform;
+		DirectX::XMStoreFloat4x4(&transform, DirectX::XMMatrixScaling(modelScale, modelScale, modelScale) *
+			DirectX::XMMatrixTranslation(modelTranslation.x, modelTranslation.y, modelTranslation.z));
+		models[0]->UpdateTransform(transform);
+	}
+
 	if (GetKeyState('W') & 0x8000) {
 		se[0]->play();
 	}
@@ -361,28 +577,7 @@ void framework::render(float elapsed_time/*Elapsed seconds from last frame*/)
 	immediateContext.Get()->VSSetShaderResources(0, _countof(nullSRViews), nullSRViews);
 	immediateContext.Get()->PSSetShaderResources(0, _countof(nullSRViews), nullSRViews);
 
-	FLOAT color[]{ 0.0f,0.5f,0.2f,1.0f };
-
-	immediateContext.Get()->ClearRenderTargetView(renderTargetView.Get(), color);
-	immediateContext.Get()->ClearDepthStencilView(depthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
-
-	immediateContext.Get()->OMSetRenderTargets(1, renderTargetView.GetAddressOf(), depthStencilView.Get());
-
-	immediateContext.Get()->OMSetDepthStencilState(depthStencilStates[static_cast<size_t>(DEPTH_STATE::ZT_OFF_ZW_OFF)].Get(), 1);
-
-	immediateContext.Get()->OMSetBlendState(blendStates[static_cast<size_t>(BLEND_STATE::ALPHA)].Get(), nullptr, 0xffffffff);
-
-	immediateContext.Get()->PSSetSamplers(0, 1, samplerStates[0].GetAddressOf());
-	immediateContext.Get()->PSSetSamplers(1, 1, samplerStates[1].GetAddressOf());
-	immediateContext.Get()->PSSetSamplers(2, 1, samplerStates[2].GetAddressOf());
-
-	immediateContext.Get()->RSSetState(rasterizerStates[static_cast<size_t>(RASTER_STATE::SOLID)].Get());
-
-	// ビュー・プロジェクション変換行列を計算し、定数バッファにセット
-	D3D11_VIEWPORT viewport;
-	UINT numViewports = 1;
-	immediateContext->RSGetViewports(&numViewports, &viewport);
-
+	// ビュー・プロジェクション変換行列を計算する (定数バッファはsceneパスでセット)
 	float aspectRatio = viewport.Width / viewport.Height;
 	DirectX::XMMATRIX P = DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(30), aspectRatio, 0.1f/*near panel*/, 100.0f/*far panel*/);
 
@@ -396,10 +591,6 @@ void framework::render(float elapsed_time/*Elapsed seconds from last frame*/)
 	data.lightDirection = lightDirection;
 	data.cameraPosition = cameraPosition;
 
-	immediateContext.Get()->UpdateSubresource(constantBuffers[0].Get(), 0, 0, &data, 0, 0);
-	immediateContext.Get()->VSSetConstantBuffers(1, 1, constantBuffers[0].GetAddressOf());
-	immediateContext.Get()->PSSetConstantBuffers(1, 1, constantBuffers[0].GetAddressOf());
-
 	const DirectX::XMFLOAT4X4 coordinateSystemTransforms[] = {
 		{-1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1},					// 0:RHS Y-UP
 		{1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1},					// 1:LHS Y-UP
@@ -422,47 +613,273 @@ void framework::render(float elapsed_time/*Elapsed seconds from last frame*/)
 	DirectX::XMFLOAT4X4 world;
 	DirectX::XMStoreFloat4x4(&world, C * S * R * T);
 
-	framebuffers[0]->clear(immediateContext.Get());
-	framebuffers[0]->activate(immediateContext.Get());
+	DirectX::XMFLOAT4X4 view, projection;
+	DirectX::XMStoreFloat4x4(&view, V);
+	DirectX::XMStoreFloat4x4(&projection, P);
+	if (skinnedMeshes[0]) {
+		const float projectedSize = skinnedMeshes[0]->projected_size(world, view, projection, viewport.Height);
+		skinnedMeshLod = forcedLod >= 0 ? static_cast<size_t>(forcedLod) :
+			skinnedMeshes[0]->select_lod(projectedSize, skinnedMeshLod, lodPixelError);
+		// アニメーションLODは次のupdateでこのカメラを使う (1フレーム遅れ)
+		animationSystem->set_camera(view, projection, viewport.Height);
+	}
+	prepare_crowd(data.viewProjection, view, projection, world);
+
+	// パスの依存関係から実行順を決め、遅延コンテキストに記録できるパスはワーカースレッドで同時に記録する
+	// (scene・輝度抽出・ブラー・合成は遅延コンテキスト、lambertとUIは即時コンテキスト)
+	frameGraph.clear();
+	const FrameGraph::ResourceId sceneColor = frameGraph.create_resource("scene color");
+	const FrameGraph::ResourceId luminance = frameGraph.create_resource("luminance");
+	const FrameGraph::ResourceId bloom = frameGraph.create_resource("bloom");
+	const FrameGraph::ResourceId backBuffer = frameGraph.import_resource("back buffer");
+
+	const FrameGraph::PassId scenePass = frameGraph.add_pass("scene", [&](ID3D11DeviceContext* context) {
+		record_scene(context, data, world);
+	});
+	frameGraph.write(scenePass, sceneColor);
+
+	// LambertShaderはサブセットをRenderQueueに積んでソートしてから描く。ステートトラッカーがimmediateContextのものなので、
+	// 順番が来たらその場で記録する
+	if (lambertModels && models[0]) {
+		const FrameGraph::PassId lambertPass = frameGraph.add_pass("lambert", [&](ID3D11DeviceContext* context) {
+			// 前のパスのコマンドリストを実行したのでステートはクリアされている
+			graphics->GetStateTracker()->invalidate();
+			framebuffers[0]->activate(context);
+
+			RenderContext rc;
+			rc.view = view;
+			rc.projection = projection;
+			rc.lightDirection = lightDirection;
+			Shader* shader = graphics->GetShader();
+			shader->Begin(context, rc);
+			shader->Draw(context, models[0].get());
+			shader->End(context);
+
+			framebuffers[0]->deactivate(context);
+		}, false);
+		frameGraph.read(lambertPass, sceneColor);
+		frameGraph.write(lambertPass, sceneColor);
+	}
+
+	const FrameGraph::PassId luminancePass = frameGraph.add_pass("luminance extraction", [&](ID3D11DeviceContext* context) {
+		StateTracker states(context);
+		set_fullscreen_states(states);
+		framebuffers[1]->clear(context);
+		framebuffers[1]->activate(context);
+		bitBlockTransfer->set_luminance_clamp(context, luminanceMin, luminanceMax);
+		bitBlockTransfer->blit(context, framebuffers[0]->shaderResourceViews[0].GetAddressOf(), 0, 1, pixelShaders[0].Get());
+		framebuffers[1]->deactivate(context);
+		add_pass_statistics(states);
+	});
+	frameGraph.read(luminancePass, sceneColor);
+	frameGraph.write(luminancePass, luminance);
+
+	// 抽出した輝度をぼかす (ブルームの強さもここで掛ける)
+	const FrameGraph::PassId blurPass = frameGraph.add_pass("blur", [&](ID3D11DeviceContext* context) {
+		StateTracker states(context);
+		set_fullscreen_states(states);
+		framebuffers[2]->clear(context);
+		framebuffers[2]->activate(context);
+		bitBlockTransfer->set_blur(context, blurGaussianSigma, blurBloomIntensity);
+		bitBlockTransfer->blit(context, framebuffers[1]->shaderResourceViews[0].GetAddressOf(), 0, 1, pixelShaders[1].Get());
+		framebuffers[2]->deactivate(context);
+		add_pass_statistics(states);
+	});
+	frameGraph.read(blurPass, luminance);
+	frameGraph.write(blurPass, bloom);
+
+	const FrameGraph::PassId compositePass = frameGraph.add_pass("composite", [&](ID3D11DeviceContext* context) {
+		StateTracker states(context);
+		set_fullscreen_states(states);
+
+		FLOAT color[]{ 0.0f,0.5f,0.2f,1.0f };
+		context->ClearRenderTargetView(renderTargetView.Get(), color);
+		context->ClearDepthStencilView(depthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+		context->OMSetRenderTargets(1, renderTargetView.GetAddressOf(), depthStencilView.Get());
+		context->RSSetViewports(1, &viewport);
+
+		ID3D11ShaderResourceView* shaderResourceViews[2] = {
+			framebuffers[0]->shaderResourceViews[0].Get(),framebuffers[2]->shaderResourceViews[0].Get(),
+		};
+		bitBlockTransfer->set_tone_exposure(context, toneExposure);
+		bitBlockTransfer->blit(context, shaderResourceViews, 0, 2, pixelShaders[2].Get());
+		add_pass_statistics(states);
+	});
+	frameGraph.read(compositePass, sceneColor);
+	frameGraph.read(compositePass, bloom);
+	frameGraph.write(compositePass, backBuffer);
+
+	// ImGuiは初期化したコンテキスト (immediateContext) にしか描けないので、順番が来たらその場で記録する
+	const FrameGraph::PassId uiPass = frameGraph.add_pass("UI", [&](ID3D11DeviceContext* context) {
+#ifdef USE_IMGUI
+		context->OMSetRenderTargets(1, renderTargetView.GetAddressOf(), depthStencilView.Get());
+		context->RSSetViewports(1, &viewport);
+		ImGui::Render();
+		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+#endif
+	}, false);
+	frameGraph.read(uiPass, backBuffer);
+	frameGraph.write(uiPass, backBuffer);
 
-	immediateContext.Get()->RSSetState(rasterizerStates[static_cast<size_t>(RASTER_STATE::CULL_NONE)].Get());
-	immediateContext.Get()->OMSetDepthStencilState(depthStencilStates[static_cast<size_t>(DEPTH_STATE::ZT_OFF_ZW_OFF)].Get(), 0);
-	immediateContext.Get()->OMSetBlendState(blendStates[static_cast<size_t>(BLEND_STATE::NONE)].Get(), nullptr, 0xffffffff);
-	spriteBatches[0]->begin(immediateContext.Get());
-	spriteBatches[0]->render(immediateContext.Get(), 0, 0, 1280, 720);
-	spriteBatches[0]->end(immediateContext.Get());
+	frameGraph.compile();
+	frameGraph.execute(*deferredContextBackend, deferredPasses ? recordThreadPool.get() : nullptr);
+	// コマンドリストを実行すると即時コンテキストのステートはクリアされる。パスはそれぞれのStateTrackerで設定している
+	stateTracker->invalidate();
+	// lambertパスはGraphicsのStateTrackerで設定している
+	stateTracker->add_statistics(graphics->GetStateTracker()->statistics());
+	graphics->GetStateTracker()->reset_statistics();
 
-	immediateContext.Get()->OMSetDepthStencilState(depthStencilStates[static_cast<size_t>(DEPTH_STATE::ZT_ON_ZW_ON)].Get(), 0);
-	immediateContext.Get()->RSSetState(rasterizerStates[static_cast<size_t>(RASTER_STATE::SOLID)].Get());
-	immediateContext.Get()->OMSetBlendState(blendStates[static_cast<size_t>(BLEND_STATE::NONE)].Get(), nullptr, 0xffffffff);
+	// このフレームの定数をフェンスで区切る
+	constantRing->end_frame();
 
-	if (skinnedMeshes[0]->animationClips.size() > 0) {
-#if 1
-		int clipIndex = 0;
-		int frameIndex = 0;
-		static float animationTick = 0;
+	UINT syncInterval = 0;
+	
+	swapChain->Present(syncInterval, 0);
+	
+}
+
+// sceneパスが描く群衆を用意する : インスタンスのワールド行列、AnimationSystemへのset_world、LOD選択とカリング。
+// sceneパスはワーカースレッドで記録されることがあるので、renderでグラフを組む前に済ませる
+void framework::prepare_crowd(const DirectX::XMFLOAT4X4& viewProjection,
+	const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, const DirectX::XMFLOAT4X4& world)
+{
+	// カリング用 : バインドポーズの箱をアニメーションではみ出す分だけ広げる
+	const DirectX::XMFLOAT3 cameraEye = { eyeX, eyeY, eyeZ };
+	DirectX::XMFLOAT3 crowdBoundsMin = { 0,0,0 }, crowdBoundsMax = { 0,0,0 };
+	if (skinnedMeshes[0]) {
+		skinnedMeshes[0]->bounding_box(crowdBoundsMin, crowdBoundsMax);
+		const float margin = 0.25f * std::max<float>({ crowdBoundsMax.x - crowdBoundsMin.x, crowdBoundsMax.y - crowdBoundsMin.y,
+			crowdBoundsMax.z - crowdBoundsMin.z });
+		crowdBoundsMin = { crowdBoundsMin.x - margin, crowdBoundsMin.y - margin, crowdBoundsMin.z - margin };
+		crowdBoundsMax = { crowdBoundsMax.x + margin, crowdBoundsMax.y + margin, crowdBoundsMax.z + margin };
+	}
+	cullStatistics = {};
 
-		SkinnedMesh::Animation& animation = skinnedMeshes[0]->animationClips.at(clipIndex);
-		frameIndex = static_cast<int>(animationTick * animation.samplingRate);
-		if (frameIndex > animation.sequence.size() - 1) {
-			frameIndex = 0;
-			animationTick = 0;
+	if (!skinnedMeshes[0]) {
+		// Still loading
+	}
+	else if (bakedCrowd && bakedAnimation) {
+		// 開始時間はAnimationSystemと同じずらし方
+		const size_t columns = 10;
+		bakedInstances.resize(static_cast<size_t>(crowdSize));
+		for (size_t instanceIndex = 0; instanceIndex < bakedInstances.size(); ++instanceIndex) {
+			SkinnedMesh::BakedInstance& instance = bakedInstances.at(instanceIndex);
+			DirectX::XMStoreFloat4x4(&instance.world, DirectX::XMLoadFloat4x4(&world) *
+				DirectX::XMMatrixTranslation(crowdSpacing * (instanceIndex % columns), 0, crowdSpacing * (instanceIndex / columns)));
+			instance.clip = 0;
+			instance.seconds = bakedCrowdTime + instanceIndex * 0.37f;
+		}
+		if (crowdCulling) {
+			frustumCuller.clear();
+			for (const SkinnedMesh::BakedInstance& instance : bakedInstances) {
+				frustumCuller.add(crowdBoundsMin, crowdBoundsMax, instance.world, maxDrawDistance);
+			}
+			frustumCuller.cull(viewProjection, cameraEye);
+			cullStatistics = frustumCuller.statistics();
+			// 見えるものを前に詰める (visible()は昇順なので上書きされる前に読める)
+			const std::vector<uint32_t>& visible = frustumCuller.visible();
+			for (size_t visibleIndex = 0; visibleIndex < visible.size(); ++visibleIndex) {
+				bakedInstances.at(visibleIndex) = bakedInstances.at(visible.at(visibleIndex));
+			}
+			bakedInstances.resize(visible.size());
 		}
 		else {
-			animationTick += elapsed_time;
+			cullStatistics = {};
+			cullStatistics.tested = cullStatistics.visible = static_cast<uint32_t>(bakedInstances.size());
+		}
+	}
+	else if (animationSystem->instance_count() > 0) {
+		// 格子状に並べる
+		const size_t columns = 10;
+		crowdInstances.resize(animationSystem->instance_count());
+		for (size_t instanceIndex = 0; instanceIndex < animationSystem->instance_count(); ++instanceIndex) {
+			SkinnedMesh::Instance& instance = crowdInstances.at(instanceIndex);
+			DirectX::XMStoreFloat4x4(&instance.world, DirectX::XMLoadFloat4x4(&world) *
+				DirectX::XMMatrixTranslation(crowdSpacing * (instanceIndex % columns), 0, crowdSpacing * (instanceIndex / columns)));
+			animationSystem->set_world(static_cast<AnimationSystem::InstanceId>(instanceIndex), instance.world);
+			instance.materialColor = materialColor;
+			instance.palette = &animationSystem->palette(static_cast<AnimationSystem::InstanceId>(instanceIndex));
+			// インスタンスごとのLOD (ヒステリシスは前フレームのLODから)
+			instance.lod = forcedLod >= 0 ? static_cast<size_t>(forcedLod) : skinnedMeshes[0]->select_lod(
+				skinnedMeshes[0]->projected_size(instance.world, view, projection, viewport.Height), instance.lod, lodPixelError);
+		}
+		visibleCrowdInstances.clear();
+		if (crowdCulling) {
+			frustumCuller.clear();
+			for (const SkinnedMesh::Instance& instance : crowdInstances) {
+				frustumCuller.add(crowdBoundsMin, crowdBoundsMax, instance.world, maxDrawDistance);
+			}
+			frustumCuller.cull(viewProjection, cameraEye);
+			cullStatistics = frustumCuller.statistics();
+			for (uint32_t instanceIndex : frustumCuller.visible()) {
+				visibleCrowdInstances.push_back(crowdInstances.at(instanceIndex));
+			}
 		}
+		else {
+			visibleCrowdInstances = crowdInstances;
+			cullStatistics = {};
+			cullStatistics.tested = cullStatistics.visible = static_cast<uint32_t>(crowdInstances.size());
+		}
+	}
+}
 
-		SkinnedMesh::Animation::Keyframe& keyframe = animation.sequence.at(frameIndex);
+// sceneパス : framebuffers[0]に背景と群衆を描く。ワーカースレッドで遅延コンテキストに記録されることがあるので、
+// フレームの状態は読むだけ (群衆はprepare_crowdで用意してある)
+void framework::record_scene(ID3D11DeviceContext* context, const SceneConstants& sceneConstants, const DirectX::XMFLOAT4X4& world)
+{
+	// 遅延コンテキストは何も設定されていない状態から始まる
+	StateTracker states(context);
+	states.set_sampler(0, samplerStates[0].Get());
+	states.set_sampler(1, samplerStates[1].Get());
+	states.set_sampler(2, samplerStates[2].Get());
+	upload_constants(context, 1, constantBuffers[0].Get(), &sceneConstants, sizeof(sceneConstants), CONSTANT_STAGE_VS | CONSTANT_STAGE_PS);
+
+	framebuffers[0]->clear(context);
+	framebuffers[0]->activate(context);
+
+	states.set_rasterizer_state(rasterizerStates[static_cast<size_t>(RASTER_STATE::CULL_NONE)].Get());
+	states.set_depth_stencil_state(depthStencilStates[static_cast<size_t>(DEPTH_STATE::ZT_OFF_ZW_OFF)].Get(), 0);
+	states.set_blend_state(blendStates[static_cast<size_t>(BLEND_STATE::NONE)].Get());
+	spriteBatches[0]->begin(context);
+	spriteBatches[0]->render(context, 0, 0, 1280, 720);
+	spriteBatches[0]->end(context);
+
+	states.set_depth_stencil_state(depthStencilStates[static_cast<size_t>(DEPTH_STATE::ZT_ON_ZW_ON)].Get(), 0);
+	states.set_rasterizer_state(rasterizerStates[static_cast<size_t>(RASTER_STATE::SOLID)].Get());
+	states.set_blend_state(blendStates[static_cast<size_t>(BLEND_STATE::NONE)].Get());
+
+	if (!skinnedMeshes[0]) {
+		// Still loading
+	}
+	else if (bakedCrowd && bakedAnimation) {
+		// 見えるインスタンスはprepare_crowdで詰めてある。1回のインスタンス描画で全員
+		skinnedMeshes[0]->render_baked(context, *bakedAnimation, bakedInstances.data(), bakedInstances.size(),
+			materialColor, skinnedMeshLod);
+	}
+	else if (animationSystem->instance_count() > 0) {
+#if 1
+		// ポーズとパレットはupdateで、見えるインスタンスとそのLODはprepare_crowdで計算済み
+		if (instancedCrowd) {
+			// LODごとにサブセット1回のインスタンス描画
+			skinnedMeshes[0]->render_instanced(context, visibleCrowdInstances.data(), visibleCrowdInstances.size());
+		}
+		else {
+			for (const SkinnedMesh::Instance& instance : visibleCrowdInstances) {
+				skinnedMeshes[0]->render(context, instance.world, instance.materialColor, *instance.palette, instance.lod);
+			}
+		}
 #else
 		SkinnedMesh::Animation::Keyframe keyframe;
+		SkinnedMesh::Animation::Keyframe sampledKeyframes[2];
+		skinnedMeshes[0]->sample_animation(skinnedMeshes[0]->animationClips.at(0), 40, sampledKeyframes[0]);
+		skinnedMeshes[0]->sample_animation(skinnedMeshes[0]->animationClips.at(0), 80, sampledKeyframes[1]);
 		const SkinnedMesh::Animation::Keyframe* keyframes[2] = {
-			&skinnedMeshes[0]->animationClips.at(0).sequence.at(40),
-			&skinnedMeshes[0]->animationClips.at(0).sequence.at(80),
+			&sampledKeyframes[0],
+			&sampledKeyframes[1],
 		};
 
 		skinnedMeshes[0]->blend_animations(keyframes, factor, keyframe);
 		skinnedMeshes[0]->update_animation(keyframe);
-#endif
 
 #if 0
 		XMStoreFloat4(&keyframe.nodes.at(keyframeIndex).rotation,
@@ -470,52 +887,36 @@ void framework::render(float elapsed_time/*Elapsed seconds from last frame*/)
 		keyframe.nodes.at(keyframeIndex).translation.x = setTestTranslation.x;
 		skinnedMeshes[0]->update_animation(keyframe);
 #endif
-		skinnedMeshes[0]->render(immediateContext.Get(), world, materialColor, &keyframe);
+		skinnedMeshes[0]->render(context, world, materialColor, &keyframe, skinnedMeshLod);
+#endif
 	}
 	else {
-		skinnedMeshes[0]->render(immediateContext.Get(), world, materialColor, nullptr);
+		skinnedMeshes[0]->render(context, world, materialColor, nullptr, skinnedMeshLod);
 	}
 
-	framebuffers[0]->deactivate(immediateContext.Get());
-
-#if 1
-	immediateContext.Get()->RSSetState(rasterizerStates[static_cast<size_t>(RASTER_STATE::CULL_NONE)].Get());
-	immediateContext.Get()->OMSetDepthStencilState(depthStencilStates[static_cast<size_t>(DEPTH_STATE::ZT_OFF_ZW_OFF)].Get(), 0);
-	bitBlockTransfer->blit(immediateContext.Get(), framebuffers[0]->shaderResourceViews[0].GetAddressOf(), 0, 1);
-#endif
-
-	framebuffers[1]->clear(immediateContext.Get());
-	framebuffers[1]->activate(immediateContext.Get());
-	bitBlockTransfer->blit(immediateContext.Get(),
-		framebuffers[0]->shaderResourceViews[0].GetAddressOf(), 0, 1, pixelShaders[0].Get());
-	framebuffers[1]->deactivate(immediateContext.Get());
-
-#if 1
-	bitBlockTransfer->set_luminance_clamp(immediateContext.Get(), luminanceMin, luminanceMax);
-	bitBlockTransfer->blit(immediateContext.Get(),
-		framebuffers[1]->shaderResourceViews[0].GetAddressOf(), 0, 1);
-#endif
-
-	ID3D11ShaderResourceView* shaderResourceViews[2] = {
-		framebuffers[0]->shaderResourceViews[0].Get(),framebuffers[1]->shaderResourceViews->Get(),
-	};
-
-	bitBlockTransfer->set_blur(immediateContext.Get(), blurGaussianSigma, blurBloomIntensity);
-	bitBlockTransfer->set_tone_exposure(immediateContext.Get(), toneExposure);
-	bitBlockTransfer->blit(immediateContext.Get(), shaderResourceViews, 0, 2,pixelShaders[1].Get());
-
+	framebuffers[0]->deactivate(context);
+	add_pass_statistics(states);
+}
 
-#ifdef USE_IMGUI
-	ImGui::Render();
-	ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
-#endif
+// 全画面の描画 (ブリット) 用のステート
+void framework::set_fullscreen_states(StateTracker& states)
+{
+	states.set_sampler(0, samplerStates[0].Get());
+	states.set_sampler(1, samplerStates[1].Get());
+	states.set_sampler(2, samplerStates[2].Get());
+	states.set_rasterizer_state(rasterizerStates[static_cast<size_t>(RASTER_STATE::CULL_NONE)].Get());
+	states.set_depth_stencil_state(depthStencilStates[static_cast<size_t>(DEPTH_STATE::ZT_OFF_ZW_OFF)].Get(), 0);
+	states.set_blend_state(blendStates[static_cast<size_t>(BLEND_STATE::NONE)].Get());
+}
 
-	UINT syncInterval = 0;
-	
-	swapChain->Present(syncInterval, 0);
-	
+// パスのStateTrackerの統計をstateTrackerに足す。ワーカースレッドから同時に呼ばれる
+void framework::add_pass_statistics(const StateTracker& states)
+{
+	std::lock_guard<std::mutex> lock(passStatisticsMutex);
+	stateTracker->add_statistics(states.statistics());
 }
 
+
 bool framework::uninitialize()
 {
 	/*device->Release();
@@ -533,5 +934,6 @@ bool framework::uninitialize()
 
 framework::~framework()
 {
+	remove_shared_constant_ring(constantRing.get());
 
 }
\ No newline at end of file
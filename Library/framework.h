@@ -3,6 +3,7 @@
 #include <windows.h>
 #include <tchar.h>
 #include <sstream>
+#include <mutex>
 #include <wrl.h>
 
 #include "misc.h"
@@ -16,6 +17,16 @@
 #include "geometric_primitive.h"
 #include "static_mesh.h"
 #include "skinned_mesh.h"
+#include "animation_system.h"
+#include "state_tracker.h"
+#include "constant_ring.h"
+#include "frustum_culler.h"
+#include "frame_graph.h"
+#include "deferred_context_backend.h"
+#include "thread_pool.h"
+#include "../Graphics/Graphics.h"
+#include "../Graphics/Model.h"
+#include "../Graphics/ResourceManager.h"
 
 #include <d3d11.h>
 
@@ -39,7 +50,7 @@ CONST LPCWSTR APPLICATION_NAME{ L"X3DGP" };
 class framework
 {
 private:
-	// ImGuipϐ
+	// ImGui用変数
 
 	DirectX::XMMATRIX world;
 
@@ -55,12 +66,30 @@ private:
 	DirectX::XMFLOAT3 rotation = { 0,0,0 };
 	DirectX::XMFLOAT4 materialColor = { 1,1,1,1 };
 
-	// Animation֌W
+	// LOD関係 : skinnedMeshes[0]の前フレームのLOD (ヒステリシス用)
+	size_t skinnedMeshLod = 0;
+	float lodPixelError = 1.0f;
+	int forcedLod = -1; // -1 : 画面サイズで自動選択
+
+	// Animation関係
+	int crowdSize = 1;			// skinnedMeshes[0]を並べる数
+	float crowdSpacing = 1.5f;
+	bool bakedCrowd = false;	// ベイクしたパレットで全員を1回のインスタンス描画
+	bool instancedCrowd = true;	// パレットはそれぞれのまま、LODごとにまとめてインスタンス描画
+	bool crowdCulling = true;	// 視錐台と描画距離で見えないインスタンスを描画しない
+	float maxDrawDistance = 60.0f;
+	bool deferredPasses = true;	// パスをワーカースレッドで遅延コンテキストに記録する (falseならimmediateContextに順に記録)
+	float bakedCrowdTime = 0;
+	// models[0] (Graphics/のModel) をLambertShaderで描く
+	bool lambertModels = true;
+	DirectX::XMFLOAT3 modelTranslation = { -3.0f, -1.0f, 0.0f };
+	float modelScale = 0.01f;
+	int modelAnimation = 0;	// models[0]でループ再生するアニメーション
 	int keyframeIndex = 0;
 	DirectX::XMFLOAT4 setTestTranslation = { 0,0,0,0 };
 	float factor = 0.5f;
 
-	// Cӎ]֌W(Animation)
+	// 任意軸回転関係(Animation)
 	DirectX::XMFLOAT4 rAxis = { 1,0,0,0 };
 	float rotateAngle = 0;
 
@@ -78,29 +107,51 @@ public:
 	enum class SAMPLER_STATE { POINT, LINEAR, ANISOTROPIC, LINEAR_BORDER_BLACK, LINEAR_BORDER_WHITE};
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerStates[3];
 	enum class DEPTH_STATE { ZT_ON_ZW_ON, ZT_ON_ZW_OFF, ZT_OFF_ZW_ON, ZT_OFF_ZW_OFF};
-	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencilStates[4]; // `揇
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencilStates[4]; // 描画順
 	enum class BLEND_STATE { NONE, ALPHA, ADD, MULTIPRY};
 	Microsoft::WRL::ComPtr<ID3D11BlendState> blendStates[4];
 	enum class RASTER_STATE { SOLID, WIREFRAME, CULL_NONE, WIREFRAME_CULL_NONE};
 	Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizerStates[4];
 
 	Microsoft::WRL::ComPtr<ID3D11Device> device; 
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext> immediateContext;		// DX11̕`施ߓ𑗂邽߂̃m
-	Microsoft::WRL::ComPtr<IDXGISwapChain> swapChain;					// n[hEFȀ񂪋l܂Ă
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> renderTargetView;	// fBXvC̃obNobt@̃eNX``ƂĎwł悤ɂ
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> immediateContext;		// DX11の描画命令等を送るためのモノ
+	Microsoft::WRL::ComPtr<IDXGISwapChain> swapChain;					// ハードウェアの情報が詰まっているもの
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> renderTargetView;	// ディスプレイのバックバッファのテクスチャを描画先として指定できるようにしたもの
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> depthStencilView;
+	D3D11_VIEWPORT viewport;											// バックバッファ全体
 	std::unique_ptr<Sprite> sprites[8];
 	std::unique_ptr<SpriteBatch> spriteBatches[8];
 
 	struct SceneConstants {
-		DirectX::XMFLOAT4X4 viewProjection;		// r[EvWFNVϊs
-		DirectX::XMFLOAT4 lightDirection;		// Cǧ
-		DirectX::XMFLOAT4 cameraPosition;		// J̈ʒu
+		DirectX::XMFLOAT4X4 viewProjection;		// ビュー・プロジェクション変換行列
+		DirectX::XMFLOAT4 lightDirection;		// ライトの向き
+		DirectX::XMFLOAT4 cameraPosition;		// カメラの位置
 	};
 	Microsoft::WRL::ComPtr<ID3D11Buffer> constantBuffers[8];
 	std::unique_ptr<GeometricPrimitive> geometricPrimitives[8];
 
-	std::unique_ptr<SkinnedMesh> skinnedMeshes[8];
+	std::shared_ptr<SkinnedMesh> skinnedMeshes[8];
+	AsyncHandle<SkinnedMesh> skinnedMeshLoads[8];
+
+	// Loads models on worker threads; update() finalizes them within a per-frame budget.
+	std::unique_ptr<AsyncLoader> asyncLoader;
+
+	// Poses and bone palettes of every animated instance, evaluated on worker threads in update().
+	std::unique_ptr<AnimationSystem> animationSystem;
+	// skinnedMeshes[0]の全クリップのパレット (bakedCrowdを初めて有効にした時に読み込むかベイクする)
+	std::unique_ptr<BakedAnimation> bakedAnimation;
+	std::vector<SkinnedMesh::BakedInstance> bakedInstances;
+	// bakedCrowdでない時の全員 (render_instanced、lodは前フレームの値を引き継ぐ)
+	std::vector<SkinnedMesh::Instance> crowdInstances;
+	// 群衆のカリング。visibleCrowdInstancesはcrowdInstancesのうち見えるものだけ
+	FrustumCuller frustumCuller;
+	FrustumCuller::Statistics cullStatistics;
+	std::vector<SkinnedMesh::Instance> visibleCrowdInstances;
+
+	// Graphics/ (LambertShader・DebugRenderer・ResourceManagerが使う) はこのデバイスで作る
+	std::unique_ptr<Graphics> graphics;
+	std::unique_ptr<Model> models[8];
+	AsyncHandle<ModelResource> modelLoads[8];
 
 	std::unique_ptr<Framebuffer> framebuffers[8];
 
@@ -108,6 +159,18 @@ public:
 
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> pixelShaders[8];
 
+	// ブレンド・深度・ラスタライザ・サンプラはこれを通して設定する (同じステートの再設定を省く)
+	// パスごとのStateTrackerとGraphicsのStateTrackerの統計もここに足して、プロファイラに出す
+	std::unique_ptr<StateTracker> stateTracker;
+	std::mutex passStatisticsMutex;
+	// immediateContextでの描画ごとの定数の割り当て元 (フレームごとにフェンスを打つ。遅延コンテキストのリングはdeferredContextBackendが持つ)
+	std::unique_ptr<ConstantRing> constantRing;
+
+	// renderのパス (scene, lambert, luminance extraction, blur, composite, UI) と、それを記録するワーカースレッドと遅延コンテキスト
+	FrameGraph frameGraph;
+	std::unique_ptr<DeferredContextBackend> deferredContextBackend;
+	std::unique_ptr<ThreadPool> recordThreadPool;
+
 	Microsoft::WRL::ComPtr<IXAudio2> xaudio2;
 	IXAudio2MasteringVoice* masterVoice = nullptr;
 	std::unique_ptr<Audio> bgm[8];
@@ -216,6 +279,11 @@ private:
 	bool initialize();
 	void update(float elapsed_time/*Elapsed seconds from last frame*/);
 	void render(float elapsed_time/*Elapsed seconds from last frame*/);
+	void prepare_crowd(const DirectX::XMFLOAT4X4& viewProjection,
+		const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, const DirectX::XMFLOAT4X4& world);
+	void record_scene(ID3D11DeviceContext* context, const SceneConstants& sceneConstants, const DirectX::XMFLOAT4X4& world);
+	void set_fullscreen_states(StateTracker& states);
+	void add_pass_statistics(const StateTracker& states);
 	bool uninitialize();
 
 private:
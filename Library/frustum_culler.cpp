@@ -0,0 +1,231 @@
+#include "frustum_culler.h"
+#include "misc.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+
+using namespace DirectX;
+
+namespace {
+    const size_t LANES = 4;
+
+    // Planes of the view-projection's clip volume (row vectors, 0 <= z <= w), inside when dot(plane, p) >= 0
+    void extract_planes(const XMFLOAT4X4& M, XMFLOAT4 planes[6]) {
+        const XMVECTOR x = XMVectorSet(M._11, M._21, M._31, M._41);
+        const XMVECTOR y = XMVectorSet(M._12, M._22, M._32, M._42);
+        const XMVECTOR z = XMVectorSet(M._13, M._23, M._33, M._43);
+        const XMVECTOR w = XMVectorSet(M._14, M._24, M._34, M._44);
+        const XMVECTOR clipPlanes[6] = { w + x, w - x, w + y, w - y, z, w - z };
+        for (size_t i = 0; i < 6; ++i) {
+            XMStoreFloat4(&planes[i], XMPlaneNormalize(clipPlanes[i]));
+        }
+    }
+
+    uint32_t bit_count(uint32_t bits) {
+        uint32_t count = 0;
+        for (; bits; bits &= bits - 1) {
+            ++count;
+        }
+        return count;
+    }
+}
+
+void FrustumCuller::clear() {
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    extentX.clear();
+    extentY.clear();
+    extentZ.clear();
+    maxDistancesSquared.clear();
+    objectCount = 0;
+    visibleObjects.clear();
+}
+
+uint32_t FrustumCuller::add(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax, const XMFLOAT4X4& world, float maxDistance) {
+    XMFLOAT3 center = { 0, 0, 0 };
+    // Fails every plane test
+    XMFLOAT3 extent = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    if (boundsMin.x <= boundsMax.x && boundsMin.y <= boundsMax.y && boundsMin.z <= boundsMax.z) {
+        const XMVECTOR localMin = XMLoadFloat3(&boundsMin);
+        const XMVECTOR localMax = XMLoadFloat3(&boundsMax);
+        const XMMATRIX W = XMLoadFloat4x4(&world);
+        XMStoreFloat3(&center, XMVector3TransformCoord((localMin + localMax) * 0.5f, W));
+        // Each world axis gets every local axis' extent along it
+        const XMVECTOR localExtent = (localMax - localMin) * 0.5f;
+        const XMVECTOR worldExtent = XMVectorAbs(W.r[0]) * XMVectorSplatX(localExtent) + XMVectorAbs(W.r[1]) * XMVectorSplatY(localExtent) +
+            XMVectorAbs(W.r[2]) * XMVectorSplatZ(localExtent);
+        XMStoreFloat3(&extent, worldExtent);
+    }
+
+    // Drop the padding of the last cull
+    if (centerX.size() != objectCount) {
+        for (std::vector<float>* stream : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &maxDistancesSquared }) {
+            stream->resize(objectCount);
+        }
+    }
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    extentX.push_back(extent.x);
+    extentY.push_back(extent.y);
+    extentZ.push_back(extent.z);
+    // Squared, FLT_MAX rather than an overflow for 'no limit'
+    maxDistancesSquared.push_back(maxDistance < sqrtf(FLT_MAX) ? maxDistance * maxDistance : FLT_MAX);
+    return static_cast<uint32_t>(objectCount++);
+}
+
+void FrustumCuller::cull(const XMFLOAT4X4& viewProjection, const XMFLOAT3& cameraPosition) {
+    XMFLOAT4 planes[6];
+    extract_planes(viewProjection, planes);
+
+    visibleObjects.clear();
+    cullStatistics = {};
+    cullStatistics.tested = static_cast<uint32_t>(objectCount);
+    if (objectCount == 0) {
+        return;
+    }
+
+    // The padding lanes are tested too and masked out below
+    const size_t paddedCount = (objectCount + LANES - 1) / LANES * LANES;
+    for (std::vector<float>* stream : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &maxDistancesSquared }) {
+        stream->resize(paddedCount, 0.0f);
+    }
+
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    __m128 absX[6], absY[6], absZ[6];
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    for (int plane = 0; plane < 6; ++plane) {
+        planeX[plane] = _mm_set1_ps(planes[plane].x);
+        planeY[plane] = _mm_set1_ps(planes[plane].y);
+        planeZ[plane] = _mm_set1_ps(planes[plane].z);
+        planeW[plane] = _mm_set1_ps(planes[plane].w);
+        absX[plane] = _mm_and_ps(planeX[plane], absMask);
+        absY[plane] = _mm_and_ps(planeY[plane], absMask);
+        absZ[plane] = _mm_and_ps(planeZ[plane], absMask);
+    }
+    const __m128 cameraX = _mm_set1_ps(cameraPosition.x);
+    const __m128 cameraY = _mm_set1_ps(cameraPosition.y);
+    const __m128 cameraZ = _mm_set1_ps(cameraPosition.z);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (size_t first = 0; first < paddedCount; first += LANES) {
+        const __m128 cx = _mm_loadu_ps(&centerX[first]);
+        const __m128 cy = _mm_loadu_ps(&centerY[first]);
+        const __m128 cz = _mm_loadu_ps(&centerZ[first]);
+        const __m128 ex = _mm_loadu_ps(&extentX[first]);
+        const __m128 ey = _mm_loadu_ps(&extentY[first]);
+        const __m128 ez = _mm_loadu_ps(&extentZ[first]);
+
+        // Outside a plane when even the box's corner furthest along the plane's normal is behind it
+        __m128 outside = zero;
+        for (int plane = 0; plane < 6; ++plane) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, planeX[plane]), _mm_mul_ps(cy, planeY[plane])),
+                _mm_add_ps(_mm_mul_ps(cz, planeZ[plane]), planeW[plane]));
+            const __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, absX[plane]), _mm_mul_ps(ey, absY[plane])), _mm_mul_ps(ez, absZ[plane]));
+            distance = _mm_add_ps(distance, radius);
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+        }
+
+        // Distance from the camera to the nearest point of the box
+        const __m128 dx = _mm_max_ps(_mm_sub_ps(_mm_and_ps(_mm_sub_ps(cx, cameraX), absMask), ex), zero);
+        const __m128 dy = _mm_max_ps(_mm_sub_ps(_mm_and_ps(_mm_sub_ps(cy, cameraY), absMask), ey), zero);
+        const __m128 dz = _mm_max_ps(_mm_sub_ps(_mm_and_ps(_mm_sub_ps(cz, cameraZ), absMask), ez), zero);
+        const __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        const __m128 beyond = _mm_cmpgt_ps(distanceSquared, _mm_loadu_ps(&maxDistancesSquared[first]));
+
+        const uint32_t valid = objectCount - first >= LANES ? 0xf : (1u << (objectCount - first)) - 1;
+        const uint32_t outsideBits = static_cast<uint32_t>(_mm_movemask_ps(outside)) & valid;
+        const uint32_t beyondBits = static_cast<uint32_t>(_mm_movemask_ps(beyond)) & valid & ~outsideBits;
+        cullStatistics.outsideFrustum += bit_count(outsideBits);
+        cullStatistics.beyondDistance += bit_count(beyondBits);
+        for (uint32_t visibleBits = valid & ~(outsideBits | beyondBits); visibleBits; visibleBits &= visibleBits - 1) {
+            uint32_t lane = 0;
+            while (!(visibleBits & (1u << lane))) {
+                ++lane;
+            }
+            visibleObjects.push_back(static_cast<uint32_t>(first + lane));
+        }
+    }
+    cullStatistics.visible = static_cast<uint32_t>(visibleObjects.size());
+}
+
+void FrustumCuller::cull_scalar(const XMFLOAT4 planes[6], const XMFLOAT3& cameraPosition) {
+    visibleObjects.clear();
+    cullStatistics = {};
+    cullStatistics.tested = static_cast<uint32_t>(objectCount);
+    for (size_t object = 0; object < objectCount; ++object) {
+        bool outside = false;
+        for (int plane = 0; plane < 6 && !outside; ++plane) {
+            const XMFLOAT4& p = planes[plane];
+            outside = centerX[object] * p.x + centerY[object] * p.y + centerZ[object] * p.z + p.w +
+                extentX[object] * fabsf(p.x) + extentY[object] * fabsf(p.y) + extentZ[object] * fabsf(p.z) < 0;
+        }
+        if (outside) {
+            ++cullStatistics.outsideFrustum;
+            continue;
+        }
+        const float dx = std::max<float>(fabsf(centerX[object] - cameraPosition.x) - extentX[object], 0);
+        const float dy = std::max<float>(fabsf(centerY[object] - cameraPosition.y) - extentY[object], 0);
+        const float dz = std::max<float>(fabsf(centerZ[object] - cameraPosition.z) - extentZ[object], 0);
+        if (dx * dx + dy * dy + dz * dz > maxDistancesSquared[object]) {
+            ++cullStatistics.beyondDistance;
+            continue;
+        }
+        visibleObjects.push_back(static_cast<uint32_t>(object));
+    }
+    cullStatistics.visible = static_cast<uint32_t>(visibleObjects.size());
+}
+
+void FrustumCuller::benchmark_culling(size_t objectCount, int iterations) {
+    if (objectCount == 0 || iterations <= 0) {
+        return;
+    }
+
+    // Unit boxes scattered around a camera at the origin looking down +z, fixed seed so runs compare
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> distance(20.0f, 200.0f);
+    FrustumCuller culler;
+    const XMFLOAT3 boundsMin = { -0.5f, -0.5f, -0.5f };
+    const XMFLOAT3 boundsMax = { 0.5f, 0.5f, 0.5f };
+    for (size_t object = 0; object < objectCount; ++object) {
+        XMFLOAT4X4 world;
+        XMStoreFloat4x4(&world, XMMatrixRotationY(position(random)) * XMMatrixTranslation(position(random), position(random), position(random)));
+        culler.add(boundsMin, boundsMax, world, distance(random));
+    }
+    XMFLOAT4X4 viewProjection;
+    XMStoreFloat4x4(&viewProjection, XMMatrixLookAtLH(XMVectorZero(), XMVectorSet(0, 0, 1, 1), XMVectorSet(0, 1, 0, 0)) *
+        XMMatrixPerspectiveFovLH(XMConvertToRadians(30), 16.0f / 9.0f, 0.1f, 100.0f));
+    const XMFLOAT3 cameraPosition = { 0, 0, 0 };
+    XMFLOAT4 planes[6];
+    extract_planes(viewProjection, planes);
+
+    benchmark timer;
+    auto objects_per_second = [&](auto kernel) {
+        kernel(); // warm up
+        timer.begin();
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            kernel();
+        }
+        const float seconds = timer.end();
+        return seconds > 0 ? static_cast<float>(objectCount) * iterations / seconds : 0.0f;
+    };
+    const float scalar = objects_per_second([&]() { culler.cull_scalar(planes, cameraPosition); });
+    const std::vector<uint32_t> reference = culler.visible();
+    const float sse = objects_per_second([&]() { culler.cull(viewProjection, cameraPosition); });
+    const Statistics& statistics = culler.statistics();
+
+    std::stringstream message;
+    message << std::fixed << std::setprecision(1)
+        << "Frustum culling : " << objectCount << " boxes (Mboxes/s)\n"
+        << "  scalar : " << scalar / 1e6f << "\n"
+        << "  SSE : " << sse / 1e6f << (culler.visible() == reference ? "" : " (differs from scalar)") << "\n"
+        << "  visible " << statistics.visible << ", outside the frustum " << statistics.outsideFrustum
+        << ", beyond their distance " << statistics.beyondDistance << "\n";
+    OutputDebugStringA(message.str().c_str());
+}
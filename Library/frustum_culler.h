@@ -0,0 +1,60 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <cstddef>
+#include <cfloat>
+#include <vector>
+
+// View-frustum and draw distance culling of a frame's objects by their bounding boxes.
+//
+// Objects are added with their local bounds and world matrix; add takes the box to world space at once (center
+// and half extents, the extents through the absolute matrix, so the box stays axis aligned and contains the
+// transformed one). cull then tests four boxes at a time against the six planes of the view-projection with SSE,
+// and drops those whose nearest point is farther from the camera than their max draw distance. What is left
+// comes out as a compacted list of object indices, in add order.
+//
+// Conservative : a box crossing a plane, or the corner of the frustum, is kept.
+class FrustumCuller {
+public:
+    // Of the last cull
+    struct Statistics {
+        uint32_t tested = 0;
+        uint32_t visible = 0;
+        uint32_t outsideFrustum = 0;
+        uint32_t beyondDistance = 0;    // inside the frustum, but past their max draw distance
+    };
+
+    FrustumCuller() = default;
+    virtual ~FrustumCuller() = default;
+
+    FrustumCuller(const FrustumCuller&) = delete;
+    FrustumCuller& operator=(const FrustumCuller&) = delete;
+
+    void clear();
+    // Returns the object's index, counting from 0 since clear. A box with min > max (no vertices) is never visible.
+    uint32_t add(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax, const DirectX::XMFLOAT4X4& world,
+        float maxDistance = FLT_MAX);
+    size_t object_count() const { return objectCount; }
+
+    // 'viewProjection' : row vectors, D3D clip space (0 <= z <= w)
+    void cull(const DirectX::XMFLOAT4X4& viewProjection, const DirectX::XMFLOAT3& cameraPosition);
+    // Valid after cull, until the next add or clear
+    const std::vector<uint32_t>& visible() const { return visibleObjects; }
+    const Statistics& statistics() const { return cullStatistics; }
+
+    // SIMD against a plane by plane scalar loop over 'objectCount' random boxes, reported with OutputDebugStringA
+    static void benchmark_culling(size_t objectCount = 100000, int iterations = 100);
+
+private:
+    // World-space boxes, structure of arrays padded to a multiple of 4 for the SSE loads
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    std::vector<float> maxDistancesSquared;
+    size_t objectCount = 0;
+
+    std::vector<uint32_t> visibleObjects;
+    Statistics cullStatistics;
+
+    void cull_scalar(const DirectX::XMFLOAT4 planes[6], const DirectX::XMFLOAT3& cameraPosition);
+};
@@ -29,7 +29,7 @@ void FullscreenQuad::blit(ID3D11DeviceContext* immediateContext,
 
     immediateContext->PSSetShaderResources(startSlot, numViews, shaderResourceView);
 
-    immediateContext->Draw(4, 0); // `揈
+    immediateContext->Draw(4, 0); // 描画処理
 }
 
 void FullscreenQuad::set_luminance_clamp(ID3D11DeviceContext* immediateContext, float min, float max) {
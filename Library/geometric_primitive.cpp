@@ -1,106 +1,107 @@
 #include "geometric_primitive.h"
 #include "shader.h"
 #include "misc.h"
+#include "constant_ring.h"
 
 GeometricPrimitive::GeometricPrimitive(ID3D11Device* device) {
     Vertex vertices[24] = {};
-    // TCY1.0̐̃f[^쐬(dS_Ƃ)B̂̃Rg[|Cg 8 A
-    // 1 ̃Rg[|Cg̈ʒuɂ͖@̌Ⴄ_ 3 ̂Œ_̑ 8x3=24 A
-    // _ziverticesjɂׂĒ_̈ʒuE@i[B
-
-    // O
-    vertices[0].position = { 0,1,0 };       // 
-    vertices[1].position = { 1,1,0 };       // E
-    vertices[2].position = { 1,0,0 };       // E
-    vertices[3].position = { 0,0,0 };       // 
-
-    vertices[0].normal = { 0,0,-1 };        // 
-    vertices[1].normal = { 0,0,-1 };        // E
-    vertices[2].normal = { 0,0,-1 };        // E
-    vertices[3].normal = { 0,0,-1 };        // 
-
-    // 
-    vertices[4].position = { 0,1,1 };       // 
-    vertices[5].position = { 1,1,1 };       // E
-    vertices[6].position = { 1,0,1 };       // E
-    vertices[7].position = { 0,0,1 };       // 
-
-    vertices[4].normal = { 0,0,1 };         // 
-    vertices[5].normal = { 0,0,1 };         // E
-    vertices[6].normal = { 0,0,1 };         // E
-    vertices[7].normal = { 0,0,1 };         // 
-
-    // 
-    vertices[8].position = { 1,1,1 };       // 
-    vertices[9].position = { 0,1,1 };       // E
-    vertices[10].position = { 1,1,0 };      // E
-    vertices[11].position = { 0,1,0 };      // 
-
-    vertices[8].normal = { 0,1,0 };         // 
-    vertices[9].normal = { 0,1,0 };         // E
-    vertices[10].normal = { 0,1,0 };        // E
-    vertices[11].normal = { 0,1,0 };        // 
-
-    // 
-    vertices[12].position = { 0,0,0 };      // 
-    vertices[13].position = { 1,0,0 };      // E
-    vertices[14].position = { 0,0,1 };      // E
-    vertices[15].position = { 1,0,1 };      // 
-
-    vertices[12].normal = { 0,-1,0 };       // 
-    vertices[13].normal = { 0,-1,0 };       // E
-    vertices[14].normal = { 0,-1,0 };       // E
-    vertices[15].normal = { 0,-1,0 };       // 
-
-    // 
-    vertices[16].position = { 0,1,1 };      // 
-    vertices[17].position = { 0,1,0 };      // E
-    vertices[18].position = { 0,0,0 };      // E
-    vertices[19].position = { 0,0,1 };      // 
-
-    vertices[16].normal = { -1,0,0 };       // 
-    vertices[17].normal = { -1,0,0 };       // E
-    vertices[18].normal = { -1,0,0 };       // E
-    vertices[19].normal = { -1,0,0 };       // 
-
-    // E
-    vertices[20].position = { 1,1,0 };      // 
-    vertices[21].position = { 1,1,1 };      // E
-    vertices[22].position = { 1,0,1 };      // E
-    vertices[23].position = { 1,0,0 };      // 
-
-    vertices[20].normal = { 1,0,0 };        // 
-    vertices[21].normal = { 1,0,0 };        // E
-    vertices[22].normal = { 1,0,0 };        // E
-    vertices[23].normal = { 1,0,0 };        // 
+    // サイズが1.0の正立方体データを作成する(重心を原点とする)。正立方体のコントロールポイント数は 8 個、
+    // 1 つのコントロールポイントの位置には法線の向きが違う頂点が 3 個あるので頂点情報の総数は 8x3=24 個、
+    // 頂点情報配列（vertices）にすべて頂点の位置・法線情報を格納する。
+
+    // 手前面
+    vertices[0].position = { 0,1,0 };       // 左上
+    vertices[1].position = { 1,1,0 };       // 右上
+    vertices[2].position = { 1,0,0 };       // 右下
+    vertices[3].position = { 0,0,0 };       // 左下
+
+    vertices[0].normal = { 0,0,-1 };        // 左上
+    vertices[1].normal = { 0,0,-1 };        // 右上
+    vertices[2].normal = { 0,0,-1 };        // 右下
+    vertices[3].normal = { 0,0,-1 };        // 左下
+
+    // 奥面
+    vertices[4].position = { 0,1,1 };       // 左上
+    vertices[5].position = { 1,1,1 };       // 右上
+    vertices[6].position = { 1,0,1 };       // 右下
+    vertices[7].position = { 0,0,1 };       // 左下
+
+    vertices[4].normal = { 0,0,1 };         // 左上
+    vertices[5].normal = { 0,0,1 };         // 右上
+    vertices[6].normal = { 0,0,1 };         // 右下
+    vertices[7].normal = { 0,0,1 };         // 左下
+
+    // 上面
+    vertices[8].position = { 1,1,1 };       // 左上
+    vertices[9].position = { 0,1,1 };       // 右上
+    vertices[10].position = { 1,1,0 };      // 右下
+    vertices[11].position = { 0,1,0 };      // 左下
+
+    vertices[8].normal = { 0,1,0 };         // 左上
+    vertices[9].normal = { 0,1,0 };         // 右上
+    vertices[10].normal = { 0,1,0 };        // 右下
+    vertices[11].normal = { 0,1,0 };        // 左下
+
+    // 下面
+    vertices[12].position = { 0,0,0 };      // 左上
+    vertices[13].position = { 1,0,0 };      // 右上
+    vertices[14].position = { 0,0,1 };      // 右下
+    vertices[15].position = { 1,0,1 };      // 左下
+
+    vertices[12].normal = { 0,-1,0 };       // 左上
+    vertices[13].normal = { 0,-1,0 };       // 右上
+    vertices[14].normal = { 0,-1,0 };       // 右下
+    vertices[15].normal = { 0,-1,0 };       // 左下
+
+    // 左面
+    vertices[16].position = { 0,1,1 };      // 左上
+    vertices[17].position = { 0,1,0 };      // 右上
+    vertices[18].position = { 0,0,0 };      // 右下
+    vertices[19].position = { 0,0,1 };      // 左下
+
+    vertices[16].normal = { -1,0,0 };       // 左上
+    vertices[17].normal = { -1,0,0 };       // 右上
+    vertices[18].normal = { -1,0,0 };       // 右下
+    vertices[19].normal = { -1,0,0 };       // 左下
+
+    // 右面
+    vertices[20].position = { 1,1,0 };      // 左上
+    vertices[21].position = { 1,1,1 };      // 右上
+    vertices[22].position = { 1,0,1 };      // 右下
+    vertices[23].position = { 1,0,0 };      // 左下
+
+    vertices[20].normal = { 1,0,0 };        // 左上
+    vertices[21].normal = { 1,0,0 };        // 右上
+    vertices[22].normal = { 1,0,0 };        // 右下
+    vertices[23].normal = { 1,0,0 };        // 左下
 
     uint32_t indices[36] = {};
-    // ̂6ʎA1̖ʂ23p`|Sō\̂3p`|S̑6~212A
-    // ̂`悷邽߂123p|S`悪KvAĎQƂ钸_12~336A
-    // 3p`|SQƂ钸_̃CfbNX(_ԍ)`揇ɔz(indices)Ɋi[B
-    // v肪\ʂɂȂ悤Ɋi[邱ƁB
+    // 正立方体は6面持ち、1つの面は2つの3角形ポリゴンで構成されるので3角形ポリゴンの総数は6×2＝12個、
+    // 正立方体を描画するために12回の3角ポリゴン描画が必要、よって参照される頂点情報は12×3＝36回、
+    // 3角形ポリゴンが参照する頂点情報のインデックス(頂点番号)を描画順に配列(indices)に格納する。
+    // 時計回りが表面になるように格納すること。
 
-    // O 0~3
+    // 手前面 0~3
     indices[0] = 0; indices[1] = 1; indices[2] = 2; 
     indices[3] = 0; indices[4] = 2; indices[5] = 3;
 
-    //  4~7
+    // 奥面 4~7
     indices[6] = 4; indices[7] = 6; indices[8] = 5;
     indices[9] = 4; indices[10] = 7; indices[11] = 6;
 
-    //  8~11
+    // 上面 8~11
     indices[12] = 11; indices[13] = 9; indices[14] = 8;
     indices[15] = 8; indices[16] = 10; indices[17] = 11;
 
-    //  12~15
+    // 下面 12~15
     indices[18] = 12; indices[19] = 13; indices[20] = 14;
     indices[21] = 13; indices[22] = 15; indices[23] = 14;
 
-    //  16~19
+    // 左面 16~19
     indices[24] = 16; indices[25] = 17; indices[26] = 18;
     indices[27] = 16; indices[28] = 18; indices[29] = 19;
 
-    //  20~23
+    // 左面 20~23
     indices[30] = 20; indices[31] = 21; indices[32] = 22;
     indices[33] = 20; indices[34] = 22; indices[35] = 23;
 
@@ -166,8 +167,7 @@ void GeometricPrimitive::render(ID3D11DeviceContext* immediateContext,
     immediateContext->PSSetShader(pixelShader.Get(), nullptr, 0);
 
     Constants data = { world, materialColor };
-    immediateContext->UpdateSubresource(constantBuffer.Get(), 0, 0, &data, 0, 0);
-    immediateContext->VSSetConstantBuffers(0, 1, constantBuffer.GetAddressOf());
+    upload_constants(immediateContext, 0, constantBuffer.Get(), &data, sizeof(data));
 
     D3D11_BUFFER_DESC bufferDesc = {};
     indexBuffer->GetDesc(&bufferDesc);
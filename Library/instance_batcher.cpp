@@ -0,0 +1,42 @@
+#include "instance_batcher.h"
+
+#include <algorithm>
+
+void InstanceBatcher::clear() {
+    batchIndices.clear();
+    instanceBatches.clear();
+    builtBatches.clear();
+    instanceOrder.clear();
+}
+
+uint32_t InstanceBatcher::add(const void* resource, uint32_t lod) {
+    // A frame has few batches : a new one shifts the sorted keys after it, every other instance is a binary search
+    const Key key = { resource, lod };
+    std::vector<std::pair<Key, uint32_t>>::iterator found = std::lower_bound(batchIndices.begin(), batchIndices.end(), key,
+        [](const std::pair<Key, uint32_t>& entry, const Key& value) { return entry.first < value; });
+    if (found == batchIndices.end() || !(found->first == key)) {
+        found = batchIndices.insert(found, { key, static_cast<uint32_t>(builtBatches.size()) });
+        builtBatches.push_back({ resource, lod, 0, 0 });
+    }
+    // The counts are gathered here, build turns them into offsets
+    ++builtBatches.at(found->second).count;
+    instanceBatches.push_back(found->second);
+    return static_cast<uint32_t>(instanceBatches.size() - 1);
+}
+
+void InstanceBatcher::build() {
+    uint32_t first = 0;
+    for (Batch& batch : builtBatches) {
+        batch.first = first;
+        first += batch.count;
+    }
+    instanceOrder.resize(instanceBatches.size());
+    // Write cursor of every batch, starting at its first
+    cursors.resize(builtBatches.size());
+    for (size_t batchIndex = 0; batchIndex < builtBatches.size(); ++batchIndex) {
+        cursors[batchIndex] = builtBatches[batchIndex].first;
+    }
+    for (uint32_t instanceIndex = 0; instanceIndex < instanceBatches.size(); ++instanceIndex) {
+        instanceOrder[cursors[instanceBatches[instanceIndex]]++] = instanceIndex;
+    }
+}
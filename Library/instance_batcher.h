@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <functional>
+
+// Groups the instances drawn over a frame by what they draw, so that each group goes out as one instanced draw.
+//
+// Instances are added in any order with the resource they draw (a model, a mesh...) and their LOD. build then
+// lays them out batch after batch : order() lists the instance indices so that every batch is a contiguous
+// range [first, first + count) of it, which is the range of the per-frame instance buffer the batch draws.
+// Batches come in the order their first instance was added, and instances keep their add order inside their
+// batch (a stable counting sort), so the same scene builds the same buffer every frame.
+//
+// Only indices : no device, the caller writes its own instance data in order(). Every array is flat and kept
+// across clear, so a frame that doesn't outgrow the previous ones doesn't allocate.
+class InstanceBatcher {
+public:
+    struct Batch {
+        const void* resource;
+        uint32_t lod;
+        uint32_t first;     // into order()
+        uint32_t count;
+    };
+
+    InstanceBatcher() = default;
+    virtual ~InstanceBatcher() = default;
+
+    InstanceBatcher(const InstanceBatcher&) = delete;
+    InstanceBatcher& operator=(const InstanceBatcher&) = delete;
+
+    void clear();
+    // Returns the instance's index, counting from 0 since clear
+    uint32_t add(const void* resource, uint32_t lod);
+    size_t instance_count() const { return instanceBatches.size(); }
+
+    void build();
+    // Valid after build, until the next add or clear
+    const std::vector<Batch>& batches() const { return builtBatches; }
+    const std::vector<uint32_t>& order() const { return instanceOrder; }
+
+private:
+    struct Key {
+        const void* resource;
+        uint32_t lod;
+        bool operator==(const Key& rhs) const { return resource == rhs.resource && lod == rhs.lod; }
+        bool operator<(const Key& rhs) const {
+            return resource != rhs.resource ? std::less<const void*>()(resource, rhs.resource) : lod < rhs.lod;
+        }
+    };
+    // Batch index of every key seen since clear, sorted by key, and of every instance
+    std::vector<std::pair<Key, uint32_t>> batchIndices;
+    std::vector<uint32_t> instanceBatches;
+
+    std::vector<Batch> builtBatches;
+    std::vector<uint32_t> instanceOrder;
+    std::vector<uint32_t> cursors; // build's write cursor of every batch
+};
@@ -0,0 +1,241 @@
+#include "mesh_optimizer.h"
+#include "cooked_model.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+namespace mesh_optimizer {
+    CacheStatistics analyze_vertex_cache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+        CacheStatistics statistics;
+        if (indexCount < 3 || vertexCount == 0) {
+            return statistics;
+        }
+
+        // FIFO : a vertex is still cached if fewer than 'cacheSize' misses happened since it was loaded.
+        std::vector<uint64_t> loadedAt(vertexCount, 0);
+        std::vector<bool> referenced(vertexCount, false);
+        uint64_t missCount = 0;
+        size_t referencedCount = 0;
+        for (size_t i = 0; i < indexCount; ++i) {
+            const uint32_t index = indices[i];
+            if (!referenced.at(index)) {
+                referenced.at(index) = true;
+                ++referencedCount;
+            }
+            else if (missCount - loadedAt.at(index) < cacheSize) {
+                continue;
+            }
+            ++missCount;
+            loadedAt.at(index) = missCount;
+        }
+        statistics.acmr = static_cast<float>(missCount) / (indexCount / 3);
+        statistics.atvr = static_cast<float>(missCount) / referencedCount;
+        return statistics;
+    }
+
+    size_t weld_vertices(void* vertices, size_t vertexCount, size_t stride, uint32_t* indices, size_t indexCount) {
+        uint8_t* bytes = static_cast<uint8_t*>(vertices);
+
+        // Open addressing over the kept vertices
+        size_t slotCount = 1;
+        while (slotCount < vertexCount * 2) {
+            slotCount <<= 1;
+        }
+        const size_t mask = slotCount - 1;
+        std::vector<uint32_t> slots(slotCount, UINT32_MAX);
+        std::vector<uint32_t> remap(vertexCount);
+
+        size_t weldedCount = 0;
+        for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+            const uint8_t* vertex = bytes + vertexIndex * stride;
+            size_t slot = cooked::hash_bytes(vertex, stride) & mask;
+            while (slots.at(slot) != UINT32_MAX && memcmp(bytes + slots.at(slot) * stride, vertex, stride) != 0) {
+                slot = (slot + 1) & mask;
+            }
+            if (slots.at(slot) == UINT32_MAX) {
+                // Kept vertices only ever move down, so this never overwrites one not yet visited
+                if (weldedCount != vertexIndex) {
+                    memcpy(bytes + weldedCount * stride, vertex, stride);
+                }
+                slots.at(slot) = static_cast<uint32_t>(weldedCount++);
+            }
+            remap.at(vertexIndex) = slots.at(slot);
+        }
+
+        for (size_t i = 0; i < indexCount; ++i) {
+            indices[i] = remap.at(indices[i]);
+        }
+        return weldedCount;
+    }
+
+    namespace {
+        // Forsyth's tuned constants
+        constexpr int CACHE_SIZE = 32;
+        constexpr float CACHE_DECAY_POWER = 1.5f;
+        constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+        constexpr float VALENCE_BOOST_SCALE = 2.0f;
+        constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+        float vertex_score(int cachePosition, uint32_t remainingTriangles) {
+            if (remainingTriangles == 0) {
+                return -1.0f; // nothing left to draw with it
+            }
+            float score = 0;
+            if (cachePosition >= 0) {
+                if (cachePosition < 3) {
+                    // Used by the triangle just emitted : a fixed score so it isn't favoured too much
+                    score = LAST_TRIANGLE_SCORE;
+                }
+                else {
+                    const float scale = 1.0f / (CACHE_SIZE - 3);
+                    score = powf(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+                }
+            }
+            // Boost vertices with few triangles left so they don't get stranded
+            score += VALENCE_BOOST_SCALE * powf(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+            return score;
+        }
+    }
+
+    void optimize_vertex_cache(uint32_t* indices, size_t indexCount, size_t vertexCount) {
+        const size_t triangleCount = indexCount / 3;
+        if (triangleCount < 2) {
+            return;
+        }
+
+        // Triangles around every vertex. Emitted triangles are swapped to the end of the vertex's list.
+        std::vector<uint32_t> remaining(vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; ++i) {
+            ++remaining.at(indices[i]);
+        }
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+            adjacencyOffsets.at(vertexIndex + 1) = adjacencyOffsets.at(vertexIndex) + remaining.at(vertexIndex);
+        }
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < triangleCount * 3; ++i) {
+                adjacency.at(fill.at(indices[i])++) = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        std::vector<float> vertexScores(vertexCount, 0);
+        for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+            vertexScores.at(vertexIndex) = vertex_score(-1, remaining.at(vertexIndex));
+        }
+
+        std::vector<bool> emitted(triangleCount, false);
+        int bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+            const uint32_t* corners = indices + triangle * 3;
+            const float score = vertexScores.at(corners[0]) + vertexScores.at(corners[1]) + vertexScores.at(corners[2]);
+            if (score > bestScore) {
+                bestScore = score;
+                bestTriangle = static_cast<int>(triangle);
+            }
+        }
+
+        std::vector<uint32_t> output;
+        output.reserve(triangleCount * 3);
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> nextCache;
+        cache.reserve(CACHE_SIZE + 3);
+        nextCache.reserve(CACHE_SIZE + 3);
+        size_t scanCursor = 0;
+
+        for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+            if (bestTriangle < 0) {
+                // Nothing in the cache touches a remaining triangle : restart from the next one not drawn yet.
+                // The cursor only moves forward, which keeps this linear instead of rescanning every score.
+                while (emitted.at(scanCursor)) {
+                    ++scanCursor;
+                }
+                bestTriangle = static_cast<int>(scanCursor);
+            }
+
+            const uint32_t* corners = indices + bestTriangle * 3;
+            emitted.at(bestTriangle) = true;
+            output.insert(output.end(), corners, corners + 3);
+
+            // Take the triangle out of its vertices' lists
+            for (int corner = 0; corner < 3; ++corner) {
+                const uint32_t vertexIndex = corners[corner];
+                uint32_t* begin = adjacency.data() + adjacencyOffsets.at(vertexIndex);
+                uint32_t* end = begin + remaining.at(vertexIndex);
+                uint32_t* found = std::find(begin, end, static_cast<uint32_t>(bestTriangle));
+                if (found != end) {
+                    std::swap(*found, end[-1]);
+                    --remaining.at(vertexIndex);
+                }
+            }
+
+            // The triangle's vertices move to the front, the rest shift back
+            nextCache.clear();
+            nextCache.insert(nextCache.end(), corners, corners + 3);
+            for (uint32_t vertexIndex : cache) {
+                if (vertexIndex != corners[0] && vertexIndex != corners[1] && vertexIndex != corners[2]) {
+                    nextCache.push_back(vertexIndex);
+                }
+            }
+            // Whatever falls off the end leaves the cache
+            for (size_t position = CACHE_SIZE; position < nextCache.size(); ++position) {
+                const uint32_t vertexIndex = nextCache.at(position);
+                vertexScores.at(vertexIndex) = vertex_score(-1, remaining.at(vertexIndex));
+            }
+            if (nextCache.size() > CACHE_SIZE) {
+                nextCache.resize(CACHE_SIZE);
+            }
+            std::swap(cache, nextCache);
+
+            for (size_t position = 0; position < cache.size(); ++position) {
+                const uint32_t vertexIndex = cache.at(position);
+                vertexScores.at(vertexIndex) = vertex_score(static_cast<int>(position), remaining.at(vertexIndex));
+            }
+
+            // Only triangles around cached vertices changed score, and the next one is picked among them
+            bestTriangle = -1;
+            bestScore = -1.0f;
+            for (uint32_t vertexIndex : cache) {
+                const uint32_t* begin = adjacency.data() + adjacencyOffsets.at(vertexIndex);
+                const uint32_t* end = begin + remaining.at(vertexIndex);
+                for (const uint32_t* triangle = begin; triangle < end; ++triangle) {
+                    const uint32_t* triangleCorners = indices + *triangle * 3;
+                    const float score = vertexScores.at(triangleCorners[0]) + vertexScores.at(triangleCorners[1]) + vertexScores.at(triangleCorners[2]);
+                    if (score > bestScore) {
+                        bestScore = score;
+                        bestTriangle = static_cast<int>(*triangle);
+                    }
+                }
+            }
+        }
+
+        // A trailing partial triangle (indexCount not a multiple of 3) stays where it was
+        std::copy(output.begin(), output.end(), indices);
+    }
+
+    size_t optimize_vertex_fetch(void* vertices, size_t vertexCount, size_t stride, uint32_t* indices, size_t indexCount) {
+        std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+        uint32_t nextIndex = 0;
+        for (size_t i = 0; i < indexCount; ++i) {
+            uint32_t& index = remap.at(indices[i]);
+            if (index == UINT32_MAX) {
+                index = nextIndex++;
+            }
+            indices[i] = index;
+        }
+
+        // Scatter into a copy : a vertex can move either way
+        uint8_t* bytes = static_cast<uint8_t*>(vertices);
+        std::vector<uint8_t> source(bytes, bytes + vertexCount * stride);
+        for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+            if (remap.at(vertexIndex) != UINT32_MAX) {
+                memcpy(bytes + remap.at(vertexIndex) * stride, source.data() + vertexIndex * stride, stride);
+            }
+        }
+        return nextIndex;
+    }
+}
@@ -0,0 +1,280 @@
+#include "mesh_simplifier.h"
+#include "cooked_model.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+namespace mesh_simplifier {
+    namespace {
+        struct Vector3 {
+            float x, y, z;
+        };
+
+        inline Vector3 subtract(const Vector3& a, const Vector3& b) {
+            return { a.x - b.x, a.y - b.y, a.z - b.z };
+        }
+
+        inline Vector3 cross(const Vector3& a, const Vector3& b) {
+            return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+        }
+
+        inline float dot(const Vector3& a, const Vector3& b) {
+            return a.x * b.x + a.y * b.y + a.z * b.z;
+        }
+
+        // Sum of squared distances to a set of planes, each weighted by its triangle's area.
+        // Stored as the symmetric 4x4 matrix's upper triangle.
+        struct Quadric {
+            double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+            double b0 = 0, b1 = 0, b2 = 0;
+            double c = 0;
+            double weight = 0;
+
+            void add_plane(const Vector3& normal, double d, double planeWeight) {
+                const double nx = normal.x, ny = normal.y, nz = normal.z;
+                a00 += planeWeight * nx * nx; a01 += planeWeight * nx * ny; a02 += planeWeight * nx * nz;
+                a11 += planeWeight * ny * ny; a12 += planeWeight * ny * nz; a22 += planeWeight * nz * nz;
+                b0 += planeWeight * nx * d; b1 += planeWeight * ny * d; b2 += planeWeight * nz * d;
+                c += planeWeight * d * d;
+                weight += planeWeight;
+            }
+
+            void add(const Quadric& q) {
+                a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+                b0 += q.b0; b1 += q.b1; b2 += q.b2;
+                c += q.c;
+                weight += q.weight;
+            }
+
+            // Mean squared distance of 'v' to the planes
+            double evaluate(const Vector3& v) const {
+                const double x = v.x, y = v.y, z = v.z;
+                const double result =
+                    a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + a11 * y * y + 2 * a12 * y * z + a22 * z * z +
+                    2 * (b0 * x + b1 * y + b2 * z) + c;
+                return weight > 0 ? std::max<double>(result, 0.0) / weight : 0.0;
+            }
+        };
+
+        struct Collapse {
+            uint32_t from;
+            uint32_t to;
+            double cost;
+        };
+
+        inline uint64_t edge_key(uint32_t a, uint32_t b) {
+            return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+        }
+
+        // A collapse is rejected if it turns any remaining triangle around 'from' over or squashes it flat
+        constexpr float MIN_NORMAL_COSINE = 0.25f;
+    }
+
+    size_t simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+        const void* positions, size_t vertexCount, size_t stride, const uint32_t* groups,
+        size_t targetIndexCount, float maxError, float* resultError) {
+        indexCount -= indexCount % 3;
+        std::vector<uint32_t> result(indices, indices + indexCount);
+        float largestError = 0;
+
+        auto position = [&](uint32_t vertexIndex) {
+            Vector3 v;
+            memcpy(&v, static_cast<const uint8_t*>(positions) + vertexIndex * stride, sizeof(v));
+            return v;
+        };
+
+        // Vertices at the same position share one id : their quadric and their triangles' surface
+        std::vector<uint32_t> positionIds(vertexCount, UINT32_MAX);
+        std::vector<uint32_t> wedgeCounts;
+        {
+            std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+            for (uint32_t vertexIndex : result) {
+                if (positionIds.at(vertexIndex) != UINT32_MAX) {
+                    continue;
+                }
+                const Vector3 v = position(vertexIndex);
+                std::vector<uint32_t>& bucket = buckets[cooked::hash_bytes(&v, sizeof(v))];
+                uint32_t id = UINT32_MAX;
+                for (uint32_t other : bucket) {
+                    const Vector3 w = position(other);
+                    if (memcmp(&v, &w, sizeof(v)) == 0) {
+                        id = positionIds.at(other);
+                        break;
+                    }
+                }
+                if (id == UINT32_MAX) {
+                    id = static_cast<uint32_t>(wedgeCounts.size());
+                    wedgeCounts.push_back(0);
+                }
+                bucket.push_back(vertexIndex);
+                positionIds.at(vertexIndex) = id;
+                ++wedgeCounts.at(id);
+            }
+        }
+
+        std::vector<bool> locked(vertexCount, false);
+        for (uint32_t vertexIndex : result) {
+            if (wedgeCounts.at(positionIds.at(vertexIndex)) > 1) {
+                locked.at(vertexIndex) = true;
+            }
+        }
+        {
+            std::unordered_map<uint64_t, uint32_t> edgeUses;
+            edgeUses.reserve(indexCount);
+            for (size_t i = 0; i < indexCount; i += 3) {
+                for (int corner = 0; corner < 3; ++corner) {
+                    ++edgeUses[edge_key(result.at(i + corner), result.at(i + (corner + 1) % 3))];
+                }
+            }
+            for (const auto& edge : edgeUses) {
+                if (edge.second != 2) {
+                    locked.at(static_cast<uint32_t>(edge.first >> 32)) = true;
+                    locked.at(static_cast<uint32_t>(edge.first & UINT32_MAX)) = true;
+                }
+            }
+        }
+
+        std::vector<Quadric> quadrics(wedgeCounts.size());
+        for (size_t i = 0; i < indexCount; i += 3) {
+            const Vector3 p0 = position(result.at(i)), p1 = position(result.at(i + 1)), p2 = position(result.at(i + 2));
+            Vector3 normal = cross(subtract(p1, p0), subtract(p2, p0));
+            const float doubleArea = sqrtf(dot(normal, normal));
+            if (doubleArea == 0) {
+                continue;
+            }
+            normal = { normal.x / doubleArea, normal.y / doubleArea, normal.z / doubleArea };
+            Quadric quadric;
+            quadric.add_plane(normal, -dot(normal, p0), doubleArea * 0.5);
+            for (int corner = 0; corner < 3; ++corner) {
+                quadrics.at(positionIds.at(result.at(i + corner))).add(quadric);
+            }
+        }
+
+        const double maxCost = static_cast<double>(maxError) * maxError;
+        std::vector<Collapse> collapses;
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+        std::vector<uint32_t> adjacency;
+        std::vector<bool> touched(vertexCount);
+        std::vector<uint32_t> remap(vertexCount);
+
+        // Each pass collapses a batch of the cheapest edges that don't touch one another, then rebuilds the
+        // triangle list. Cheap edges are spread over the surface, so batches reduce evenly.
+        while (result.size() > targetIndexCount) {
+            collapses.clear();
+            for (size_t i = 0; i < result.size(); i += 3) {
+                for (int corner = 0; corner < 3; ++corner) {
+                    const uint32_t a = result.at(i + corner);
+                    const uint32_t b = result.at(i + (corner + 1) % 3);
+                    for (int direction = 0; direction < 2; ++direction) {
+                        const uint32_t from = direction == 0 ? a : b;
+                        const uint32_t to = direction == 0 ? b : a;
+                        if (locked.at(from) || (groups && groups[from] != groups[to])) {
+                            continue;
+                        }
+                        Quadric quadric = quadrics.at(positionIds.at(from));
+                        quadric.add(quadrics.at(positionIds.at(to)));
+                        const double cost = quadric.evaluate(position(to));
+                        if (cost <= maxCost) {
+                            collapses.push_back({ from, to, cost });
+                        }
+                    }
+                }
+            }
+            if (collapses.empty()) {
+                break;
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+                return a.cost < b.cost || (a.cost == b.cost && (a.from < b.from || (a.from == b.from && a.to < b.to)));
+            });
+
+            std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+            for (uint32_t vertexIndex : result) {
+                ++adjacencyOffsets.at(vertexIndex + 1);
+            }
+            for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+                adjacencyOffsets.at(vertexIndex + 1) += adjacencyOffsets.at(vertexIndex);
+            }
+            adjacency.resize(result.size());
+            {
+                std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+                for (size_t i = 0; i < result.size(); ++i) {
+                    adjacency.at(fill.at(result.at(i))++) = static_cast<uint32_t>(i / 3);
+                }
+            }
+
+            // A collapse removes about two triangles
+            const size_t wanted = std::max<size_t>((result.size() - targetIndexCount) / 6, 1);
+            size_t collapsed = 0;
+            std::fill(touched.begin(), touched.end(), false);
+            for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+                remap.at(vertexIndex) = static_cast<uint32_t>(vertexIndex);
+            }
+            for (const Collapse& collapse : collapses) {
+                if (collapsed >= wanted) {
+                    break;
+                }
+                if (touched.at(collapse.from) || touched.at(collapse.to)) {
+                    continue;
+                }
+
+                const uint32_t* begin = adjacency.data() + adjacencyOffsets.at(collapse.from);
+                const uint32_t* end = adjacency.data() + adjacencyOffsets.at(collapse.from + 1);
+                const Vector3 target = position(collapse.to);
+                bool valid = true;
+                for (const uint32_t* triangle = begin; triangle < end && valid; ++triangle) {
+                    const uint32_t* corners = result.data() + *triangle * 3;
+                    if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to) {
+                        continue; // collapses to nothing
+                    }
+                    Vector3 before[3], after[3];
+                    for (int corner = 0; corner < 3; ++corner) {
+                        before[corner] = position(corners[corner]);
+                        after[corner] = corners[corner] == collapse.from ? target : before[corner];
+                    }
+                    const Vector3 normalBefore = cross(subtract(before[1], before[0]), subtract(before[2], before[0]));
+                    const Vector3 normalAfter = cross(subtract(after[1], after[0]), subtract(after[2], after[0]));
+                    const float lengths = sqrtf(dot(normalBefore, normalBefore) * dot(normalAfter, normalAfter));
+                    valid = dot(normalBefore, normalAfter) > MIN_NORMAL_COSINE * lengths;
+                }
+                if (!valid) {
+                    continue;
+                }
+
+                remap.at(collapse.from) = collapse.to;
+                quadrics.at(positionIds.at(collapse.to)).add(quadrics.at(positionIds.at(collapse.from)));
+                largestError = std::max<float>(largestError, static_cast<float>(sqrt(collapse.cost)));
+                // Everything around 'from' changes shape : leave it alone for the rest of this pass
+                for (const uint32_t* triangle = begin; triangle < end; ++triangle) {
+                    const uint32_t* corners = result.data() + *triangle * 3;
+                    touched.at(corners[0]) = touched.at(corners[1]) = touched.at(corners[2]) = true;
+                }
+                ++collapsed;
+            }
+            if (collapsed == 0) {
+                break;
+            }
+
+            size_t write = 0;
+            for (size_t i = 0; i < result.size(); i += 3) {
+                const uint32_t i0 = remap.at(result.at(i)), i1 = remap.at(result.at(i + 1)), i2 = remap.at(result.at(i + 2));
+                const uint32_t p0 = positionIds.at(i0), p1 = positionIds.at(i1), p2 = positionIds.at(i2);
+                if (p0 == p1 || p1 == p2 || p2 == p0) {
+                    continue;
+                }
+                result.at(write++) = i0;
+                result.at(write++) = i1;
+                result.at(write++) = i2;
+            }
+            result.resize(write);
+        }
+
+        std::copy(result.begin(), result.end(), destination);
+        if (resultError) {
+            *resultError = largestError;
+        }
+        return result.size();
+    }
+}
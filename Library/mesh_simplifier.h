@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Import-stage mesh simplification for LOD chains : quadric error metric edge collapse (Garland & Heckbert,
+// "Surface Simplification Using Quadric Error Metrics").
+//
+// Every collapse moves a vertex onto one of its neighbours, so no vertex is created or interpolated and the
+// simplified index range keeps referring to the original vertex buffer. Vertices that must not move are
+// locked :
+//  - on an open edge of the index range. Since welding leaves a separate vertex on each side of a UV/normal
+//    seam, seams show up as open edges too, and simplifying one material subset at a time keeps its border
+//    with the other subsets.
+//  - sharing their position with another vertex (the ends of a seam, split skin weights)
+//  - on an edge used by more than two triangles
+// A vertex only collapses onto a neighbour of the same group (e.g. dominant bone), which keeps skin weight
+// boundaries where they were.
+namespace mesh_simplifier {
+    // Bump when the output for the same input changes, so cached results get rebuilt.
+    constexpr uint32_t VERSION = 1;
+
+    // Simplifies one index range until at most 'targetIndexCount' indices are left, no collapse under
+    // 'maxError' remains, or nothing can collapse any more. 'positions' points to the first vertex's float3
+    // position, 'stride' bytes apart. 'groups' may be null. 'destination' receives the indices (at most
+    // 'indexCount'); the return value is their count. 'resultError' receives the largest deviation from the
+    // source surface introduced, in position units.
+    size_t simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+        const void* positions, size_t vertexCount, size_t stride, const uint32_t* groups,
+        size_t targetIndexCount, float maxError, float* resultError = nullptr);
+}
@@ -18,6 +18,8 @@ inline LPWSTR hr_trace(HRESULT hr)
 	FormatMessageW(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS | FORMAT_MESSAGE_ALLOCATE_BUFFER, NULL, hr, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), reinterpret_cast<LPWSTR>(&msg), 0, NULL);
 	return msg;
 }
+// Graphics/ のコードはこの名前で使う
+#define HRTrace(hr) hr_trace(hr)
 
 class benchmark
 {
@@ -0,0 +1,482 @@
+#include "obj_parser.h"
+#include "cooked_model.h"
+#include "thread_pool.h"
+
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <filesystem>
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace obj {
+    namespace {
+        inline bool is_blank(char c) {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        // Hand written scanner over [p, end). Never reads past 'end' and never consumes a '\n' except in skip_line.
+        struct Scanner {
+            const char* p;
+            const char* end;
+
+            bool at_end() const { return p >= end; }
+            bool at_line_end() const { return p >= end || *p == '\n' || *p == '#'; }
+
+            void skip_blanks() {
+                while (p < end && is_blank(*p)) ++p;
+            }
+            void skip_line() {
+                const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+                p = newline ? newline + 1 : end;
+            }
+            // 'keyword' followed by a blank. Consumes it on a match.
+            bool keyword(std::string_view keyword) {
+                const size_t length = keyword.size();
+                if (static_cast<size_t>(end - p) > length && memcmp(p, keyword.data(), length) == 0 && is_blank(p[length])) {
+                    p += length;
+                    return true;
+                }
+                return false;
+            }
+            std::string_view token() {
+                skip_blanks();
+                const char* begin = p;
+                while (p < end && !is_blank(*p) && *p != '\n') ++p;
+                return std::string_view(begin, p - begin);
+            }
+            // Up to the end of the line, blanks trimmed on both sides. Names may contain spaces.
+            std::string_view rest_of_line() {
+                skip_blanks();
+                const char* begin = p;
+                while (p < end && *p != '\n') ++p;
+                const char* last = p;
+                while (last > begin && is_blank(last[-1])) --last;
+                return std::string_view(begin, last - begin);
+            }
+            bool read_float(float& value) {
+                skip_blanks();
+                if (p < end && *p == '+') ++p; // from_chars doesn't take a leading '+'
+                const std::from_chars_result result = std::from_chars(p, end, value);
+                if (result.ec != std::errc()) {
+                    return false;
+                }
+                p = result.ptr;
+                return true;
+            }
+            bool read_int(int32_t& value) {
+                const std::from_chars_result result = std::from_chars(p, end, value);
+                if (result.ec != std::errc()) {
+                    return false;
+                }
+                p = result.ptr;
+                return true;
+            }
+        };
+
+        enum Attribute { POSITION, TEXCOORD, NORMAL };
+
+        // A face corner as written. Relative (negative) indices can't be resolved until the counts of the
+        // preceding chunks are known, so they are stored chunk-local and flagged.
+        struct Corner {
+            int32_t index[3] = {};  // 0-based
+            uint8_t present = 0;    // bit per Attribute
+            uint8_t relative = 0;   // bit per Attribute : index[] is relative to the chunk's first element
+        };
+
+        struct MaterialSwitch {
+            size_t faceIndex;       // usemtl applies from this face of the chunk on
+            std::string name;
+        };
+
+        struct Chunk {
+            const char* begin = nullptr;
+            const char* end = nullptr;
+
+            std::vector<XMFLOAT3> positions;
+            std::vector<XMFLOAT2> texcoords;
+            std::vector<XMFLOAT3> normals;
+            std::vector<Corner> corners;
+            std::vector<uint32_t> faceSizes;
+            std::vector<MaterialSwitch> materialSwitches;
+            std::vector<std::string> mtllibs;
+            size_t invalidFaceCount = 0;
+        };
+
+        bool read_corner(Scanner& scanner, const Chunk& chunk, Corner& corner) {
+            const size_t counts[3] = { chunk.positions.size(), chunk.texcoords.size(), chunk.normals.size() };
+            auto store = [&](Attribute attribute, int32_t value) {
+                if (value == 0) {
+                    return false;
+                }
+                if (value > 0) {
+                    corner.index[attribute] = value - 1;
+                }
+                else {
+                    // May go below 0 : refers back into a previous chunk.
+                    corner.index[attribute] = static_cast<int32_t>(counts[attribute]) + value;
+                    corner.relative |= 1 << attribute;
+                }
+                corner.present |= 1 << attribute;
+                return true;
+            };
+
+            int32_t value = 0;
+            if (!scanner.read_int(value) || !store(POSITION, value)) {
+                return false;
+            }
+            if (scanner.p < scanner.end && *scanner.p == '/') {
+                ++scanner.p;
+                if (scanner.p < scanner.end && *scanner.p != '/') {
+                    if (!scanner.read_int(value) || !store(TEXCOORD, value)) {
+                        return false;
+                    }
+                }
+                if (scanner.p < scanner.end && *scanner.p == '/') {
+                    ++scanner.p;
+                    if (!scanner.read_int(value) || !store(NORMAL, value)) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        void scan_chunk(Chunk& chunk, bool flipV) {
+            Scanner scanner{ chunk.begin, chunk.end };
+            while (!scanner.at_end()) {
+                scanner.skip_blanks();
+                if (scanner.keyword("v")) {
+                    XMFLOAT3 position;
+                    if (scanner.read_float(position.x) && scanner.read_float(position.y) && scanner.read_float(position.z)) {
+                        chunk.positions.push_back(position);
+                    }
+                }
+                else if (scanner.keyword("vt")) {
+                    XMFLOAT2 texcoord = { 0,0 };
+                    if (scanner.read_float(texcoord.x)) {
+                        scanner.read_float(texcoord.y); // v is optional
+                        if (flipV) texcoord.y = 1.0f - texcoord.y;
+                        chunk.texcoords.push_back(texcoord);
+                    }
+                }
+                else if (scanner.keyword("vn")) {
+                    XMFLOAT3 normal;
+                    if (scanner.read_float(normal.x) && scanner.read_float(normal.y) && scanner.read_float(normal.z)) {
+                        chunk.normals.push_back(normal);
+                    }
+                }
+                else if (scanner.keyword("f")) {
+                    const size_t firstCorner = chunk.corners.size();
+                    bool valid = true;
+                    for (scanner.skip_blanks(); !scanner.at_line_end(); scanner.skip_blanks()) {
+                        Corner corner;
+                        if (!read_corner(scanner, chunk, corner)) {
+                            valid = false;
+                            break;
+                        }
+                        chunk.corners.push_back(corner);
+                    }
+                    const size_t cornerCount = chunk.corners.size() - firstCorner;
+                    if (valid && cornerCount >= 3) {
+                        chunk.faceSizes.push_back(static_cast<uint32_t>(cornerCount));
+                    }
+                    else {
+                        chunk.corners.resize(firstCorner);
+                        ++chunk.invalidFaceCount;
+                    }
+                }
+                else if (scanner.keyword("usemtl")) {
+                    chunk.materialSwitches.push_back({ chunk.faceSizes.size(), std::string(scanner.rest_of_line()) });
+                }
+                else if (scanner.keyword("mtllib")) {
+                    // One or more file names
+                    for (std::string_view name = scanner.token(); !name.empty(); name = scanner.token()) {
+                        chunk.mtllibs.emplace_back(name);
+                    }
+                }
+                scanner.skip_line();
+            }
+        }
+
+        // Resolved corner, UINT32_MAX for a missing texcoord/normal.
+        struct Key {
+            uint32_t index[3];
+            bool operator==(const Key& other) const {
+                return index[0] == other.index[0] && index[1] == other.index[1] && index[2] == other.index[2];
+            }
+        };
+
+        inline uint64_t hash_key(const Key& key) {
+            uint64_t hash = key.index[0] * 0x9E3779B97F4A7C15ull;
+            hash ^= (key.index[1] + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+            hash ^= (key.index[2] + 0x85EBCA77C2B2AE63ull) * 0x165667B19E3779F9ull;
+            return hash ^ (hash >> 29);
+        }
+
+        ThreadPool& parser_pool() {
+            static ThreadPool threadPool;
+            return threadPool;
+        }
+    }
+
+    bool parse_obj(const wchar_t* objFilename, bool flipV, Mesh& mesh, bool parallel) {
+        mesh = {};
+
+        MappedFile file;
+        if (!file.open(objFilename)) {
+            return false;
+        }
+        const char* data = reinterpret_cast<const char*>(file.data());
+        const size_t size = file.size();
+
+        // Split at line boundaries
+        size_t chunkCount = 1;
+        if (parallel && size > PARALLEL_CHUNK_SIZE) {
+            chunkCount = std::min(parser_pool().thread_count(), size / PARALLEL_CHUNK_SIZE);
+            chunkCount = std::max<size_t>(chunkCount, 1);
+        }
+        std::vector<Chunk> chunks(chunkCount);
+        const char* cursor = data;
+        for (size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+            const char* end = data + size * (chunkIndex + 1) / chunkCount;
+            if (chunkIndex + 1 < chunkCount) {
+                end = std::max(end, cursor);
+                const char* newline = static_cast<const char*>(memchr(end, '\n', data + size - end));
+                end = newline ? newline + 1 : data + size;
+            }
+            else {
+                end = data + size;
+            }
+            chunks.at(chunkIndex).begin = cursor;
+            chunks.at(chunkIndex).end = end;
+            cursor = end;
+        }
+
+        if (chunkCount > 1) {
+            for (Chunk& chunk : chunks) {
+                parser_pool().submit([&chunk, flipV]() { scan_chunk(chunk, flipV); });
+            }
+            parser_pool().wait();
+        }
+        else {
+            scan_chunk(chunks.at(0), flipV);
+        }
+
+        // Attribute arrays in file order; every chunk's relative indices are offset by its base.
+        std::vector<XMFLOAT3> positions;
+        std::vector<XMFLOAT2> texcoords;
+        std::vector<XMFLOAT3> normals;
+        std::vector<size_t> bases[3];
+        for (const Chunk& chunk : chunks) {
+            bases[POSITION].push_back(positions.size());
+            bases[TEXCOORD].push_back(texcoords.size());
+            bases[NORMAL].push_back(normals.size());
+            positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+            texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+            normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        }
+        const size_t counts[3] = { positions.size(), texcoords.size(), normals.size() };
+
+        // Triangulate into per-material corner lists, materials in order of first use.
+        std::vector<std::string> groupNames;
+        std::vector<std::vector<Key>> groupCorners;
+        std::unordered_map<std::string, size_t> groupIndices;
+        auto group_of = [&](const std::string& name) {
+            auto it = groupIndices.find(name);
+            if (it != groupIndices.end()) {
+                return it->second;
+            }
+            groupIndices.emplace(name, groupNames.size());
+            groupNames.push_back(name);
+            groupCorners.emplace_back();
+            return groupNames.size() - 1;
+        };
+
+        size_t currentGroup = SIZE_MAX;
+        for (size_t chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+            const Chunk& chunk = chunks.at(chunkIndex);
+            mesh.statistics.invalidFaceCount += chunk.invalidFaceCount;
+            mesh.mtllibs.insert(mesh.mtllibs.end(), chunk.mtllibs.begin(), chunk.mtllibs.end());
+
+            size_t switchIndex = 0;
+            size_t cornerIndex = 0;
+            for (size_t faceIndex = 0; faceIndex <= chunk.faceSizes.size(); ++faceIndex) {
+                while (switchIndex < chunk.materialSwitches.size() && chunk.materialSwitches.at(switchIndex).faceIndex == faceIndex) {
+                    currentGroup = group_of(chunk.materialSwitches.at(switchIndex).name);
+                    ++switchIndex;
+                }
+                if (faceIndex == chunk.faceSizes.size()) {
+                    break;
+                }
+
+                const uint32_t faceSize = chunk.faceSizes.at(faceIndex);
+                const Corner* corners = &chunk.corners.at(cornerIndex);
+                cornerIndex += faceSize;
+
+                // Resolve
+                Key keys[64];
+                Key* faceKeys = faceSize <= _countof(keys) ? keys : nullptr;
+                std::vector<Key> largeFace;
+                if (!faceKeys) {
+                    largeFace.resize(faceSize);
+                    faceKeys = largeFace.data();
+                }
+                bool valid = true;
+                for (uint32_t corner = 0; corner < faceSize && valid; ++corner) {
+                    for (int attribute = POSITION; attribute <= NORMAL; ++attribute) {
+                        uint32_t& resolved = faceKeys[corner].index[attribute];
+                        resolved = UINT32_MAX;
+                        if (corners[corner].present & (1 << attribute)) {
+                            int64_t index = corners[corner].index[attribute];
+                            if (corners[corner].relative & (1 << attribute)) {
+                                index += bases[attribute].at(chunkIndex);
+                            }
+                            if (index < 0 || index >= static_cast<int64_t>(counts[attribute])) {
+                                valid = false;
+                                break;
+                            }
+                            resolved = static_cast<uint32_t>(index);
+                        }
+                        else if (attribute == POSITION) {
+                            valid = false;
+                        }
+                    }
+                }
+                if (!valid) {
+                    ++mesh.statistics.invalidFaceCount;
+                    continue;
+                }
+
+                if (currentGroup == SIZE_MAX) {
+                    currentGroup = group_of(std::string());
+                }
+                std::vector<Key>& groupKeys = groupCorners.at(currentGroup);
+                for (uint32_t corner = 1; corner + 1 < faceSize; ++corner) {
+                    groupKeys.push_back(faceKeys[0]);
+                    groupKeys.push_back(faceKeys[corner]);
+                    groupKeys.push_back(faceKeys[corner + 1]);
+                }
+                ++mesh.statistics.faceCount;
+                mesh.statistics.cornerCount += faceSize;
+            }
+        }
+        mesh.statistics.chunkCount = chunkCount;
+
+        // Weld : open addressing table from Key to vertex index
+        size_t totalCorners = 0;
+        for (const std::vector<Key>& keys : groupCorners) {
+            totalCorners += keys.size();
+        }
+        size_t capacity = 16;
+        while (capacity < totalCorners * 2) {
+            capacity <<= 1;
+        }
+        const size_t mask = capacity - 1;
+        std::vector<uint32_t> slots(capacity, UINT32_MAX);
+        std::vector<Key> vertexKeys;
+        vertexKeys.reserve(totalCorners / 2);
+        mesh.indices.reserve(totalCorners);
+
+        for (size_t groupIndex = 0; groupIndex < groupNames.size(); ++groupIndex) {
+            const std::vector<Key>& keys = groupCorners.at(groupIndex);
+            if (keys.empty()) {
+                continue;
+            }
+            Group& group = mesh.groups.emplace_back();
+            group.material = groupNames.at(groupIndex);
+            group.indexStart = static_cast<uint32_t>(mesh.indices.size());
+            for (const Key& key : keys) {
+                size_t slot = hash_key(key) & mask;
+                while (slots.at(slot) != UINT32_MAX && !(vertexKeys.at(slots.at(slot)) == key)) {
+                    slot = (slot + 1) & mask;
+                }
+                if (slots.at(slot) == UINT32_MAX) {
+                    slots.at(slot) = static_cast<uint32_t>(vertexKeys.size());
+                    vertexKeys.push_back(key);
+                }
+                mesh.indices.push_back(slots.at(slot));
+            }
+            group.indexCount = static_cast<uint32_t>(mesh.indices.size()) - group.indexStart;
+        }
+
+        mesh.vertices.resize(vertexKeys.size());
+        for (size_t vertexIndex = 0; vertexIndex < vertexKeys.size(); ++vertexIndex) {
+            const Key& key = vertexKeys.at(vertexIndex);
+            Vertex& vertex = mesh.vertices.at(vertexIndex);
+            vertex.position = positions.at(key.index[POSITION]);
+            if (key.index[TEXCOORD] != UINT32_MAX) vertex.texcoord = texcoords.at(key.index[TEXCOORD]);
+            if (key.index[NORMAL] != UINT32_MAX) vertex.normal = normals.at(key.index[NORMAL]);
+        }
+
+        // Every MTL, looked up next to the OBJ
+        std::vector<std::string> loaded;
+        for (const std::string& mtllib : mesh.mtllibs) {
+            if (std::find(loaded.begin(), loaded.end(), mtllib) != loaded.end()) {
+                continue;
+            }
+            loaded.push_back(mtllib);
+            std::filesystem::path mtlFilename(objFilename);
+            mtlFilename.replace_filename(std::filesystem::path(mtllib).filename());
+            parse_mtl(mtlFilename.c_str(), mesh.materials);
+        }
+        return true;
+    }
+
+    bool parse_mtl(const wchar_t* mtlFilename, std::vector<Material>& materials) {
+        MappedFile file;
+        if (!file.open(mtlFilename)) {
+            return false;
+        }
+        Scanner scanner{ reinterpret_cast<const char*>(file.data()), reinterpret_cast<const char*>(file.data()) + file.size() };
+
+        // "Kd r g b", or "Kd r" for grey
+        auto read_color = [&scanner](XMFLOAT4& color) {
+            float r;
+            if (scanner.read_float(r)) {
+                float g = r, b = r;
+                if (scanner.read_float(g)) {
+                    scanner.read_float(b);
+                }
+                color = { r,g,b,1 };
+            }
+        };
+        // Options ("-bm 1.0", "-s 1 1 1" ...) come first, the file name last.
+        auto read_map = [&scanner](std::string& filename) {
+            std::string_view last;
+            for (std::string_view token = scanner.token(); !token.empty(); token = scanner.token()) {
+                last = token;
+            }
+            filename = last;
+        };
+
+        while (!scanner.at_end()) {
+            scanner.skip_blanks();
+            if (scanner.keyword("newmtl")) {
+                materials.emplace_back().name = scanner.rest_of_line();
+            }
+            else if (materials.empty()) {
+                // Statements before the first newmtl have nothing to apply to
+            }
+            else if (scanner.keyword("Ka")) {
+                read_color(materials.back().ka);
+            }
+            else if (scanner.keyword("Kd")) {
+                read_color(materials.back().kd);
+            }
+            else if (scanner.keyword("Ks")) {
+                read_color(materials.back().ks);
+            }
+            else if (scanner.keyword("map_Kd")) {
+                read_map(materials.back().textureFilenames[0]);
+            }
+            else if (scanner.keyword("map_bump") || scanner.keyword("map_Bump") || scanner.keyword("bump")) {
+                read_map(materials.back().textureFilenames[1]);
+            }
+            scanner.skip_line();
+        }
+        return true;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Wavefront OBJ/MTL parser.
+//
+// The file is memory mapped and scanned in place (no streams, std::from_chars for numbers). Files larger than
+// PARALLEL_CHUNK_SIZE are split at line boundaries and the chunks are scanned on a thread pool; relative
+// (negative) indices are resolved once every chunk's counts are known.
+// Faces are fan triangulated, corners with the same position/texcoord/normal indices are welded into one
+// vertex, and triangles are grouped by material so every material is one contiguous index range.
+namespace obj {
+    // Bump when the output for the same input changes, so cached results get rebuilt.
+    constexpr uint32_t PARSER_VERSION = 2;
+    constexpr size_t PARALLEL_CHUNK_SIZE = 256 * 1024;
+
+    struct Vertex {
+        DirectX::XMFLOAT3 position = { 0,0,0 };
+        DirectX::XMFLOAT3 normal = { 0,0,0 };
+        DirectX::XMFLOAT2 texcoord = { 0,0 };
+    };
+
+    // Triangles using one material. Faces before the first usemtl use the material "".
+    struct Group {
+        std::string material;
+        uint32_t indexStart = 0;
+        uint32_t indexCount = 0;
+    };
+
+    struct Material {
+        std::string name;
+        DirectX::XMFLOAT4 ka = { 0.2f,0.2f,0.2f,1.0f };
+        DirectX::XMFLOAT4 kd = { 0.8f,0.8f,0.8f,1.0f };
+        DirectX::XMFLOAT4 ks = { 1.0f,1.0f,1.0f,1.0f };
+        std::string textureFilenames[2]; // map_Kd, map_bump/bump, as written in the MTL
+    };
+
+    struct Statistics {
+        size_t faceCount = 0;
+        size_t cornerCount = 0;         // face corners before welding
+        size_t invalidFaceCount = 0;    // faces referencing missing positions/texcoords/normals, skipped
+        size_t chunkCount = 0;
+    };
+
+    struct Mesh {
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<Group> groups;
+        std::vector<std::string> mtllibs;   // every mtllib, in order, as written
+        std::vector<Material> materials;    // from all mtllibs found next to the OBJ
+        Statistics statistics;
+    };
+
+    // 'flipV' stores 1 - v. 'parallel' false scans the whole file on the calling thread.
+    // Returns false if the OBJ can't be opened.
+    bool parse_obj(const wchar_t* objFilename, bool flipV, Mesh& mesh, bool parallel = true);
+
+    // Appends the materials of one MTL file. Returns false if it can't be opened.
+    bool parse_mtl(const wchar_t* mtlFilename, std::vector<Material>& materials);
+}
@@ -0,0 +1,255 @@
+#include "pose.h"
+
+#include <crtdbg.h>
+#include <intrin.h>
+#include <immintrin.h>
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace {
+    // One SIMD width's worth of operations, so the local matrix kernel is written once for SSE and AVX.
+    struct Sse {
+        using Vector = __m128;
+        static const size_t WIDTH = 4;
+        static Vector load(const float* p) { return _mm_loadu_ps(p); }
+        static Vector set(float value) { return _mm_set1_ps(value); }
+        static Vector add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+        static Vector subtract(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+        static Vector multiply(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+
+        // Lane j of x, y, z, w becomes row 'row' of matrices[j]
+        static void store_rows(XMFLOAT4X4A* matrices, int row, Vector x, Vector y, Vector z, Vector w) {
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+            _mm_store_ps(matrices[0].m[row], x);
+            _mm_store_ps(matrices[1].m[row], y);
+            _mm_store_ps(matrices[2].m[row], z);
+            _mm_store_ps(matrices[3].m[row], w);
+        }
+    };
+
+    struct Avx {
+        using Vector = __m256;
+        static const size_t WIDTH = 8;
+        static Vector load(const float* p) { return _mm256_loadu_ps(p); }
+        static Vector set(float value) { return _mm256_set1_ps(value); }
+        static Vector add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+        static Vector subtract(Vector a, Vector b) { return _mm256_sub_ps(a, b); }
+        static Vector multiply(Vector a, Vector b) { return _mm256_mul_ps(a, b); }
+
+        // The 4x4 transpose works within each 128 bit half : the low half holds lanes 0-3, the high half 4-7
+        static void store_rows(XMFLOAT4X4A* matrices, int row, Vector x, Vector y, Vector z, Vector w) {
+            const __m256 xy0 = _mm256_unpacklo_ps(x, y);
+            const __m256 xy1 = _mm256_unpackhi_ps(x, y);
+            const __m256 zw0 = _mm256_unpacklo_ps(z, w);
+            const __m256 zw1 = _mm256_unpackhi_ps(z, w);
+            const __m256 lane0 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1, 0, 1, 0));
+            const __m256 lane1 = _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3, 2, 3, 2));
+            const __m256 lane2 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1, 0, 1, 0));
+            const __m256 lane3 = _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3, 2, 3, 2));
+            _mm_store_ps(matrices[0].m[row], _mm256_castps256_ps128(lane0));
+            _mm_store_ps(matrices[1].m[row], _mm256_castps256_ps128(lane1));
+            _mm_store_ps(matrices[2].m[row], _mm256_castps256_ps128(lane2));
+            _mm_store_ps(matrices[3].m[row], _mm256_castps256_ps128(lane3));
+            _mm_store_ps(matrices[4].m[row], _mm256_extractf128_ps(lane0, 1));
+            _mm_store_ps(matrices[5].m[row], _mm256_extractf128_ps(lane1, 1));
+            _mm_store_ps(matrices[6].m[row], _mm256_extractf128_ps(lane2, 1));
+            _mm_store_ps(matrices[7].m[row], _mm256_extractf128_ps(lane3, 1));
+        }
+    };
+
+    // S * R * T of 'count' nodes (a multiple of WIDTH), the same matrix XMMatrixScaling *
+    // XMMatrixRotationQuaternion * XMMatrixTranslation gives, expanded so all lanes run in parallel.
+    template<class Simd>
+    void local_transforms(const float* const streams[Pose::STREAM_COUNT], size_t count, XMFLOAT4X4A* matrices) {
+        using Vector = typename Simd::Vector;
+        const Vector zero = Simd::set(0.0f);
+        const Vector one = Simd::set(1.0f);
+        const Vector two = Simd::set(2.0f);
+        for (size_t first = 0; first < count; first += Simd::WIDTH) {
+            const Vector qx = Simd::load(streams[Pose::ROTATION_X] + first);
+            const Vector qy = Simd::load(streams[Pose::ROTATION_Y] + first);
+            const Vector qz = Simd::load(streams[Pose::ROTATION_Z] + first);
+            const Vector qw = Simd::load(streams[Pose::ROTATION_W] + first);
+
+            const Vector x2 = Simd::multiply(qx, two), y2 = Simd::multiply(qy, two), z2 = Simd::multiply(qz, two);
+            const Vector xx = Simd::multiply(qx, x2), yy = Simd::multiply(qy, y2), zz = Simd::multiply(qz, z2);
+            const Vector xy = Simd::multiply(qx, y2), xz = Simd::multiply(qx, z2), yz = Simd::multiply(qy, z2);
+            const Vector wx = Simd::multiply(qw, x2), wy = Simd::multiply(qw, y2), wz = Simd::multiply(qw, z2);
+
+            const Vector sx = Simd::load(streams[Pose::SCALING_X] + first);
+            const Vector sy = Simd::load(streams[Pose::SCALING_Y] + first);
+            const Vector sz = Simd::load(streams[Pose::SCALING_Z] + first);
+
+            XMFLOAT4X4A* block = matrices + first;
+            Simd::store_rows(block, 0,
+                Simd::multiply(sx, Simd::subtract(one, Simd::add(yy, zz))),
+                Simd::multiply(sx, Simd::add(xy, wz)),
+                Simd::multiply(sx, Simd::subtract(xz, wy)), zero);
+            Simd::store_rows(block, 1,
+                Simd::multiply(sy, Simd::subtract(xy, wz)),
+                Simd::multiply(sy, Simd::subtract(one, Simd::add(xx, zz))),
+                Simd::multiply(sy, Simd::add(yz, wx)), zero);
+            Simd::store_rows(block, 2,
+                Simd::multiply(sz, Simd::add(xz, wy)),
+                Simd::multiply(sz, Simd::subtract(yz, wx)),
+                Simd::multiply(sz, Simd::subtract(one, Simd::add(xx, yy))), zero);
+            Simd::store_rows(block, 3,
+                Simd::load(streams[Pose::TRANSLATION_X] + first),
+                Simd::load(streams[Pose::TRANSLATION_Y] + first),
+                Simd::load(streams[Pose::TRANSLATION_Z] + first), one);
+        }
+    }
+
+    void local_transforms_avx(const float* const streams[Pose::STREAM_COUNT], size_t count, XMFLOAT4X4A* matrices) {
+        local_transforms<Avx>(streams, count, matrices);
+        _mm256_zeroupper(); // no AVX to SSE transition penalty in the caller
+    }
+
+    const float IDENTITY[Pose::STREAM_COUNT] = { 1, 1, 1, 0, 0, 0, 1, 0, 0, 0 };
+}
+
+void Pose::Hierarchy::build(const int64_t* parentIndices, size_t nodeCount) {
+    order.clear();
+    parents.clear();
+    order.reserve(nodeCount);
+    parents.reserve(nodeCount);
+
+    // Children lists, then a depth-first walk from every root
+    std::vector<uint32_t> childOffsets(nodeCount + 1, 0);
+    for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+        const int64_t parentIndex = parentIndices[nodeIndex];
+        if (parentIndex >= 0 && static_cast<size_t>(parentIndex) < nodeCount) {
+            ++childOffsets[parentIndex + 1];
+        }
+    }
+    for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+        childOffsets[nodeIndex + 1] += childOffsets[nodeIndex];
+    }
+    std::vector<uint32_t> children(childOffsets[nodeCount]);
+    {
+        std::vector<uint32_t> fill(childOffsets.begin(), childOffsets.end() - 1);
+        for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+            const int64_t parentIndex = parentIndices[nodeIndex];
+            if (parentIndex >= 0 && static_cast<size_t>(parentIndex) < nodeCount) {
+                children[fill[parentIndex]++] = static_cast<uint32_t>(nodeIndex);
+            }
+        }
+    }
+
+    std::vector<bool> visited(nodeCount, false);
+    std::vector<uint32_t> stack;
+    auto walk = [&](uint32_t root, int32_t rootParent) {
+        visited[root] = true;
+        order.push_back(root);
+        parents.push_back(rootParent);
+        stack.assign(1, root);
+        while (!stack.empty()) {
+            const uint32_t nodeIndex = stack.back();
+            stack.pop_back();
+            for (uint32_t child = childOffsets[nodeIndex]; child < childOffsets[nodeIndex + 1]; ++child) {
+                const uint32_t childIndex = children[child];
+                if (!visited[childIndex]) {
+                    visited[childIndex] = true;
+                    order.push_back(childIndex);
+                    parents.push_back(static_cast<int32_t>(nodeIndex));
+                    stack.push_back(childIndex);
+                }
+            }
+        }
+    };
+    for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+        const int64_t parentIndex = parentIndices[nodeIndex];
+        if (parentIndex < 0 || static_cast<size_t>(parentIndex) >= nodeCount) {
+            walk(static_cast<uint32_t>(nodeIndex), -1);
+        }
+    }
+    // Whatever no root reaches is part of a cycle
+    for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+        if (!visited[nodeIndex]) {
+            walk(static_cast<uint32_t>(nodeIndex), -1);
+        }
+    }
+}
+
+void Pose::resize(size_t count) {
+    const size_t padded = (count + LANES - 1) / LANES * LANES;
+    if (padded != paddedCount) {
+        std::vector<float> resized(STREAM_COUNT * padded);
+        for (int streamIndex = 0; streamIndex < STREAM_COUNT; ++streamIndex) {
+            float* destination = resized.data() + streamIndex * padded;
+            const size_t kept = std::min<size_t>(nodeCount, count);
+            std::copy(streams.data() + streamIndex * paddedCount, streams.data() + streamIndex * paddedCount + kept, destination);
+            std::fill(destination + kept, destination + padded, IDENTITY[streamIndex]);
+        }
+        streams = std::move(resized);
+        paddedCount = padded;
+        globalTransforms.resize(padded);
+    }
+    else {
+        for (int streamIndex = 0; streamIndex < STREAM_COUNT; ++streamIndex) {
+            float* values = streams.data() + streamIndex * paddedCount;
+            std::fill(values + std::min<size_t>(nodeCount, count), values + paddedCount, IDENTITY[streamIndex]);
+        }
+    }
+    nodeCount = count;
+}
+
+void Pose::set_local(size_t nodeIndex, const XMFLOAT3& scaling, const XMFLOAT4& rotation, const XMFLOAT3& translation) {
+    float* values = streams.data() + nodeIndex;
+    values[SCALING_X * paddedCount] = scaling.x;
+    values[SCALING_Y * paddedCount] = scaling.y;
+    values[SCALING_Z * paddedCount] = scaling.z;
+    values[ROTATION_X * paddedCount] = rotation.x;
+    values[ROTATION_Y * paddedCount] = rotation.y;
+    values[ROTATION_Z * paddedCount] = rotation.z;
+    values[ROTATION_W * paddedCount] = rotation.w;
+    values[TRANSLATION_X * paddedCount] = translation.x;
+    values[TRANSLATION_Y * paddedCount] = translation.y;
+    values[TRANSLATION_Z * paddedCount] = translation.z;
+}
+
+void Pose::get_local(size_t nodeIndex, XMFLOAT3& scaling, XMFLOAT4& rotation, XMFLOAT3& translation) const {
+    const float* values = streams.data() + nodeIndex;
+    scaling = { values[SCALING_X * paddedCount], values[SCALING_Y * paddedCount], values[SCALING_Z * paddedCount] };
+    rotation = { values[ROTATION_X * paddedCount], values[ROTATION_Y * paddedCount],
+        values[ROTATION_Z * paddedCount], values[ROTATION_W * paddedCount] };
+    translation = { values[TRANSLATION_X * paddedCount], values[TRANSLATION_Y * paddedCount], values[TRANSLATION_Z * paddedCount] };
+}
+
+void Pose::update(const Hierarchy& hierarchy, bool allowAvx) {
+    _ASSERT_EXPR(hierarchy.node_count() == nodeCount, L"Pose and Hierarchy have different node counts");
+
+    const float* streamPointers[STREAM_COUNT];
+    for (int streamIndex = 0; streamIndex < STREAM_COUNT; ++streamIndex) {
+        streamPointers[streamIndex] = streams.data() + streamIndex * paddedCount;
+    }
+    static const bool avx = avx_supported();
+    if (allowAvx && avx) {
+        local_transforms_avx(streamPointers, paddedCount, globalTransforms.data());
+    }
+    else {
+        local_transforms<Sse>(streamPointers, paddedCount, globalTransforms.data());
+    }
+
+    // In place : a parent is already global when its children read it, and a child still holds its local matrix
+    const uint32_t* order = hierarchy.order.data();
+    const int32_t* parents = hierarchy.parents.data();
+    XMFLOAT4X4A* matrices = globalTransforms.data();
+    for (size_t i = 0; i < nodeCount; ++i) {
+        const int32_t parentIndex = parents[i];
+        if (parentIndex >= 0) {
+            XMFLOAT4X4A& matrix = matrices[order[i]];
+            XMStoreFloat4x4A(&matrix, XMMatrixMultiply(XMLoadFloat4x4A(&matrix), XMLoadFloat4x4A(&matrices[parentIndex])));
+        }
+    }
+}
+
+bool Pose::avx_supported() {
+    int information[4];
+    __cpuid(information, 1);
+    const bool osxsave = (information[2] & (1 << 27)) != 0;
+    const bool avx = (information[2] & (1 << 28)) != 0;
+    // The OS must also save the YMM registers on context switches
+    return osxsave && avx && (_xgetbv(0) & 6) == 6;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Structure-of-arrays pose : the local scaling/rotation/translation of every node as separate float streams,
+// and the model-space matrices update builds from them.
+//
+// update converts LANES nodes per step (AVX when the CPU has it, SSE otherwise) with no per-node matrix
+// products, then walks a Hierarchy's parent-before-child order doing one matrix multiply per node in place.
+class Pose {
+public:
+    // Streams are padded to a multiple of this, so the SIMD loops never need a scalar tail.
+    static const size_t LANES = 8;
+
+    enum Stream {
+        SCALING_X, SCALING_Y, SCALING_Z,
+        ROTATION_X, ROTATION_Y, ROTATION_Z, ROTATION_W,
+        TRANSLATION_X, TRANSLATION_Y, TRANSLATION_Z,
+        STREAM_COUNT
+    };
+
+    // Parent-before-child order of a node array, built once per skeleton/scene.
+    struct Hierarchy {
+        std::vector<uint32_t> order;    // node indices, every parent ahead of its children
+        std::vector<int32_t> parents;   // parent of order[i], -1 for roots
+
+        // 'parentIndices' : parent of every node, -1 for roots. Nodes in a cycle are treated as roots.
+        void build(const int64_t* parentIndices, size_t nodeCount);
+        size_t node_count() const { return order.size(); }
+    };
+
+    // New nodes get the identity transform.
+    void resize(size_t nodeCount);
+    size_t node_count() const { return nodeCount; }
+
+    float* stream(Stream stream) { return streams.data() + stream * paddedCount; }
+    const float* stream(Stream stream) const { return streams.data() + stream * paddedCount; }
+
+    void set_local(size_t nodeIndex, const DirectX::XMFLOAT3& scaling, const DirectX::XMFLOAT4& rotation,
+        const DirectX::XMFLOAT3& translation);
+    void get_local(size_t nodeIndex, DirectX::XMFLOAT3& scaling, DirectX::XMFLOAT4& rotation,
+        DirectX::XMFLOAT3& translation) const;
+
+    // Rebuilds global_transforms from the local streams. 'hierarchy' must have node_count nodes.
+    // 'allowAvx' = false forces the 4 wide SSE path (benchmarks).
+    void update(const Hierarchy& hierarchy, bool allowAvx = true);
+
+    // Model-space matrix of every node, valid after update.
+    const DirectX::XMFLOAT4X4A* global_transforms() const { return globalTransforms.data(); }
+    const DirectX::XMFLOAT4X4A& global_transform(size_t nodeIndex) const { return globalTransforms[nodeIndex]; }
+
+    static bool avx_supported();
+
+private:
+    size_t nodeCount = 0;
+    size_t paddedCount = 0;
+    std::vector<float> streams;
+    std::vector<DirectX::XMFLOAT4X4A> globalTransforms;
+};
@@ -0,0 +1,127 @@
+#include "render_queue.h"
+#include "misc.h"
+
+#include <algorithm>
+#include <cstring>
+
+uint64_t RenderQueue::make_key(uint32_t pass, uint32_t shader, uint32_t material, uint32_t texture, float depth) {
+    const uint64_t depthBits = static_cast<uint64_t>(std::min<float>(std::max<float>(depth, 0), 1) * ((1 << DEPTH_BITS) - 1) + 0.5f);
+    uint64_t key = pass & ((1u << PASS_BITS) - 1);
+    key = (key << SHADER_BITS) | (shader & ((1u << SHADER_BITS) - 1));
+    key = (key << MATERIAL_BITS) | (material & ((1u << MATERIAL_BITS) - 1));
+    key = (key << TEXTURE_BITS) | (texture & ((1u << TEXTURE_BITS) - 1));
+    key = (key << DEPTH_BITS) | depthBits;
+    return key;
+}
+
+uint32_t RenderQueue::id(const void* object) {
+    // 0 is kept for null so that unset fields sort first
+    if (!object) {
+        return 0;
+    }
+    std::unordered_map<const void*, uint32_t>::const_iterator found = ids.find(object);
+    if (found != ids.end()) {
+        return found->second;
+    }
+    const uint32_t newId = static_cast<uint32_t>(ids.size()) + 1;
+    ids.emplace(object, newId);
+    return newId;
+}
+
+uint32_t RenderQueue::push_constants(ID3D11Buffer* buffer, UINT slot, const void* data, size_t size) {
+    _ASSERT_EXPR(slot < StateTracker::CONSTANT_BUFFER_SLOTS, L"Constant buffer slot out of range");
+    ConstantBlock block = { buffer, slot, constantBytes.size(), size };
+    constantBytes.resize(constantBytes.size() + size);
+    memcpy(constantBytes.data() + block.offset, data, size);
+    constantBlocks.push_back(block);
+    return static_cast<uint32_t>(constantBlocks.size() - 1);
+}
+
+void RenderQueue::sort() {
+    sortEntries.resize(packets.size());
+    for (size_t packetIndex = 0; packetIndex < packets.size(); ++packetIndex) {
+        sortEntries.at(packetIndex) = { packets.at(packetIndex).key, static_cast<uint32_t>(packetIndex) };
+    }
+    sortScratch.resize(sortEntries.size());
+
+    // LSD radix sort, a byte per pass. Stable, so equal keys keep their push order. Bytes every key shares
+    // (most of the pass and shader bits in a typical frame) are skipped.
+    uint64_t differingBits = 0;
+    for (const SortEntry& entry : sortEntries) {
+        differingBits |= entry.key ^ sortEntries.front().key;
+    }
+    for (int shift = 0; shift < 64; shift += 8) {
+        if (((differingBits >> shift) & 0xff) == 0) {
+            continue;
+        }
+        size_t offsets[256] = {};
+        for (const SortEntry& entry : sortEntries) {
+            ++offsets[(entry.key >> shift) & 0xff];
+        }
+        size_t sum = 0;
+        for (size_t& offset : offsets) {
+            const size_t count = offset;
+            offset = sum;
+            sum += count;
+        }
+        for (const SortEntry& entry : sortEntries) {
+            sortScratch[offsets[(entry.key >> shift) & 0xff]++] = entry;
+        }
+        sortEntries.swap(sortScratch);
+    }
+}
+
+void RenderQueue::submit(StateTracker& stateTracker) {
+    if (packets.empty()) {
+        clear();
+        return;
+    }
+    sort();
+
+    // Last block uploaded to each slot during this submit. Blocks go to VS and PS alike, so the slot is the key for
+    // both stages : whichever buffer the block came from, the slot holds its bytes.
+    std::fill(std::begin(slotBlocks), std::end(slotBlocks), NO_CONSTANTS);
+    auto upload = [&](uint32_t blockIndex) {
+        const ConstantBlock& block = constantBlocks.at(blockIndex);
+        uint32_t& uploaded = slotBlocks[block.slot];
+        if (uploaded != NO_CONSTANTS) {
+            const ConstantBlock& previous = constantBlocks.at(uploaded);
+            if (uploaded == blockIndex || (previous.size == block.size &&
+                memcmp(constantBytes.data() + previous.offset, constantBytes.data() + block.offset, block.size) == 0)) {
+                stateTracker.skip_constants();
+                return;
+            }
+        }
+        uploaded = blockIndex;
+        stateTracker.upload_constants(block.slot, block.buffer, constantBytes.data() + block.offset, block.size);
+    };
+
+    for (const SortEntry& entry : sortEntries) {
+        const DrawPacket& packet = packets.at(entry.packet);
+        stateTracker.set_vertex_shader(packet.vertexShader);
+        stateTracker.set_pixel_shader(packet.pixelShader);
+        stateTracker.set_input_layout(packet.inputLayout);
+        stateTracker.set_primitive_topology(packet.topology);
+        stateTracker.set_blend_state(packet.blendState);
+        stateTracker.set_depth_stencil_state(packet.depthStencilState);
+        stateTracker.set_rasterizer_state(packet.rasterizerState);
+        stateTracker.set_sampler(0, packet.samplerState);
+        stateTracker.set_ps_shader_resource(0, packet.shaderResourceView);
+        stateTracker.set_vertex_buffer(packet.vertexBuffer, packet.vertexStride);
+        stateTracker.set_index_buffer(packet.indexBuffer);
+        for (uint32_t blockIndex : packet.constants) {
+            if (blockIndex == NO_CONSTANTS) {
+                continue;
+            }
+            upload(blockIndex);
+        }
+        stateTracker.draw_indexed(packet.indexCount, packet.startIndexLocation, packet.baseVertexLocation);
+    }
+    clear();
+}
+
+void RenderQueue::clear() {
+    packets.clear();
+    constantBlocks.clear();
+    constantBytes.clear();
+}
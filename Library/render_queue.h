@@ -0,0 +1,94 @@
+#pragma once
+
+#include <d3d11.h>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+#include "state_tracker.h"
+
+// Draws collected over a pass and submitted in sort key order, so that draws sharing a shader, a material and
+// a texture end up next to each other and the StateTracker drops the binds they have in common.
+//
+// Keys are 64 bits, most significant first :
+//   pass (4) | shader (12) | material (16) | texture (16) | depth (16)
+// Shader/material/texture ids come from id(), depth is 0 (near) to 1 (far); pass 1 - depth to draw back to front.
+// Packets carry their constants as blocks pushed with push_constants; consecutive packets that share a block,
+// or whose block holds the same bytes as the slot's last upload, don't upload it again. The uploads go
+// through StateTracker::upload_constants, so they are constant ring slices when the context has a ring.
+class RenderQueue {
+public:
+    static const uint32_t PASS_BITS = 4;
+    static const uint32_t SHADER_BITS = 12;
+    static const uint32_t MATERIAL_BITS = 16;
+    static const uint32_t TEXTURE_BITS = 16;
+    static const uint32_t DEPTH_BITS = 16;
+    static uint64_t make_key(uint32_t pass, uint32_t shader, uint32_t material, uint32_t texture, float depth);
+
+    static const uint32_t NO_CONSTANTS = ~0u;
+    static const int MAX_PACKET_CONSTANTS = 2;
+
+    // Everything a draw binds. Null states and views are bound as null (D3D11 defaults / unbound).
+    struct DrawPacket {
+        uint64_t key = 0;
+        ID3D11VertexShader* vertexShader = nullptr;
+        ID3D11PixelShader* pixelShader = nullptr;
+        ID3D11InputLayout* inputLayout = nullptr;
+        D3D11_PRIMITIVE_TOPOLOGY topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+        ID3D11BlendState* blendState = nullptr;
+        ID3D11DepthStencilState* depthStencilState = nullptr;
+        ID3D11RasterizerState* rasterizerState = nullptr;
+        ID3D11SamplerState* samplerState = nullptr;             // PS slot 0
+        ID3D11ShaderResourceView* shaderResourceView = nullptr; // PS slot 0
+        ID3D11Buffer* vertexBuffer = nullptr;
+        UINT vertexStride = 0;
+        ID3D11Buffer* indexBuffer = nullptr;                    // R32_UINT
+        uint32_t constants[MAX_PACKET_CONSTANTS] = { NO_CONSTANTS, NO_CONSTANTS };
+        UINT indexCount = 0;
+        UINT startIndexLocation = 0;
+        INT baseVertexLocation = 0;
+    };
+
+    RenderQueue() = default;
+    virtual ~RenderQueue() = default;
+
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    // Small id of 'object' for a key field, stable for the queue's lifetime. Wraps past the field's width, which
+    // only lets unrelated objects share a group.
+    uint32_t id(const void* object);
+
+    // Copies 'size' bytes for 'buffer', bound to VS and PS slot 'slot'. 'size' must be the buffer's ByteWidth.
+    uint32_t push_constants(ID3D11Buffer* buffer, UINT slot, const void* data, size_t size);
+    void push(const DrawPacket& packet) { packets.push_back(packet); }
+    size_t packet_count() const { return packets.size(); }
+
+    // Sorts the packets (radix sort on the keys), draws them through 'stateTracker' and empties the queue.
+    // Draws with equal keys keep their push order.
+    void submit(StateTracker& stateTracker);
+    void clear();
+
+private:
+    struct ConstantBlock {
+        ID3D11Buffer* buffer;
+        UINT slot;
+        size_t offset;
+        size_t size;
+    };
+    std::vector<DrawPacket> packets;
+    std::vector<ConstantBlock> constantBlocks;
+    std::vector<uint8_t> constantBytes;
+    uint32_t slotBlocks[StateTracker::CONSTANT_BUFFER_SLOTS];   // submit's last upload per slot
+
+    std::unordered_map<const void*, uint32_t> ids;
+
+    // Sort scratch, kept to avoid allocating every frame
+    struct SortEntry {
+        uint64_t key;
+        uint32_t packet;
+    };
+    std::vector<SortEntry> sortEntries;
+    std::vector<SortEntry> sortScratch;
+    void sort();
+};
@@ -2,7 +2,7 @@
 #include "misc.h"
 #include <sstream>
 
-// VF[_[t@C̃[hW[
+// シェーダーファイルのロードをモジュール化
 HRESULT create_vs_from_cso(ID3D11Device* device, const char* csoName, ID3D11VertexShader** vertexShader,
     ID3D11InputLayout** inputLayout, D3D11_INPUT_ELEMENT_DESC* inputElementDesc, UINT numElements) {
     FILE* fp = nullptr;
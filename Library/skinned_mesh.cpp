@@ -2,17 +2,26 @@
 #include "skinned_mesh.h"
 #include "shader.h"
 #include "texture.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "vertex_compression.h"
+#include "constant_ring.h"
 #include <sstream>
+#include <iomanip>
+#include <cfloat>
 #include <fstream>
 #include <functional>
 #include <filesystem>
+#include <type_traits>
+#include <algorithm>
+#include <atomic>
 using namespace DirectX;
 
 XMFLOAT4X4 to_xmfloat4x4(const FbxAMatrix& fbxamatrix);
 XMFLOAT3 to_xmfloat3(const FbxDouble3& fbxdouble3);
 XMFLOAT4 to_xmfloat4(const FbxDouble4& fbxdouble4);
 
-struct BoneInfluence { // ̉ex
+struct BoneInfluence { // 骨の影響度
     uint32_t boneIndex;
     float boneWeight;
 };
@@ -49,76 +58,342 @@ void fetch_bone_influences(const FbxMesh* fbxMesh,
 }
 
 
-SkinnedMesh::SkinnedMesh(ID3D11Device* device, const char* fbxFilename, bool triangulate,float samplingRate) {
+SkinnedMesh::SkinnedMesh(ID3D11Device* device, const char* fbxFilename, bool triangulate,float samplingRate,
+    bool compressVertices, bool retainCpuVertices) : retainCpuVertices(retainCpuVertices) {
+    const bool loaded = load(fbxFilename, triangulate, samplingRate, compressVertices);
+    _ASSERT_EXPR_A(loaded, "FBX import failed");
+
+    create_com_objects(device, fbxFilename);
+}
+
+bool SkinnedMesh::load(const char* fbxFilename, bool triangulate, float samplingRate, bool compressVertices) {
+    std::filesystem::path cookedFilename(fbxFilename);
+    cookedFilename.replace_extension("cooked");
     std::filesystem::path cerealFilename(fbxFilename);
     cerealFilename.replace_extension("cereal");
-    if (std::filesystem::exists(cerealFilename.c_str())) {
-        std::ifstream ifs(cerealFilename.c_str(),std::ios::binary);
-        cereal::BinaryInputArchive deserialization(ifs);
-        deserialization(sceneView, meshes, materials, animationClips);
+
+    const cooked::SourceKey sourceKey = source_key(fbxFilename, triangulate, samplingRate, compressVertices);
+
+    // The mapping stays open with the model : create_com_objects uploads vertices/indices straight from it and
+    // the animation clips sample their keys from it.
+    cooked::Reader cookedReader;
+    if (cookedFile.open(cookedFilename.c_str()) && cookedReader.open(cookedFile) &&
+        cookedReader.up_to_date(sourceKey, cookedFilename.parent_path()) &&
+        read_cooked(cookedReader, sceneView, meshes, materials, animationClips)) {
+        // Loaded from the cooked cache
+        update_lod_metrics();
+        precompute_skinning();
+        build_pose_hierarchy();
+        build_palette(static_cast<const Animation::Keyframe*>(nullptr), bindPosePalette);
+        return true;
     }
-    else {
 
-        FbxManager* fbxManager = FbxManager::Create();
-        FbxScene* fbxScene = FbxScene::Create(fbxManager, "");
+    if (cookedFile.is_open()) {
+        std::stringstream message;
+        message << "SkinnedMesh : " << cookedFilename.string() << " is stale, re-importing\n";
+        OutputDebugStringA(message.str().c_str());
+        cookedFile.close();
+    }
+    sceneView = {};
+    meshes.clear();
+    materials.clear();
+    animationClips.clear();
+
+    if (!read_cereal(cerealFilename, sourceKey, sceneView, meshes, materials, animationClips)) {
+        sceneView = {};
+        meshes.clear();
+        materials.clear();
+        animationClips.clear();
+
+        if (!import_fbx(fbxFilename, triangulate, samplingRate)) {
+            return false;
+        }
 
-        FbxImporter* fbxImporter = FbxImporter::Create(fbxManager, "");
-        bool importStatus = false;
-        importStatus = fbxImporter->Initialize(fbxFilename);
-        _ASSERT_EXPR_A(importStatus, fbxImporter->GetStatus().GetErrorString());
+        std::ofstream ofs(cerealFilename.c_str(), std::ios::binary);
+        cereal::BinaryOutputArchive serialization(ofs);
+        serialization(cooked::VERSION, sourceKey.hash, sourceKey.flags, sourceKey.samplingRate,
+            sceneView, meshes, materials, animationClips);
+    }
+    // The cereal cache keeps the float vertices, the cooked file only the compressed ones.
+    if (compressVertices) {
+        for (Mesh& mesh : meshes) {
+            compress_vertices(mesh);
+        }
+    }
+    save_cooked(cookedFilename.c_str(), sourceKey);
+    update_lod_metrics();
+    precompute_skinning();
+    build_pose_hierarchy();
+    build_palette(static_cast<const Animation::Keyframe*>(nullptr), bindPosePalette);
+    return true;
+}
 
-        importStatus = fbxImporter->Import(fbxScene);
-        _ASSERT_EXPR_A(importStatus, fbxImporter->GetStatus().GetErrorString());
-
-        FbxGeometryConverter fbxConverter = fbxManager;
-        if (triangulate) {
-            fbxConverter.Triangulate(fbxScene, true/*replace*/, false/*legacy*/);
-            fbxConverter.RemoveBadPolygonsFromMeshes(fbxScene);
-        }
-
-        std::function<void(FbxNode*)> traverse = [&](FbxNode* fbxNode) {
-            Scene::Node& node = sceneView.nodes.emplace_back();
-            node.attribute = fbxNode->GetNodeAttribute() ?
-                fbxNode->GetNodeAttribute()->GetAttributeType() : FbxNodeAttribute::EType::eUnknown;
-            node.name = fbxNode->GetName();
-            node.uniqueId = fbxNode->GetUniqueID();
-            node.parentIndex = sceneView.indexof(fbxNode->GetParent() ?
-                fbxNode->GetParent()->GetUniqueID() : 0);
-            for (int childIndex = 0; childIndex < fbxNode->GetChildCount(); ++childIndex) {
-                traverse(fbxNode->GetChild(childIndex));
+void SkinnedMesh::update_lod_metrics() {
+    // Bounding boxes are in mesh space : take their corners to model space first
+    XMVECTOR minimum = XMVectorReplicate(+D3D11_FLOAT32_MAX);
+    XMVECTOR maximum = XMVectorReplicate(-D3D11_FLOAT32_MAX);
+    size_t levelCount = 0;
+    for (const Mesh& mesh : meshes) {
+        if (mesh.boundingBox[0].x > mesh.boundingBox[1].x) {
+            continue; // no vertices
+        }
+        const XMMATRIX transform = XMLoadFloat4x4(&mesh.defaultGlobalTransform);
+        for (int corner = 0; corner < 8; ++corner) {
+            const XMFLOAT3 point(mesh.boundingBox[corner & 1].x, mesh.boundingBox[(corner >> 1) & 1].y, mesh.boundingBox[(corner >> 2) & 1].z);
+            const XMVECTOR transformed = XMVector3TransformCoord(XMLoadFloat3(&point), transform);
+            minimum = XMVectorMin(minimum, transformed);
+            maximum = XMVectorMax(maximum, transformed);
+        }
+        levelCount = std::max<size_t>(levelCount, mesh.lod_count());
+    }
+    if (levelCount == 0) {
+        boundingBoxMin = { 0,0,0 };
+        boundingBoxMax = { 0,0,0 };
+        boundingSphereCenter = { 0,0,0 };
+        boundingSphereRadius = 0;
+        lodErrors.assign(1, 0.0f);
+        return;
+    }
+    XMStoreFloat3(&boundingBoxMin, minimum);
+    XMStoreFloat3(&boundingBoxMax, maximum);
+    XMStoreFloat3(&boundingSphereCenter, (minimum + maximum) * 0.5f);
+    boundingSphereRadius = XMVectorGetX(XMVector3Length(maximum - minimum)) * 0.5f;
+
+    // A mesh past its last level keeps drawing its coarsest one, whose error then counts for the later levels too
+    lodErrors.assign(levelCount, 0.0f);
+    for (const Mesh& mesh : meshes) {
+        const XMMATRIX transform = XMLoadFloat4x4(&mesh.defaultGlobalTransform);
+        const float scale = std::max<float>({ XMVectorGetX(XMVector3Length(transform.r[0])),
+            XMVectorGetX(XMVector3Length(transform.r[1])), XMVectorGetX(XMVector3Length(transform.r[2])) });
+        for (size_t lod = 1; lod < levelCount; ++lod) {
+            if (!mesh.lods.empty()) {
+                const float error = mesh.lods.at(std::min<size_t>(lod, mesh.lods.size()) - 1).error * scale;
+                lodErrors.at(lod) = std::max<float>(lodErrors.at(lod), error);
             }
-        };
-        traverse(fbxScene->GetRootNode());
+        }
+    }
+}
 
-#if 0
-        for (const Scene::Node& node : sceneView.nodes) {
-            FbxNode* fbxNode = fbxScene->FindNodeByName(node.name.c_str());
-            // Display node data in the output window as debug
-            std::string nodeName = fbxNode->GetName();
-            uint64_t uid = fbxNode->GetUniqueID();
-            uint64_t parentUid = fbxNode->GetParent() ? fbxNode->GetParent()->GetUniqueID() : 0;
-            int32_t type = fbxNode->GetNodeAttribute() ? fbxNode->GetNodeAttribute()->GetAttributeType() : 0;
-
-            std::stringstream debugString;
-            debugString << nodeName << ":" << uid << ":" << parentUid << ":" << type << "\n";
-            OutputDebugStringA(debugString.str().c_str());
+void SkinnedMesh::precompute_skinning() {
+    for (Mesh& mesh : meshes) {
+        XMStoreFloat4x4(&mesh.inverseDefaultGlobalTransform, XMMatrixInverse(nullptr, XMLoadFloat4x4(&mesh.defaultGlobalTransform)));
+    }
+}
+
+float SkinnedMesh::projected_size(const XMFLOAT4X4& world, const XMFLOAT4X4& view, const XMFLOAT4X4& projection,
+    float viewportHeight) const {
+    const XMMATRIX W = XMLoadFloat4x4(&world);
+    const XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&boundingSphereCenter), W * XMLoadFloat4x4(&view));
+    const float radius = boundingSphereRadius * std::max<float>({ XMVectorGetX(XMVector3Length(W.r[0])),
+        XMVectorGetX(XMVector3Length(W.r[1])), XMVectorGetX(XMVector3Length(W.r[2])) });
+    const float depth = XMVectorGetZ(center);
+    if (depth <= radius) {
+        return FLT_MAX;
+    }
+    // _22 : cot(fovY / 2), the projected height of one unit at depth 1 over half the viewport
+    return radius * projection._22 / depth * viewportHeight;
+}
+
+void SkinnedMesh::bounding_sphere(const XMFLOAT4X4& world, XMFLOAT3& center, float& radius) const {
+    const XMMATRIX W = XMLoadFloat4x4(&world);
+    XMStoreFloat3(&center, XMVector3TransformCoord(XMLoadFloat3(&boundingSphereCenter), W));
+    radius = boundingSphereRadius * std::max<float>({ XMVectorGetX(XMVector3Length(W.r[0])),
+        XMVectorGetX(XMVector3Length(W.r[1])), XMVectorGetX(XMVector3Length(W.r[2])) });
+}
+
+size_t SkinnedMesh::select_lod(float projectedSize, size_t currentLod, float maxPixelError, float hysteresis) const {
+    if (boundingSphereRadius <= 0) {
+        return 0;
+    }
+    const float pixelsPerUnit = projectedSize / (boundingSphereRadius * 2);
+    for (size_t lod = lodErrors.size() - 1; lod > 0; --lod) {
+        const float threshold = lod > currentLod ? maxPixelError * (1 - hysteresis) : maxPixelError;
+        if (lodErrors.at(lod) * pixelsPerUnit <= threshold) {
+            return lod;
         }
-#endif
+    }
+    return 0;
+}
+
+AsyncHandle<SkinnedMesh> SkinnedMesh::load_async(AsyncLoader& loader, ID3D11Device* device, const char* fbxFilename,
+    bool triangulate, float samplingRate, bool compressVertices, bool retainCpuVertices) {
+    const std::string filename(fbxFilename);
+    return loader.load<SkinnedMesh>([device, filename, triangulate, samplingRate, compressVertices, retainCpuVertices](AsyncLoader::FinalizeSteps& finalizeSteps) {
+        std::shared_ptr<SkinnedMesh> skinnedMesh(new SkinnedMesh());
+        skinnedMesh->retainCpuVertices = retainCpuVertices;
+        if (!skinnedMesh->load(filename.c_str(), triangulate, samplingRate, compressVertices)) {
+            return std::shared_ptr<SkinnedMesh>();
+        }
+
+        // One step per buffer pair / material, so a large model is spread over several frames.
+        for (size_t meshIndex = 0; meshIndex < skinnedMesh->meshes.size(); ++meshIndex) {
+            finalizeSteps.push_back([device, skinnedMesh, meshIndex]() {
+                skinnedMesh->create_mesh_buffers(device, skinnedMesh->meshes.at(meshIndex));
+            });
+        }
+        for (const std::pair<const uint64_t, Material>& pair : skinnedMesh->materials) {
+            const uint64_t materialUniqueId = pair.first;
+            finalizeSteps.push_back([device, skinnedMesh, filename, materialUniqueId]() {
+                skinnedMesh->create_material_views(device, filename.c_str(), skinnedMesh->materials.at(materialUniqueId));
+            });
+        }
+        finalizeSteps.push_back([device, skinnedMesh]() {
+            skinnedMesh->create_shaders(device);
+        });
+        return skinnedMesh;
+    });
+}
+
+cooked::SourceKey SkinnedMesh::source_key(const char* fbxFilename, bool triangulate, float samplingRate, bool compressVertices) {
+    cooked::SourceKey sourceKey;
+    sourceKey.hash = cooked::hash_file(std::filesystem::path(fbxFilename).c_str());
+    sourceKey.flags = (triangulate ? 1 : 0) | (compressVertices ? 2 : 0) |
+        (mesh_optimizer::VERSION << 8) | (mesh_simplifier::VERSION << 16); // caches from an older optimizer are rebuilt
+    sourceKey.samplingRate = samplingRate;
+    return sourceKey;
+}
+
+cooked::CookResult SkinnedMesh::cook(const char* fbxFilename, bool triangulate, float samplingRate,
+    bool compressVertices, bool force) {
+    std::filesystem::path cookedFilename(fbxFilename);
+    cookedFilename.replace_extension("cooked");
+
+    const cooked::SourceKey sourceKey = source_key(fbxFilename, triangulate, samplingRate, compressVertices);
+    if (sourceKey.hash == 0) {
+        return cooked::CookResult::FAILED;
+    }
+    if (!force && cooked::is_up_to_date(cookedFilename.c_str(), sourceKey, cookedFilename.parent_path())) {
+        return cooked::CookResult::UP_TO_DATE;
+    }
+
+    SkinnedMesh skinnedMesh;
+    if (!skinnedMesh.import_fbx(fbxFilename, triangulate, samplingRate)) {
+        return cooked::CookResult::FAILED;
+    }
+    if (compressVertices) {
+        for (Mesh& mesh : skinnedMesh.meshes) {
+            compress_vertices(mesh);
+        }
+    }
+    return skinnedMesh.save_cooked(cookedFilename.c_str(), sourceKey) ?
+        cooked::CookResult::COOKED : cooked::CookResult::FAILED;
+}
 
-        fetch_meshes(fbxScene, meshes);
+std::filesystem::path SkinnedMesh::baked_filename(const char* fbxFilename) {
+    std::filesystem::path bakedFilename(fbxFilename);
+    bakedFilename.replace_extension("baked");
+    return bakedFilename;
+}
 
-        fetch_materials(fbxScene, materials);
+cooked::CookResult SkinnedMesh::cook_baked_animations(const char* fbxFilename, bool triangulate, float samplingRate,
+    bool compressVertices, float framesPerSecond, bool force) {
+    const cooked::SourceKey sourceKey = source_key(fbxFilename, triangulate, samplingRate, compressVertices);
+    if (sourceKey.hash == 0) {
+        return cooked::CookResult::FAILED;
+    }
+    const std::filesystem::path bakedFilename = baked_filename(fbxFilename);
+    BakedAnimation baked;
+    if (!force && baked.load(bakedFilename, sourceKey, framesPerSecond)) {
+        return cooked::CookResult::UP_TO_DATE;
+    }
 
-        fetch_animations(fbxScene, animationClips, samplingRate);
+    // Through the cooked file when there is one, so the FBX is only imported once
+    SkinnedMesh skinnedMesh;
+    if (!skinnedMesh.load(fbxFilename, triangulate, samplingRate, compressVertices)) {
+        return cooked::CookResult::FAILED;
+    }
+    skinnedMesh.bake_animations(baked, framesPerSecond);
+    return baked.save(bakedFilename, sourceKey) ? cooked::CookResult::COOKED : cooked::CookResult::FAILED;
+}
 
+bool SkinnedMesh::read_cereal(const std::filesystem::path& cerealFilename, const cooked::SourceKey& sourceKey,
+    Scene& sceneView, std::vector<Mesh>& meshes, std::unordered_map<uint64_t, Material>& materials,
+    std::vector<Animation>& animationClips) {
+    std::ifstream ifs(cerealFilename.c_str(), std::ios::binary);
+    if (!ifs) {
+        return false;
+    }
+    try {
+        // The archive starts with the format version and the key it was imported with;
+        // anything else is a stale or older cache.
+        uint32_t version = 0;
+        cooked::SourceKey archivedKey;
+        cereal::BinaryInputArchive deserialization(ifs);
+        deserialization(version, archivedKey.hash, archivedKey.flags, archivedKey.samplingRate);
+        if (version != cooked::VERSION || (sourceKey.hash != 0 && archivedKey.hash != sourceKey.hash) ||
+            archivedKey.flags != sourceKey.flags || archivedKey.samplingRate != sourceKey.samplingRate) {
+            return false;
+        }
+        deserialization(sceneView, meshes, materials, animationClips);
+    }
+    catch (const cereal::Exception&) {
+        return false;
+    }
+    return true;
+}
+
+bool SkinnedMesh::import_fbx(const char* fbxFilename, bool triangulate, float samplingRate) {
+    // Each call owns its FbxManager, so separate SkinnedMesh instances can import on separate threads.
+    FbxManager* fbxManager = FbxManager::Create();
+    FbxScene* fbxScene = FbxScene::Create(fbxManager, "");
+
+    FbxImporter* fbxImporter = FbxImporter::Create(fbxManager, "");
+    bool importStatus = false;
+    importStatus = fbxImporter->Initialize(fbxFilename);
+    if (importStatus) {
+        importStatus = fbxImporter->Import(fbxScene);
+    }
+    if (!importStatus) {
+        std::stringstream message;
+        message << "SkinnedMesh : " << fbxFilename << " : " << fbxImporter->GetStatus().GetErrorString() << "\n";
+        OutputDebugStringA(message.str().c_str());
         fbxManager->Destroy();
+        return false;
+    }
 
-        std::ofstream ofs(cerealFilename.c_str(), std::ios::binary);
-        cereal::BinaryOutputArchive serialization(ofs);
-        serialization(sceneView, meshes, materials, animationClips);
+    FbxGeometryConverter fbxConverter = fbxManager;
+    if (triangulate) {
+        fbxConverter.Triangulate(fbxScene, true/*replace*/, false/*legacy*/);
+        fbxConverter.RemoveBadPolygonsFromMeshes(fbxScene);
     }
 
-    create_com_objects(device, fbxFilename);
+    std::function<void(FbxNode*)> traverse = [&](FbxNode* fbxNode) {
+        Scene::Node& node = sceneView.nodes.emplace_back();
+        node.attribute = fbxNode->GetNodeAttribute() ?
+            fbxNode->GetNodeAttribute()->GetAttributeType() : FbxNodeAttribute::EType::eUnknown;
+        node.name = fbxNode->GetName();
+        node.uniqueId = fbxNode->GetUniqueID();
+        node.parentIndex = sceneView.indexof(fbxNode->GetParent() ?
+            fbxNode->GetParent()->GetUniqueID() : 0);
+        for (int childIndex = 0; childIndex < fbxNode->GetChildCount(); ++childIndex) {
+            traverse(fbxNode->GetChild(childIndex));
+        }
+    };
+    traverse(fbxScene->GetRootNode());
+
+#if 0
+    for (const Scene::Node& node : sceneView.nodes) {
+        FbxNode* fbxNode = fbxScene->FindNodeByName(node.name.c_str());
+        // Display node data in the output window as debug
+        std::string nodeName = fbxNode->GetName();
+        uint64_t uid = fbxNode->GetUniqueID();
+        uint64_t parentUid = fbxNode->GetParent() ? fbxNode->GetParent()->GetUniqueID() : 0;
+        int32_t type = fbxNode->GetNodeAttribute() ? fbxNode->GetNodeAttribute()->GetAttributeType() : 0;
+
+        std::stringstream debugString;
+        debugString << nodeName << ":" << uid << ":" << parentUid << ":" << type << "\n";
+        OutputDebugStringA(debugString.str().c_str());
+    }
+#endif
+
+    fetch_meshes(fbxScene, meshes);
+
+    fetch_materials(fbxScene, materials);
+
+    fetch_animations(fbxScene, animationClips, samplingRate);
+
+    fbxManager->Destroy();
+    return true;
 }
 
 void SkinnedMesh::fetch_meshes(FbxScene* fbxScene, std::vector<Mesh>& meshes) {
@@ -130,7 +405,7 @@ void SkinnedMesh::fetch_meshes(FbxScene* fbxScene, std::vector<Mesh>& meshes) {
         FbxNode* fbxNode = fbxScene->FindNodeByName(node.name.c_str());
         FbxMesh* fbxMesh = fbxNode->GetMesh();
 
-        Mesh& mesh = meshes.emplace_back(); // C++17emplace_back̖߂lvoidȂ\zvfւ̎QƂɂȂĂ邽߂̋Lqł
+        Mesh& mesh = meshes.emplace_back(); // C++17からemplace_backの戻り値がvoidじゃなく構築した要素への参照になっているためこの記述ができる
         mesh.uniqueId = fbxMesh->GetNode()->GetUniqueID();
         mesh.name = fbxMesh->GetNode()->GetName();
         mesh.nodeIndex = sceneView.indexof(mesh.uniqueId);
@@ -190,9 +465,9 @@ void SkinnedMesh::fetch_meshes(FbxScene* fbxScene, std::vector<Mesh>& meshes) {
                         vertex.boneWeights[influenceIndex] = influencesPerControlPoint.at(influenceIndex).boneWeight;
                         vertex.boneIndices[influenceIndex] = influencesPerControlPoint.at(influenceIndex).boneIndex;
                     }
-                    // UNIT22̉P͂ł̂H
+                    // UNIT22の改善策はこれでいいのか？
                     else { 
-                        // exł̂TA폜
+                        // 影響度が最も小さいものを探し、削除
                         size_t minWeightIndex = 0;
                         float minWeight = vertex.boneWeights[0];
 
@@ -203,7 +478,7 @@ void SkinnedMesh::fetch_meshes(FbxScene* fbxScene, std::vector<Mesh>& meshes) {
                             }
                         }
 
-                        // ex팸
+                        // 影響度を削減
                         vertex.boneWeights[minWeightIndex] = influencesPerControlPoint.at(influenceIndex).boneWeight;
                         vertex.boneIndices[minWeightIndex] = influencesPerControlPoint.at(influenceIndex).boneIndex;
                     }
@@ -225,7 +500,7 @@ void SkinnedMesh::fetch_meshes(FbxScene* fbxScene, std::vector<Mesh>& meshes) {
                     vertex.texcoord.y = 1.0f - static_cast<float>(uv[1]);
                 }
                 if (fbxMesh->GenerateTangentsData(0, false)) {
-                    const FbxGeometryElementTangent* tangent = fbxMesh->GetElementTangent(0); // Tangent͕ʂɉsȃxNg Tangent͓ςƂɎg
+                    const FbxGeometryElementTangent* tangent = fbxMesh->GetElementTangent(0); // Tangentは平面に沿った平行なベクトル Tangentは内積するときに使う
                     vertex.tangent.x = static_cast<float>(tangent->GetDirectArray().GetAt(vertexIndex)[0]);
                     vertex.tangent.y = static_cast<float>(tangent->GetDirectArray().GetAt(vertexIndex)[1]);
                     vertex.tangent.z = static_cast<float>(tangent->GetDirectArray().GetAt(vertexIndex)[2]);
@@ -233,21 +508,160 @@ void SkinnedMesh::fetch_meshes(FbxScene* fbxScene, std::vector<Mesh>& meshes) {
                 }
 
                 mesh.vertices.at(vertexIndex) = std::move(vertex);
-                for (const Vertex& v : mesh.vertices) {
-                    mesh.boundingBox[0].x = std::min<float>(mesh.boundingBox[0].x, v.position.x);
-                    mesh.boundingBox[0].x = std::min<float>(mesh.boundingBox[0].y, v.position.y);
-                    mesh.boundingBox[0].x = std::min<float>(mesh.boundingBox[0].z, v.position.z);
-                    mesh.boundingBox[1].x = std::max<float>(mesh.boundingBox[1].x, v.position.x);
-                    mesh.boundingBox[1].x = std::max<float>(mesh.boundingBox[1].y, v.position.y);
-                    mesh.boundingBox[1].x = std::max<float>(mesh.boundingBox[1].z, v.position.z);
-                }
-
 
-                mesh.indices.at(static_cast<size_t>(offset) + positionInPolygon) = vertexIndex; // CfbNXobt@[̓̈ʒuɒ_CfbNXݒ
+                mesh.indices.at(static_cast<size_t>(offset) + positionInPolygon) = vertexIndex; // インデックスバッファーの特定の位置に頂点インデックスを設定
                 subset.indexCount++;
             }
         }
+
+        optimize_mesh(mesh);
+
+        for (const Vertex& v : mesh.vertices) {
+            mesh.boundingBox[0].x = std::min<float>(mesh.boundingBox[0].x, v.position.x);
+            mesh.boundingBox[0].y = std::min<float>(mesh.boundingBox[0].y, v.position.y);
+            mesh.boundingBox[0].z = std::min<float>(mesh.boundingBox[0].z, v.position.z);
+            mesh.boundingBox[1].x = std::max<float>(mesh.boundingBox[1].x, v.position.x);
+            mesh.boundingBox[1].y = std::max<float>(mesh.boundingBox[1].y, v.position.y);
+            mesh.boundingBox[1].z = std::max<float>(mesh.boundingBox[1].z, v.position.z);
+        }
+    }
+}
+
+// fetch_meshes writes one vertex per polygon corner. Welds the identical ones, reorders every subset's
+// triangles for the post-transform cache and the vertices for fetch, and reports the cache statistics.
+void SkinnedMesh::optimize_mesh(Mesh& mesh) {
+    static_assert(std::is_trivially_copyable<Vertex>::value, "mesh_optimizer moves vertices with memcpy");
+    std::vector<Vertex>& vertices = mesh.vertices;
+    std::vector<uint32_t>& indices = mesh.indices;
+
+    const size_t importedVertexCount = vertices.size();
+    const mesh_optimizer::CacheStatistics imported =
+        mesh_optimizer::analyze_vertex_cache(indices.data(), indices.size(), vertices.size());
+
+    size_t vertexCount = mesh_optimizer::weld_vertices(vertices.data(), vertices.size(), sizeof(Vertex),
+        indices.data(), indices.size());
+    const size_t lod0IndexCount = indices.size();
+    build_lods(mesh, vertexCount);
+    for (size_t lod = 0; lod < mesh.lod_count(); ++lod) {
+        for (const Mesh::Subset& subset : mesh.lod_subsets(lod)) {
+            mesh_optimizer::optimize_vertex_cache(indices.data() + subset.startIndexLocation, subset.indexCount, vertexCount);
+        }
+    }
+    // LOD 0 comes first in the index buffer, so the vertices stay in its order; coarser levels use a subset of them.
+    vertexCount = mesh_optimizer::optimize_vertex_fetch(vertices.data(), vertexCount, sizeof(Vertex),
+        indices.data(), indices.size());
+    vertices.resize(vertexCount);
+
+    const mesh_optimizer::CacheStatistics optimized =
+        mesh_optimizer::analyze_vertex_cache(indices.data(), lod0IndexCount, vertices.size());
+
+    std::stringstream message;
+    message << std::fixed << std::setprecision(3)
+        << "SkinnedMesh optimize : " << mesh.name << " : " << lod0IndexCount / 3 << " triangles, "
+        << mesh.subsets.size() << " subsets, vertices " << importedVertexCount << " -> " << vertices.size()
+        << ", ACMR " << imported.acmr << " -> " << optimized.acmr
+        << ", ATVR " << imported.atvr << " -> " << optimized.atvr << "\n";
+    for (size_t lod = 1; lod < mesh.lod_count(); ++lod) {
+        uint32_t lodIndexCount = 0;
+        for (const Mesh::Subset& subset : mesh.lod_subsets(lod)) {
+            lodIndexCount += subset.indexCount;
+        }
+        message << "    LOD " << lod << " : " << lodIndexCount / 3 << " triangles, error " << mesh.lods.at(lod - 1).error << "\n";
     }
+    OutputDebugStringA(message.str().c_str());
+}
+
+void SkinnedMesh::build_lods(Mesh& mesh, size_t vertexCount) {
+    mesh.lods.clear();
+    if (vertexCount == 0 || mesh.subsets.empty()) {
+        return;
+    }
+
+    // Skin weight boundaries : a vertex only collapses onto one with the same dominant bone
+    std::vector<uint32_t> dominantBones(vertexCount);
+    XMFLOAT3 minimum = mesh.vertices.at(0).position, maximum = minimum;
+    for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+        const Vertex& vertex = mesh.vertices.at(vertexIndex);
+        const int dominant = static_cast<int>(std::max_element(vertex.boneWeights, vertex.boneWeights + MAX_BONE_INFLUENCES) - vertex.boneWeights);
+        dominantBones.at(vertexIndex) = vertex.boneIndices[dominant];
+        XMStoreFloat3(&minimum, XMVectorMin(XMLoadFloat3(&minimum), XMLoadFloat3(&vertex.position)));
+        XMStoreFloat3(&maximum, XMVectorMax(XMLoadFloat3(&maximum), XMLoadFloat3(&vertex.position)));
+    }
+    const float maxError = MAX_LOD_ERROR * XMVectorGetX(XMVector3Length(XMLoadFloat3(&maximum) - XMLoadFloat3(&minimum)));
+
+    std::vector<uint32_t> simplified;
+    uint32_t previousIndexCount = static_cast<uint32_t>(mesh.indices.size());
+    float previousError = 0;
+    for (int lod = 1; lod < MAX_LODS; ++lod) {
+        // Subsets are simplified one at a time, which keeps the borders between materials in place
+        const std::vector<Mesh::Subset> previous = mesh.lod_subsets(lod - 1);
+        Mesh::Lod level;
+        level.error = previousError;
+        uint32_t lodIndexCount = 0;
+        for (const Mesh::Subset& source : previous) {
+            simplified.resize(source.indexCount);
+            float error = 0;
+            const size_t simplifiedCount = mesh_simplifier::simplify(simplified.data(),
+                mesh.indices.data() + source.startIndexLocation, source.indexCount,
+                &mesh.vertices.at(0).position, vertexCount, sizeof(Vertex), dominantBones.data(),
+                source.indexCount / 2, maxError - previousError, &error);
+
+            Mesh::Subset& subset = level.subsets.emplace_back(source);
+            subset.startIndexLocation = static_cast<uint32_t>(mesh.indices.size());
+            subset.indexCount = static_cast<uint32_t>(simplifiedCount);
+            mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.begin() + simplifiedCount);
+            // Errors of successive levels add up at most
+            level.error = std::max<float>(level.error, previousError + error);
+            lodIndexCount += subset.indexCount;
+        }
+
+        // Not worth a level : drop it and stop
+        if (lodIndexCount > previousIndexCount * 9 / 10) {
+            mesh.indices.resize(level.subsets.front().startIndexLocation);
+            break;
+        }
+        previousIndexCount = lodIndexCount;
+        previousError = level.error;
+        mesh.lods.push_back(std::move(level));
+    }
+}
+
+bool SkinnedMesh::compress_vertices(Mesh& mesh) {
+    vertex_compression::Error error;
+    bool boneIndicesFit = true;
+    std::vector<CompressedVertex> compressedVertices(mesh.vertices.size());
+    for (size_t vertexIndex = 0; vertexIndex < mesh.vertices.size(); ++vertexIndex) {
+        const Vertex& vertex = mesh.vertices.at(vertexIndex);
+        CompressedVertex& compressedVertex = compressedVertices.at(vertexIndex);
+        compressedVertex.position = vertex.position;
+        vertex_compression::encode_octahedral(vertex.normal, compressedVertex.normal);
+        vertex_compression::encode_tangent(vertex.tangent, compressedVertex.tangent);
+        vertex_compression::encode_texcoord(vertex.texcoord, compressedVertex.texcoord);
+        vertex_compression::encode_weights(vertex.boneWeights, compressedVertex.boneWeights);
+        for (int influenceIndex = 0; influenceIndex < MAX_BONE_INFLUENCES; ++influenceIndex) {
+            boneIndicesFit &= vertex.boneIndices[influenceIndex] <= UINT8_MAX;
+            compressedVertex.boneIndices[influenceIndex] = static_cast<uint8_t>(vertex.boneIndices[influenceIndex]);
+        }
+
+        error.add_normal(vertex.normal, compressedVertex.normal);
+        error.add_tangent(vertex.tangent, compressedVertex.tangent);
+        error.add_texcoord(vertex.texcoord, compressedVertex.texcoord);
+        error.add_weights(vertex.boneWeights, compressedVertex.boneWeights);
+    }
+
+    const bool compressed = boneIndicesFit && error.within_bounds();
+    std::stringstream message;
+    message << "SkinnedMesh compress : " << mesh.name << " : " << sizeof(Vertex) << " -> " << sizeof(CompressedVertex)
+        << " bytes/vertex, max error normal " << error.normalDegrees << " deg, tangent " << error.tangentDegrees
+        << " deg, texcoord " << error.texcoord << ", weight " << error.weight
+        << (compressed ? "\n" : " : over the bounds, kept uncompressed\n");
+    OutputDebugStringA(message.str().c_str());
+
+    if (compressed) {
+        mesh.compressedVertices = std::move(compressedVertices);
+    }
+    mesh.compressed = compressed;
+    return compressed;
 }
 
 void SkinnedMesh::fetch_materials(FbxScene* fbxScene, std::unordered_map<uint64_t, Material>& materials) {
@@ -265,41 +679,41 @@ void SkinnedMesh::fetch_materials(FbxScene* fbxScene, std::unordered_map<uint64_
                 material.name = fbxMaterial->GetName();
                 material.uniqueId = fbxMaterial->GetUniqueID();
                 FbxProperty fbxProperty;
-                fbxProperty = fbxMaterial->FindProperty(FbxSurfaceMaterial::sDiffuse);  // ÃJ[T
-                if (fbxProperty.IsValid()) {                                            // 񂪗Lǂ
-                    const FbxDouble3 color = fbxProperty.Get<FbxDouble3>();             // LȂJ[̎擾
+                fbxProperty = fbxMaterial->FindProperty(FbxSurfaceMaterial::sDiffuse);  // 陰のカラー情報を探す
+                if (fbxProperty.IsValid()) {                                            // 見つけた情報が有効かどうか
+                    const FbxDouble3 color = fbxProperty.Get<FbxDouble3>();             // 有効ならカラー情報の取得
                     material.Kd.x = static_cast<float>(color[0]);
                     material.Kd.y = static_cast<float>(color[1]);
                     material.Kd.z = static_cast<float>(color[2]);
                     material.Kd.w = 1.0f;
 
-                    const FbxFileTexture* fbxTexture = fbxProperty.GetSrcObject<FbxFileTexture>(); // FbxFileTexture^̃IuWFNg
+                    const FbxFileTexture* fbxTexture = fbxProperty.GetSrcObject<FbxFileTexture>(); // FbxFileTexture型のオブジェクトを入手
                     material.textureFilenames[0] =
-                        fbxTexture ? fbxTexture->GetRelativeFileName() : ""; // 񂪂΃eNX`t@C̑΃pX擾A΋󕶎
+                        fbxTexture ? fbxTexture->GetRelativeFileName() : ""; // 情報があればテクスチャファイルの相対パスを取得、無ければ空文字を代入
                 }
-                fbxProperty = fbxMaterial->FindProperty(FbxSurfaceMaterial::sSpecular); // ˌ̃J[T
-                if (fbxProperty.IsValid()) {                                            // 񂪗Lǂ
-                    const FbxDouble3 color = fbxProperty.Get<FbxDouble3>();             // LȂJ[̎擾
+                fbxProperty = fbxMaterial->FindProperty(FbxSurfaceMaterial::sSpecular); // 反射光のカラー情報を探す
+                if (fbxProperty.IsValid()) {                                            // 見つけた情報が有効かどうか
+                    const FbxDouble3 color = fbxProperty.Get<FbxDouble3>();             // 有効ならカラー情報の取得
                     material.Ks.x = static_cast<float>(color[0]);
                     material.Ks.y = static_cast<float>(color[1]);
                     material.Ks.z = static_cast<float>(color[2]);
                     material.Ks.w = 1.0f;
 
-                    const FbxFileTexture* fbxTexture = fbxProperty.GetSrcObject<FbxFileTexture>(); // FbxFileTexture^̃IuWFNg
+                    const FbxFileTexture* fbxTexture = fbxProperty.GetSrcObject<FbxFileTexture>(); // FbxFileTexture型のオブジェクトを入手
                     material.textureFilenames[1] =
-                        fbxTexture ? fbxTexture->GetRelativeFileName() : ""; // 񂪂΃eNX`t@C̑΃pX擾A΋󕶎
+                        fbxTexture ? fbxTexture->GetRelativeFileName() : ""; // 情報があればテクスチャファイルの相対パスを取得、無ければ空文字を代入
                 }
-                fbxProperty = fbxMaterial->FindProperty(FbxSurfaceMaterial::sAmbient);  // ̃J[T
-                if (fbxProperty.IsValid()) {                                            // 񂪗Lǂ
-                    const FbxDouble3 color = fbxProperty.Get<FbxDouble3>();             // LȂJ[̎擾
+                fbxProperty = fbxMaterial->FindProperty(FbxSurfaceMaterial::sAmbient);  // 環境光のカラー情報を探す
+                if (fbxProperty.IsValid()) {                                            // 見つけた情報が有効かどうか
+                    const FbxDouble3 color = fbxProperty.Get<FbxDouble3>();             // 有効ならカラー情報の取得
                     material.Ka.x = static_cast<float>(color[0]);
                     material.Ka.y = static_cast<float>(color[1]);
                     material.Ka.z = static_cast<float>(color[2]);
                     material.Ka.w = 1.0f;
 
-                    const FbxFileTexture* fbxTexture = fbxProperty.GetSrcObject<FbxFileTexture>(); // FbxFileTexture^̃IuWFNg
+                    const FbxFileTexture* fbxTexture = fbxProperty.GetSrcObject<FbxFileTexture>(); // FbxFileTexture型のオブジェクトを入手
                     material.textureFilenames[2] =
-                        fbxTexture ? fbxTexture->GetRelativeFileName() : ""; // 񂪂΃eNX`t@C̑΃pX擾A΋󕶎
+                        fbxTexture ? fbxTexture->GetRelativeFileName() : ""; // 情報があればテクスチャファイルの相対パスを取得、無ければ空文字を代入
                 }
                 fbxProperty = fbxMaterial->FindProperty(FbxSurfaceMaterial::sNormalMap);
                 if (fbxProperty.IsValid()) {
@@ -307,14 +721,14 @@ void SkinnedMesh::fetch_materials(FbxScene* fbxScene, std::unordered_map<uint64_
                     material.textureFilenames[1] = fileTexture ? fileTexture->GetRelativeFileName() : "";
                 }
 
-                materials.emplace(material.uniqueId, std::move(material)); // mapReiȂ̂idl(gĂяo)material(g)ǉ
+                materials.emplace(material.uniqueId, std::move(material)); // mapコンテナなのでid値(中身を呼び出す鍵)とmaterial情報(中身)を追加
             }
         }
         else {
             Material material;
             material.name = "";
             material.uniqueId = 0;
-            materials.emplace(material.uniqueId, std::move(material)); // _~[}eA̐
+            materials.emplace(material.uniqueId, std::move(material)); // ダミーマテリアルの生成
         }
     }
 }
@@ -323,7 +737,7 @@ void SkinnedMesh::fetch_skeleton(FbxMesh* fbxMesh, Skeleton& bindPose) {
     const int deformerCount = fbxMesh->GetDeformerCount(FbxDeformer::eSkin);
     for (int deformerIndex = 0; deformerIndex < deformerCount; ++deformerIndex) {
         FbxSkin* skin = static_cast<FbxSkin*>(fbxMesh->GetDeformer(deformerIndex, FbxDeformer::eSkin));
-        const int clusterCount = skin->GetClusterCount(); // NX^̓XLɍp1{̃{[̏ǗĂ
+        const int clusterCount = skin->GetClusterCount(); // クラスタはスキンに作用する1本のボーンの情報を管理している
         bindPose.bones.resize(clusterCount);
         for (int clusterIndex = 0; clusterIndex < clusterCount; ++clusterIndex) {
             FbxCluster* cluster = skin->GetCluster(clusterIndex);
@@ -373,24 +787,23 @@ void SkinnedMesh::fetch_animations(FbxScene* fbxScene, std::vector<Animation>& a
             samplingRate : static_cast<float>(oneSecond.GetFrameRate(timeMode));
 
         const FbxTime samplingInterval = static_cast<FbxLongLong>(oneSecond.Get() / animationClip.samplingRate);
-        const FbxTakeInfo* takeInfo = fbxScene->GetTakeInfo(animationClip.name.c_str()); // w肵animationClip̏擾Iȏ
+        const FbxTakeInfo* takeInfo = fbxScene->GetTakeInfo(animationClip.name.c_str()); // 指定したanimationClipの情報を取得的な処理多分
         const FbxTime startTime = takeInfo->mLocalTimeSpan.GetStart();
         const FbxTime stopTime = takeInfo->mLocalTimeSpan.GetStop();
 
+        // Only local transforms are kept; global matrices are rebuilt from them by update_animation.
+        const size_t nodeCount = sceneView.nodes.size();
+        std::vector<FbxNode*> fbxNodes(nodeCount);
+        for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+            fbxNodes.at(nodeIndex) = fbxScene->FindNodeByName(sceneView.nodes.at(nodeIndex).name.c_str());
+        }
+        std::vector<CompressedAnimation::Transform> frames;
+        uint32_t frameCount = 0;
         for (FbxTime time = startTime; time < stopTime; time += samplingInterval) {
-            Animation::Keyframe& keyframe = animationClip.sequence.emplace_back();
-
-            const size_t nodeCount = sceneView.nodes.size();
-            keyframe.nodes.resize(nodeCount);
-
             for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
-                FbxNode* fbxNode = fbxScene->FindNodeByName(sceneView.nodes.at(nodeIndex).name.c_str());
+                CompressedAnimation::Transform& node = frames.emplace_back();
+                FbxNode* fbxNode = fbxNodes.at(nodeIndex);
                 if (fbxNode) {
-                    Animation::Keyframe::Node& node = keyframe.nodes.at(nodeIndex);
-                    // 'globalTransform' is a transformation matrix of anode with respect to
-                    // the scene's global coordinate system.
-                    node.globalTransform = to_xmfloat4x4(fbxNode->EvaluateGlobalTransform(time));
-
                     // 'localTransform' is a transformation matrix of a node with respect to
                     // its parent's local coordinate system.
                     const FbxAMatrix& localTransform = fbxNode->EvaluateLocalTransform(time);
@@ -399,27 +812,230 @@ void SkinnedMesh::fetch_animations(FbxScene* fbxScene, std::vector<Animation>& a
                     node.translation = to_xmfloat3(localTransform.GetT());
                 }
             }
+            ++frameCount;
         }
+        animationClip.sequence.compress(frames.data(), frameCount, static_cast<uint32_t>(nodeCount));
     }
     for (int animationStackIndex = 0; animationStackIndex < animationStackCount; ++animationStackIndex) {
         delete animationStackNames[animationStackIndex];
     }
 }
 
+namespace {
+    void to_keyframe(const std::vector<CompressedAnimation::Transform>& pose, SkinnedMesh::Animation::Keyframe& keyframe) {
+        keyframe.nodes.resize(pose.size());
+        for (size_t nodeIndex = 0; nodeIndex < pose.size(); ++nodeIndex) {
+            SkinnedMesh::Animation::Keyframe::Node& node = keyframe.nodes.at(nodeIndex);
+            node.scaling = pose.at(nodeIndex).scaling;
+            node.rotation = pose.at(nodeIndex).rotation;
+            node.translation = pose.at(nodeIndex).translation;
+        }
+    }
+
+    void to_pose(const std::vector<CompressedAnimation::Transform>& transforms, Pose& pose) {
+        pose.resize(transforms.size());
+        for (size_t nodeIndex = 0; nodeIndex < transforms.size(); ++nodeIndex) {
+            const CompressedAnimation::Transform& transform = transforms[nodeIndex];
+            pose.set_local(nodeIndex, transform.scaling, transform.rotation, transform.translation);
+        }
+    }
+
+    // Decoding scratch, reused by every sample_animation on this thread
+    std::vector<CompressedAnimation::Transform>& sampled_transforms(size_t nodeCount) {
+        static thread_local std::vector<CompressedAnimation::Transform> transforms;
+        transforms.resize(nodeCount);
+        return transforms;
+    }
+}
+
+void SkinnedMesh::sample_animation(const Animation& animation, float frame, Animation::Keyframe& keyframe) const {
+    std::vector<CompressedAnimation::Transform>& pose = sampled_transforms(animation.sequence.node_count());
+    animation.sequence.sample(frame, pose.data());
+    to_keyframe(pose, keyframe);
+}
+
+ClipSampler SkinnedMesh::clip_sampler(const Animation& animation, ClipSampler::WrapMode wrapMode,
+    CompressedAnimation::RotationInterpolation rotationInterpolation) {
+    return ClipSampler(animation.sequence, animation.samplingRate, wrapMode, rotationInterpolation);
+}
+
+void SkinnedMesh::sample_animation(ClipSampler& sampler, float seconds, Animation::Keyframe& keyframe) const {
+    if (!sampler.sequence()) {
+        return;
+    }
+    std::vector<CompressedAnimation::Transform>& pose = sampled_transforms(sampler.sequence()->node_count());
+    sampler.sample(seconds, pose.data());
+    to_keyframe(pose, keyframe);
+}
+
+void SkinnedMesh::sample_animation(ClipSampler& sampler, float seconds, Pose& pose) const {
+    if (!sampler.sequence()) {
+        return;
+    }
+    std::vector<CompressedAnimation::Transform>& transforms = sampled_transforms(sampler.sequence()->node_count());
+    sampler.sample(seconds, transforms.data());
+    to_pose(transforms, pose);
+}
+
+void SkinnedMesh::sample_animation(ClipSampler& sampler, float seconds, Pose& pose, const uint8_t* nodeMask) const {
+    if (!sampler.sequence()) {
+        return;
+    }
+    const size_t nodeCount = sampler.sequence()->node_count();
+    if (!nodeMask || pose.node_count() != nodeCount) {
+        sample_animation(sampler, seconds, pose);
+        return;
+    }
+    std::vector<CompressedAnimation::Transform>& transforms = sampled_transforms(nodeCount);
+    sampler.sample(seconds, transforms.data(), nodeMask);
+    for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+        if (nodeMask[nodeIndex]) {
+            const CompressedAnimation::Transform& transform = transforms[nodeIndex];
+            pose.set_local(nodeIndex, transform.scaling, transform.rotation, transform.translation);
+        }
+    }
+}
+
+// Keyframe callers go through the SoA engine too : the locals are scattered into a scratch Pose and the
+// matrices gathered back.
 void SkinnedMesh::update_animation(Animation::Keyframe& keyframe) {
-    size_t nodeCount = keyframe.nodes.size();
+    const size_t nodeCount = keyframe.nodes.size();
+    if (nodeCount != poseHierarchy.node_count()) {
+        _ASSERT_EXPR(false, L"The keyframe doesn't match this scene's nodes");
+        return;
+    }
+    static thread_local Pose pose;
+    pose.resize(nodeCount);
+    for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+        const Animation::Keyframe::Node& node = keyframe.nodes[nodeIndex];
+        pose.set_local(nodeIndex, node.scaling, node.rotation, node.translation);
+    }
+    pose.update(poseHierarchy);
     for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
-        Animation::Keyframe::Node& node = keyframe.nodes.at(nodeIndex);
-        XMMATRIX S = XMMatrixScaling(node.scaling.x, node.scaling.y, node.scaling.z);
-        XMMATRIX R = XMMatrixRotationQuaternion(XMLoadFloat4(&node.rotation));
-        XMMATRIX T = XMMatrixTranslation(node.translation.x, node.translation.y, node.translation.z);
+        keyframe.nodes[nodeIndex].globalTransform = pose.global_transform(nodeIndex);
+    }
+}
+
+void SkinnedMesh::sample_animation(const Animation& animation, float frame, Pose& pose) const {
+    std::vector<CompressedAnimation::Transform>& transforms = sampled_transforms(animation.sequence.node_count());
+    animation.sequence.sample(frame, transforms.data());
+    to_pose(transforms, pose);
+}
 
-        int64_t parentIndex = sceneView.nodes.at(nodeIndex).parentIndex;
-        XMMATRIX P = parentIndex < 0 ? XMMatrixIdentity() :
-            XMLoadFloat4x4(&keyframe.nodes.at(parentIndex).globalTransform);
+void SkinnedMesh::update_pose(Pose& pose) const {
+    if (pose.node_count() != poseHierarchy.node_count()) {
+        _ASSERT_EXPR(false, L"The pose doesn't match this scene's nodes");
+        return;
+    }
+    pose.update(poseHierarchy);
+}
 
-        XMStoreFloat4x4(&node.globalTransform, S * R * T * P);
+BoneMask SkinnedMesh::bone_mask(const char* nodeName, float weight) const {
+    const int64_t nodeIndex = sceneView.indexof(std::string(nodeName));
+    if (nodeIndex < 0) {
+        _ASSERT_EXPR(false, L"No scene node has that name");
+        return {};
     }
+    return BoneMask::subtree(poseHierarchy, static_cast<uint32_t>(nodeIndex), weight);
+}
+
+void SkinnedMesh::build_pose_hierarchy() {
+    std::vector<int64_t> parentIndices;
+    parentIndices.reserve(sceneView.nodes.size());
+    for (const Scene::Node& node : sceneView.nodes) {
+        parentIndices.push_back(node.parentIndex);
+    }
+    poseHierarchy.build(parentIndices.data(), parentIndices.size());
+
+    // Height of every node above its deepest descendant, children before parents (reverse hierarchy order)
+    std::vector<int> heights(parentIndices.size(), 0);
+    for (size_t i = poseHierarchy.order.size(); i-- > 0;) {
+        const int32_t parent = poseHierarchy.parents.at(i);
+        if (parent >= 0) {
+            heights.at(parent) = std::max<int>(heights.at(parent), heights.at(poseHierarchy.order.at(i)) + 1);
+        }
+    }
+    reducedJointMask.resize(heights.size());
+    reducedJointCount = 0;
+    for (size_t nodeIndex = 0; nodeIndex < heights.size(); ++nodeIndex) {
+        reducedJointMask.at(nodeIndex) = heights.at(nodeIndex) >= REDUCED_FROZEN_LEVELS ? 1 : 0;
+        reducedJointCount += reducedJointMask.at(nodeIndex);
+    }
+}
+
+void SkinnedMesh::joint_mask(const uint32_t* nodes, size_t nodeCount, std::vector<uint8_t>& mask) const {
+    mask.assign(sceneView.nodes.size(), 0);
+    for (size_t i = 0; i < nodeCount; ++i) {
+        // Stops at a flagged node : its ancestors are flagged already
+        for (int64_t nodeIndex = nodes[i]; nodeIndex >= 0 && static_cast<size_t>(nodeIndex) < mask.size() && !mask.at(nodeIndex);
+            nodeIndex = sceneView.nodes.at(nodeIndex).parentIndex) {
+            mask.at(nodeIndex) = 1;
+        }
+    }
+}
+
+void SkinnedMesh::benchmark_pose(int iterations) const {
+    const size_t nodeCount = poseHierarchy.node_count();
+    if (nodeCount == 0 || iterations <= 0) {
+        return;
+    }
+
+    // update_animation as it was before Pose : per-node S, R and T matrices, bounds checked parent loads
+    auto update_reference = [this](Animation::Keyframe& keyframe) {
+        size_t nodeCount = keyframe.nodes.size();
+        for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+            Animation::Keyframe::Node& node = keyframe.nodes.at(nodeIndex);
+            XMMATRIX S = XMMatrixScaling(node.scaling.x, node.scaling.y, node.scaling.z);
+            XMMATRIX R = XMMatrixRotationQuaternion(XMLoadFloat4(&node.rotation));
+            XMMATRIX T = XMMatrixTranslation(node.translation.x, node.translation.y, node.translation.z);
+
+            int64_t parentIndex = sceneView.nodes.at(nodeIndex).parentIndex;
+            XMMATRIX P = parentIndex < 0 ? XMMatrixIdentity() :
+                XMLoadFloat4x4(&keyframe.nodes.at(parentIndex).globalTransform);
+
+            XMStoreFloat4x4(&node.globalTransform, S * R * T * P);
+        }
+    };
+
+    benchmark timer;
+    std::stringstream message;
+    message << std::fixed << std::setprecision(1)
+        << "SkinnedMesh pose : " << nodeCount << " nodes, AVX " << (Pose::avx_supported() ? "available" : "not available") << "\n";
+    for (size_t characterCount : { 1, 100, 1000 }) {
+        // Every character in its own pose, spread over the first clip
+        std::vector<Animation::Keyframe> keyframes(characterCount);
+        std::vector<Pose> poses(characterCount);
+        for (size_t character = 0; character < characterCount; ++character) {
+            if (!animationClips.empty() && animationClips.at(0).frame_count() > 0) {
+                const float frame = static_cast<float>(character % animationClips.at(0).frame_count());
+                sample_animation(animationClips.at(0), frame, keyframes.at(character));
+                sample_animation(animationClips.at(0), frame, poses.at(character));
+            }
+            else {
+                keyframes.at(character).nodes.resize(nodeCount);
+                poses.at(character).resize(nodeCount);
+            }
+        }
+
+        auto joints_per_second = [&](auto update) {
+            timer.begin();
+            for (int iteration = 0; iteration < iterations; ++iteration) {
+                for (size_t character = 0; character < characterCount; ++character) {
+                    update(character);
+                }
+            }
+            const float seconds = timer.end();
+            return seconds > 0 ? static_cast<float>(nodeCount) * characterCount * iterations / seconds / 1000000.0f : 0.0f;
+        };
+        const float reference = joints_per_second([&](size_t character) { update_reference(keyframes[character]); });
+        const float sse = joints_per_second([&](size_t character) { poses[character].update(poseHierarchy, false); });
+        const float avx = joints_per_second([&](size_t character) { poses[character].update(poseHierarchy); });
+
+        message << "  " << characterCount << " characters : AoS " << reference << " M joints/s, SoA SSE " << sse
+            << " M joints/s (x" << (reference > 0 ? sse / reference : 0.0f) << "), SoA best " << avx
+            << " M joints/s (x" << (reference > 0 ? avx / reference : 0.0f) << ")\n";
+    }
+    OutputDebugStringA(message.str().c_str());
 }
 
 bool SkinnedMesh::append_animations(const char* animationFilename, float samplingRate) {
@@ -468,49 +1084,115 @@ void SkinnedMesh::blend_animations(const Animation::Keyframe* keyframes[2], floa
 
 void SkinnedMesh::create_com_objects(ID3D11Device* device, const char* fbxFilename) {
     for (Mesh& mesh : meshes) {
-        HRESULT hr = S_OK;
-        D3D11_BUFFER_DESC bufferDesc = {};
-        D3D11_SUBRESOURCE_DATA subresourceData = {};
-        bufferDesc.ByteWidth = static_cast<UINT>(sizeof(Vertex) * mesh.vertices.size());
-        bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-        bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-        bufferDesc.CPUAccessFlags = 0;
-        bufferDesc.MiscFlags = 0;
-        bufferDesc.StructureByteStride = 0;
-        subresourceData.pSysMem = mesh.vertices.data();
-        subresourceData.SysMemPitch = 0;
-        subresourceData.SysMemSlicePitch = 0;
-        hr = device->CreateBuffer(&bufferDesc, &subresourceData, mesh.vertexBuffer.ReleaseAndGetAddressOf());
-        _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+        create_mesh_buffers(device, mesh);
+    }
+    for (std::unordered_map<uint64_t, Material>::iterator iterator = materials.begin();
+        iterator != materials.end(); ++iterator) {
+        create_material_views(device, fbxFilename, iterator->second);
+    }
+    create_shaders(device);
+}
 
-        bufferDesc.ByteWidth = static_cast<UINT>(sizeof(uint32_t) * mesh.indices.size());
-        bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-        bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-        subresourceData.pSysMem = mesh.indices.data();
-        hr = device->CreateBuffer(&bufferDesc, &subresourceData, mesh.indexBuffer.ReleaseAndGetAddressOf());
-        _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+void SkinnedMesh::create_mesh_buffers(ID3D11Device* device, Mesh& mesh) {
+    // Meshes read from a cooked file reference the mapping instead of owning their vertices.
+    const void* vertices = nullptr;
+    size_t vertexCount = 0;
+    if (mesh.compressed) {
+        vertices = mesh.cookedCompressedVertices ? mesh.cookedCompressedVertices : mesh.compressedVertices.data();
+        vertexCount = mesh.cookedCompressedVertices ? mesh.cookedVertexCount : mesh.compressedVertices.size();
+    }
+    else {
+        vertices = mesh.cookedVertices ? mesh.cookedVertices : mesh.vertices.data();
+        vertexCount = mesh.cookedVertices ? mesh.cookedVertexCount : mesh.vertices.size();
+    }
+    const uint32_t* indices = mesh.cookedIndices ? mesh.cookedIndices : mesh.indices.data();
+    const size_t indexCount = mesh.cookedIndices ? mesh.cookedIndexCount : mesh.indices.size();
+
+    HRESULT hr = S_OK;
+    D3D11_BUFFER_DESC bufferDesc = {};
+    D3D11_SUBRESOURCE_DATA subresourceData = {};
+    bufferDesc.ByteWidth = static_cast<UINT>((mesh.compressed ? sizeof(CompressedVertex) : sizeof(Vertex)) * vertexCount);
+    bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+    bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    bufferDesc.CPUAccessFlags = 0;
+    bufferDesc.MiscFlags = 0;
+    bufferDesc.StructureByteStride = 0;
+    subresourceData.pSysMem = vertices;
+    subresourceData.SysMemPitch = 0;
+    subresourceData.SysMemSlicePitch = 0;
+    hr = device->CreateBuffer(&bufferDesc, &subresourceData, mesh.vertexBuffer.ReleaseAndGetAddressOf());
+    _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+
+    bufferDesc.ByteWidth = static_cast<UINT>(sizeof(uint32_t) * indexCount);
+    bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+    bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    subresourceData.pSysMem = indices;
+    hr = device->CreateBuffer(&bufferDesc, &subresourceData, mesh.indexBuffer.ReleaseAndGetAddressOf());
+    _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+
+    // skin_mesh works on the vertices the GPU got : float vertices are read from the mapping in place, compressed
+    // ones are decoded once here.
+    if (retainCpuVertices) {
+        if (mesh.compressed) {
+            const CompressedVertex* compressedVertices = static_cast<const CompressedVertex*>(vertices);
+            mesh.vertices.resize(vertexCount);
+            for (size_t vertexIndex = 0; vertexIndex < vertexCount; ++vertexIndex) {
+                const CompressedVertex& compressed = compressedVertices[vertexIndex];
+                Vertex& vertex = mesh.vertices.at(vertexIndex);
+                vertex.position = compressed.position;
+                vertex.normal = vertex_compression::decode_octahedral(compressed.normal);
+                vertex.tangent = vertex_compression::decode_tangent(compressed.tangent);
+                vertex.texcoord = vertex_compression::decode_texcoord(compressed.texcoord);
+                for (int influence = 0; influence < MAX_BONE_INFLUENCES; ++influence) {
+                    vertex.boneWeights[influence] = compressed.boneWeights[influence] / 255.0f;
+                    vertex.boneIndices[influence] = compressed.boneIndices[influence];
+                }
+            }
+        }
+        mesh.compressedVertices.clear();
+        mesh.cookedCompressedVertices = nullptr;
+        if (!mesh.cookedVertices) {
+            mesh.cookedVertexCount = 0;
+        }
+    }
+    else {
+        mesh.cookedVertices = nullptr;
+        mesh.cookedCompressedVertices = nullptr;
+        mesh.cookedVertexCount = 0;
+        mesh.cookedIndices = nullptr;
+        mesh.cookedIndexCount = 0;
+    }
 #if 1
+    if (!retainCpuVertices) {
         mesh.vertices.clear();
+        mesh.compressedVertices.clear();
         mesh.indices.clear();
-#endif
     }
+#endif
+}
 
-    for (std::unordered_map<uint64_t, Material>::iterator iterator = materials.begin();
-        iterator != materials.end(); ++iterator) {
-        for (size_t textureIndex = 0; textureIndex < 2; ++textureIndex) {
-            if (iterator->second.textureFilenames[textureIndex].size() > 0) {
-                std::filesystem::path path(fbxFilename);
-                path.replace_filename(iterator->second.textureFilenames[textureIndex]);
-                D3D11_TEXTURE2D_DESC texture2dDesc;
-                load_texture_from_file(device, path.c_str(), iterator->second.shaderResouceViews[textureIndex].GetAddressOf(), &texture2dDesc);
-            }
-            else {
-                make_dummy_texture(device, iterator->second.shaderResouceViews[textureIndex].GetAddressOf(),textureIndex == 1 ? 0xFFFF7F7F : 0xFFFFFFFF, 16);
-            }
+std::filesystem::path SkinnedMesh::texture_filename(const char* fbxFilename, const Material& material, size_t textureIndex) {
+    std::filesystem::path path(fbxFilename);
+    path.replace_filename(material.textureFilenames[textureIndex]);
+    return path;
+}
+
+void SkinnedMesh::create_material_views(ID3D11Device* device, const char* fbxFilename, Material& material) {
+    // Textures come from the shared cache and decode in the background. Until then the material shows
+    // the same colours as a material without textures (white diffuse, flat normal).
+    for (size_t textureIndex = 0; textureIndex < 2; ++textureIndex) {
+        const DWORD placeholder = textureIndex == 1 ? 0xFFFF7F7F : 0xFFFFFFFF;
+        if (material.textureFilenames[textureIndex].size() > 0) {
+            const std::filesystem::path path = texture_filename(fbxFilename, material, textureIndex);
+            material.textures[textureIndex] = request_texture(device, path.c_str(), placeholder);
+        }
+        else {
+            material.textures[textureIndex] = solid_texture(device, placeholder);
         }
     }
+}
 
-
+void SkinnedMesh::create_shaders(ID3D11Device* device) {
     HRESULT hr = S_OK;
     D3D11_INPUT_ELEMENT_DESC input_element_desc[]
     {
@@ -524,6 +1206,27 @@ void SkinnedMesh::create_com_objects(ID3D11Device* device, const char* fbxFilena
     create_vs_from_cso(device, "./Shader/skinned_mesh_vs.cso", vertexShader.ReleaseAndGetAddressOf(),
     inputLayout.ReleaseAndGetAddressOf(), input_element_desc, ARRAYSIZE(input_element_desc));
     create_ps_from_cso(device, "./Shader/skinned_mesh_ps.cso", pixelShader.ReleaseAndGetAddressOf());
+
+    if (std::any_of(meshes.begin(), meshes.end(), [](const Mesh& mesh) { return mesh.compressed; })) {
+        D3D11_INPUT_ELEMENT_DESC compressed_input_element_desc[]
+        {
+            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT },
+            { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT },
+            { "TANGENT", 0, DXGI_FORMAT_R16G16_SINT, 0, D3D11_APPEND_ALIGNED_ELEMENT },
+            { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT },
+            { "WEIGHTS", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT },
+            { "BONES", 0, DXGI_FORMAT_R8G8B8A8_UINT, 0, D3D11_APPEND_ALIGNED_ELEMENT },
+        };
+        create_vs_from_cso(device, "./Shader/skinned_mesh_compressed_vs.cso", compressedVertexShader.ReleaseAndGetAddressOf(),
+            compressedInputLayout.ReleaseAndGetAddressOf(), compressed_input_element_desc, ARRAYSIZE(compressed_input_element_desc));
+        // Same input signature as skinned_mesh_compressed_vs : shares its input layout
+        create_vs_from_cso(device, "./Shader/skinned_mesh_baked_compressed_vs.cso", bakedCompressedVertexShader.ReleaseAndGetAddressOf(),
+            nullptr, nullptr, 0);
+        create_vs_from_cso(device, "./Shader/skinned_mesh_instanced_compressed_vs.cso", instancedCompressedVertexShader.ReleaseAndGetAddressOf(),
+            nullptr, nullptr, 0);
+    }
+    create_vs_from_cso(device, "./Shader/skinned_mesh_baked_vs.cso", bakedVertexShader.ReleaseAndGetAddressOf(), nullptr, nullptr, 0);
+    create_vs_from_cso(device, "./Shader/skinned_mesh_instanced_vs.cso", instancedVertexShader.ReleaseAndGetAddressOf(), nullptr, nullptr, 0);
     
      D3D11_BUFFER_DESC buffer_desc{};
     buffer_desc.ByteWidth = sizeof(Constants);
@@ -531,36 +1234,157 @@ void SkinnedMesh::create_com_objects(ID3D11Device* device, const char* fbxFilena
     buffer_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
     hr = device->CreateBuffer(&buffer_desc, nullptr, constantBuffer.ReleaseAndGetAddressOf());
     _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+
+    buffer_desc.ByteWidth = sizeof(BakedConstants);
+    hr = device->CreateBuffer(&buffer_desc, nullptr, bakedConstantBuffer.ReleaseAndGetAddressOf());
+    _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+
+    buffer_desc.ByteWidth = sizeof(InstancedConstants);
+    hr = device->CreateBuffer(&buffer_desc, nullptr, instancedConstantBuffer.ReleaseAndGetAddressOf());
+    _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
 }
 
-void SkinnedMesh::render(ID3D11DeviceContext* immediateContext,
-    const XMFLOAT4X4& world, const XMFLOAT4& materialColor,
-    const Animation::Keyframe* keyframe) {
-    for (const Mesh& mesh : meshes) {
-        uint32_t stride = sizeof(Vertex);
-        uint32_t offset = 0;
-        immediateContext->IASetVertexBuffers(0, 1, mesh.vertexBuffer.GetAddressOf(), &stride, &offset);
-        immediateContext->IASetIndexBuffer(mesh.indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-        immediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        immediateContext->IASetInputLayout(inputLayout.Get());
+namespace {
+    // Source of Palette::version. Palettes are built on worker threads too.
+    std::atomic<uint64_t> paletteVersions = 0;
+    // render records passes on worker threads too
+    struct {
+        std::atomic<uint64_t> boneBytes = 0;
+        std::atomic<uint64_t> constantBytes = 0;
+        std::atomic<uint32_t> boneUploads = 0;
+        std::atomic<uint32_t> skippedBoneUploads = 0;
+        std::atomic<uint64_t> instanceBytes = 0;
+    } uploadStatistics;
+
+    // Recreates the dynamic structured buffer 'buffer' and its view when 'elementCount' doesn't fit, at least doubling 'capacity'
+    void reserve_structured_buffer(ID3D11DeviceContext* immediateContext, UINT stride, size_t elementCount, size_t& capacity,
+        Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& view) {
+        if (capacity >= elementCount) {
+            return;
+        }
+        capacity = std::max<size_t>(elementCount, capacity * 2);
+        Microsoft::WRL::ComPtr<ID3D11Device> device;
+        immediateContext->GetDevice(device.GetAddressOf());
 
-        immediateContext->VSSetShader(vertexShader.Get(), nullptr, 0);
-        immediateContext->PSSetShader(pixelShader.Get(), nullptr, 0);
+        D3D11_BUFFER_DESC bufferDesc = {};
+        bufferDesc.ByteWidth = static_cast<UINT>(stride * capacity);
+        bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+        bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        bufferDesc.StructureByteStride = stride;
+        HRESULT hr = device->CreateBuffer(&bufferDesc, nullptr, buffer.ReleaseAndGetAddressOf());
+        _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
 
-        Constants data;
+        D3D11_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc = {};
+        shaderResourceViewDesc.Format = DXGI_FORMAT_UNKNOWN;
+        shaderResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+        shaderResourceViewDesc.Buffer.NumElements = static_cast<UINT>(capacity);
+        hr = device->CreateShaderResourceView(buffer.Get(), &shaderResourceViewDesc, view.ReleaseAndGetAddressOf());
+        _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+    }
+}
+
+SkinnedMesh::DrawState& SkinnedMesh::draw_state(ID3D11DeviceContext* context) {
+    DrawState* drawState = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(drawStateMutex);
+        std::unique_ptr<DrawState>& entry = drawStates[context];
+        if (!entry) {
+            entry = std::make_unique<DrawState>();
+            entry->context = context;
+        }
+        drawState = entry.get();
+    }
+    if (drawState->meshBones.size() == meshes.size()) {
+        return *drawState;
+    }
+
+    // Sized to each mesh's own bones, rewritten with WRITE_DISCARD whenever it is drawn with a new palette
+    Microsoft::WRL::ComPtr<ID3D11Device> device;
+    context->GetDevice(device.GetAddressOf());
+    drawState->meshBones.resize(meshes.size());
+    for (size_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex) {
+        DrawState::MeshBones& bones = drawState->meshBones.at(meshIndex);
+        const size_t boneCount = std::max<size_t>(std::min<size_t>(meshes.at(meshIndex).bindPose.bones.size(), MAX_BONES), 1);
+        D3D11_BUFFER_DESC bufferDesc = {};
+        bufferDesc.ByteWidth = static_cast<UINT>(sizeof(XMFLOAT4X4) * boneCount);
+        bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+        bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        bufferDesc.StructureByteStride = sizeof(XMFLOAT4X4);
+        HRESULT hr = device->CreateBuffer(&bufferDesc, nullptr, bones.buffer.ReleaseAndGetAddressOf());
+        _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc = {};
+        shaderResourceViewDesc.Format = DXGI_FORMAT_UNKNOWN;
+        shaderResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+        shaderResourceViewDesc.Buffer.FirstElement = 0;
+        shaderResourceViewDesc.Buffer.NumElements = static_cast<UINT>(boneCount);
+        hr = device->CreateShaderResourceView(bones.buffer.Get(), &shaderResourceViewDesc, bones.view.ReleaseAndGetAddressOf());
+        _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+        bones.uploadedPalette = 0;
+    }
+    return *drawState;
+}
+
+void SkinnedMesh::build_palette(const Pose& pose, Palette& palette) const {
+    if (pose.node_count() > 0) {
+        build_palette([&pose](int64_t nodeIndex) {
+            return static_cast<const XMFLOAT4X4*>(&pose.global_transform(static_cast<size_t>(nodeIndex)));
+        }, palette);
+    }
+    else {
+        build_palette(static_cast<const Animation::Keyframe*>(nullptr), palette);
+    }
+}
+
+void SkinnedMesh::build_palette(const Animation::Keyframe* keyframe, Palette& palette) const {
+    if (keyframe && keyframe->nodes.size() > 0) {
+        build_palette([keyframe](int64_t nodeIndex) {
+            return &keyframe->nodes.at(nodeIndex).globalTransform;
+        }, palette);
+    }
+    else {
+        build_palette([](int64_t) {
+            return static_cast<const XMFLOAT4X4*>(nullptr);
+        }, palette);
+    }
+}
+
+template<class GlobalTransform>
+void SkinnedMesh::build_palette(GlobalTransform globalTransform, Palette& palette) const {
+    size_t paletteSize = 0;
+    for (const Mesh& mesh : meshes) {
+        paletteSize += std::max<size_t>(std::min<size_t>(mesh.bindPose.bones.size(), MAX_BONES), 1);
+    }
+    palette.meshTransforms.resize(meshes.size());
+    palette.boneTransforms.resize(paletteSize);
+    palette.firstBones.resize(meshes.size() + 1);
+    palette.version = ++paletteVersions;
+
+    uint32_t firstBone = 0;
+    for (size_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex) {
+        const Mesh& mesh = meshes.at(meshIndex);
+        const size_t boneCount = std::min<size_t>(mesh.bindPose.bones.size(), MAX_BONES);
+        _ASSERT_EXPR(mesh.bindPose.bones.size() <= MAX_BONES, L"The mesh has more bones than MAX_BONES");
+        palette.firstBones.at(meshIndex) = firstBone;
+        XMFLOAT4X4* boneTransforms = palette.boneTransforms.data() + firstBone;
+        firstBone += static_cast<uint32_t>(std::max<size_t>(boneCount, 1));
 
 #if 0
-        XMStoreFloat4x4(&data.boneTransforms[0], XMMatrixIdentity()); // Pʍs
-        XMStoreFloat4x4(&data.boneTransforms[1], XMMatrixRotationRollPitchYaw(0, 0, XMConvertToRadians(+45)));
-        XMStoreFloat4x4(&data.boneTransforms[2], XMMatrixRotationRollPitchYaw(0, 0, XMConvertToRadians(-45)));
+        XMStoreFloat4x4(&boneTransforms[0], XMMatrixIdentity()); // 単位行列化
+        XMStoreFloat4x4(&boneTransforms[1], XMMatrixRotationRollPitchYaw(0, 0, XMConvertToRadians(+45)));
+        XMStoreFloat4x4(&boneTransforms[2], XMMatrixRotationRollPitchYaw(0, 0, XMConvertToRadians(-45)));
 #endif
 
 #if 0
         // Bind pose transform(Offset matrix) : Convert from the model(mesh) space to the bone space
         XMMATRIX B[3];
-        B[0] = XMLoadFloat4x4(&mesh.bindPose.bones.at(0).offsetTransform); // ƂȂʒu̐ݒ
-        B[1] = XMLoadFloat4x4(&mesh.bindPose.bones.at(1).offsetTransform); // ƂȂʒu̐ݒ
-        B[2] = XMLoadFloat4x4(&mesh.bindPose.bones.at(2).offsetTransform); // ƂȂʒu̐ݒ
+        B[0] = XMLoadFloat4x4(&mesh.bindPose.bones.at(0).offsetTransform); // 基準となる位置の設定
+        B[1] = XMLoadFloat4x4(&mesh.bindPose.bones.at(1).offsetTransform); // 基準となる位置の設定
+        B[2] = XMLoadFloat4x4(&mesh.bindPose.bones.at(2).offsetTransform); // 基準となる位置の設定
 
         // Animation bone transform : Convert from the bone space to the model(mesh) or the parent bone space
         XMMATRIX A[3];
@@ -573,49 +1397,827 @@ void SkinnedMesh::render(ID3D11DeviceContext* immediateContext,
         // from A2 space to parent bone(A1) space
         A[2] = XMMatrixRotationRollPitchYaw(0, 0, XMConvertToRadians(-45)) * XMMatrixTranslation(0, 2, 0);
         
-        // {[̌vZ
-        XMStoreFloat4x4(&data.boneTransforms[0], B[0] * A[0]);
-        XMStoreFloat4x4(&data.boneTransforms[1], B[1] * A[1] * A[0]);
-        XMStoreFloat4x4(&data.boneTransforms[2], B[2] * A[2] * A[1] * A[0]);
+        // ボーンの計算
+        XMStoreFloat4x4(&boneTransforms[0], B[0] * A[0]);
+        XMStoreFloat4x4(&boneTransforms[1], B[1] * A[1] * A[0]);
+        XMStoreFloat4x4(&boneTransforms[2], B[2] * A[2] * A[1] * A[0]);
 #endif
-        if (keyframe && keyframe->nodes.size() > 0) {
-            const Animation::Keyframe::Node& meshNode = keyframe->nodes.at(mesh.nodeIndex);
-            XMStoreFloat4x4(&data.world, XMLoadFloat4x4(&meshNode.globalTransform) * XMLoadFloat4x4(&world));
-            const size_t boneCount = mesh.bindPose.bones.size();
-            for (int boneIndex = 0; boneIndex < boneCount; ++boneIndex) {
-                const Skeleton::Bone& bone = mesh.bindPose.bones.at(boneIndex); // bonew
-                const Animation::Keyframe::Node& boneNode = keyframe->nodes.at(bone.nodeIndex); // w肵bone擾
-
-                XMStoreFloat4x4(&data.boneTransforms[boneIndex],
-                    XMLoadFloat4x4(&bone.offsetTransform) *                                 // ƂȂʒu
-                    XMLoadFloat4x4(&boneNode.globalTransform) *                             // ړ̈ʒu
-                    XMMatrixInverse(nullptr, XMLoadFloat4x4(&mesh.defaultGlobalTransform))  // ƂȂʒűts nullptrɓ邱ƂŃ|C^i[vZł̂ݎgƂł
+        if (const XMFLOAT4X4* meshNodeTransform = globalTransform(mesh.nodeIndex)) {
+            palette.meshTransforms.at(meshIndex) = *meshNodeTransform;
+            // 基準となる位置の逆行列はメッシュで共通なのでloadで計算済み
+            const XMMATRIX inverseDefaultGlobalTransform = XMLoadFloat4x4(&mesh.inverseDefaultGlobalTransform);
+            for (size_t boneIndex = 0; boneIndex < boneCount; ++boneIndex) {
+                const Skeleton::Bone& bone = mesh.bindPose.bones.at(boneIndex); // boneを指定
+                const XMFLOAT4X4* boneNodeTransform = globalTransform(bone.nodeIndex); // 指定したboneから情報を取得
+
+                XMStoreFloat4x4(&boneTransforms[boneIndex],
+                    XMLoadFloat4x4(&bone.offsetTransform) *     // 基準となる位置
+                    XMLoadFloat4x4(boneNodeTransform) *         // 移動後の位置
+                    inverseDefaultGlobalTransform               // 基準となる位置の逆行列
                 );
             }
+            if (boneCount == 0) {
+                boneTransforms[0] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+            }
         }
         else {
-            XMStoreFloat4x4(&data.world,
-                XMLoadFloat4x4(&mesh.defaultGlobalTransform) * XMLoadFloat4x4(&world));
-            for (size_t boneIndex = 0; boneIndex < MAX_BONES; ++boneIndex) {
-                data.boneTransforms[boneIndex] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+            palette.meshTransforms.at(meshIndex) = mesh.defaultGlobalTransform;
+            for (size_t boneIndex = 0; boneIndex < std::max<size_t>(boneCount, 1); ++boneIndex) {
+                boneTransforms[boneIndex] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
             }
         }
-        for (const Mesh::Subset& subset : mesh.subsets) {
+    }
+    palette.firstBones.at(meshes.size()) = firstBone;
+}
+
+void SkinnedMesh::render(ID3D11DeviceContext* immediateContext,
+    const XMFLOAT4X4& world, const XMFLOAT4& materialColor,
+    const Animation::Keyframe* keyframe, size_t lod) {
+    if (keyframe && keyframe->nodes.size() > 0) {
+        Palette& renderPalette = draw_state(immediateContext).renderPalette;
+        build_palette(keyframe, renderPalette);
+        render(immediateContext, world, materialColor, renderPalette, lod);
+        return;
+    }
+    render(immediateContext, world, materialColor, bindPosePalette, lod);
+}
+
+void SkinnedMesh::render(ID3D11DeviceContext* immediateContext,
+    const XMFLOAT4X4& world, const XMFLOAT4& materialColor, const Pose& pose, size_t lod) {
+    Palette& renderPalette = draw_state(immediateContext).renderPalette;
+    build_palette(pose, renderPalette);
+    render(immediateContext, world, materialColor, renderPalette, lod);
+}
+
+void SkinnedMesh::render(ID3D11DeviceContext* immediateContext,
+    const XMFLOAT4X4& world, const XMFLOAT4& materialColor, const Palette& palette, size_t lod) {
+    _ASSERT_EXPR(palette.meshTransforms.size() == meshes.size(), L"The palette was built for another model");
+    DrawState& drawState = draw_state(immediateContext);
+    for (size_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex) {
+        Mesh& mesh = meshes.at(meshIndex);
+        DrawState::MeshBones& bones = drawState.meshBones.at(meshIndex);
+        uint32_t stride = mesh.compressed ? sizeof(CompressedVertex) : sizeof(Vertex);
+        uint32_t offset = 0;
+        immediateContext->IASetVertexBuffers(0, 1, mesh.vertexBuffer.GetAddressOf(), &stride, &offset);
+        immediateContext->IASetIndexBuffer(mesh.indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+        immediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        immediateContext->IASetInputLayout(mesh.compressed ? compressedInputLayout.Get() : inputLayout.Get());
+
+        immediateContext->VSSetShader(mesh.compressed ? compressedVertexShader.Get() : vertexShader.Get(), nullptr, 0);
+        immediateContext->PSSetShader(pixelShader.Get(), nullptr, 0);
+
+        // Only this mesh's bones, and only when the buffer doesn't already hold this palette. A command list has to
+        // map a dynamic buffer with DISCARD before using it, whatever the buffer held when it was recorded.
+        const bool immediate = immediateContext->GetType() == D3D11_DEVICE_CONTEXT_IMMEDIATE;
+        if (!immediate || bones.uploadedPalette != palette.version) {
+            const uint32_t firstBone = palette.firstBones.at(meshIndex);
+            const size_t boneBytes = sizeof(XMFLOAT4X4) * (palette.firstBones.at(meshIndex + 1) - firstBone);
+            D3D11_MAPPED_SUBRESOURCE mappedSubresource;
+            HRESULT hr = immediateContext->Map(bones.buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedSubresource);
+            _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+            memcpy(mappedSubresource.pData, palette.boneTransforms.data() + firstBone, boneBytes);
+            immediateContext->Unmap(bones.buffer.Get(), 0);
+            // The command list's upload only lands when it is executed
+            bones.uploadedPalette = immediate ? palette.version : 0;
+            uploadStatistics.boneBytes += boneBytes;
+            ++uploadStatistics.boneUploads;
+        }
+        else {
+            ++uploadStatistics.skippedBoneUploads;
+        }
+        immediateContext->VSSetShaderResources(BONE_BUFFER_SLOT, 1, bones.view.GetAddressOf());
+
+        Constants data;
+        XMStoreFloat4x4(&data.world, XMLoadFloat4x4(&palette.meshTransforms.at(meshIndex)) * XMLoadFloat4x4(&world));
+
+        for (const Mesh::Subset& subset : mesh.lod_subsets(lod)) {
             const Material& material = materials.at(subset.materialUniqueId);
 
             XMStoreFloat4(&data.materialColor, XMLoadFloat4(&materialColor) * XMLoadFloat4(&material.Kd));
 
-            immediateContext->UpdateSubresource(constantBuffer.Get(), 0, 0, &data, 0, 0);
-            immediateContext->VSSetConstantBuffers(0, 1, constantBuffer.GetAddressOf());
+            upload_constants(immediateContext, 0, constantBuffer.Get(), &data, sizeof(data));
+            uploadStatistics.constantBytes += sizeof(Constants);
 
-            immediateContext->PSSetShaderResources(0, 1, material.shaderResouceViews[0].GetAddressOf());
-            immediateContext->PSSetShaderResources(1, 1, material.shaderResouceViews[1].GetAddressOf()); // specularp
+            ID3D11ShaderResourceView* shaderResourceViews[2] = {
+                material.textures[0]->view(),
+                material.textures[1]->view(), // specular用
+            };
+            immediateContext->PSSetShaderResources(0, 2, shaderResourceViews);
 
             immediateContext->DrawIndexed(subset.indexCount, subset.startIndexLocation, 0);
         }
     }
 }
 
+// skin_mesh passes a mesh's vertex array to the kernels as is
+static_assert(sizeof(SkinnedMesh::Vertex) == sizeof(cpu_skinning::SourceVertex), "Vertex and SourceVertex differ");
+static_assert(offsetof(SkinnedMesh::Vertex, tangent) == offsetof(cpu_skinning::SourceVertex, tangent), "Vertex and SourceVertex differ");
+static_assert(offsetof(SkinnedMesh::Vertex, boneWeights) == offsetof(cpu_skinning::SourceVertex, boneWeights), "Vertex and SourceVertex differ");
+static_assert(offsetof(SkinnedMesh::Vertex, boneIndices) == offsetof(cpu_skinning::SourceVertex, boneIndices), "Vertex and SourceVertex differ");
+
+void SkinnedMesh::skin_mesh(size_t meshIndex, const Palette& palette, std::vector<cpu_skinning::SkinnedVertex>& skinned,
+    ThreadPool* threadPool) const {
+    const Mesh& mesh = meshes.at(meshIndex);
+    // A cooked float mesh is still in the mapping, anything else was kept in 'vertices' by create_mesh_buffers
+    const Vertex* meshVertices = mesh.cookedVertices ? mesh.cookedVertices : mesh.vertices.data();
+    const size_t vertexCount = mesh.cookedVertices ? mesh.cookedVertexCount : mesh.vertices.size();
+    skinned.resize(vertexCount);
+    if (vertexCount == 0) {
+        return;
+    }
+
+    // Like render : the mesh's node transform after each bone (a mesh without bones has one identity entry)
+    thread_local std::vector<XMFLOAT4X4> boneTransforms;
+    const XMMATRIX meshTransform = XMLoadFloat4x4(&palette.meshTransforms.at(meshIndex));
+    const uint32_t firstBone = palette.firstBones.at(meshIndex);
+    const uint32_t boneCount = palette.firstBones.at(meshIndex + 1) - firstBone;
+    boneTransforms.resize(boneCount);
+    for (uint32_t bone = 0; bone < boneCount; ++bone) {
+        XMStoreFloat4x4(&boneTransforms.at(bone), XMLoadFloat4x4(&palette.boneTransforms.at(firstBone + bone)) * meshTransform);
+    }
+
+    const cpu_skinning::SourceVertex* vertices = reinterpret_cast<const cpu_skinning::SourceVertex*>(meshVertices);
+    if (threadPool) {
+        cpu_skinning::skin(*threadPool, vertices, vertexCount, boneTransforms.data(), boneTransforms.size(), skinned.data());
+    }
+    else {
+        cpu_skinning::skin(vertices, vertexCount, boneTransforms.data(), boneTransforms.size(), skinned.data());
+    }
+}
+
+void SkinnedMesh::bake_animations(BakedAnimation& baked, float framesPerSecond, ClipSampler::WrapMode wrapMode) const {
+    Palette palette;
+    build_palette(static_cast<const Animation::Keyframe*>(nullptr), palette);
+    baked.reset(static_cast<uint32_t>(palette.boneTransforms.size()), framesPerSecond);
+
+    Pose pose;
+    std::vector<XMFLOAT4X4> boneTransforms(palette.boneTransforms.size());
+    for (const Animation& animation : animationClips) {
+        ClipSampler sampler = clip_sampler(animation, wrapMode);
+        const uint32_t clipIndex = baked.add_clip(sampler.duration(), wrapMode);
+        const BakedAnimation::Clip& clip = baked.clip(clipIndex);
+        for (uint32_t frame = 0; frame < clip.frameCount; ++frame) {
+            sample_animation(sampler, std::min<float>(frame / framesPerSecond, clip.duration), pose);
+            update_pose(pose);
+            build_palette(pose, palette);
+
+            // render multiplies the mesh's node transform into the world matrix; instances only have a world matrix
+            for (size_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex) {
+                const XMMATRIX meshTransform = XMLoadFloat4x4(&palette.meshTransforms.at(meshIndex));
+                for (uint32_t bone = palette.firstBones.at(meshIndex); bone < palette.firstBones.at(meshIndex + 1); ++bone) {
+                    XMStoreFloat4x4(&boneTransforms.at(bone), XMLoadFloat4x4(&palette.boneTransforms.at(bone)) * meshTransform);
+                }
+            }
+            baked.set_frame(clip.firstRow + frame, boneTransforms.data());
+        }
+    }
+}
+
+void SkinnedMesh::render_baked(ID3D11DeviceContext* immediateContext, const BakedAnimation& baked, const BakedInstance* instances,
+    size_t instanceCount, const XMFLOAT4& materialColor, size_t lod) {
+    _ASSERT_EXPR(baked.view(), L"Create the baked animation's texture first");
+    if (instanceCount == 0) {
+        return;
+    }
+
+    // Clip and time become the two rows to blend here, so the shader only does the texel fetches
+    DrawState& drawState = draw_state(immediateContext);
+    std::vector<BakedInstanceData>& bakedInstanceData = drawState.bakedInstanceData;
+    bakedInstanceData.resize(instanceCount);
+    for (size_t instanceIndex = 0; instanceIndex < instanceCount; ++instanceIndex) {
+        const BakedInstance& instance = instances[instanceIndex];
+        const BakedAnimation::FrameAddress address = baked.address(instance.clip, instance.seconds);
+        BakedInstanceData& data = bakedInstanceData[instanceIndex];
+        data.world = instance.world;
+        data.rows[0] = address.rows[0];
+        data.rows[1] = address.rows[1];
+        data.blend = address.blend;
+        data.padding = 0;
+    }
+
+    reserve_structured_buffer(immediateContext, sizeof(BakedInstanceData), instanceCount, drawState.instanceCapacity,
+        drawState.instanceBuffer, drawState.instanceBufferView);
+    D3D11_MAPPED_SUBRESOURCE mappedSubresource;
+    HRESULT hr = immediateContext->Map(drawState.instanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedSubresource);
+    _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+    memcpy(mappedSubresource.pData, bakedInstanceData.data(), sizeof(BakedInstanceData) * instanceCount);
+    immediateContext->Unmap(drawState.instanceBuffer.Get(), 0);
+    uploadStatistics.instanceBytes += sizeof(BakedInstanceData) * instanceCount;
+
+    ID3D11ShaderResourceView* shaderResourceViews[2] = { drawState.instanceBufferView.Get(), baked.view() };
+    immediateContext->VSSetShaderResources(BAKED_INSTANCE_SLOT, 2, shaderResourceViews);
+    immediateContext->PSSetShader(pixelShader.Get(), nullptr, 0);
+    immediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    uint32_t firstBone = 0;
+    for (Mesh& mesh : meshes) {
+        uint32_t stride = mesh.compressed ? sizeof(CompressedVertex) : sizeof(Vertex);
+        uint32_t offset = 0;
+        immediateContext->IASetVertexBuffers(0, 1, mesh.vertexBuffer.GetAddressOf(), &stride, &offset);
+        immediateContext->IASetIndexBuffer(mesh.indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+        immediateContext->IASetInputLayout(mesh.compressed ? compressedInputLayout.Get() : inputLayout.Get());
+        immediateContext->VSSetShader(mesh.compressed ? bakedCompressedVertexShader.Get() : bakedVertexShader.Get(), nullptr, 0);
+
+        BakedConstants data = {};
+        data.firstBone = firstBone;
+        firstBone += static_cast<uint32_t>(std::max<size_t>(std::min<size_t>(mesh.bindPose.bones.size(), MAX_BONES), 1));
+
+        for (const Mesh::Subset& subset : mesh.lod_subsets(lod)) {
+            const Material& material = materials.at(subset.materialUniqueId);
+            XMStoreFloat4(&data.materialColor, XMLoadFloat4(&materialColor) * XMLoadFloat4(&material.Kd));
+            upload_constants(immediateContext, 2, bakedConstantBuffer.Get(), &data, sizeof(data));
+            uploadStatistics.constantBytes += sizeof(BakedConstants);
+
+            ID3D11ShaderResourceView* materialViews[2] = {
+                material.textures[0]->view(),
+                material.textures[1]->view(),
+            };
+            immediateContext->PSSetShaderResources(0, 2, materialViews);
+
+            immediateContext->DrawIndexedInstanced(subset.indexCount, static_cast<UINT>(instanceCount), subset.startIndexLocation, 0, 0);
+        }
+    }
+    _ASSERT_EXPR(firstBone == baked.palette_size(), L"The baked animation was made from another model");
+}
+
+void SkinnedMesh::render_instanced(ID3D11DeviceContext* immediateContext, const Instance* instances, size_t instanceCount) {
+    if (instanceCount == 0) {
+        return;
+    }
+
+    // Group by LOD, and give every distinct palette its place in the bone buffer
+    DrawState& drawState = draw_state(immediateContext);
+    InstanceBatcher& instanceBatcher = drawState.instanceBatcher;
+    std::vector<std::pair<const Palette*, uint32_t>>& sortedPalettes = drawState.sortedPalettes;
+    std::vector<uint32_t>& instanceBoneBases = drawState.instanceBoneBases;
+    instanceBatcher.clear();
+    sortedPalettes.resize(instanceCount);
+    instanceBoneBases.resize(instanceCount);
+    for (size_t instanceIndex = 0; instanceIndex < instanceCount; ++instanceIndex) {
+        const Instance& instance = instances[instanceIndex];
+        const Palette* palette = instance.palette ? instance.palette : &bindPosePalette;
+        _ASSERT_EXPR(palette->meshTransforms.size() == meshes.size(), L"The palette was built for another model");
+        sortedPalettes[instanceIndex] = { palette, static_cast<uint32_t>(instanceIndex) };
+        instanceBatcher.add(this, static_cast<uint32_t>(instance.lod));
+    }
+    instanceBatcher.build();
+    // Instances sharing a palette end up next to each other : each run is one copy of it in the bone buffer
+    std::sort(sortedPalettes.begin(), sortedPalettes.end(),
+        [](const std::pair<const Palette*, uint32_t>& a, const std::pair<const Palette*, uint32_t>& b) {
+            return std::less<const Palette*>()(a.first, b.first);
+        });
+    uint32_t boneCount = 0;
+    uint32_t paletteCount = 0;
+    for (size_t sortedIndex = 0; sortedIndex < instanceCount; ++sortedIndex) {
+        const Palette* palette = sortedPalettes[sortedIndex].first;
+        if (sortedIndex == 0 || palette != sortedPalettes[sortedIndex - 1].first) {
+            boneCount += static_cast<uint32_t>(palette->boneTransforms.size());
+            ++paletteCount;
+        }
+        instanceBoneBases[sortedPalettes[sortedIndex].second] = boneCount - static_cast<uint32_t>(palette->boneTransforms.size());
+    }
+    const std::vector<uint32_t>& order = instanceBatcher.order();
+
+    HRESULT hr = S_OK;
+    D3D11_MAPPED_SUBRESOURCE mappedSubresource;
+    // Palettes without bones (a model without skin) still need an element for the view
+    reserve_structured_buffer(immediateContext, sizeof(XMFLOAT4X4), std::max<size_t>(boneCount, 1), drawState.instancedBoneCapacity,
+        drawState.instancedBoneBuffer, drawState.instancedBoneBufferView);
+    hr = immediateContext->Map(drawState.instancedBoneBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedSubresource);
+    _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+    for (size_t sortedIndex = 0; sortedIndex < instanceCount; ++sortedIndex) {
+        const Palette* palette = sortedPalettes[sortedIndex].first;
+        if (sortedIndex == 0 || palette != sortedPalettes[sortedIndex - 1].first) {
+            memcpy(static_cast<XMFLOAT4X4*>(mappedSubresource.pData) + instanceBoneBases[sortedPalettes[sortedIndex].second],
+                palette->boneTransforms.data(), sizeof(XMFLOAT4X4) * palette->boneTransforms.size());
+        }
+    }
+    immediateContext->Unmap(drawState.instancedBoneBuffer.Get(), 0);
+    uploadStatistics.boneBytes += sizeof(XMFLOAT4X4) * boneCount;
+    uploadStatistics.boneUploads += paletteCount;
+
+    // One block of instances per mesh, each in batch order, so a batch of a mesh is a contiguous range
+    const size_t instancedDataCount = instanceCount * meshes.size();
+    reserve_structured_buffer(immediateContext, sizeof(InstancedData), instancedDataCount, drawState.instancedInstanceCapacity,
+        drawState.instancedInstanceBuffer, drawState.instancedInstanceBufferView);
+    hr = immediateContext->Map(drawState.instancedInstanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedSubresource);
+    _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+    InstancedData* instancedData = static_cast<InstancedData*>(mappedSubresource.pData);
+    for (size_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex) {
+        for (size_t orderIndex = 0; orderIndex < order.size(); ++orderIndex) {
+            const Instance& instance = instances[order[orderIndex]];
+            const Palette* palette = instance.palette ? instance.palette : &bindPosePalette;
+            InstancedData data = {};
+            XMStoreFloat4x4(&data.world, XMLoadFloat4x4(&palette->meshTransforms.at(meshIndex)) * XMLoadFloat4x4(&instance.world));
+            data.materialColor = instance.materialColor;
+            data.firstBone = instanceBoneBases[order[orderIndex]] + palette->firstBones.at(meshIndex);
+            instancedData[meshIndex * instanceCount + orderIndex] = data;
+        }
+    }
+    immediateContext->Unmap(drawState.instancedInstanceBuffer.Get(), 0);
+    uploadStatistics.instanceBytes += sizeof(InstancedData) * instancedDataCount;
+
+    ID3D11ShaderResourceView* shaderResourceViews[2] = { drawState.instancedInstanceBufferView.Get(), drawState.instancedBoneBufferView.Get() };
+    immediateContext->VSSetShaderResources(INSTANCED_INSTANCE_SLOT, 2, shaderResourceViews);
+    immediateContext->PSSetShader(pixelShader.Get(), nullptr, 0);
+    immediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    for (size_t meshIndex = 0; meshIndex < meshes.size(); ++meshIndex) {
+        const Mesh& mesh = meshes.at(meshIndex);
+        uint32_t stride = mesh.compressed ? sizeof(CompressedVertex) : sizeof(Vertex);
+        uint32_t offset = 0;
+        immediateContext->IASetVertexBuffers(0, 1, mesh.vertexBuffer.GetAddressOf(), &stride, &offset);
+        immediateContext->IASetIndexBuffer(mesh.indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+        immediateContext->IASetInputLayout(mesh.compressed ? compressedInputLayout.Get() : inputLayout.Get());
+        immediateContext->VSSetShader(mesh.compressed ? instancedCompressedVertexShader.Get() : instancedVertexShader.Get(), nullptr, 0);
+
+        for (const InstanceBatcher::Batch& batch : instanceBatcher.batches()) {
+            InstancedConstants data = {};
+            data.instanceOffset = static_cast<uint32_t>(meshIndex * instanceCount + batch.first);
+            for (const Mesh::Subset& subset : mesh.lod_subsets(batch.lod)) {
+                const Material& material = materials.at(subset.materialUniqueId);
+                data.materialColor = material.Kd;
+                upload_constants(immediateContext, 2, instancedConstantBuffer.Get(), &data, sizeof(data));
+                uploadStatistics.constantBytes += sizeof(InstancedConstants);
+
+                ID3D11ShaderResourceView* materialViews[2] = {
+                    material.textures[0]->view(),
+                    material.textures[1]->view(),
+                };
+                immediateContext->PSSetShaderResources(0, 2, materialViews);
+
+                immediateContext->DrawIndexedInstanced(subset.indexCount, batch.count, subset.startIndexLocation, 0, 0);
+            }
+        }
+    }
+}
+
+void SkinnedMesh::blend_palettes(const Palette& from, const Palette& to, float factor, Palette& palette) {
+    _ASSERT_EXPR(from.boneTransforms.size() == to.boneTransforms.size() && from.meshTransforms.size() == to.meshTransforms.size(),
+        L"The palettes belong to different models");
+    auto lerp = [factor](const std::vector<XMFLOAT4X4>& a, const std::vector<XMFLOAT4X4>& b, std::vector<XMFLOAT4X4>& result) {
+        result.resize(a.size());
+        for (size_t i = 0; i < a.size(); ++i) {
+            const float* x = &a[i]._11;
+            const float* y = &b[i]._11;
+            float* z = &result[i]._11;
+            for (int element = 0; element < 16; ++element) {
+                z[element] = x[element] + (y[element] - x[element]) * factor;
+            }
+        }
+    };
+    lerp(from.meshTransforms, to.meshTransforms, palette.meshTransforms);
+    lerp(from.boneTransforms, to.boneTransforms, palette.boneTransforms);
+    palette.firstBones = to.firstBones;
+    palette.version = ++paletteVersions;
+}
+
+SkinnedMesh::UploadStatistics SkinnedMesh::upload_statistics() {
+    UploadStatistics statistics;
+    statistics.boneBytes = uploadStatistics.boneBytes;
+    statistics.constantBytes = uploadStatistics.constantBytes;
+    statistics.boneUploads = uploadStatistics.boneUploads;
+    statistics.skippedBoneUploads = uploadStatistics.skippedBoneUploads;
+    statistics.instanceBytes = uploadStatistics.instanceBytes;
+    return statistics;
+}
+
+void SkinnedMesh::reset_upload_statistics() {
+    uploadStatistics.boneBytes = 0;
+    uploadStatistics.constantBytes = 0;
+    uploadStatistics.boneUploads = 0;
+    uploadStatistics.skippedBoneUploads = 0;
+    uploadStatistics.instanceBytes = 0;
+}
+
+// Records stored in the cooked file. Strings are kept in the STRINGS blob and referenced by offset.
+namespace cooked {
+    struct NodeRecord {
+        uint64_t uniqueId;
+        StringRef name;
+        int64_t parentIndex;
+        int32_t attribute;
+        int32_t padding;
+    };
+    struct MeshRecord {
+        uint64_t uniqueId;
+        StringRef name;
+        int64_t nodeIndex;
+        XMFLOAT4X4 defaultGlobalTransform;
+        XMFLOAT3 boundingBox[2];
+        uint32_t firstVertex, vertexCount;
+        uint32_t firstIndex, indexCount;
+        uint32_t firstSubset, subsetCount;
+        uint32_t firstBone, boneCount;
+        uint32_t compressed;    // firstVertex/vertexCount refer to COMPRESSED_VERTICES instead of VERTICES
+        uint32_t reserved;
+        uint32_t firstLod, lodCount; // LOD 1 and up
+    };
+    // Every level has the mesh's subset count of records in SUBSETS, starting at firstSubset
+    struct LodRecord {
+        uint32_t firstSubset;
+        float error;
+    };
+    struct SubsetRecord {
+        uint64_t materialUniqueId;
+        StringRef materialName;
+        uint32_t startIndexLocation;
+        uint32_t indexCount;
+    };
+    struct BoneRecord {
+        uint64_t uniqueId;
+        StringRef name;
+        int64_t parentIndex;
+        int64_t nodeIndex;
+        XMFLOAT4X4 offsetTransform;
+    };
+    struct MaterialRecord {
+        uint64_t uniqueId;
+        StringRef name;
+        XMFLOAT4 Ka, Kd, Ks;
+        StringRef textureFilenames[4];
+    };
+    struct ClipRecord {
+        StringRef name;
+        float samplingRate;
+        uint32_t frameCount;
+        uint32_t nodeCount;
+        uint32_t trackCount;
+        uint32_t keyCount;
+        uint64_t firstRestTransform;    // index into CLIP_REST_POSE
+        uint64_t firstTrack;            // index into CLIP_TRACKS, track keys are relative to firstKey
+        uint64_t firstKey;              // index into CLIP_KEY_FRAMES, CLIP_KEY_VALUES holds 3 values per key
+        CompressedAnimation::Statistics statistics;
+    };
+}
+static_assert(std::is_trivially_copyable_v<SkinnedMesh::Vertex>, "Vertex is written to the cooked file as raw bytes");
+static_assert(sizeof(SkinnedMesh::CompressedVertex) == 32, "CompressedVertex must match the input layout in create_shaders");
+static_assert(std::is_trivially_copyable_v<CompressedAnimation::Transform>, "CompressedAnimation::Transform is written to the cooked file as raw bytes");
+static_assert(std::is_trivially_copyable_v<CompressedAnimation::Track>, "CompressedAnimation::Track is written to the cooked file as raw bytes");
+
+bool SkinnedMesh::read_cooked(const cooked::Reader& reader, Scene& sceneView, std::vector<Mesh>& meshes,
+    std::unordered_map<uint64_t, Material>& materials, std::vector<Animation>& animationClips) {
+    using cooked::BlobType;
+
+    size_t nodeCount = 0, meshCount = 0, subsetCount = 0, lodCount = 0, boneCount = 0, vertexCount = 0, compressedVertexCount = 0, indexCount = 0;
+    size_t materialCount = 0, clipCount = 0, restTransformCount = 0, trackCount = 0, keyFrameCount = 0, keyValueCount = 0;
+    const cooked::NodeRecord* nodeRecords = reader.get<cooked::NodeRecord>(BlobType::NODES, nodeCount);
+    const cooked::MeshRecord* meshRecords = reader.get<cooked::MeshRecord>(BlobType::MESHES, meshCount);
+    const cooked::SubsetRecord* subsetRecords = reader.get<cooked::SubsetRecord>(BlobType::SUBSETS, subsetCount);
+    const cooked::LodRecord* lodRecords = reader.get<cooked::LodRecord>(BlobType::LODS, lodCount);
+    const cooked::BoneRecord* boneRecords = reader.get<cooked::BoneRecord>(BlobType::BONES, boneCount);
+    const Vertex* vertices = reader.get<Vertex>(BlobType::VERTICES, vertexCount);
+    const CompressedVertex* compressedVertices = reader.get<CompressedVertex>(BlobType::COMPRESSED_VERTICES, compressedVertexCount);
+    const uint32_t* indices = reader.get<uint32_t>(BlobType::INDICES, indexCount);
+    const cooked::MaterialRecord* materialRecords = reader.get<cooked::MaterialRecord>(BlobType::MATERIALS, materialCount);
+    const cooked::ClipRecord* clipRecords = reader.get<cooked::ClipRecord>(BlobType::CLIPS, clipCount);
+    const CompressedAnimation::Transform* restTransforms = reader.get<CompressedAnimation::Transform>(BlobType::CLIP_REST_POSE, restTransformCount);
+    const CompressedAnimation::Track* tracks = reader.get<CompressedAnimation::Track>(BlobType::CLIP_TRACKS, trackCount);
+    const uint16_t* keyFrames = reader.get<uint16_t>(BlobType::CLIP_KEY_FRAMES, keyFrameCount);
+    const uint16_t* keyValues = reader.get<uint16_t>(BlobType::CLIP_KEY_VALUES, keyValueCount);
+    if (!nodeRecords || !meshRecords || !subsetRecords || !lodRecords || !boneRecords || !vertices || !compressedVertices || !indices ||
+        !materialRecords || !clipRecords || !restTransforms || !tracks || !keyFrames || !keyValues ||
+        keyValueCount != keyFrameCount * 3) {
+        return false;
+    }
+
+    sceneView.nodes.resize(nodeCount);
+    for (size_t nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+        const cooked::NodeRecord& record = nodeRecords[nodeIndex];
+        Scene::Node& node = sceneView.nodes.at(nodeIndex);
+        node.uniqueId = record.uniqueId;
+        node.name = reader.string(record.name);
+        node.attribute = static_cast<FbxNodeAttribute::EType>(record.attribute);
+        node.parentIndex = record.parentIndex;
+    }
+
+    meshes.resize(meshCount);
+    for (size_t meshIndex = 0; meshIndex < meshCount; ++meshIndex) {
+        const cooked::MeshRecord& record = meshRecords[meshIndex];
+        if (static_cast<size_t>(record.firstVertex) + record.vertexCount > (record.compressed ? compressedVertexCount : vertexCount) ||
+            static_cast<size_t>(record.firstIndex) + record.indexCount > indexCount ||
+            static_cast<size_t>(record.firstSubset) + record.subsetCount > subsetCount ||
+            static_cast<size_t>(record.firstLod) + record.lodCount > lodCount ||
+            static_cast<size_t>(record.firstBone) + record.boneCount > boneCount) {
+            return false;
+        }
+
+        Mesh& mesh = meshes.at(meshIndex);
+        mesh.uniqueId = record.uniqueId;
+        mesh.name = reader.string(record.name);
+        mesh.nodeIndex = record.nodeIndex;
+        mesh.defaultGlobalTransform = record.defaultGlobalTransform;
+        mesh.boundingBox[0] = record.boundingBox[0];
+        mesh.boundingBox[1] = record.boundingBox[1];
+
+        // No copy: create_com_objects hands these pointers to CreateBuffer.
+        if (record.compressed) {
+            mesh.cookedCompressedVertices = compressedVertices + record.firstVertex;
+            mesh.compressed = true;
+        }
+        else {
+            mesh.cookedVertices = vertices + record.firstVertex;
+        }
+        mesh.cookedVertexCount = record.vertexCount;
+        mesh.cookedIndices = indices + record.firstIndex;
+        mesh.cookedIndexCount = record.indexCount;
+
+        auto read_subsets = [&](uint32_t firstSubset, std::vector<Mesh::Subset>& subsets) {
+            subsets.resize(record.subsetCount);
+            for (uint32_t subsetIndex = 0; subsetIndex < record.subsetCount; ++subsetIndex) {
+                const cooked::SubsetRecord& subsetRecord = subsetRecords[firstSubset + subsetIndex];
+                Mesh::Subset& subset = subsets.at(subsetIndex);
+                subset.materialUniqueId = subsetRecord.materialUniqueId;
+                subset.materialName = reader.string(subsetRecord.materialName);
+                subset.startIndexLocation = subsetRecord.startIndexLocation;
+                subset.indexCount = subsetRecord.indexCount;
+                if (static_cast<size_t>(subset.startIndexLocation) + subset.indexCount > record.indexCount) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        if (!read_subsets(record.firstSubset, mesh.subsets)) {
+            return false;
+        }
+        mesh.lods.resize(record.lodCount);
+        for (uint32_t lodIndex = 0; lodIndex < record.lodCount; ++lodIndex) {
+            const cooked::LodRecord& lodRecord = lodRecords[record.firstLod + lodIndex];
+            if (static_cast<size_t>(lodRecord.firstSubset) + record.subsetCount > subsetCount ||
+                !read_subsets(lodRecord.firstSubset, mesh.lods.at(lodIndex).subsets)) {
+                return false;
+            }
+            mesh.lods.at(lodIndex).error = lodRecord.error;
+        }
+
+        mesh.bindPose.bones.resize(record.boneCount);
+        for (uint32_t boneIndex = 0; boneIndex < record.boneCount; ++boneIndex) {
+            const cooked::BoneRecord& boneRecord = boneRecords[record.firstBone + boneIndex];
+            Skeleton::Bone& bone = mesh.bindPose.bones.at(boneIndex);
+            bone.uniqueId = boneRecord.uniqueId;
+            bone.name = reader.string(boneRecord.name);
+            bone.parentIndex = boneRecord.parentIndex;
+            bone.nodeIndex = boneRecord.nodeIndex;
+            bone.offsetTransform = boneRecord.offsetTransform;
+        }
+    }
+
+    for (size_t materialIndex = 0; materialIndex < materialCount; ++materialIndex) {
+        const cooked::MaterialRecord& record = materialRecords[materialIndex];
+        Material material;
+        material.uniqueId = record.uniqueId;
+        material.name = reader.string(record.name);
+        material.Ka = record.Ka;
+        material.Kd = record.Kd;
+        material.Ks = record.Ks;
+        for (size_t textureIndex = 0; textureIndex < 4; ++textureIndex) {
+            material.textureFilenames[textureIndex] = reader.string(record.textureFilenames[textureIndex]);
+        }
+        materials.emplace(material.uniqueId, std::move(material));
+    }
+
+    animationClips.resize(clipCount);
+    for (size_t clipIndex = 0; clipIndex < clipCount; ++clipIndex) {
+        const cooked::ClipRecord& record = clipRecords[clipIndex];
+        if (record.firstRestTransform > restTransformCount || record.nodeCount > restTransformCount - record.firstRestTransform ||
+            record.firstTrack > trackCount || record.trackCount > trackCount - record.firstTrack ||
+            record.firstKey > keyFrameCount || record.keyCount > keyFrameCount - record.firstKey) {
+            return false;
+        }
+
+        Animation& animationClip = animationClips.at(clipIndex);
+        animationClip.name = reader.string(record.name);
+        animationClip.samplingRate = record.samplingRate;
+        // No copy either: the clip samples its keys from the mapping, which stays open as long as the model
+        if (!animationClip.sequence.assign_view(record.frameCount, restTransforms + record.firstRestTransform, record.nodeCount,
+            tracks + record.firstTrack, record.trackCount, keyFrames + record.firstKey, keyValues + record.firstKey * 3,
+            record.keyCount, record.statistics)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SkinnedMesh::save_cooked(const wchar_t* cookedFilename, const cooked::SourceKey& sourceKey) const {
+    using cooked::BlobType;
+    cooked::Writer writer;
+    writer.set_source(sourceKey);
+
+    std::vector<cooked::NodeRecord> nodeRecords;
+    for (const Scene::Node& node : sceneView.nodes) {
+        cooked::NodeRecord& record = nodeRecords.emplace_back();
+        record.uniqueId = node.uniqueId;
+        record.name = writer.add_string(node.name);
+        record.parentIndex = node.parentIndex;
+        record.attribute = static_cast<int32_t>(node.attribute);
+    }
+    writer.add(BlobType::NODES, nodeRecords.data(), nodeRecords.size());
+
+    std::vector<cooked::MeshRecord> meshRecords;
+    for (const Mesh& mesh : meshes) {
+        cooked::MeshRecord& record = meshRecords.emplace_back();
+        record.uniqueId = mesh.uniqueId;
+        record.name = writer.add_string(mesh.name);
+        record.nodeIndex = mesh.nodeIndex;
+        record.defaultGlobalTransform = mesh.defaultGlobalTransform;
+        record.boundingBox[0] = mesh.boundingBox[0];
+        record.boundingBox[1] = mesh.boundingBox[1];
+
+        if (mesh.compressed) {
+            record.firstVertex = static_cast<uint32_t>(writer.add(BlobType::COMPRESSED_VERTICES, mesh.compressedVertices.data(), mesh.compressedVertices.size()));
+            record.vertexCount = static_cast<uint32_t>(mesh.compressedVertices.size());
+        }
+        else {
+            record.firstVertex = static_cast<uint32_t>(writer.add(BlobType::VERTICES, mesh.vertices.data(), mesh.vertices.size()));
+            record.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        }
+        record.compressed = mesh.compressed ? 1 : 0;
+        record.reserved = 0;
+        record.firstIndex = static_cast<uint32_t>(writer.add(BlobType::INDICES, mesh.indices.data(), mesh.indices.size()));
+        record.indexCount = static_cast<uint32_t>(mesh.indices.size());
+
+        auto add_subsets = [&](const std::vector<Mesh::Subset>& subsets) {
+            std::vector<cooked::SubsetRecord> subsetRecords;
+            for (const Mesh::Subset& subset : subsets) {
+                cooked::SubsetRecord& subsetRecord = subsetRecords.emplace_back();
+                subsetRecord.materialUniqueId = subset.materialUniqueId;
+                subsetRecord.materialName = writer.add_string(subset.materialName);
+                subsetRecord.startIndexLocation = subset.startIndexLocation;
+                subsetRecord.indexCount = subset.indexCount;
+            }
+            return static_cast<uint32_t>(writer.add(BlobType::SUBSETS, subsetRecords.data(), subsetRecords.size()));
+        };
+        record.firstSubset = add_subsets(mesh.subsets);
+        record.subsetCount = static_cast<uint32_t>(mesh.subsets.size());
+
+        std::vector<cooked::LodRecord> lodRecords;
+        for (const Mesh::Lod& lod : mesh.lods) {
+            cooked::LodRecord& lodRecord = lodRecords.emplace_back();
+            lodRecord.firstSubset = add_subsets(lod.subsets);
+            lodRecord.error = lod.error;
+        }
+        record.firstLod = static_cast<uint32_t>(writer.add(BlobType::LODS, lodRecords.data(), lodRecords.size()));
+        record.lodCount = static_cast<uint32_t>(lodRecords.size());
+
+        std::vector<cooked::BoneRecord> boneRecords;
+        for (const Skeleton::Bone& bone : mesh.bindPose.bones) {
+            cooked::BoneRecord& boneRecord = boneRecords.emplace_back();
+            boneRecord.uniqueId = bone.uniqueId;
+            boneRecord.name = writer.add_string(bone.name);
+            boneRecord.parentIndex = bone.parentIndex;
+            boneRecord.nodeIndex = bone.nodeIndex;
+            boneRecord.offsetTransform = bone.offsetTransform;
+        }
+        record.firstBone = static_cast<uint32_t>(writer.add(BlobType::BONES, boneRecords.data(), boneRecords.size()));
+        record.boneCount = static_cast<uint32_t>(boneRecords.size());
+    }
+    writer.add(BlobType::MESHES, meshRecords.data(), meshRecords.size());
+    // Make sure every blob exists even when the model has no meshes, bones or clips.
+    writer.add<Vertex>(BlobType::VERTICES, nullptr, 0);
+    writer.add<CompressedVertex>(BlobType::COMPRESSED_VERTICES, nullptr, 0);
+    writer.add<uint32_t>(BlobType::INDICES, nullptr, 0);
+    writer.add<cooked::SubsetRecord>(BlobType::SUBSETS, nullptr, 0);
+    writer.add<cooked::LodRecord>(BlobType::LODS, nullptr, 0);
+    writer.add<cooked::BoneRecord>(BlobType::BONES, nullptr, 0);
+
+    std::vector<cooked::MaterialRecord> materialRecords;
+    for (const std::pair<const uint64_t, Material>& pair : materials) {
+        const Material& material = pair.second;
+        cooked::MaterialRecord& record = materialRecords.emplace_back();
+        record.uniqueId = material.uniqueId;
+        record.name = writer.add_string(material.name);
+        record.Ka = material.Ka;
+        record.Kd = material.Kd;
+        record.Ks = material.Ks;
+        for (size_t textureIndex = 0; textureIndex < 4; ++textureIndex) {
+            record.textureFilenames[textureIndex] = writer.add_string(material.textureFilenames[textureIndex]);
+        }
+    }
+    writer.add(BlobType::MATERIALS, materialRecords.data(), materialRecords.size());
+
+    std::vector<cooked::ClipRecord> clipRecords;
+    writer.add<CompressedAnimation::Transform>(BlobType::CLIP_REST_POSE, nullptr, 0);
+    writer.add<CompressedAnimation::Track>(BlobType::CLIP_TRACKS, nullptr, 0);
+    writer.add<uint16_t>(BlobType::CLIP_KEY_FRAMES, nullptr, 0);
+    writer.add<uint16_t>(BlobType::CLIP_KEY_VALUES, nullptr, 0);
+    for (const Animation& animationClip : animationClips) {
+        const CompressedAnimation& sequence = animationClip.sequence;
+        cooked::ClipRecord& record = clipRecords.emplace_back();
+        record.name = writer.add_string(animationClip.name);
+        record.samplingRate = animationClip.samplingRate;
+        record.frameCount = sequence.frame_count();
+        record.nodeCount = sequence.node_count();
+        record.trackCount = static_cast<uint32_t>(sequence.tracks().size());
+        record.keyCount = static_cast<uint32_t>(sequence.key_frames().size());
+        record.firstRestTransform = writer.add(BlobType::CLIP_REST_POSE, sequence.rest_pose().data(), sequence.rest_pose().size());
+        record.firstTrack = writer.add(BlobType::CLIP_TRACKS, sequence.tracks().data(), sequence.tracks().size());
+        record.firstKey = writer.add(BlobType::CLIP_KEY_FRAMES, sequence.key_frames().data(), sequence.key_frames().size());
+        writer.add(BlobType::CLIP_KEY_VALUES, sequence.key_values().data(), sequence.key_values().size());
+        record.statistics = sequence.statistics();
+    }
+    writer.add(BlobType::CLIPS, clipRecords.data(), clipRecords.size());
+
+    return writer.save(cookedFilename);
+}
+
+void SkinnedMesh::benchmark_load(const char* fbxFilename, int iterations) {
+    std::filesystem::path cerealFilename(fbxFilename);
+    cerealFilename.replace_extension("cereal");
+    std::filesystem::path cookedFilename(fbxFilename);
+    cookedFilename.replace_extension("cooked");
+    if (!std::filesystem::exists(cerealFilename) || !std::filesystem::exists(cookedFilename)) {
+        std::stringstream message;
+        message << "benchmark_load : " << fbxFilename << " has no .cereal/.cooked cache yet, construct it once first\n";
+        OutputDebugStringA(message.str().c_str());
+        return;
+    }
+
+    // The cereal archive is keyed like the cooked file; reuse the cooked file's key so both caches are accepted.
+    cooked::SourceKey sourceKey;
+    {
+        MappedFile cookedFile(cookedFilename.c_str());
+        cooked::Reader cookedReader;
+        if (!cookedReader.open(cookedFile)) {
+            OutputDebugStringA("benchmark_load : cooked file is invalid\n");
+            return;
+        }
+        sourceKey = cookedReader.source();
+    }
+
+    // Both paths are measured up to the point where create_com_objects can upload the data.
+    benchmark timer;
+    float cerealSeconds = 0;
+    float cookedSeconds = 0;
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        Scene scene;
+        std::vector<Mesh> meshes;
+        std::unordered_map<uint64_t, Material> materials;
+        std::vector<Animation> animationClips;
+
+        timer.begin();
+        const bool loaded = read_cereal(cerealFilename, sourceKey, scene, meshes, materials, animationClips);
+        cerealSeconds += timer.end();
+        _ASSERT_EXPR_A(loaded, "benchmark_load : cereal file is stale");
+    }
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        Scene scene;
+        std::vector<Mesh> meshes;
+        std::unordered_map<uint64_t, Material> materials;
+        std::vector<Animation> animationClips;
+
+        timer.begin();
+        MappedFile cookedFile(cookedFilename.c_str());
+        cooked::Reader cookedReader;
+        const bool loaded = cookedReader.open(cookedFile) &&
+            read_cooked(cookedReader, scene, meshes, materials, animationClips);
+        cookedSeconds += timer.end();
+        _ASSERT_EXPR_A(loaded, "benchmark_load : cooked file is invalid");
+    }
+
+    std::stringstream message;
+    message << "SkinnedMesh load benchmark : " << fbxFilename << " (" << iterations << " iterations)\n"
+        << "  cereal : " << cerealSeconds * 1000.0f / iterations << " ms\n"
+        << "  cooked : " << cookedSeconds * 1000.0f / iterations << " ms"
+        << " (x" << (cookedSeconds > 0 ? cerealSeconds / cookedSeconds : 0.0f) << ")\n";
+    OutputDebugStringA(message.str().c_str());
+}
+
+void SkinnedMesh::report_animations(int iterations) const {
+    benchmark timer;
+    Animation::Keyframe keyframe;
+    std::stringstream message;
+    message << "SkinnedMesh animation clips : " << animationClips.size() << "\n";
+    for (const Animation& animationClip : animationClips) {
+        const CompressedAnimation& sequence = animationClip.sequence;
+        const CompressedAnimation::Statistics& statistics = sequence.statistics();
+        // What a vector<Keyframe> of full nodes used to take for the same clip.
+        const size_t uncompressedBytes = sequence.frame_count() *
+            (sizeof(Animation::Keyframe) + sequence.node_count() * sizeof(Animation::Keyframe::Node));
+        const size_t compressedBytes = sequence.memory_size();
+
+        float seconds = 0;
+        if (sequence.frame_count() > 0) {
+            timer.begin();
+            for (int iteration = 0; iteration < iterations; ++iteration) {
+                for (uint32_t frame = 0; frame < sequence.frame_count(); ++frame) {
+                    sample_animation(animationClip, static_cast<float>(frame) + 0.5f, keyframe);
+                }
+            }
+            seconds = timer.end() / (static_cast<float>(iterations) * sequence.frame_count());
+        }
+
+        message << "  " << animationClip.name << " : " << sequence.frame_count() << " frames, " << sequence.node_count() << " nodes\n"
+            << "    memory   : " << uncompressedBytes / 1024.0f << " KB -> " << compressedBytes / 1024.0f << " KB"
+            << " (x" << (compressedBytes > 0 ? static_cast<float>(uncompressedBytes) / compressedBytes : 0.0f) << ")\n"
+            << "    channels : " << statistics.animatedChannels << " animated, " << statistics.constantChannels << " constant\n"
+            << "    keys     : " << statistics.keyCount << " / " << statistics.sourceKeyCount << "\n"
+            << "    error    : rotation " << XMConvertToDegrees(statistics.maxRotationError) << " deg, translation "
+            << statistics.maxTranslationError << ", scaling " << statistics.maxScalingError << "\n"
+            << "    sample   : " << seconds * 1000000.0f << " us\n";
+    }
+    OutputDebugStringA(message.str().c_str());
+}
+
 inline XMFLOAT4X4 to_xmfloat4x4(const FbxAMatrix& fbxamatrix) {
     XMFLOAT4X4 xmfloat4x4;
     for (int row = 0; row < 4; ++row) {
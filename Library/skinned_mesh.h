@@ -5,6 +5,9 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <algorithm>
+#include <memory>
+#include <mutex>
 #include <fbxsdk.h>
 
 #include <cereal/archives/binary.hpp>
@@ -13,6 +16,17 @@
 #include <cereal/types/set.hpp>
 #include <cereal/types/unordered_map.hpp>
 
+#include "cooked_model.h"
+#include "compressed_animation.h"
+#include "clip_sampler.h"
+#include "blend_tree.h"
+#include "baked_animation.h"
+#include "cpu_skinning.h"
+#include "instance_batcher.h"
+#include "pose.h"
+#include "async_loader.h"
+#include "texture.h"
+
 using namespace DirectX;
 
 namespace DirectX {
@@ -82,6 +96,16 @@ struct Scene {
         }
         return -1;
     }
+    int64_t indexof(const std::string& name) const {
+        int64_t index = 0;
+        for (const Node& node : nodes) {
+            if (node.name == name) {
+                return index;
+            }
+            ++index;
+        }
+        return -1;
+    }
     template<class T>
     void serialize(T& archive) {
         archive(nodes);
@@ -103,11 +127,29 @@ public:
             archive(position, normal, tangent, texcoord, boneWeights, boneIndices);
         }
     };
+    // Opt-in 32 byte layout ('compressVertices', cook_settings.txt 'compress_vertices'), encoded at cook time
+    // and decoded by skinned_mesh_compressed_vs.hlsl. See vertex_compression.h for the encodings.
+    struct CompressedVertex {
+        DirectX::XMFLOAT3 position;
+        int16_t normal[2];                          // R16G16_SNORM octahedral
+        int16_t tangent[2];                         // R16G16_SINT octahedral, bitangent sign in the lowest bit of y
+        uint16_t texcoord[2];                       // R16G16_FLOAT
+        uint8_t boneWeights[MAX_BONE_INFLUENCES];   // R8G8B8A8_UNORM
+        uint8_t boneIndices[MAX_BONE_INFLUENCES];   // R8G8B8A8_UINT, MAX_BONES is 256
+    };
     static const int MAX_BONES = 256;
+    // Vertex shader slot of the bone buffer, register(t8) in skinned_mesh.hlsli
+    static const UINT BONE_BUFFER_SLOT = 8;
+    // render_baked's instances and BakedAnimation texture, register(t9) and register(t10) in skinned_mesh_baked.hlsli
+    static const UINT BAKED_INSTANCE_SLOT = 9;
+    static const UINT BAKED_PALETTE_SLOT = 10;
+    // render_instanced's instances and bones, the same registers in skinned_mesh_instanced.hlsli
+    static const UINT INSTANCED_INSTANCE_SLOT = 9;
+    static const UINT INSTANCED_BONE_SLOT = 10;
+    // Updated per subset. The skinning matrices are in each mesh's bone buffer, uploaded once per mesh (see render).
     struct Constants {
         DirectX::XMFLOAT4X4 world;
         DirectX::XMFLOAT4 materialColor;
-        DirectX::XMFLOAT4X4 boneTransforms[MAX_BONES] = { { 1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1 } };
     };
     struct Skeleton {
         struct Bone {
@@ -149,6 +191,8 @@ public:
         std::string name;
         float samplingRate = 0;
 
+        // Pose buffer : the local transforms of every scene node at one point of a clip, plus the global
+        // matrices update_animation derives from them. Clips themselves only store compressed local transforms.
         struct Keyframe {
             struct Node {
                 // 'globalTransform' is used to convert from local space of node to global space of scene.
@@ -171,7 +215,9 @@ public:
                 archive(nodes);
             }
         };
-        std::vector<Keyframe> sequence;
+        // Sampled local transforms of every node, see compressed_animation.h. Decoded by sample_animation.
+        CompressedAnimation sequence;
+        uint32_t frame_count() const { return sequence.frame_count(); }
         template<class T>
         void serialize(T& archive) {
             archive(name, samplingRate, sequence);
@@ -180,7 +226,7 @@ public:
     std::vector<Animation> animationClips;
     template<class T>
     void serialize(T& archive) {
-        archive(animationClips); // VACY肪Ă邩ǂ̔f
+        archive(animationClips); // シリアライズ問題が解決してるかどうかの判断がつかん
     }
 
     struct Mesh {
@@ -192,7 +238,13 @@ public:
         std::vector<Vertex> vertices;
         std::vector<uint32_t> indices;
 
+        // Filled by compress_vertices. Uploaded instead of 'vertices' when 'compressed'.
+        std::vector<CompressedVertex> compressedVertices;
+        bool compressed = false;
+
         DirectX::XMFLOAT4X4 defaultGlobalTransform = { 1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1 };
+        // Inverse of defaultGlobalTransform, which every skinning matrix ends with. Filled by load.
+        DirectX::XMFLOAT4X4 inverseDefaultGlobalTransform = { 1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1 };
 
         struct Subset {
             uint64_t materialUniqueId = 0;
@@ -207,6 +259,24 @@ public:
         };
         std::vector<Subset> subsets;
 
+        // A simplified level of detail, see build_lods. Its subsets are in the same order and have the same
+        // materials as 'subsets', with index ranges further down 'indices'. Every level draws from 'vertices'.
+        struct Lod {
+            std::vector<Subset> subsets;
+            float error = 0; // largest deviation from the full mesh, in mesh units
+            template<class T>
+            void serialize(T& archive) {
+                archive(subsets, error);
+            }
+        };
+        // LOD 1 and up, coarser each. LOD 0 is 'subsets'.
+        std::vector<Lod> lods;
+        size_t lod_count() const { return lods.size() + 1; }
+        // 'lod' past the last level gives the coarsest one
+        const std::vector<Subset>& lod_subsets(size_t lod) const {
+            return lod == 0 || lods.empty() ? subsets : lods.at(std::min<size_t>(lod, lods.size()) - 1).subsets;
+        }
+
         Skeleton bindPose;
 
         DirectX::XMFLOAT3 boundingBox[2] = {
@@ -217,11 +287,19 @@ public:
         template<class T>
         void serialize(T& archive) {
             archive(uniqueId, name, nodeIndex, subsets,  defaultGlobalTransform,
-                bindPose, boundingBox, vertices, indices);
+                bindPose, boundingBox, vertices, indices, lods);
         }
     private:
         Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
         Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+
+        // Views into a memory-mapped cooked file. Dropped once create_com_objects has uploaded them, except the float
+        // vertices and indices 'retainCpuVertices' keeps for skin_mesh.
+        const Vertex* cookedVertices = nullptr;
+        const CompressedVertex* cookedCompressedVertices = nullptr;
+        size_t cookedVertexCount = 0;
+        const uint32_t* cookedIndices = nullptr;
+        size_t cookedIndexCount = 0;
         friend class SkinnedMesh;
     };
     std::vector<Mesh> meshes;
@@ -229,9 +307,9 @@ public:
         uint64_t uniqueId = 0;
         std::string name;
 
-        DirectX::XMFLOAT4 Ka = { 0.2f,0.2f,0.2f,1.0f }; // Ambient  
-        DirectX::XMFLOAT4 Kd = { 0.8f,0.8f,0.8f,1.0f }; // Diffuse  A
-        DirectX::XMFLOAT4 Ks = { 1.0f,1.0f,1.0f,1.0f }; // Specular 
+        DirectX::XMFLOAT4 Ka = { 0.2f,0.2f,0.2f,1.0f }; // Ambient  環境光
+        DirectX::XMFLOAT4 Kd = { 0.8f,0.8f,0.8f,1.0f }; // Diffuse  陰
+        DirectX::XMFLOAT4 Ks = { 1.0f,1.0f,1.0f,1.0f }; // Specular 光沢
 
         std::string textureFilenames[4];
         template<class T>
@@ -239,7 +317,7 @@ public:
             archive(uniqueId, name, Ka, Kd, Ks, textureFilenames);
         }
 
-        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResouceViews[4];
+        std::shared_ptr<Texture> textures[4]; // from the shared texture cache, bind view()
     };
     std::unordered_map<uint64_t, Material> materials;
 
@@ -247,22 +325,115 @@ private:
     Microsoft::WRL::ComPtr<ID3D11VertexShader> vertexShader;
     Microsoft::WRL::ComPtr<ID3D11PixelShader> pixelShader;
     Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+    // Only created when a mesh is compressed
+    Microsoft::WRL::ComPtr<ID3D11VertexShader> compressedVertexShader;
+    Microsoft::WRL::ComPtr<ID3D11InputLayout> compressedInputLayout;
     Microsoft::WRL::ComPtr<ID3D11Buffer> constantBuffer;
+    // render_baked
+    struct BakedInstanceData {
+        DirectX::XMFLOAT4X4 world;
+        uint32_t rows[2];
+        float blend;
+        uint32_t padding;
+    };
+    struct BakedConstants {
+        DirectX::XMFLOAT4 materialColor;
+        uint32_t firstBone;
+        uint32_t padding[3];
+    };
+    Microsoft::WRL::ComPtr<ID3D11VertexShader> bakedVertexShader;
+    Microsoft::WRL::ComPtr<ID3D11VertexShader> bakedCompressedVertexShader;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> bakedConstantBuffer;
+    // render_instanced
+    struct InstancedData {
+        DirectX::XMFLOAT4X4 world;          // the mesh's node transform folded in
+        DirectX::XMFLOAT4 materialColor;
+        uint32_t firstBone;                 // this mesh's first bone in the bone buffer
+        uint32_t padding[3];
+    };
+    struct InstancedConstants {
+        DirectX::XMFLOAT4 materialColor;
+        uint32_t instanceOffset;            // SV_InstanceID doesn't count StartInstanceLocation
+        uint32_t padding[3];
+    };
+    Microsoft::WRL::ComPtr<ID3D11VertexShader> instancedVertexShader;
+    Microsoft::WRL::ComPtr<ID3D11VertexShader> instancedCompressedVertexShader;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> instancedConstantBuffer;
 public:
-    SkinnedMesh(ID3D11Device* device, const char* fbxFilename, bool triangulate = false,float samplingRate = 0);
+    // 'compressVertices' : meshes use CompressedVertex, except those whose encoding error exceeds the bounds in vertex_compression.h.
+    // 'retainCpuVertices' : keep each mesh's vertices and indices after the upload, for skin_mesh.
+    SkinnedMesh(ID3D11Device* device, const char* fbxFilename, bool triangulate = false,float samplingRate = 0,
+        bool compressVertices = false, bool retainCpuVertices = false);
     virtual ~SkinnedMesh() = default;
 
+    // Same as the constructor without blocking : the cache/FBX parsing runs on 'loader's worker threads, and
+    // the buffers and shaders are created by later AsyncLoader::finalize calls. Textures stream in through the texture cache.
+    static AsyncHandle<SkinnedMesh> load_async(AsyncLoader& loader, ID3D11Device* device, const char* fbxFilename,
+        bool triangulate = false, float samplingRate = 0, bool compressVertices = false, bool retainCpuVertices = false);
+
     void fetch_meshes(FbxScene* fbxScene, std::vector<Mesh>& meshes);
 
+    // Welds one imported mesh, builds its LODs and reorders them (see mesh_optimizer.h), LOD 0's subset ranges unchanged.
+    static void optimize_mesh(Mesh& mesh);
+
+    // Levels of detail build_lods generates per mesh, LOD 0 included. Each halves the triangles of the one before,
+    // as far as MAX_LOD_ERROR of the mesh's bounding box diagonal allows.
+    static const int MAX_LODS = 4;
+    static constexpr float MAX_LOD_ERROR = 0.05f;
+
+    // Appends the simplified levels of 'mesh' (see mesh_simplifier.h) to its index buffer, 'vertexCount' welded
+    // vertices in use. Fewer levels are kept when simplification stops paying off.
+    static void build_lods(Mesh& mesh, size_t vertexCount);
+
+    // Encodes 'mesh.vertices' into 'mesh.compressedVertices' and measures the error. Returns false, leaving the
+    // mesh uncompressed, if the error exceeds the bounds. Results go to the output window.
+    static bool compress_vertices(Mesh& mesh);
+
     void fetch_materials(FbxScene* fbxScene, std::unordered_map<uint64_t, Material>& materials);
 
     void fetch_skeleton(FbxMesh* fbxMesh, Skeleton& bindPose);
 
     void fetch_animations(FbxScene* fbxScene, std::vector<Animation>& animationClips,
-        float samplingRate /* If this value is 0, the animation data will be sampled at the default frame rate. */); // :samplingRate̒l0̏ꍇanimation datadefaultframeRate̒lsampling(o)
+        float samplingRate /* If this value is 0, the animation data will be sampled at the default frame rate. */); // 訳:samplingRateの値が0の場合animation dataがdefaultのframeRateの値でsampling(取り出す)する
+
+    // Decodes the local transforms of 'animation' at 'frame' (fractional frames interpolate) into 'keyframe'.
+    // Call update_animation afterwards to rebuild the global matrices render needs.
+    void sample_animation(const Animation& animation, float frame, Animation::Keyframe& keyframe) const;
 
     void update_animation(Animation::Keyframe& keyframe);
 
+    // Structure-of-arrays counterparts of sample_animation/update_animation (see pose.h). 'pose' is resized to the scene's node count.
+    void sample_animation(const Animation& animation, float frame, Pose& pose) const;
+
+    // Time-based playback : 'seconds' into 'sampler's clip, wrapped and interpolated (see clip_sampler.h).
+    // Make the sampler with clip_sampler, one per playing instance.
+    static ClipSampler clip_sampler(const Animation& animation, ClipSampler::WrapMode wrapMode = ClipSampler::WrapMode::LOOP,
+        CompressedAnimation::RotationInterpolation rotationInterpolation = CompressedAnimation::RotationInterpolation::NLERP);
+    void sample_animation(ClipSampler& sampler, float seconds, Animation::Keyframe& keyframe) const;
+    void sample_animation(ClipSampler& sampler, float seconds, Pose& pose) const;
+    // Only the nodes whose 'nodeMask' flag is set are decoded; the others keep what 'pose' held (frozen). A pose
+    // that doesn't have the scene's node count yet is sampled in full.
+    void sample_animation(ClipSampler& sampler, float seconds, Pose& pose, const uint8_t* nodeMask) const;
+    // Animation LOD (see animation_system.h) : every node but the last REDUCED_FROZEN_LEVELS of each chain, so
+    // fingers, toes and other leaf bones stay frozen
+    static const int REDUCED_FROZEN_LEVELS = 1;
+    const uint8_t* reduced_joint_mask() const { return reducedJointMask.data(); }
+    size_t reduced_joint_count() const { return reducedJointCount; }
+    // Flags 'nodes' and all their ancestors, which their global transforms depend on
+    void joint_mask(const uint32_t* nodes, size_t nodeCount, std::vector<uint8_t>& mask) const;
+    void update_pose(Pose& pose) const;
+    const Pose::Hierarchy& pose_hierarchy() const { return poseHierarchy; }
+
+    // Blend trees (see blend_tree.h) : clips are added with the Animation's sequence and samplingRate, then the
+    // tree is prepared for this scene's nodes. evaluate's Pose goes to update_pose and render.
+    void prepare_blend_tree(BlendTree& tree) const { tree.prepare(sceneView.nodes.size()); }
+    // Scene node 'nodeName' and its descendants, e.g. the spine for an upper body layer.
+    BoneMask bone_mask(const char* nodeName, float weight = 1.0f) const;
+
+    // Joints per second of update_animation's former per-node AoS routine against Pose::update (SSE and AVX) for
+    // 1, 100 and 1000 characters. Results go to the output window.
+    void benchmark_pose(int iterations = 10) const;
+
     bool append_animations(const char* animationFilename, float samplingRate);
 
     void blend_animations(const Animation::Keyframe* keyframes[2], float factor,
@@ -270,7 +441,202 @@ public:
 
     void create_com_objects(ID3D11Device* device, const char* fbxFilename);
 
-    void render(ID3D11DeviceContext* immediateContext, const XMFLOAT4X4& world, const XMFLOAT4& materialColor,const Animation::Keyframe* keyframe);
+    // Everything render needs from an animated pose : the model-space matrix of each mesh's node and its skinning
+    // matrices. build_palette only reads the model, so every instance can build its own on a worker thread and
+    // render just copies it into the constant buffer (see animation_system.h).
+    struct Palette {
+        std::vector<DirectX::XMFLOAT4X4> meshTransforms;    // one per mesh
+        std::vector<DirectX::XMFLOAT4X4> boneTransforms;    // every mesh's bones, one mesh after another
+        std::vector<uint32_t> firstBones;                   // each mesh's first entry in boneTransforms
+        uint64_t version = 0;                               // unique to each build, so render can skip re-uploading it
+    };
+    // 'pose' : after update_pose. Reuses 'palette's storage, so rebuilding the same instance doesn't allocate.
+    void build_palette(const Pose& pose, Palette& palette) const;
+    // 'keyframe' : after update_animation, or null for the bind pose
+    void build_palette(const Animation::Keyframe* keyframe, Palette& palette) const;
+
+    // 'lod' : level of detail to draw, from select_lod. Meshes with fewer levels draw their coarsest one.
+    void render(ID3D11DeviceContext* immediateContext, const XMFLOAT4X4& world, const XMFLOAT4& materialColor,const Animation::Keyframe* keyframe,
+        size_t lod = 0);
+    // 'pose' : after update_pose
+    void render(ID3D11DeviceContext* immediateContext, const XMFLOAT4X4& world, const XMFLOAT4& materialColor, const Pose& pose,
+        size_t lod = 0);
+    // 'palette' : from build_palette. Every device context has its own bone buffers, so passes recorded on different
+    // deferred contexts can draw this model at once. On the immediate context a mesh skips its bone upload when its
+    // buffer already holds 'palette'; a deferred context always uploads.
+    void render(ID3D11DeviceContext* immediateContext, const XMFLOAT4X4& world, const XMFLOAT4& materialColor, const Palette& palette,
+        size_t lod = 0);
+
+    // CPU skinning (see cpu_skinning.h) of mesh 'meshIndex' with 'palette', the same blend the vertex shader does,
+    // into 'skinned' in model space : one entry per vertex of the mesh. The vertices only outlive the upload
+    // with 'retainCpuVertices'. Compressed meshes are skinned from their decoded vertices, as the GPU sees them.
+    // 'threadPool' splits large meshes over its workers.
+    void skin_mesh(size_t meshIndex, const Palette& palette, std::vector<cpu_skinning::SkinnedVertex>& skinned,
+        ThreadPool* threadPool = nullptr) const;
+
+    // Bytes render sent to the GPU since the last reset, every SkinnedMesh together, whichever thread recorded them.
+    // Read and reset them while no pass is being recorded.
+    struct UploadStatistics {
+        uint64_t boneBytes = 0;         // bone buffers
+        uint64_t constantBytes = 0;     // per-subset constants
+        uint32_t boneUploads = 0;
+        uint32_t skippedBoneUploads = 0; // the bone buffer already held the palette
+        uint64_t instanceBytes = 0;     // render_baked's and render_instanced's instance buffers
+    };
+    static UploadStatistics upload_statistics();
+    static void reset_upload_statistics();
+
+    // Baked crowds (see baked_animation.h) : every clip's palettes sampled 'framesPerSecond' times a second, each
+    // bone with its mesh's node transform folded in. CPU only; create the texture with BakedAnimation::create_texture.
+    void bake_animations(BakedAnimation& baked, float framesPerSecond = 30.0f,
+        ClipSampler::WrapMode wrapMode = ClipSampler::WrapMode::LOOP) const;
+    struct BakedInstance {
+        DirectX::XMFLOAT4X4 world;
+        uint32_t clip = 0;
+        float seconds = 0;
+    };
+    // Draws every instance with one DrawIndexedInstanced per subset. 'baked' : from this model, texture created.
+    void render_baked(ID3D11DeviceContext* immediateContext, const BakedAnimation& baked, const BakedInstance* instances,
+        size_t instanceCount, const XMFLOAT4& materialColor, size_t lod = 0);
+
+    // Many instances of this model, each with its own palette and LOD. Instances are grouped by LOD (InstanceBatcher)
+    // and their world matrices, colors and the palettes they use go into two per-frame buffers, so each subset is
+    // one DrawIndexedInstanced per LOD instead of a constant buffer update and a DrawIndexed per instance.
+    // Instances sharing a palette share its bones.
+    struct Instance {
+        DirectX::XMFLOAT4X4 world;
+        DirectX::XMFLOAT4 materialColor = { 1, 1, 1, 1 };
+        const Palette* palette = nullptr;   // from build_palette; null for the bind pose
+        size_t lod = 0;
+    };
+    void render_instanced(ID3D11DeviceContext* immediateContext, const Instance* instances, size_t instanceCount);
+
+    // Per-matrix lerp of two palettes of this model into 'palette', a new version. Cheaper than evaluating a pose,
+    // and close enough between two poses a few frames apart (animation LOD).
+    static void blend_palettes(const Palette& from, const Palette& to, float factor, Palette& palette);
+
+    // Diameter in pixels the model's bind pose bounding sphere covers on screen, FLT_MAX when the camera is inside it.
+    float projected_size(const XMFLOAT4X4& world, const XMFLOAT4X4& view, const XMFLOAT4X4& projection, float viewportHeight) const;
+    // World-space bounding sphere of the bind pose
+    void bounding_sphere(const XMFLOAT4X4& world, XMFLOAT3& center, float& radius) const;
+    // Model-space bounding box of the bind pose (all meshes), for FrustumCuller::add
+    void bounding_box(XMFLOAT3& minimum, XMFLOAT3& maximum) const {
+        minimum = boundingBoxMin;
+        maximum = boundingBoxMax;
+    }
+
+    // Coarsest level whose simplification error covers at most 'maxPixelError' pixels at 'projectedSize' (projected_size).
+    // 'currentLod' is the level this instance drew last frame : going coarser needs 'hysteresis' of extra margin, so a
+    // model sitting on a threshold doesn't flip between two levels every frame.
+    size_t select_lod(float projectedSize, size_t currentLod, float maxPixelError = 1.0f, float hysteresis = 0.25f) const;
+    size_t lod_count() const { return lodErrors.size(); }
+
+    // Cooked binary cache (see cooked_model.h). Vertex and index arrays are not copied out of the
+    // mapping; the caller has to keep 'reader's file mapped until create_com_objects has run.
+    static bool read_cooked(const cooked::Reader& reader, Scene& sceneView, std::vector<Mesh>& meshes,
+        std::unordered_map<uint64_t, Material>& materials, std::vector<Animation>& animationClips);
+    bool save_cooked(const wchar_t* cookedFilename, const cooked::SourceKey& sourceKey) const;
+
+    // Hash of the FBX plus the import parameters. Caches built with a different key are never used.
+    static cooked::SourceKey source_key(const char* fbxFilename, bool triangulate, float samplingRate, bool compressVertices = false);
+
+    // Headless import for the asset cooker: writes the '.cooked' file next to the FBX without a D3D device.
+    // Does nothing if the existing '.cooked' file already matches the source and parameters, unless 'force'.
+    static cooked::CookResult cook(const char* fbxFilename, bool triangulate = false, float samplingRate = 0,
+        bool compressVertices = false, bool force = false);
+
+    // '.baked' file next to the FBX, written by cook_baked_animations and read with BakedAnimation::load and source_key
+    static std::filesystem::path baked_filename(const char* fbxFilename);
+    static cooked::CookResult cook_baked_animations(const char* fbxFilename, bool triangulate = false, float samplingRate = 0,
+        bool compressVertices = false, float framesPerSecond = 30.0f, bool force = false);
+
+    // Compares the time spent reading the '.cereal' cache against the '.cooked' cache of 'fbxFilename'.
+    // Both caches must already exist, i.e. the SkinnedMesh has been constructed once. Results go to the output window.
+    static void benchmark_load(const char* fbxFilename, int iterations = 10);
+
+    // Memory of every clip before/after compression, its worst error and the time sample_animation takes.
+    // Results go to the output window.
+    void report_animations(int iterations = 10) const;
 protected:
     Scene sceneView;
+
+private:
+    SkinnedMesh() = default;
+
+    // CPU side of loading : the cooked file, else the cereal cache, else the FBX. A cooked file stays mapped as
+    // long as the model : the animation clips and retained vertices are read from it in place. Returns false if
+    // the FBX can't be imported.
+    bool load(const char* fbxFilename, bool triangulate, float samplingRate, bool compressVertices);
+    MappedFile cookedFile;
+    bool retainCpuVertices = false;
+
+    // Bind pose bounding box and sphere of all meshes and the largest error of each LOD among them, in model units.
+    // Filled by load for projected_size, select_lod and bounding_box.
+    void update_lod_metrics();
+    DirectX::XMFLOAT3 boundingBoxMin = { 0,0,0 };
+    DirectX::XMFLOAT3 boundingBoxMax = { 0,0,0 };
+    DirectX::XMFLOAT3 boundingSphereCenter = { 0,0,0 };
+    float boundingSphereRadius = 0;
+    std::vector<float> lodErrors;
+
+    // Built from sceneView by load
+    Pose::Hierarchy poseHierarchy;
+    std::vector<uint8_t> reducedJointMask;
+    size_t reducedJointCount = 0;
+    void build_pose_hierarchy();
+
+    // 'globalTransform(nodeIndex)' gives the animated model-space matrix of a node, or null for the bind pose.
+    template<class GlobalTransform>
+    void build_palette(GlobalTransform globalTransform, Palette& palette) const;
+    // Built by load : a model drawn in its bind pose every frame keeps the same version and isn't re-uploaded.
+    // Only read while drawing.
+    Palette bindPosePalette;
+
+    // Everything the draws write, one per device context. Passes recorded in parallel on their own deferred
+    // contexts can draw the same model without sharing buffers or scratch.
+    struct DrawState {
+        Microsoft::WRL::ComPtr<ID3D11DeviceContext> context; // keeps the key's address from being reused
+        // StructuredBuffer of each mesh's skinning matrices, one entry per bone (at least one)
+        struct MeshBones {
+            Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+            Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> view;
+            uint64_t uploadedPalette = 0; // Palette::version the buffer holds (0 : unknown, e.g. after a command list wrote it)
+        };
+        std::vector<MeshBones> meshBones;
+        // Scratch of the Keyframe/Pose render overloads
+        Palette renderPalette;
+        // render_baked
+        Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> instanceBufferView;
+        size_t instanceCapacity = 0;
+        std::vector<BakedInstanceData> bakedInstanceData;
+        // render_instanced : the instances grouped by LOD, every instance's palette sorted by address (the runs are
+        // the distinct palettes) and where its palette's bones start in the bone buffer. Flat and reused.
+        InstanceBatcher instanceBatcher;
+        std::vector<std::pair<const Palette*, uint32_t>> sortedPalettes; // palette, instance
+        std::vector<uint32_t> instanceBoneBases;
+        Microsoft::WRL::ComPtr<ID3D11Buffer> instancedInstanceBuffer;
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> instancedInstanceBufferView;
+        size_t instancedInstanceCapacity = 0;
+        Microsoft::WRL::ComPtr<ID3D11Buffer> instancedBoneBuffer;
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> instancedBoneBufferView;
+        size_t instancedBoneCapacity = 0;
+    };
+    std::mutex drawStateMutex;
+    std::unordered_map<ID3D11DeviceContext*, std::unique_ptr<DrawState>> drawStates;
+    // 'context's state, with a bone buffer for every mesh. Only the lookup locks : a context is used by one thread at a time.
+    DrawState& draw_state(ID3D11DeviceContext* context);
+    // Fills each mesh's inverseDefaultGlobalTransform. Called by load.
+    void precompute_skinning();
+
+    // The steps of create_com_objects, which load_async runs one at a time on the main thread.
+    void create_mesh_buffers(ID3D11Device* device, Mesh& mesh);
+    void create_material_views(ID3D11Device* device, const char* fbxFilename, Material& material);
+    void create_shaders(ID3D11Device* device);
+    static std::filesystem::path texture_filename(const char* fbxFilename, const Material& material, size_t textureIndex);
+
+    bool import_fbx(const char* fbxFilename, bool triangulate, float samplingRate);
+    static bool read_cereal(const std::filesystem::path& cerealFilename, const cooked::SourceKey& sourceKey,
+        Scene& sceneView, std::vector<Mesh>& meshes, std::unordered_map<uint64_t, Material>& materials,
+        std::vector<Animation>& animationClips);
 };
\ No newline at end of file
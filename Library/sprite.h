@@ -2,20 +2,22 @@
 #include <d3d11.h>
 #include <directxmath.h>
 #include <wrl.h>
+#include <memory>
+#include "texture.h"
 #include <string>
 
 
 class Sprite {
 private:
-    // oϐ
+    // メンバ変数
     Microsoft::WRL::ComPtr<ID3D11VertexShader> vertexShader;
     Microsoft::WRL::ComPtr<ID3D11PixelShader> pixelShader;
     Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
     Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
-    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResourceView;
+    std::shared_ptr<Texture> texture;
     D3D11_TEXTURE2D_DESC texture2dDesc;
 public:
-    // o֐
+    // メンバ関数
     void render(ID3D11DeviceContext* immediateContext,
         float dx,float dy,float dw,float dh,
         float r,float g,float b,float a,
@@ -36,7 +38,7 @@ public:
     void textout(ID3D11DeviceContext* immediateContext, std::string s,
         float x, float y, float w, float h, float r, float g, float b, float a);
 
-    // _(x,y)_(cx,cy)𒆐SɊp(angle)ŉ]̍WvZ֐(inline)
+    // 点(x,y)が点(cx,cy)を中心に角(angle)で回転した時の座標を計算する関数(inline)
     void rotate(float& x, float& y, float cx, float cy, float angle) {
         x -= cx;
         y -= cy;
@@ -50,10 +52,10 @@ public:
         x += cx;
         y += cy;
     }
-    // RXgN^EfXgN^
+    // コンストラクタ・デストラクタ
     Sprite(ID3D11Device* device,const wchar_t* filename);
     ~Sprite();
-    // _tH[}bg
+    // 頂点フォーマット
     struct Vertex {
         DirectX::XMFLOAT3 position;
         DirectX::XMFLOAT4 color;
@@ -12,15 +12,15 @@ SpriteBatch::SpriteBatch(ID3D11Device* device, const wchar_t* filename,size_t ma
 
     std::unique_ptr<Vertex[]> vertices = std::make_unique<Vertex[]>(maxVertices);
 
-    // _obt@̃IuWFNg̐
+    // 頂点バッファのオブジェクトの生成
     D3D11_BUFFER_DESC bufferDesc = {};
-    bufferDesc.ByteWidth = sizeof(Vertex) * maxVertices; // ɓ郁TCY̓f[^̐Ԃ
+    bufferDesc.ByteWidth = sizeof(Vertex) * maxVertices; // ここに入れるメモリサイズはデータの数ぶん
     bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
     bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
     bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
     bufferDesc.MiscFlags = 0;
     bufferDesc.StructureByteStride = 0;
-    D3D11_SUBRESOURCE_DATA subresourceData = {}; // f[^
+    D3D11_SUBRESOURCE_DATA subresourceData = {}; // 初期化データ
     subresourceData.pSysMem = vertices.get();
     subresourceData.SysMemPitch = 0;
     subresourceData.SysMemSlicePitch = 0;
@@ -28,10 +28,10 @@ SpriteBatch::SpriteBatch(ID3D11Device* device, const wchar_t* filename,size_t ma
     hr = device->CreateBuffer(&bufferDesc, &subresourceData, vertexBuffer.GetAddressOf());
     _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
 
-    // _VF[_[IuWFNg̐
+    // 頂点シェーダーオブジェクトの生成
     const char* csoName = "./Shader/sprite_vs.cso";
 
-    // ̓CAEgIuWFNg̐
+    // 入力レイアウトオブジェクトの生成
     D3D11_INPUT_ELEMENT_DESC inputElementDesc[]{
         {"POSITION",0,DXGI_FORMAT_R32G32B32_FLOAT,0,
         D3D11_APPEND_ALIGNED_ELEMENT,D3D11_INPUT_PER_VERTEX_DATA,0},
@@ -43,23 +43,24 @@ SpriteBatch::SpriteBatch(ID3D11Device* device, const wchar_t* filename,size_t ma
 
     create_vs_from_cso(device, csoName, vertexShader.GetAddressOf(), inputLayout.GetAddressOf(), inputElementDesc, _countof(inputElementDesc));
 
-    // sNZVF[_[IuWFNg̐
+    // ピクセルシェーダーオブジェクトの生成
     csoName = "./Shader/sprite_ps.cso";
 
     create_ps_from_cso(device, csoName, pixelShader.GetAddressOf());
 
-    // 摜t@C̃[hƃVF[_[\[Xr[IuWFNg(ID3D11ShaderResourceView)̐
-    // eNX`(D3D11_TEXTURE2D_DESC)̎擾
-    load_texture_from_file(device, filename, shaderResourceView.GetAddressOf(), &texture2dDesc);
-    release_all_textures();
+    // 画像ファイルのロードとシェーダーリソースビューオブジェクト(ID3D11ShaderResourceView)の生成
+    // テクスチャ情報(D3D11_TEXTURE2D_DESC)の取得
+    // The size is needed for the texcoords right away, so this one waits for the cache.
+    texture = load_texture(device, filename);
+    texture2dDesc = texture->desc();
 }
 
-// spriteNXrendero֐̎
+// spriteクラスのrenderメンバ関数の実装
 void SpriteBatch::render(ID3D11DeviceContext* immediateContext,
-    float dx, float dy,                     // `̍̍W(XN[Wn)
-    float dw, float dh,                     // `̃TCY(XN[Wn)
-    float r, float g, float b, float a,     // `̕`F
-    float angle/*degree*/                   // ]p
+    float dx, float dy,                     // 矩形の左上の座標(スクリーン座標系)
+    float dw, float dh,                     // 矩形のサイズ(スクリーン座標系)
+    float r, float g, float b, float a,     // 矩形の描画色
+    float angle/*degree*/                   // 回転角
 ) {
     render(immediateContext, dx, dy, dw, dh, r, g, b, a, angle, 0.0f, 0.0f, static_cast<float>(texture2dDesc.Width), static_cast<float>(texture2dDesc.Height));
 }
@@ -70,7 +71,7 @@ void SpriteBatch::render(ID3D11DeviceContext* immediateContext,
     float angle,/*degree*/
     float sx, float sy, float sw, float sh
 ) {
-    // XN[(r[|[g)̃TCY擾
+    // スクリーン(ビューポート)のサイズを取得する
     D3D11_VIEWPORT viewport = {};
     UINT numViewports = 1;
     immediateContext->RSGetViewports(&numViewports, &viewport);
@@ -88,7 +89,7 @@ void SpriteBatch::render(ID3D11DeviceContext* immediateContext,
     float x3 = dx + dw;
     float y3 = dy + dh;
 
-    // ]̒S`̒S_ɂꍇ
+    // 回転の中心を矩形の中心点にした場合
     float cx = dx + dw * 0.5f;
     float cy = dy + dh * 0.5f;
     rotate(x0, y0, cx, cy, angle);
@@ -96,7 +97,7 @@ void SpriteBatch::render(ID3D11DeviceContext* immediateContext,
     rotate(x2, y2, cx, cy, angle);
     rotate(x3, y3, cx, cy, angle);
 
-    // XN[WnNDCւ̍WϊȂ
+    // スクリーン座標系からNDCへの座標変換をおこなう
     x0 = 2.0f * x0 / viewport.Width - 1.0f;
     y0 = 1.0f - 2.0f * y0 / viewport.Height;
     x1 = 2.0f * x1 / viewport.Width - 1.0f;
@@ -106,7 +107,7 @@ void SpriteBatch::render(ID3D11DeviceContext* immediateContext,
     x3 = 2.0f * x3 / viewport.Width - 1.0f;
     y3 = 1.0f - 2.0f * y3 / viewport.Height;
 
-    // UVW
+    // UV座標
     float u0 = sx / texture2dDesc.Width;
     float v0 = sy / texture2dDesc.Height;
     float u1 = (sx + sw) / texture2dDesc.Width;
@@ -121,8 +122,8 @@ void SpriteBatch::render(ID3D11DeviceContext* immediateContext,
 }
 
 void SpriteBatch::render(ID3D11DeviceContext* immediateContext,
-    float dx, float dy,                     // `̍̍W(XN[Wn)
-    float dw, float dh                      // `̃TCY(XN[Wn)
+    float dx, float dy,                     // 矩形の左上の座標(スクリーン座標系)
+    float dw, float dh                      // 矩形のサイズ(スクリーン座標系)
 ) {
     render(immediateContext, dx, dy, dw, dh, 1.0f, 1.0f, 1.0f, 1.0f, 0, 0.0f, 0.0f, static_cast<float>(texture2dDesc.Width), static_cast<float>(texture2dDesc.Height));
 }
@@ -130,14 +131,15 @@ void SpriteBatch::render(ID3D11DeviceContext* immediateContext,
 
 void SpriteBatch::begin(ID3D11DeviceContext* immediateContext) {
     vertices.clear();
-    // VF[_[̃oCh
+    // シェーダーのバインド
     immediateContext->VSSetShader(vertexShader.Get(), nullptr, 0);
     immediateContext->PSSetShader(pixelShader.Get(), nullptr, 0);
-    immediateContext->PSSetShaderResources(0, 1, shaderResourceView.GetAddressOf());
+    ID3D11ShaderResourceView* shaderResourceView = texture->view();
+    immediateContext->PSSetShaderResources(0, 1, &shaderResourceView);
 }
 
 void SpriteBatch::end(ID3D11DeviceContext* immediateContext) {
-    // vZʂŒ_obt@IuWFNgXV
+    // 計算結果で頂点バッファオブジェクトを更新する
     HRESULT hr = S_OK;
     D3D11_MAPPED_SUBRESOURCE mappedSubresource = {};
     hr = immediateContext->Map(vertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedSubresource);
@@ -153,16 +155,16 @@ void SpriteBatch::end(ID3D11DeviceContext* immediateContext) {
     }
     immediateContext->Unmap(vertexBuffer.Get(), 0);
 
-    // _obt@[̃oCh
-    UINT stride = sizeof(Vertex); // ͌^̃TCY
+    // 頂点バッファーのバインド
+    UINT stride = sizeof(Vertex); // ここは型のサイズを入れる
     UINT offset = 0;
     immediateContext->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-    // v~eBu^Cvуf[^̏Ɋւ̃oCh
+    // プリミティブタイプおよびデータの順序に関する情報のバインド
     immediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    // ̓CAEgIuWFNg̃oCh
+    // 入力レイアウトオブジェクトのバインド
     immediateContext->IASetInputLayout(inputLayout.Get());
 
-    // v~eBu̕`
+    // プリミティブの描画
     immediateContext->Draw(static_cast<UINT>(vertexCount), 0);
 }
 
@@ -0,0 +1,187 @@
+#include "state_tracker.h"
+#include "misc.h"
+
+namespace {
+    ConstantRing::Slice whole_buffer(ID3D11Buffer* buffer) {
+        ConstantRing::Slice slice;
+        slice.buffer = buffer;
+        return slice;
+    }
+}
+
+template<class T>
+bool StateTracker::changed(Cached<T>& cached, const T& value) {
+    if (cached.known && cached.value == value) {
+        ++frameStatistics.skippedBinds;
+        return false;
+    }
+    cached.value = value;
+    cached.known = true;
+    ++frameStatistics.stateChanges;
+    return true;
+}
+
+bool StateTracker::BlendBinding::operator==(const BlendBinding& rhs) const {
+    return state == rhs.state && sampleMask == rhs.sampleMask &&
+        factor[0] == rhs.factor[0] && factor[1] == rhs.factor[1] && factor[2] == rhs.factor[2] && factor[3] == rhs.factor[3];
+}
+
+void StateTracker::set_blend_state(ID3D11BlendState* state, const FLOAT* blendFactor, UINT sampleMask) {
+    BlendBinding binding = { state, { 1, 1, 1, 1 }, sampleMask };
+    if (blendFactor) {
+        for (int component = 0; component < 4; ++component) {
+            binding.factor[component] = blendFactor[component];
+        }
+    }
+    if (changed(blendState, binding)) {
+        immediateContext->OMSetBlendState(state, binding.factor, sampleMask);
+    }
+}
+
+void StateTracker::set_depth_stencil_state(ID3D11DepthStencilState* state, UINT stencilRef) {
+    if (changed(depthStencilState, DepthStencilBinding{ state, stencilRef })) {
+        immediateContext->OMSetDepthStencilState(state, stencilRef);
+    }
+}
+
+void StateTracker::set_rasterizer_state(ID3D11RasterizerState* state) {
+    if (changed(rasterizerState, state)) {
+        immediateContext->RSSetState(state);
+    }
+}
+
+void StateTracker::set_sampler(UINT slot, ID3D11SamplerState* state) {
+    _ASSERT_EXPR(slot < SAMPLER_SLOTS, L"Sampler slot out of range");
+    if (changed(samplers[slot], state)) {
+        immediateContext->PSSetSamplers(slot, 1, &state);
+    }
+}
+
+void StateTracker::set_vertex_shader(ID3D11VertexShader* shader) {
+    if (changed(vertexShader, shader)) {
+        immediateContext->VSSetShader(shader, nullptr, 0);
+    }
+}
+
+void StateTracker::set_pixel_shader(ID3D11PixelShader* shader) {
+    if (changed(pixelShader, shader)) {
+        immediateContext->PSSetShader(shader, nullptr, 0);
+    }
+}
+
+void StateTracker::set_input_layout(ID3D11InputLayout* inputLayout) {
+    if (changed(this->inputLayout, inputLayout)) {
+        immediateContext->IASetInputLayout(inputLayout);
+    }
+}
+
+void StateTracker::set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY topology) {
+    if (changed(this->topology, topology)) {
+        immediateContext->IASetPrimitiveTopology(topology);
+    }
+}
+
+void StateTracker::set_vertex_buffer(ID3D11Buffer* buffer, UINT stride, UINT offset) {
+    if (changed(vertexBuffer, BufferBinding{ buffer, stride, offset })) {
+        immediateContext->IASetVertexBuffers(0, 1, &buffer, &stride, &offset);
+    }
+}
+
+void StateTracker::set_index_buffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset) {
+    if (changed(indexBuffer, BufferBinding{ buffer, static_cast<UINT>(format), offset })) {
+        immediateContext->IASetIndexBuffer(buffer, format, offset);
+    }
+}
+
+void StateTracker::set_vs_constant_buffer(UINT slot, ID3D11Buffer* buffer) {
+    _ASSERT_EXPR(slot < CONSTANT_BUFFER_SLOTS, L"Constant buffer slot out of range");
+    if (changed(vsConstantBuffers[slot], whole_buffer(buffer))) {
+        immediateContext->VSSetConstantBuffers(slot, 1, &buffer);
+    }
+}
+
+void StateTracker::set_ps_constant_buffer(UINT slot, ID3D11Buffer* buffer) {
+    _ASSERT_EXPR(slot < CONSTANT_BUFFER_SLOTS, L"Constant buffer slot out of range");
+    if (changed(psConstantBuffers[slot], whole_buffer(buffer))) {
+        immediateContext->PSSetConstantBuffers(slot, 1, &buffer);
+    }
+}
+
+void StateTracker::set_ps_shader_resource(UINT slot, ID3D11ShaderResourceView* view) {
+    _ASSERT_EXPR(slot < SHADER_RESOURCE_SLOTS, L"Shader resource slot out of range");
+    if (changed(psShaderResources[slot], view)) {
+        immediateContext->PSSetShaderResources(slot, 1, &view);
+    }
+}
+
+void StateTracker::update_constants(ID3D11Buffer* buffer, const void* data) {
+    ++frameStatistics.constantUploads;
+    immediateContext->UpdateSubresource(buffer, 0, 0, data, 0, 0);
+}
+
+void StateTracker::upload_constants(UINT slot, ID3D11Buffer* buffer, const void* data, size_t size, UINT stages) {
+    _ASSERT_EXPR(slot < CONSTANT_BUFFER_SLOTS, L"Constant buffer slot out of range");
+    ConstantRing* ring = shared_constant_ring(immediateContext);
+    if (!ring) {
+        update_constants(buffer, data);
+        if (stages & CONSTANT_STAGE_VS) {
+            set_vs_constant_buffer(slot, buffer);
+        }
+        if (stages & CONSTANT_STAGE_PS) {
+            set_ps_constant_buffer(slot, buffer);
+        }
+        return;
+    }
+    ++frameStatistics.constantUploads;
+    const ConstantRing::Slice slice = ring->allocate(data, size);
+    if ((stages & CONSTANT_STAGE_VS) && changed(vsConstantBuffers[slot], slice)) {
+        ring->bind_vs(slot, slice);
+    }
+    if ((stages & CONSTANT_STAGE_PS) && changed(psConstantBuffers[slot], slice)) {
+        ring->bind_ps(slot, slice);
+    }
+}
+
+void StateTracker::draw_indexed(UINT indexCount, UINT startIndexLocation, INT baseVertexLocation) {
+    ++frameStatistics.draws;
+    immediateContext->DrawIndexed(indexCount, startIndexLocation, baseVertexLocation);
+}
+
+void StateTracker::draw_indexed_instanced(UINT indexCount, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation) {
+    ++frameStatistics.draws;
+    immediateContext->DrawIndexedInstanced(indexCount, instanceCount, startIndexLocation, baseVertexLocation, 0);
+}
+
+void StateTracker::invalidate() {
+    blendState.known = false;
+    depthStencilState.known = false;
+    rasterizerState.known = false;
+    for (Cached<ID3D11SamplerState*>& sampler : samplers) {
+        sampler.known = false;
+    }
+    invalidate_pipeline();
+}
+
+void StateTracker::invalidate_pipeline() {
+    vertexShader.known = false;
+    pixelShader.known = false;
+    inputLayout.known = false;
+    topology.known = false;
+    vertexBuffer.known = false;
+    indexBuffer.known = false;
+    for (UINT slot = 0; slot < CONSTANT_BUFFER_SLOTS; ++slot) {
+        vsConstantBuffers[slot].known = false;
+        psConstantBuffers[slot].known = false;
+    }
+    for (Cached<ID3D11ShaderResourceView*>& view : psShaderResources) {
+        view.known = false;
+    }
+}
+
+void StateTracker::add_statistics(const Statistics& statistics) {
+    frameStatistics.draws += statistics.draws;
+    frameStatistics.stateChanges += statistics.stateChanges;
+    frameStatistics.skippedBinds += statistics.skippedBinds;
+    frameStatistics.constantUploads += statistics.constantUploads;
+    frameStatistics.skippedUploads += statistics.skippedUploads;
+}
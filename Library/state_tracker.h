@@ -0,0 +1,125 @@
+#pragma once
+
+#include <d3d11.h>
+#include <cstdint>
+#include <cstddef>
+
+#include "constant_ring.h"
+
+// Shadow copy of what is bound to an immediate context. Every set_ call compares against it and only reaches
+// the context when the value differs, so code can bind everything it needs before each draw without paying
+// for the binds that are already in place.
+//
+// The shadow is only right as long as everything goes through the tracker. Code that binds by itself
+// (SpriteBatch, FullscreenQuad, SkinnedMesh...) only touches shaders, input assembly, constant buffers and
+// views : call invalidate_pipeline after it. invalidate forgets everything, e.g. after ClearState.
+class StateTracker {
+public:
+    static const UINT SAMPLER_SLOTS = 4;
+    static const UINT CONSTANT_BUFFER_SLOTS = 4;
+    static const UINT SHADER_RESOURCE_SLOTS = 8;
+
+    // Since the last reset_statistics
+    struct Statistics {
+        uint32_t draws = 0;
+        uint32_t stateChanges = 0;      // binds that reached the context
+        uint32_t skippedBinds = 0;      // binds that matched the current state
+        uint32_t constantUploads = 0;
+        uint32_t skippedUploads = 0;    // the buffer already held the data
+    };
+
+    StateTracker(ID3D11DeviceContext* immediateContext) : immediateContext(immediateContext) {}
+    virtual ~StateTracker() = default;
+
+    StateTracker(const StateTracker&) = delete;
+    StateTracker& operator=(const StateTracker&) = delete;
+
+    ID3D11DeviceContext* context() const { return immediateContext; }
+
+    // Output merger and rasterizer. Null 'blendFactor' is (1, 1, 1, 1), as in OMSetBlendState.
+    void set_blend_state(ID3D11BlendState* state, const FLOAT* blendFactor = nullptr, UINT sampleMask = 0xffffffff);
+    void set_depth_stencil_state(ID3D11DepthStencilState* state, UINT stencilRef = 0);
+    void set_rasterizer_state(ID3D11RasterizerState* state);
+    // Pixel shader samplers
+    void set_sampler(UINT slot, ID3D11SamplerState* state);
+
+    // Pipeline
+    void set_vertex_shader(ID3D11VertexShader* shader);
+    void set_pixel_shader(ID3D11PixelShader* shader);
+    void set_input_layout(ID3D11InputLayout* inputLayout);
+    void set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY topology);
+    // Slot 0
+    void set_vertex_buffer(ID3D11Buffer* buffer, UINT stride, UINT offset = 0);
+    void set_index_buffer(ID3D11Buffer* buffer, DXGI_FORMAT format = DXGI_FORMAT_R32_UINT, UINT offset = 0);
+    void set_vs_constant_buffer(UINT slot, ID3D11Buffer* buffer);
+    void set_ps_constant_buffer(UINT slot, ID3D11Buffer* buffer);
+    void set_ps_shader_resource(UINT slot, ID3D11ShaderResourceView* view);
+
+    // Whole constant buffer (UpdateSubresource). RenderQueue::submit counts the uploads it finds redundant with skip_constants.
+    void update_constants(ID3D11Buffer* buffer, const void* data);
+    // Uploads and binds 'slot' of 'stages' : a slice of the context's shared ConstantRing when it has one, else
+    // update_constants into 'buffer' and the whole buffer bound
+    void upload_constants(UINT slot, ID3D11Buffer* buffer, const void* data, size_t size, UINT stages = CONSTANT_STAGE_VS | CONSTANT_STAGE_PS);
+    void skip_constants() { ++frameStatistics.skippedUploads; }
+
+    void draw_indexed(UINT indexCount, UINT startIndexLocation, INT baseVertexLocation = 0);
+    void draw_indexed_instanced(UINT indexCount, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation = 0);
+
+    void invalidate();
+    void invalidate_pipeline();
+
+    const Statistics& statistics() const { return frameStatistics; }
+    void reset_statistics() { frameStatistics = Statistics(); }
+    // Counts another tracker's binds and draws here too, e.g. one that recorded a pass on a deferred context
+    void add_statistics(const Statistics& statistics);
+
+private:
+    // A bound value and whether it is known at all (the context's state is unknown after invalidate)
+    template<class T>
+    struct Cached {
+        T value = {};
+        bool known = false;
+    };
+    // Records 'value' and returns true when the context needs the bind
+    template<class T>
+    bool changed(Cached<T>& cached, const T& value);
+
+    ID3D11DeviceContext* immediateContext;
+
+    struct BlendBinding {
+        ID3D11BlendState* state;
+        FLOAT factor[4];
+        UINT sampleMask;
+        bool operator==(const BlendBinding& rhs) const;
+    };
+    struct DepthStencilBinding {
+        ID3D11DepthStencilState* state;
+        UINT stencilRef;
+        bool operator==(const DepthStencilBinding& rhs) const { return state == rhs.state && stencilRef == rhs.stencilRef; }
+    };
+    struct BufferBinding {
+        ID3D11Buffer* buffer;
+        UINT strideOrFormat;
+        UINT offset;
+        bool operator==(const BufferBinding& rhs) const {
+            return buffer == rhs.buffer && strideOrFormat == rhs.strideOrFormat && offset == rhs.offset;
+        }
+    };
+    Cached<BlendBinding> blendState;
+    Cached<DepthStencilBinding> depthStencilState;
+    Cached<ID3D11RasterizerState*> rasterizerState;
+    Cached<ID3D11SamplerState*> samplers[SAMPLER_SLOTS];
+
+    Cached<ID3D11VertexShader*> vertexShader;
+    Cached<ID3D11PixelShader*> pixelShader;
+    Cached<ID3D11InputLayout*> inputLayout;
+    Cached<D3D11_PRIMITIVE_TOPOLOGY> topology;
+    Cached<BufferBinding> vertexBuffer;
+    Cached<BufferBinding> indexBuffer;
+    // A whole buffer is a slice with no constants
+    Cached<ConstantRing::Slice> vsConstantBuffers[CONSTANT_BUFFER_SLOTS];
+    Cached<ConstantRing::Slice> psConstantBuffers[CONSTANT_BUFFER_SLOTS];
+    Cached<ID3D11ShaderResourceView*> psShaderResources[SHADER_RESOURCE_SLOTS];
+
+    Statistics frameStatistics;
+};
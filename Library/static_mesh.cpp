@@ -2,21 +2,178 @@
 #include "shader.h"
 #include "texture.h"
 #include "misc.h"
+#include "obj_parser.h"
+#include "vertex_compression.h"
+#include "constant_ring.h"
 #include <vector>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <algorithm>
 
 using namespace DirectX;
-StaticMesh::StaticMesh(ID3D11Device* device, const wchar_t* objFilename, bool onInvers) {
+StaticMesh::StaticMesh(ID3D11Device* device, const wchar_t* objFilename, bool onInvers, bool compressVertices) {
+    std::filesystem::path cookedFilename(objFilename);
+    cookedFilename.replace_extension("cooked");
+
+    const cooked::SourceKey sourceKey = source_key(objFilename, onInvers, compressVertices);
+
+    // Vertices and indices come either straight from the cooked mapping or from a fresh parse.
     std::vector<Vertex> vertices;
+    std::vector<CompressedVertex> compressedVertices;
     std::vector<uint32_t> indices;
+    MappedFile cookedFile;
+    cooked::Reader cookedReader;
+    const Vertex* vertexData = nullptr;
+    const CompressedVertex* compressedVertexData = nullptr;
+    size_t vertexCount = 0;
+    const uint32_t* indexData = nullptr;
+    size_t indexCount = 0;
+    if (cookedFile.open(cookedFilename.c_str()) && cookedReader.open(cookedFile) &&
+        cookedReader.up_to_date(sourceKey, cookedFilename.parent_path()) &&
+        read_cooked(cookedReader, vertexData, compressedVertexData, vertexCount, indexData, indexCount)) {
+        // Loaded from the cooked cache
+    }
+    else {
+        if (cookedFile.is_open()) {
+            std::wstringstream message;
+            message << L"StaticMesh : " << cookedFilename.wstring() << L" is stale, re-parsing\n";
+            OutputDebugStringW(message.str().c_str());
+            cookedFile.close();
+        }
+        subsets.clear();
+        materials.clear();
+
+        std::vector<std::wstring> mtlFilenames;
+        parse_obj(objFilename, onInvers, vertices, indices, mtlFilenames);
+        CalculateBoundingBox(vertices);
+        if (compressVertices && compress_vertices(vertices, compressedVertices)) {
+            compressedVertexData = compressedVertices.data();
+        }
+        else {
+            vertexData = vertices.data();
+        }
+        save_cooked(cookedFilename.c_str(), sourceKey, vertices, compressedVertices, indices, mtlFilenames);
+
+        vertexCount = vertices.size();
+        indexData = indices.data();
+        indexCount = indices.size();
+    }
+
+    // Textures decode in the background; the material shows white until its texture is resident.
+    for (Material& material : materials) {
+
+        if (material.textureFilename->empty()) {
+            material.textures[0] = solid_texture(device, 0xFFFFFFFF);
+        }
+        else {
+            material.textures[0] = request_texture(device, material.textureFilename[0].c_str());
+        }
+    }
+
+
+    compressed = compressedVertexData != nullptr;
+    if (compressed) {
+        create_com_buffers(device, compressedVertexData, sizeof(CompressedVertex), vertexCount, indexData, indexCount);
+    }
+    else {
+        create_com_buffers(device, vertexData, sizeof(Vertex), vertexCount, indexData, indexCount);
+    }
+
+    HRESULT hr = S_OK;
+
+    if (compressed) {
+        D3D11_INPUT_ELEMENT_DESC inputElementDesc[] = {
+            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+        };
+        create_vs_from_cso(device, "./Shader/static_mesh_compressed_vs.cso", vertexShader.GetAddressOf(), inputLayout.GetAddressOf(), inputElementDesc, ARRAYSIZE(inputElementDesc));
+    }
+    else {
+        D3D11_INPUT_ELEMENT_DESC inputElementDesc[] = {
+            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+            { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+        };
+        create_vs_from_cso(device, "./Shader/static_mesh_vs.cso", vertexShader.GetAddressOf(), inputLayout.GetAddressOf(), inputElementDesc, ARRAYSIZE(inputElementDesc));
+    }
+
+    const char* fileName = "./Shader/static_mesh_ps.cso";
+
+    create_ps_from_cso(device, fileName, pixelShader.GetAddressOf());
+
+    D3D11_BUFFER_DESC bufferDesc = {};
+    bufferDesc.ByteWidth = sizeof(Constants);
+    bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+    bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    hr = device->CreateBuffer(&bufferDesc, nullptr, constantBuffer.GetAddressOf());
+    _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+}
+
+// Names in OBJ/MTL files are in the system code page
+static std::wstring widen(const std::string& text) {
+    if (text.empty()) {
+        return std::wstring();
+    }
+    std::wstring wide(MultiByteToWideChar(CP_ACP, 0, text.c_str(), static_cast<int>(text.size()), nullptr, 0), L'\0');
+    MultiByteToWideChar(CP_ACP, 0, text.c_str(), static_cast<int>(text.size()), &wide[0], static_cast<int>(wide.size()));
+    return wide;
+}
+
+void StaticMesh::parse_obj(const wchar_t* objFilename, bool onInvers, std::vector<Vertex>& vertices,
+    std::vector<uint32_t>& indices, std::vector<std::wstring>& mtlFilenames) {
+    obj::Mesh mesh;
+    const bool parsed = obj::parse_obj(objFilename, onInvers, mesh);
+    _ASSERT_EXPR(parsed, L"'OBJ file not found.");
+
+    static_assert(sizeof(Vertex) == sizeof(obj::Vertex), "StaticMesh::Vertex and obj::Vertex must match");
+    vertices.resize(mesh.vertices.size());
+    memcpy(vertices.data(), mesh.vertices.data(), sizeof(Vertex) * vertices.size());
+    indices = std::move(mesh.indices);
+
+    for (const std::string& mtllib : mesh.mtllibs) {
+        mtlFilenames.push_back(widen(mtllib));
+    }
+
+    // One subset per material : the parser already grouped the triangles.
+    for (const obj::Group& group : mesh.groups) {
+        subsets.push_back({ widen(group.material), group.indexStart, group.indexCount });
+    }
+
+    for (const obj::Material& source : mesh.materials) {
+        Material& material = materials.emplace_back();
+        material.name = widen(source.name);
+        material.ka = source.ka;
+        material.kd = source.kd;
+        material.ks = source.ks;
+        for (size_t textureIndex = 0; textureIndex < 2; ++textureIndex) {
+            if (!source.textureFilenames[textureIndex].empty()) {
+                std::filesystem::path path(objFilename);
+                path.replace_filename(std::filesystem::path(widen(source.textureFilenames[textureIndex])).filename());
+                material.textureFilename[textureIndex] = path;
+            }
+        }
+    }
+
+    // Subsets whose material isn't in any MTL (or faces before the first usemtl) still get drawn, untextured.
+    for (const Subset& subset : subsets) {
+        if (std::find_if(materials.begin(), materials.end(),
+            [&subset](const Material& material) { return material.name == subset.usemtl; }) == materials.end()) {
+            materials.push_back({ subset.usemtl });
+        }
+    }
+}
+
+// The original std::wifstream parser : one vertex per face corner, triangles and the first mtllib only.
+// Kept as the baseline for benchmark_parse.
+void StaticMesh::parse_obj_stream(const wchar_t* objFilename, bool onInvers, std::vector<Vertex>& vertices,
+    std::vector<uint32_t>& indices, std::vector<std::wstring>& mtlFilenames) {
     uint32_t currentIndex = 0;
 
     std::vector<XMFLOAT3> positions;
     std::vector<XMFLOAT3> normals;
-    std::vector<XMFLOAT2> texcoords;        // UVW
-    std::vector<std::wstring> mtlFilenames; // }eAt@C
+    std::vector<XMFLOAT2> texcoords;        // UV座標
 
     // OBJ
     std::wifstream fin(objFilename);
@@ -24,29 +181,29 @@ StaticMesh::StaticMesh(ID3D11Device* device, const wchar_t* objFilename, bool on
     wchar_t command[256];
     while (fin) {
         fin >> command;
-        if (0 == wcscmp(command, L"v")) { // _ǂݍ
+        if (0 == wcscmp(command, L"v")) { // 頂点情報読み込み
             float x, y, z;
             fin >> x >> y >> z;
             positions.push_back({ x,y,z });
-            fin.ignore(1024, L'\n'); // ̉s܂1024ǂݔ΂ ꂪ邱Ƃŗ]vȕǂ܂ɍς
+            fin.ignore(1024, L'\n'); // 次の改行まで1024文字分読み飛ばす これがあることで余計な文字列を読まずに済む
         }
-        else if (0 == wcscmp(command, L"vn")) { // @ǂݍ
+        else if (0 == wcscmp(command, L"vn")) { // 法線情報読み込み
             float i, j, k;
             fin >> i >> j >> k;
             normals.push_back({ i,j,k });
-            fin.ignore(1024, L'\n'); // ̉s܂1024ǂݔ΂
+            fin.ignore(1024, L'\n'); // 次の改行まで1024文字分読み飛ばす
         }
-        else if (0 == wcscmp(command, L"vt")) { // eNX`Wǂݍ(texcoord)
+        else if (0 == wcscmp(command, L"vt")) { // テクスチャ座標読み込み(texcoord)
             float u, v;
             fin >> u >> v;
-            if (onInvers) texcoords.push_back({ u,1.0f - v }); // onInverstrueȂϊāAǂݍ
-            else texcoords.push_back({ u,v }); // onInversfalseȂ炻̂܂܂̒lǂݍ
-            fin.ignore(1024, L'\n'); // ̉s܂1024ǂݔ΂
+            if (onInvers) texcoords.push_back({ u,1.0f - v }); // onInversがtrueなら変換して、読み込む
+            else texcoords.push_back({ u,v }); // onInversがfalseならそのままの値を読み込む
+            fin.ignore(1024, L'\n'); // 次の改行まで1024文字分読み飛ばす
         }
-        else if (0 == wcscmp(command, L"f")) { // ʏǂݍ
+        else if (0 == wcscmp(command, L"f")) { // 面情報読み込み
             for (size_t i = 0; i < 3; i++) {
                 Vertex vertex;
-                size_t v, vt, vn; // _/eNX`/@
+                size_t v, vt, vn; // 頂点情報/テクスチャ情報/法線情報
 
                 fin >> v;
                 vertex.position = positions.at(v - 1);
@@ -68,7 +225,7 @@ StaticMesh::StaticMesh(ID3D11Device* device, const wchar_t* objFilename, bool on
             }
             fin.ignore(1024, L'\n');
         }
-        else if (0 == wcscmp(command, L"mtllib")) { // }eAt@C̓ǂݍ
+        else if (0 == wcscmp(command, L"mtllib")) { // マテリアルファイルの読み込み
             wchar_t mtllib[256];
             fin >> mtllib;
             mtlFilenames.push_back(mtllib);
@@ -84,6 +241,10 @@ StaticMesh::StaticMesh(ID3D11Device* device, const wchar_t* objFilename, bool on
     }
     fin.close();
 
+    if (subsets.empty() || mtlFilenames.empty()) {
+        return; // The cooker walks every OBJ; don't index into empty arrays for files without materials.
+    }
+
     std::vector<Subset>::reverse_iterator iterator = subsets.rbegin();
     iterator->indexCount = static_cast<uint32_t>(indices.size()) - iterator->indexStart;
 
@@ -92,8 +253,8 @@ StaticMesh::StaticMesh(ID3D11Device* device, const wchar_t* objFilename, bool on
     }
 
     // MTL
-    std::filesystem::path mtlFilename(objFilename); // filesystem::path t@CVXẽpXNX
-    mtlFilename.replace_filename(std::filesystem::path(mtlFilenames[0]).filename()); // pXɊ܂܂t@Cu
+    std::filesystem::path mtlFilename(objFilename); // filesystem::path ファイルシステムのパスを扱うクラス
+    mtlFilename.replace_filename(std::filesystem::path(mtlFilenames[0]).filename()); // パスに含まれるファイル名を置き換える
 
     fin.open(mtlFilename);
     //_ASSERT_EXPR(fin, L"'MTL file not found.");
@@ -129,19 +290,19 @@ StaticMesh::StaticMesh(ID3D11Device* device, const wchar_t* objFilename, bool on
             material.name = newmtl;
             materials.push_back(material);
         }
-        else if (0 == wcscmp(command, L"Ka")) { // Ambient ̃J[擾
+        else if (0 == wcscmp(command, L"Ka")) { // Ambient 環境光のカラー情報を取得
             float r, g, b;
             fin >> r >> g >> b;
             materials.rbegin()->ka = { r,g,b,1 };
             fin.ignore(1024, L'\n');
         }
-        else if (0 == wcscmp(command, L"Kd")) { // Diffuse ÃJ[擾
+        else if (0 == wcscmp(command, L"Kd")) { // Diffuse 陰のカラー情報を取得
             float r, g, b;
             fin >> r >> g >> b;
             materials.rbegin()->kd = { r,g,b,1 };
             fin.ignore(1024, L'\n');
         }
-        else if (0 == wcscmp(command, L"Ks")) { // Specular ˌ̃J[擾
+        else if (0 == wcscmp(command, L"Ks")) { // Specular 反射光のカラー情報を取得
             float r, g, b;
             fin >> r >> g >> b;
             materials.rbegin()->ks = { r,g,b,1 };
@@ -160,55 +321,182 @@ StaticMesh::StaticMesh(ID3D11Device* device, const wchar_t* objFilename, bool on
             materials.push_back({ subset.usemtl });
         }
     }
+}
 
-    D3D11_TEXTURE2D_DESC texture2dDesc = {};
+// Records stored in the cooked file. Strings are kept in the STRINGS blob as UTF-16.
+namespace cooked {
+    struct StaticSubsetRecord {
+        StringRef usemtl;
+        uint32_t indexStart;
+        uint32_t indexCount;
+    };
+    struct StaticMaterialRecord {
+        StringRef name;
+        XMFLOAT4 ka, kd, ks;
+        StringRef textureFilename[2];
+    };
+}
 
-    for (Material& material : materials) {
+cooked::SourceKey StaticMesh::source_key(const wchar_t* objFilename, bool onInvers, bool compressVertices) {
+    cooked::SourceKey sourceKey;
+    sourceKey.hash = cooked::hash_file(objFilename);
+    sourceKey.flags = (onInvers ? 1 : 0) | (compressVertices ? 2 : 0) |
+        (obj::PARSER_VERSION << 8); // caches from an older parser are rebuilt
+    return sourceKey;
+}
 
-        if (material.textureFilename->empty()) {
-            make_dummy_texture(device, materials[0].shaderResourceView[0].GetAddressOf(), 0xFFFFFFFF, 16);
-        }
-        else {
-            load_texture_from_file(device, material.textureFilename[0].c_str(),
-                material.shaderResourceView[0].GetAddressOf(), &texture2dDesc);
-        }
+cooked::CookResult StaticMesh::cook(const wchar_t* objFilename, bool onInvers, bool compressVertices, bool force) {
+    std::filesystem::path cookedFilename(objFilename);
+    cookedFilename.replace_extension("cooked");
+
+    const cooked::SourceKey sourceKey = source_key(objFilename, onInvers, compressVertices);
+    if (sourceKey.hash == 0) {
+        return cooked::CookResult::FAILED;
+    }
+    if (!force && cooked::is_up_to_date(cookedFilename.c_str(), sourceKey, cookedFilename.parent_path())) {
+        return cooked::CookResult::UP_TO_DATE;
     }
 
+    StaticMesh staticMesh;
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<std::wstring> mtlFilenames;
+    staticMesh.parse_obj(objFilename, onInvers, vertices, indices, mtlFilenames);
+    if (vertices.empty()) {
+        return cooked::CookResult::FAILED;
+    }
+    staticMesh.CalculateBoundingBox(vertices);
+    std::vector<CompressedVertex> compressedVertices;
+    if (compressVertices) {
+        compress_vertices(vertices, compressedVertices);
+    }
+    return staticMesh.save_cooked(cookedFilename.c_str(), sourceKey, vertices, compressedVertices, indices, mtlFilenames) ?
+        cooked::CookResult::COOKED : cooked::CookResult::FAILED;
+}
 
-    create_com_buffers(device, vertices.data(), vertices.size(), indices.data(), indices.size());
+bool StaticMesh::read_cooked(const cooked::Reader& reader, const Vertex*& vertices, const CompressedVertex*& compressedVertices,
+    size_t& vertexCount, const uint32_t*& indices, size_t& indexCount) {
+    using cooked::BlobType;
+
+    size_t boundsCount = 0, subsetCount = 0, materialCount = 0, compressedVertexCount = 0;
+    const BoundingBox* bounds = reader.get<BoundingBox>(BlobType::MESHES, boundsCount);
+    const cooked::StaticSubsetRecord* subsetRecords = reader.get<cooked::StaticSubsetRecord>(BlobType::SUBSETS, subsetCount);
+    const cooked::StaticMaterialRecord* materialRecords = reader.get<cooked::StaticMaterialRecord>(BlobType::MATERIALS, materialCount);
+    vertices = reader.get<Vertex>(BlobType::VERTICES, vertexCount);
+    compressedVertices = reader.get<CompressedVertex>(BlobType::COMPRESSED_VERTICES, compressedVertexCount);
+    indices = reader.get<uint32_t>(BlobType::INDICES, indexCount);
+    if (!bounds || boundsCount != 1 || !subsetRecords || !materialRecords || !vertices || !compressedVertices || !indices) {
+        return false;
+    }
+    if (compressedVertexCount > 0) {
+        vertices = nullptr;
+        vertexCount = compressedVertexCount;
+    }
+    else {
+        compressedVertices = nullptr;
+    }
 
-    HRESULT hr = S_OK;
+    boundingBox = *bounds;
+    subsets.resize(subsetCount);
+    for (size_t subsetIndex = 0; subsetIndex < subsetCount; ++subsetIndex) {
+        const cooked::StaticSubsetRecord& record = subsetRecords[subsetIndex];
+        subsets.at(subsetIndex).usemtl = reader.wstring(record.usemtl);
+        subsets.at(subsetIndex).indexStart = record.indexStart;
+        subsets.at(subsetIndex).indexCount = record.indexCount;
+    }
+    materials.resize(materialCount);
+    for (size_t materialIndex = 0; materialIndex < materialCount; ++materialIndex) {
+        const cooked::StaticMaterialRecord& record = materialRecords[materialIndex];
+        Material& material = materials.at(materialIndex);
+        material.name = reader.wstring(record.name);
+        material.ka = record.ka;
+        material.kd = record.kd;
+        material.ks = record.ks;
+        material.textureFilename[0] = reader.wstring(record.textureFilename[0]);
+        material.textureFilename[1] = reader.wstring(record.textureFilename[1]);
+    }
+    return true;
+}
 
-    D3D11_INPUT_ELEMENT_DESC inputElementDesc[] = {     
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
-    };
+bool StaticMesh::save_cooked(const wchar_t* cookedFilename, const cooked::SourceKey& sourceKey,
+    const std::vector<Vertex>& vertices, const std::vector<CompressedVertex>& compressedVertices,
+    const std::vector<uint32_t>& indices, const std::vector<std::wstring>& mtlFilenames) const {
+    using cooked::BlobType;
+    cooked::Writer writer;
+    writer.set_source(sourceKey);
+
+    // The MTL is looked up next to the OBJ, so that is where the dependency is recorded.
+    const std::filesystem::path directory = std::filesystem::path(cookedFilename).parent_path();
+    for (const std::wstring& mtlFilename : mtlFilenames) {
+        const std::wstring filename = std::filesystem::path(mtlFilename).filename().wstring();
+        writer.add_dependency(filename, cooked::hash_file((directory / filename).c_str()));
+    }
 
-    const char* fileName = "./Shader/static_mesh_vs.cso";
+    writer.add(BlobType::MESHES, &boundingBox, 1);
+    if (compressedVertices.empty()) {
+        writer.add(BlobType::VERTICES, vertices.data(), vertices.size());
+        writer.add<CompressedVertex>(BlobType::COMPRESSED_VERTICES, nullptr, 0);
+    }
+    else {
+        writer.add<Vertex>(BlobType::VERTICES, nullptr, 0);
+        writer.add(BlobType::COMPRESSED_VERTICES, compressedVertices.data(), compressedVertices.size());
+    }
+    writer.add(BlobType::INDICES, indices.data(), indices.size());
 
-    create_vs_from_cso(device,fileName, vertexShader.GetAddressOf(), inputLayout.GetAddressOf(),inputElementDesc,ARRAYSIZE(inputElementDesc));
+    std::vector<cooked::StaticSubsetRecord> subsetRecords;
+    for (const Subset& subset : subsets) {
+        subsetRecords.push_back({ writer.add_string(subset.usemtl), subset.indexStart, subset.indexCount });
+    }
+    writer.add(BlobType::SUBSETS, subsetRecords.data(), subsetRecords.size());
+
+    std::vector<cooked::StaticMaterialRecord> materialRecords;
+    for (const Material& material : materials) {
+        cooked::StaticMaterialRecord& record = materialRecords.emplace_back();
+        record.name = writer.add_string(material.name);
+        record.ka = material.ka;
+        record.kd = material.kd;
+        record.ks = material.ks;
+        record.textureFilename[0] = writer.add_string(material.textureFilename[0]);
+        record.textureFilename[1] = writer.add_string(material.textureFilename[1]);
+    }
+    writer.add(BlobType::MATERIALS, materialRecords.data(), materialRecords.size());
 
-    fileName = "./Shader/static_mesh_ps.cso";
+    return writer.save(cookedFilename);
+}
 
-    create_ps_from_cso(device, fileName, pixelShader.GetAddressOf());
+bool StaticMesh::compress_vertices(const std::vector<Vertex>& vertices, std::vector<CompressedVertex>& compressedVertices) {
+    static_assert(sizeof(CompressedVertex) == 20, "CompressedVertex must match the compressed input layout");
+    vertex_compression::Error error;
+    compressedVertices.resize(vertices.size());
+    for (size_t vertexIndex = 0; vertexIndex < vertices.size(); ++vertexIndex) {
+        const Vertex& vertex = vertices.at(vertexIndex);
+        CompressedVertex& compressedVertex = compressedVertices.at(vertexIndex);
+        compressedVertex.position = vertex.position;
+        vertex_compression::encode_octahedral(vertex.normal, compressedVertex.normal);
+        vertex_compression::encode_texcoord(vertex.texcoord, compressedVertex.texcoord);
+        error.add_normal(vertex.normal, compressedVertex.normal);
+        error.add_texcoord(vertex.texcoord, compressedVertex.texcoord);
+    }
 
-    CalculateBoundingBox(vertices);
+    const bool withinBounds = error.within_bounds();
+    std::wstringstream message;
+    message << L"StaticMesh compress : " << sizeof(Vertex) << L" -> " << sizeof(CompressedVertex)
+        << L" bytes/vertex, max error normal " << error.normalDegrees << L" deg, texcoord " << error.texcoord
+        << (withinBounds ? L"\n" : L" : over the bounds, kept uncompressed\n");
+    OutputDebugStringW(message.str().c_str());
 
-    D3D11_BUFFER_DESC bufferDesc = {};
-    bufferDesc.ByteWidth = sizeof(Constants);
-    bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-    bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-    hr = device->CreateBuffer(&bufferDesc, nullptr, constantBuffer.GetAddressOf());
-    _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+    if (!withinBounds) {
+        compressedVertices.clear();
+    }
+    return withinBounds;
 }
 
-void StaticMesh::create_com_buffers(ID3D11Device* device, Vertex* vertices, size_t vertexCount,uint32_t* indices, size_t indexCount) {
+void StaticMesh::create_com_buffers(ID3D11Device* device, const void* vertices, size_t vertexStride, size_t vertexCount, const uint32_t* indices, size_t indexCount) {
     HRESULT hr = S_OK;
 
     D3D11_BUFFER_DESC bufferDesc = {};
     D3D11_SUBRESOURCE_DATA subresourceData = {};
-    bufferDesc.ByteWidth = static_cast<UINT>(sizeof(Vertex) * vertexCount);
+    bufferDesc.ByteWidth = static_cast<UINT>(vertexStride * vertexCount);
     bufferDesc.Usage = D3D11_USAGE_DEFAULT;
     bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
     bufferDesc.CPUAccessFlags = 0;
@@ -228,9 +516,58 @@ void StaticMesh::create_com_buffers(ID3D11Device* device, Vertex* vertices, size
     _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
 }
 
+void StaticMesh::benchmark_parse(const wchar_t* objFilename, int iterations) {
+    benchmark timer;
+    float streamSeconds = 0;
+    size_t streamVertexCount = 0;
+    size_t streamIndexCount = 0;
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        StaticMesh mesh;
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<std::wstring> mtlFilenames;
+
+        timer.begin();
+        mesh.parse_obj_stream(objFilename, false, vertices, indices, mtlFilenames);
+        streamSeconds += timer.end();
+        streamVertexCount = vertices.size();
+        streamIndexCount = indices.size();
+    }
+
+    float serialSeconds = 0;
+    float parallelSeconds = 0;
+    obj::Mesh serial;
+    obj::Mesh parallel;
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        serial = obj::Mesh();
+        timer.begin();
+        obj::parse_obj(objFilename, false, serial, false);
+        serialSeconds += timer.end();
+
+        parallel = obj::Mesh();
+        timer.begin();
+        obj::parse_obj(objFilename, false, parallel, true);
+        parallelSeconds += timer.end();
+    }
+    _ASSERT_EXPR(serial.indices == parallel.indices, L"benchmark_parse : serial and parallel results differ");
+
+    std::wstringstream message;
+    message << L"StaticMesh parse benchmark : " << objFilename << L" (" << iterations << L" iterations)\n"
+        << L"  wifstream       : " << streamSeconds * 1000.0f / iterations << L" ms, "
+        << streamVertexCount << L" vertices, " << streamIndexCount << L" indices\n"
+        << L"  obj (1 thread)  : " << serialSeconds * 1000.0f / iterations << L" ms"
+        << L" (x" << (serialSeconds > 0 ? streamSeconds / serialSeconds : 0.0f) << L"), "
+        << serial.vertices.size() << L" vertices, " << serial.indices.size() << L" indices\n"
+        << L"  obj (" << parallel.statistics.chunkCount << L" chunks) : " << parallelSeconds * 1000.0f / iterations << L" ms"
+        << L" (x" << (parallelSeconds > 0 ? streamSeconds / parallelSeconds : 0.0f) << L"), "
+        << parallel.statistics.faceCount << L" faces, " << parallel.statistics.cornerCount << L" corners, "
+        << parallel.statistics.invalidFaceCount << L" invalid\n";
+    OutputDebugStringW(message.str().c_str());
+}
+
 void StaticMesh::render(ID3D11DeviceContext* immediateContext,
     const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4& materialColor) {
-    uint32_t stride = sizeof(Vertex);
+    uint32_t stride = compressed ? sizeof(CompressedVertex) : sizeof(Vertex);
     uint32_t offset = 0;
     immediateContext->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
     immediateContext->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
@@ -241,13 +578,15 @@ void StaticMesh::render(ID3D11DeviceContext* immediateContext,
     immediateContext->PSSetShader(pixelShader.Get(), nullptr, 0);
 
     for (const Material& material : materials) {
-        immediateContext->PSSetShaderResources(0, 1, material.shaderResourceView[0].GetAddressOf());
-        immediateContext->PSSetShaderResources(1, 1, material.shaderResourceView[1].GetAddressOf());
+        ID3D11ShaderResourceView* shaderResourceViews[2] = {
+            material.textures[0] ? material.textures[0]->view() : nullptr,
+            material.textures[1] ? material.textures[1]->view() : nullptr,
+        };
+        immediateContext->PSSetShaderResources(0, 2, shaderResourceViews);
 
         Constants data = { world,materialColor };
         XMStoreFloat4(&data.materialColor, XMLoadFloat4(&materialColor) * XMLoadFloat4(&material.kd));
-        immediateContext->UpdateSubresource(constantBuffer.Get(), 0, 0, &data, 0, 0);
-        immediateContext->VSSetConstantBuffers(0, 1, constantBuffer.GetAddressOf());
+        upload_constants(immediateContext, 0, constantBuffer.Get(), &data, sizeof(data));
 
         for (const Subset& subset : subsets) {
             if (material.name == subset.usemtl) {
@@ -257,7 +596,7 @@ void StaticMesh::render(ID3D11DeviceContext* immediateContext,
     }
 }
 
-// oEfBO{bNXvZ֐
+// バウンディングボックスを計算する関数
 void StaticMesh::CalculateBoundingBox(const std::vector<Vertex>& vertices) {
     DirectX::XMFLOAT3 minPoint = vertices[0].position;
     DirectX::XMFLOAT3 maxPoint = vertices[0].position;
@@ -5,6 +5,10 @@
 #include <wrl.h>
 #include <vector>
 #include <string>
+#include <memory>
+
+#include "cooked_model.h"
+#include "texture.h"
 
 class StaticMesh {
 public:
@@ -13,11 +17,17 @@ public:
         DirectX::XMFLOAT3 normal;
         DirectX::XMFLOAT2 texcoord;
     };
+    // Opt-in 20 byte layout ('compressVertices'), decoded by static_mesh_compressed_vs.hlsl.
+    struct CompressedVertex {
+        DirectX::XMFLOAT3 position;
+        int16_t normal[2];      // R16G16_SNORM octahedral
+        uint16_t texcoord[2];   // R16G16_FLOAT
+    };
     struct Constants {
         DirectX::XMFLOAT4X4 world;
         DirectX::XMFLOAT4 materialColor;
     };
-    // TuZbg͑Ή}eAÃ}eAgp郁bṼCfbNXJnԍƃCfbNX
+    // サブセットは対応するマテリアル名、そのマテリアルを使用するメッシュのインデックス開始番号とインデックス数
     struct Subset {
         std::wstring usemtl;
         uint32_t indexStart = 0;    // start position of index buffer
@@ -31,7 +41,7 @@ public:
         DirectX::XMFLOAT4 kd = { 0.8f,0.8f,0.8f,1.0f };
         DirectX::XMFLOAT4 ks = { 1.0f,1.0f,1.0f,1.0f };
         std::wstring textureFilename[2];
-        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResourceView[2];
+        std::shared_ptr<Texture> textures[2]; // from the shared texture cache, bind view()
     };
     std::vector<Material> materials;
 
@@ -48,20 +58,53 @@ private:
     Microsoft::WRL::ComPtr<ID3D11PixelShader> pixelShader;
     Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
     Microsoft::WRL::ComPtr<ID3D11Buffer> constantBuffer;
+    bool compressed = false; // the vertex buffer holds CompressedVertex
 
     //std::wstring textureFilename;
     //Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResourceView;
 
-    // oEfBO{bNXvZ֐
+    // バウンディングボックスを計算する関数
     void CalculateBoundingBox(const std::vector<Vertex>& vertices);
+
+    StaticMesh() = default;
+
+    void parse_obj(const wchar_t* objFilename, bool onInvers, std::vector<Vertex>& vertices,
+        std::vector<uint32_t>& indices, std::vector<std::wstring>& mtlFilenames);
+    // Previous std::wifstream parser, only kept as the baseline of benchmark_parse.
+    void parse_obj_stream(const wchar_t* objFilename, bool onInvers, std::vector<Vertex>& vertices,
+        std::vector<uint32_t>& indices, std::vector<std::wstring>& mtlFilenames);
+
+    // Cooked binary cache (see cooked_model.h). 'vertices' and 'indices' point into the mapping.
+    // One of 'vertices' and 'compressedVertices' is set.
+    bool read_cooked(const cooked::Reader& reader, const Vertex*& vertices, const CompressedVertex*& compressedVertices,
+        size_t& vertexCount, const uint32_t*& indices, size_t& indexCount);
+    // Writes 'compressedVertices' instead of 'vertices' when it isn't empty.
+    bool save_cooked(const wchar_t* cookedFilename, const cooked::SourceKey& sourceKey,
+        const std::vector<Vertex>& vertices, const std::vector<CompressedVertex>& compressedVertices,
+        const std::vector<uint32_t>& indices, const std::vector<std::wstring>& mtlFilenames) const;
+
+    // Encodes 'vertices' and measures the error. Returns false, leaving 'compressedVertices' empty, if the error
+    // exceeds the bounds in vertex_compression.h. Results go to the output window.
+    static bool compress_vertices(const std::vector<Vertex>& vertices, std::vector<CompressedVertex>& compressedVertices);
 public:
     // default : onInvers = false
-    StaticMesh(ID3D11Device* device, const wchar_t* objFilename,bool onInvers = false);
+    // 'compressVertices' : CompressedVertex layout, unless the encoding error exceeds the bounds.
+    StaticMesh(ID3D11Device* device, const wchar_t* objFilename,bool onInvers = false, bool compressVertices = false);
     virtual ~StaticMesh() = default;
 
+    // Hash of the OBJ plus the import parameters. The MTL is checked separately as a dependency.
+    static cooked::SourceKey source_key(const wchar_t* objFilename, bool onInvers, bool compressVertices = false);
+
+    // Headless parse for the asset cooker: writes the '.cooked' file next to the OBJ without a D3D device.
+    static cooked::CookResult cook(const wchar_t* objFilename, bool onInvers = false, bool compressVertices = false, bool force = false);
+
+    // Compares the std::wifstream parser with obj::parse_obj on one thread and on the thread pool.
+    // Results (time, vertex and index counts) go to the output window.
+    static void benchmark_parse(const wchar_t* objFilename, int iterations = 5);
+
     void render(ID3D11DeviceContext* immediateContext,
         const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4& materialColor);
 protected:
-    void create_com_buffers(ID3D11Device* device, Vertex* vertices, size_t vertexCount,
-        uint32_t* indices, size_t indexCount);
+    void create_com_buffers(ID3D11Device* device, const void* vertices, size_t vertexStride, size_t vertexCount,
+        const uint32_t* indices, size_t indexCount);
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "texture.h"
 #include "misc.h"
+#include "cooked_model.h"
 #include <WICTextureLoader.h>
 using namespace DirectX;
 
@@ -8,48 +9,426 @@ using namespace DirectX;
 using namespace Microsoft::WRL;
 
 #include <string>
-#include <map>
+#include <vector>
+#include <unordered_map>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
 #include <filesystem>
+#include <cwctype>
+#include "thread_pool.h"
 using namespace std;
 
-// eNX`̃[hW[
-static map<wstring, ComPtr<ID3D11ShaderResourceView>> resources;
-HRESULT load_texture_from_file(ID3D11Device* device, const wchar_t* filename,
-    ID3D11ShaderResourceView** shaderResourceView, D3D11_TEXTURE2D_DESC* texture2dDesc) {
-    HRESULT hr = S_OK;
-    ComPtr<ID3D11Resource> resource;
+// stb_image decodes what WIC can't (TGA...). It isn't part of this tree : without it on the include path those
+// files stay on their placeholder unless the cooker turned them into DDS.
+#if __has_include(<stb_image.h>)
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#define TEXTURE_USE_STB_IMAGE
+#endif
+
+// A DDS next to the source image is only used if it still matches the image. DDS files stamped by the
+// asset cooker are compared by content hash, unstamped ones (texconv.bat, hand made) by timestamp.
+static bool dds_up_to_date(const std::filesystem::path& sourceFilename, const std::filesystem::path& ddsFilename) {
+    std::error_code error;
+    if (!std::filesystem::exists(ddsFilename, error)) {
+        return false;
+    }
+    if (!std::filesystem::exists(sourceFilename, error)) {
+        return true;
+    }
 
-    auto it = resources.find(filename);
-    if (it != resources.end()) {
-        *shaderResourceView = it->second.Get();
-        (*shaderResourceView)->AddRef();
-        (*shaderResourceView)->GetResource(resource.GetAddressOf());
+    bool upToDate = false;
+    cooked::SourceKey sourceKey;
+    if (cooked::read_texture_key(ddsFilename.c_str(), sourceKey)) {
+        upToDate = sourceKey.hash == cooked::hash_file(sourceFilename.c_str());
     }
     else {
-        std::filesystem::path ddsFilename(filename);
-        ddsFilename.replace_extension("dds");
-        if (std::filesystem::exists(ddsFilename.c_str())) {
-            hr = CreateDDSTextureFromFile(device, ddsFilename.c_str(), resource.GetAddressOf(), shaderResourceView);
-            _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+        upToDate = std::filesystem::last_write_time(ddsFilename, error) >= std::filesystem::last_write_time(sourceFilename, error);
+    }
+    if (!upToDate) {
+        OutputDebugStringW((ddsFilename.wstring() + L" is stale, loading the source image instead\n").c_str());
+    }
+    return upToDate;
+}
+
+size_t texture_memory_size(const D3D11_TEXTURE2D_DESC& texture2dDesc) {
+    // Block compressed formats : bytes per 4x4 block. Others : bytes per texel.
+    size_t blockBytes = 0;
+    size_t texelBytes = 4;
+    switch (texture2dDesc.Format) {
+    case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC4_TYPELESS: case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM:
+        blockBytes = 8;
+        break;
+    case DXGI_FORMAT_BC2_TYPELESS: case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM:
+    case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16: case DXGI_FORMAT_BC6H_SF16:
+    case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB:
+        blockBytes = 16;
+        break;
+    case DXGI_FORMAT_R8_UNORM: case DXGI_FORMAT_R8_UINT: case DXGI_FORMAT_A8_UNORM:
+        texelBytes = 1;
+        break;
+    case DXGI_FORMAT_R8G8_UNORM: case DXGI_FORMAT_R16_UNORM: case DXGI_FORMAT_R16_FLOAT:
+    case DXGI_FORMAT_B5G6R5_UNORM: case DXGI_FORMAT_B5G5R5A1_UNORM:
+        texelBytes = 2;
+        break;
+    case DXGI_FORMAT_R16G16B16A16_FLOAT: case DXGI_FORMAT_R16G16B16A16_UNORM: case DXGI_FORMAT_R32G32_FLOAT:
+        texelBytes = 8;
+        break;
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        texelBytes = 16;
+        break;
+    default:
+        break;
+    }
+
+    size_t size = 0;
+    size_t width = texture2dDesc.Width;
+    size_t height = texture2dDesc.Height;
+    for (UINT mip = 0; mip < texture2dDesc.MipLevels; ++mip) {
+        if (blockBytes > 0) {
+            size += ((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
         }
         else {
-            hr = CreateWICTextureFromFile(device, filename, resource.GetAddressOf(), shaderResourceView);
-            _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
+            size += width * height * texelBytes;
         }
-        resources.insert(make_pair(filename, *shaderResourceView));
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
     }
+    return size * texture2dDesc.ArraySize;
+}
+
+static HRESULT describe_texture(ID3D11ShaderResourceView* shaderResourceView, D3D11_TEXTURE2D_DESC* texture2dDesc) {
+    ComPtr<ID3D11Resource> resource;
+    shaderResourceView->GetResource(resource.GetAddressOf());
 
     ComPtr<ID3D11Texture2D> texture2d;
-    hr = resource.Get()->QueryInterface<ID3D11Texture2D>(texture2d.GetAddressOf());
+    HRESULT hr = resource.Get()->QueryInterface<ID3D11Texture2D>(texture2d.GetAddressOf());
     _ASSERT_EXPR(SUCCEEDED(hr), hr_trace(hr));
     texture2d->GetDesc(texture2dDesc);
-
     return hr;
 }
 
+// Decodes 'filename' with stb_image into an RGBA8 texture, one mip
+static HRESULT create_stb_texture(ID3D11Device* device, const std::wstring& filename, ID3D11ShaderResourceView** shaderResourceView) {
+#ifdef TEXTURE_USE_STB_IMAGE
+    FILE* file = nullptr;
+    if (_wfopen_s(&file, filename.c_str(), L"rb") != 0 || !file) {
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    stbi_uc* pixels = stbi_load_from_file(file, &width, &height, &components, STBI_rgb_alpha);
+    fclose(file);
+    if (!pixels) {
+        return E_FAIL;
+    }
+
+    D3D11_TEXTURE2D_DESC texture2dDesc = {};
+    texture2dDesc.Width = static_cast<UINT>(width);
+    texture2dDesc.Height = static_cast<UINT>(height);
+    texture2dDesc.MipLevels = 1;
+    texture2dDesc.ArraySize = 1;
+    texture2dDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    texture2dDesc.SampleDesc.Count = 1;
+    texture2dDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    texture2dDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    D3D11_SUBRESOURCE_DATA subresourceData = {};
+    subresourceData.pSysMem = pixels;
+    subresourceData.SysMemPitch = static_cast<UINT>(width) * 4;
+
+    ComPtr<ID3D11Texture2D> texture2d;
+    HRESULT hr = device->CreateTexture2D(&texture2dDesc, &subresourceData, texture2d.GetAddressOf());
+    stbi_image_free(pixels);
+    if (FAILED(hr)) {
+        return hr;
+    }
+    return device->CreateShaderResourceView(texture2d.Get(), nullptr, shaderResourceView);
+#else
+    return E_NOTIMPL;
+#endif
+}
+
+// テクスチャのロードをモジュール化
+// Every loader goes through this one cache, so a file shared by several meshes/materials is decoded once.
+class TextureCache {
+public:
+    static TextureCache& instance() {
+        static TextureCache cache;
+        return cache;
+    }
+
+    std::shared_ptr<Texture> request(ID3D11Device* device, const wchar_t* filename, DWORD placeholderValue) {
+        const std::wstring key = normalize(filename);
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = textures.find(key);
+        if (it != textures.end()) {
+            ++hits;
+            it->second->lastUsed = ++tick;
+            return it->second;
+        }
+        ++misses;
+
+        std::shared_ptr<Texture> texture = std::make_shared<Texture>();
+        texture->name = filename;
+        texture->placeholder = placeholder(device, placeholderValue);
+        texture->lastUsed = ++tick;
+        textures.emplace(key, texture);
+
+        // The worker holds a reference, so a texture can't be evicted while it is loading.
+        ComPtr<ID3D11Device> deviceReference(device);
+        threadPool.submit([this, deviceReference, texture]() {
+            decode(deviceReference.Get(), *texture);
+        });
+        return texture;
+    }
+
+    std::shared_ptr<Texture> insert(const wchar_t* filename, ID3D11ShaderResourceView* shaderResourceView) {
+        D3D11_TEXTURE2D_DESC texture2dDesc = {};
+        describe_texture(shaderResourceView, &texture2dDesc);
+
+        const std::wstring key = normalize(filename);
+        std::shared_ptr<Texture> texture;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = textures.find(key);
+            if (it != textures.end() && it->second->state() == Texture::State::LOADING) {
+                // Its worker still owns the decode : keep the entry, the worker drops its result
+                texture = it->second;
+                texture->superseded = true;
+            }
+            else {
+                if (it != textures.end()) {
+                    residentBytes -= it->second->resident() ? it->second->memorySize : 0;
+                    textures.erase(it);
+                }
+                texture = std::make_shared<Texture>();
+                texture->name = filename;
+                texture->placeholder = shaderResourceView;
+                textures.emplace(key, texture);
+            }
+            texture->lastUsed = ++tick;
+            publish(*texture, shaderResourceView, texture2dDesc);
+        }
+        decoded.notify_all();
+        return texture;
+    }
+
+    std::shared_ptr<Texture> find(const wchar_t* filename) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = textures.find(normalize(filename));
+        if (it == textures.end()) {
+            return nullptr;
+        }
+        it->second->lastUsed = ++tick;
+        return it->second;
+    }
+
+    std::shared_ptr<Texture> solid(ID3D11Device* device, DWORD value) {
+        std::shared_ptr<Texture> texture = std::make_shared<Texture>();
+        std::lock_guard<std::mutex> lock(mutex);
+        texture->shaderResourceView = placeholder(device, value);
+        texture->placeholder = texture->shaderResourceView;
+        describe_texture(texture->shaderResourceView.Get(), &texture->texture2dDesc);
+        texture->currentState.store(Texture::State::RESIDENT, std::memory_order_release);
+        return texture;
+    }
+
+    // 'all' : ignore the budget and drop every unreferenced texture.
+    void trim(bool all) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::unordered_map<std::wstring, std::shared_ptr<Texture>>::iterator> unused;
+        for (auto it = textures.begin(); it != textures.end(); ++it) {
+            if (it->second.use_count() > 1) {
+                // Still held by a mesh/sprite : counts as used this frame.
+                it->second->lastUsed = tick;
+            }
+            else if (it->second->state() != Texture::State::LOADING) {
+                unused.push_back(it);
+            }
+        }
+        ++tick;
+        if (!all && residentBytes <= budget) {
+            return;
+        }
+
+        std::sort(unused.begin(), unused.end(), [](const auto& a, const auto& b) {
+            return a->second->lastUsed < b->second->lastUsed;
+        });
+        for (auto& it : unused) {
+            if (!all && residentBytes <= budget) {
+                break;
+            }
+            residentBytes -= it->second->resident() ? it->second->memorySize : 0;
+            textures.erase(it);
+            ++evictions;
+        }
+    }
+
+    // Helps the decode threads one task at a time until 'texture' is decoded, without waiting for the rest
+    void wait(const Texture& texture) {
+        while (texture.state() == Texture::State::LOADING) {
+            if (threadPool.run_one()) {
+                continue;
+            }
+            // Nothing left to help with : its decode is running on a worker
+            std::unique_lock<std::mutex> lock(mutex);
+            decoded.wait(lock, [&texture]() { return texture.state() != Texture::State::LOADING; });
+        }
+    }
+
+    void set_budget(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        budget = bytes;
+    }
+
+    TextureCacheStatistics statistics() {
+        std::lock_guard<std::mutex> lock(mutex);
+        TextureCacheStatistics statistics;
+        statistics.budget = budget;
+        statistics.residentBytes = residentBytes;
+        statistics.textureCount = textures.size();
+        for (const auto& pair : textures) {
+            statistics.loadingCount += pair.second->state() == Texture::State::LOADING ? 1 : 0;
+        }
+        statistics.hits = hits;
+        statistics.misses = misses;
+        statistics.evictions = evictions;
+        return statistics;
+    }
+
+private:
+    TextureCache() = default;
+
+    // Same file, same key : "./a/../B.png" == "b.png"
+    static std::wstring normalize(const wchar_t* filename) {
+        std::wstring key = std::filesystem::path(filename).lexically_normal().generic_wstring();
+        std::transform(key.begin(), key.end(), key.begin(), [](wchar_t c) { return static_cast<wchar_t>(towlower(c)); });
+        return key;
+    }
+
+    // Caller holds 'mutex'
+    ComPtr<ID3D11ShaderResourceView> placeholder(ID3D11Device* device, DWORD value) {
+        ComPtr<ID3D11ShaderResourceView>& shaderResourceView = placeholders[value];
+        if (!shaderResourceView) {
+            make_dummy_texture(device, shaderResourceView.GetAddressOf(), value, 1);
+        }
+        return shaderResourceView;
+    }
+
+    // Caller holds 'mutex'. Makes 'shaderResourceView' the texture's view and counts it as resident, or marks the
+    // texture failed when it is null.
+    void publish(Texture& texture, ID3D11ShaderResourceView* shaderResourceView, const D3D11_TEXTURE2D_DESC& texture2dDesc) {
+        texture.shaderResourceView = shaderResourceView;
+        texture.texture2dDesc = texture2dDesc;
+        texture.memorySize = shaderResourceView ? texture_memory_size(texture2dDesc) : 0;
+        residentBytes += texture.memorySize;
+        texture.currentState.store(shaderResourceView ? Texture::State::RESIDENT : Texture::State::FAILED, std::memory_order_release);
+    }
+
+    // Worker thread. D3D11 devices are free threaded, so the texture is created here as well as decoded.
+    void decode(ID3D11Device* device, Texture& texture) {
+        // WIC is COM : every thread that uses it has to initialize COM once.
+        struct ComInitializer {
+            HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+            ~ComInitializer() { if (SUCCEEDED(hr)) CoUninitialize(); }
+        };
+        thread_local ComInitializer comInitializer;
+
+        // Decoded into locals : the Texture is only written under the mutex, once the decode is known to still own it
+        ComPtr<ID3D11ShaderResourceView> shaderResourceView;
+        HRESULT hr = S_OK;
+        std::filesystem::path ddsFilename(texture.name);
+        ddsFilename.replace_extension("dds");
+        if (dds_up_to_date(texture.name, ddsFilename)) {
+            hr = CreateDDSTextureFromFile(device, ddsFilename.c_str(), nullptr, shaderResourceView.GetAddressOf());
+        }
+        else {
+            hr = CreateWICTextureFromFile(device, texture.name.c_str(), nullptr, shaderResourceView.GetAddressOf());
+            if (FAILED(hr)) {
+                shaderResourceView.Reset();
+                hr = create_stb_texture(device, texture.name, shaderResourceView.GetAddressOf());
+            }
+        }
+        if (FAILED(hr)) {
+            OutputDebugStringW((L"Texture : can't load " + texture.name + L", keeping the placeholder\n").c_str());
+            shaderResourceView.Reset();
+        }
+        D3D11_TEXTURE2D_DESC texture2dDesc = {};
+        describe_texture(shaderResourceView ? shaderResourceView.Get() : texture.placeholder.Get(), &texture2dDesc);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            // insert_texture got there first : its view is already published and counted
+            if (texture.superseded) {
+                return;
+            }
+            publish(texture, shaderResourceView.Get(), texture2dDesc);
+        }
+        decoded.notify_all();
+    }
+
+    std::mutex mutex;
+    std::condition_variable decoded;    // a texture left LOADING
+    std::unordered_map<std::wstring, std::shared_ptr<Texture>> textures;
+    std::unordered_map<DWORD, ComPtr<ID3D11ShaderResourceView>> placeholders;
+    size_t budget = 512 * 1024 * 1024;
+    size_t residentBytes = 0;
+    uint64_t tick = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+
+    // Last, so the workers are joined before the maps they write to are destroyed.
+    ThreadPool threadPool{ std::max(1u, std::thread::hardware_concurrency() / 2) };
+};
+
+void Texture::wait() const {
+    TextureCache::instance().wait(*this);
+}
+
+std::shared_ptr<Texture> request_texture(ID3D11Device* device, const wchar_t* filename, DWORD placeholder) {
+    return TextureCache::instance().request(device, filename, placeholder);
+}
+
+std::shared_ptr<Texture> load_texture(ID3D11Device* device, const wchar_t* filename, DWORD placeholder) {
+    std::shared_ptr<Texture> texture = request_texture(device, filename, placeholder);
+    texture->wait();
+    return texture;
+}
+
+std::shared_ptr<Texture> insert_texture(const wchar_t* filename, ID3D11ShaderResourceView* shaderResourceView) {
+    return TextureCache::instance().insert(filename, shaderResourceView);
+}
+
+std::shared_ptr<Texture> find_texture(const wchar_t* filename) {
+    return TextureCache::instance().find(filename);
+}
+
+std::shared_ptr<Texture> solid_texture(ID3D11Device* device, DWORD value) {
+    return TextureCache::instance().solid(device, value);
+}
+
+void trim_textures() {
+    TextureCache::instance().trim(false);
+}
+
+void set_texture_budget(size_t bytes) {
+    TextureCache::instance().set_budget(bytes);
+    TextureCache::instance().trim(false);
+}
+
+TextureCacheStatistics texture_cache_statistics() {
+    return TextureCache::instance().statistics();
+}
+
 void release_all_textures() {
-    resources.clear();
+    TextureCache::instance().trim(true);
 }
 
 HRESULT make_dummy_texture(ID3D11Device* device, ID3D11ShaderResourceView** shader_resource_view, DWORD value/*0xAABBGGRR*/, UINT dimension) {
@@ -1,8 +1,87 @@
 #pragma once
 #include <d3d11.h>
+#include <wrl.h>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <cstdint>
 
-HRESULT load_texture_from_file(ID3D11Device* device, const wchar_t* filename,ID3D11ShaderResourceView** shaderResourceView, D3D11_TEXTURE2D_DESC* texture2dDesc);
+// Texture owned by the shared texture cache.
+// Until the file has been decoded (or if it can't be), view() returns a small solid-colour placeholder, so
+// callers bind view() every frame instead of keeping the view.
+class Texture {
+public:
+    enum class State {
+        LOADING,    // decoding on a worker thread
+        RESIDENT,
+        FAILED,     // stays on the placeholder
+    };
 
+    ID3D11ShaderResourceView* view() const {
+        return state() == State::RESIDENT ? shaderResourceView.Get() : placeholder.Get();
+    }
+    State state() const { return currentState.load(std::memory_order_acquire); }
+    bool resident() const { return state() == State::RESIDENT; }
+
+    // Blocks until the texture is resident or has failed, helping the decode threads meanwhile.
+    void wait() const;
+
+    // Valid once resident. A failed texture describes its placeholder.
+    const D3D11_TEXTURE2D_DESC& desc() const { return texture2dDesc; }
+    // Bytes of video memory, all mips and array slices. 0 for placeholders and solid textures.
+    size_t memory_size() const { return memorySize; }
+    const std::wstring& filename() const { return name; }
+
+private:
+    std::wstring name;
+    std::atomic<State> currentState = State::LOADING;
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shaderResourceView;
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> placeholder;
+    D3D11_TEXTURE2D_DESC texture2dDesc = {};
+    size_t memorySize = 0;
+    uint64_t lastUsed = 0; // cache tick, guarded by the cache mutex
+    // insert_texture published another view while this one was still decoding : the decode's result is dropped.
+    // Guarded by the cache mutex.
+    bool superseded = false;
+    friend class TextureCache;
+};
+
+// Shared texture cache used by every mesh and sprite loader.
+// Textures are keyed by normalized filename and decoded on a thread pool (the DDS next to the file if the
+// cooker made an up to date one, otherwise WIC, and stb_image for what WIC can't read, such as TGA). Textures nobody holds any more stay cached until the
+// resident total exceeds the budget, then go least recently used first.
+//
+// Returns immediately. The texture shows 'placeholder' (0xAABBGGRR) until it is resident.
+std::shared_ptr<Texture> request_texture(ID3D11Device* device, const wchar_t* filename, DWORD placeholder = 0xFFFFFFFF);
+// request_texture, then waits. For callers that need the size up front (sprites).
+std::shared_ptr<Texture> load_texture(ID3D11Device* device, const wchar_t* filename, DWORD placeholder = 0xFFFFFFFF);
+// Registers a texture decoded by other means under 'filename'. If that file is still decoding, its Texture
+// takes this view and the decode's result is dropped; otherwise the cached Texture is replaced.
+std::shared_ptr<Texture> insert_texture(const wchar_t* filename, ID3D11ShaderResourceView* shaderResourceView);
+// Cached texture, or nullptr. Doesn't start a load.
+std::shared_ptr<Texture> find_texture(const wchar_t* filename);
+// Resident 1x1 texture of one colour (0xAABBGGRR), for materials without a texture file.
+std::shared_ptr<Texture> solid_texture(ID3D11Device* device, DWORD value);
+
+// Main thread, once per frame : evicts unreferenced textures while over budget.
+void trim_textures();
+void set_texture_budget(size_t bytes);
+
+struct TextureCacheStatistics {
+    size_t budget = 0;
+    size_t residentBytes = 0;
+    size_t textureCount = 0;    // cached, resident or not
+    size_t loadingCount = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
+TextureCacheStatistics texture_cache_statistics();
+
+// Drops every texture nobody holds, regardless of the budget.
 void release_all_textures();
 
-HRESULT make_dummy_texture(ID3D11Device* device, ID3D11ShaderResourceView** shader_resource_view, DWORD value/*0xAABBGGRR*/, UINT dimension);
\ No newline at end of file
+// Bytes a texture of this description occupies, all mips and array slices.
+size_t texture_memory_size(const D3D11_TEXTURE2D_DESC& texture2dDesc);
+
+HRESULT make_dummy_texture(ID3D11Device* device, ID3D11ShaderResourceView** shader_resource_view, DWORD value/*0xAABBGGRR*/, UINT dimension);
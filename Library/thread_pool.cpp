@@ -0,0 +1,128 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+// Index of the queue owned by the current thread, or -1 outside of any pool.
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local size_t currentQueue = static_cast<size_t>(-1);
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    for (size_t queueIndex = 0; queueIndex < threadCount; ++queueIndex) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t queueIndex = 0; queueIndex < threadCount; ++queueIndex) {
+        threads.emplace_back(&ThreadPool::run, this, queueIndex);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        quit = true;
+    }
+    taskQueued.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    const size_t queueIndex = currentPool == this ? currentQueue : nextQueue++ % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues.at(queueIndex)->mutex);
+        queues.at(queueIndex)->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        ++queuedCount;
+        ++pendingCount;
+    }
+    taskQueued.notify_one();
+    // A thread inside wait helps with it too
+    allDone.notify_all();
+}
+
+bool ThreadPool::pop(size_t queueIndex, std::function<void()>& task) {
+    const size_t queueCount = queues.size();
+    if (queueIndex < queueCount) {
+        Queue& own = *queues.at(queueIndex);
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset <= queueCount; ++offset) {
+        Queue& victim = *queues.at((queueIndex + offset) % queueCount);
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::execute(std::function<void()>& task) {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        --queuedCount;
+    }
+    task();
+    task = nullptr;
+
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (--pendingCount == 0) {
+        allDone.notify_all();
+    }
+}
+
+void ThreadPool::run(size_t queueIndex) {
+    currentPool = this;
+    currentQueue = queueIndex;
+
+    std::function<void()> task;
+    for (;;) {
+        if (pop(queueIndex, task)) {
+            execute(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(stateMutex);
+        taskQueued.wait(lock, [this] { return quit || queuedCount > 0; });
+        if (quit && queuedCount == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::run_one() {
+    const size_t queueIndex = currentPool == this ? currentQueue : queues.size();
+    std::function<void()> task;
+    if (!pop(queueIndex, task)) {
+        return false;
+    }
+    execute(task);
+    return true;
+}
+
+void ThreadPool::wait() {
+    const size_t queueIndex = currentPool == this ? currentQueue : queues.size();
+    std::function<void()> task;
+    for (;;) {
+        if (pop(queueIndex, task)) {
+            execute(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(stateMutex);
+        if (pendingCount == 0) {
+            return;
+        }
+        // Woken either by the last task finishing or by new work this thread can help with.
+        allDone.wait(lock, [this] { return pendingCount == 0 || queuedCount > 0; });
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Work-stealing thread pool.
+// Every worker owns a queue: it pops its own newest task first and, when that runs dry, steals the
+// oldest task from another worker. Tasks submitted from inside a task go to the submitting worker's
+// queue, so nested work stays on the thread that has its data in cache.
+class ThreadPool {
+public:
+    // 0 : one thread per hardware thread
+    ThreadPool(size_t threadCount = 0);
+    virtual ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Blocks until every submitted task has finished. The calling thread runs queued tasks while it waits.
+    void wait();
+    // Runs one queued task on the calling thread, if there is one. For callers waiting on a particular task,
+    // which then check after every task instead of waiting for the whole pool.
+    bool run_one();
+
+    size_t thread_count() const { return threads.size(); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex stateMutex;
+    std::condition_variable taskQueued;
+    std::condition_variable allDone;
+    size_t queuedCount = 0;     // guarded by stateMutex
+    size_t pendingCount = 0;    // queued + running, guarded by stateMutex
+    bool quit = false;
+    std::atomic<size_t> nextQueue = 0;
+
+    bool pop(size_t queueIndex, std::function<void()>& task);
+    void execute(std::function<void()>& task);
+    void run(size_t queueIndex);
+};
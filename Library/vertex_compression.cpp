@@ -0,0 +1,177 @@
+#include "vertex_compression.h"
+
+#include <directxpackedvector.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace vertex_compression {
+    namespace {
+        inline float sign_not_zero(float value) {
+            return value >= 0 ? 1.0f : -1.0f;
+        }
+
+        inline float length(const XMFLOAT3& v) {
+            return sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+        }
+
+        // Unit vector -> [-1,1]^2. The lower hemisphere is folded over the diagonals.
+        void to_octahedral(const XMFLOAT3& v, float& x, float& y) {
+            const float l1 = fabsf(v.x) + fabsf(v.y) + fabsf(v.z);
+            if (l1 == 0) {
+                x = y = 0; // decodes to +z
+                return;
+            }
+            x = v.x / l1;
+            y = v.y / l1;
+            if (v.z < 0) {
+                const float foldedX = (1 - fabsf(y)) * sign_not_zero(x);
+                const float foldedY = (1 - fabsf(x)) * sign_not_zero(y);
+                x = foldedX;
+                y = foldedY;
+            }
+        }
+
+        XMFLOAT3 from_octahedral(float x, float y) {
+            XMFLOAT3 v(x, y, 1 - fabsf(x) - fabsf(y));
+            const float t = std::max(-v.z, 0.0f);
+            v.x += v.x >= 0 ? -t : t;
+            v.y += v.y >= 0 ? -t : t;
+            const float l = length(v);
+            return XMFLOAT3(v.x / l, v.y / l, v.z / l);
+        }
+
+        // atan2 keeps its precision at tiny angles, where acos of the dot product doesn't
+        float angle_degrees(const XMFLOAT3& a, const XMFLOAT3& b) {
+            const double cx = static_cast<double>(a.y) * b.z - static_cast<double>(a.z) * b.y;
+            const double cy = static_cast<double>(a.z) * b.x - static_cast<double>(a.x) * b.z;
+            const double cz = static_cast<double>(a.x) * b.y - static_cast<double>(a.y) * b.x;
+            const double dot = static_cast<double>(a.x) * b.x + static_cast<double>(a.y) * b.y + static_cast<double>(a.z) * b.z;
+            return static_cast<float>(atan2(sqrt(cx * cx + cy * cy + cz * cz), dot) * 180.0 / 3.14159265358979323846);
+        }
+
+        // Octahedral coordinates on a grid of 1/xScale by 1/yScale steps. Rounding each coordinate on its own
+        // isn't always the closest direction, so all four surrounding grid points are decoded and compared.
+        void quantize_octahedral(const XMFLOAT3& v, int xScale, int yScale, int& qx, int& qy) {
+            float x, y;
+            to_octahedral(v, x, y);
+            const int baseX = static_cast<int>(floorf(x * xScale));
+            const int baseY = static_cast<int>(floorf(y * yScale));
+            const float l = length(v);
+            float bestDot = -2.0f;
+            for (int offsetY = 0; offsetY < 2; ++offsetY) {
+                for (int offsetX = 0; offsetX < 2; ++offsetX) {
+                    const int candidateX = std::clamp(baseX + offsetX, -xScale, xScale);
+                    const int candidateY = std::clamp(baseY + offsetY, -yScale, yScale);
+                    const XMFLOAT3 decoded = from_octahedral(static_cast<float>(candidateX) / xScale, static_cast<float>(candidateY) / yScale);
+                    const float dot = l > 0 ? (decoded.x * v.x + decoded.y * v.y + decoded.z * v.z) / l : 0;
+                    if (dot > bestDot) {
+                        bestDot = dot;
+                        qx = candidateX;
+                        qy = candidateY;
+                    }
+                }
+            }
+        }
+
+        constexpr int SNORM16_SCALE = 32767;
+        constexpr int TANGENT_Y_SCALE = 16383; // 15 bits, the lowest bit holds the sign
+    }
+
+    void encode_octahedral(const XMFLOAT3& v, int16_t encoded[2]) {
+        int qx, qy;
+        quantize_octahedral(v, SNORM16_SCALE, SNORM16_SCALE, qx, qy);
+        encoded[0] = static_cast<int16_t>(qx);
+        encoded[1] = static_cast<int16_t>(qy);
+    }
+
+    XMFLOAT3 decode_octahedral(const int16_t encoded[2]) {
+        return from_octahedral(static_cast<float>(encoded[0]) / SNORM16_SCALE, static_cast<float>(encoded[1]) / SNORM16_SCALE);
+    }
+
+    void encode_tangent(const XMFLOAT4& tangent, int16_t encoded[2]) {
+        int qx, qy;
+        quantize_octahedral(XMFLOAT3(tangent.x, tangent.y, tangent.z), SNORM16_SCALE, TANGENT_Y_SCALE, qx, qy);
+        encoded[0] = static_cast<int16_t>(qx);
+        encoded[1] = static_cast<int16_t>(qy * 2 + (tangent.w < 0 ? 1 : 0));
+    }
+
+    XMFLOAT4 decode_tangent(const int16_t encoded[2]) {
+        const int sign = encoded[1] & 1;
+        const int qy = (encoded[1] - sign) / 2;
+        const XMFLOAT3 v = from_octahedral(static_cast<float>(encoded[0]) / SNORM16_SCALE, static_cast<float>(qy) / TANGENT_Y_SCALE);
+        return XMFLOAT4(v.x, v.y, v.z, sign ? -1.0f : 1.0f);
+    }
+
+    void encode_texcoord(const XMFLOAT2& texcoord, uint16_t encoded[2]) {
+        encoded[0] = PackedVector::XMConvertFloatToHalf(texcoord.x);
+        encoded[1] = PackedVector::XMConvertFloatToHalf(texcoord.y);
+    }
+
+    XMFLOAT2 decode_texcoord(const uint16_t encoded[2]) {
+        return XMFLOAT2(PackedVector::XMConvertHalfToFloat(encoded[0]), PackedVector::XMConvertHalfToFloat(encoded[1]));
+    }
+
+    void encode_weights(const float weights[4], uint8_t encoded[4]) {
+        float total = 0;
+        for (int i = 0; i < 4; ++i) {
+            total += weights[i];
+        }
+        if (fabsf(total - 1.0f) > 1e-3f) {
+            // Not a normalized set : plain rounding
+            for (int i = 0; i < 4; ++i) {
+                encoded[i] = static_cast<uint8_t>(std::clamp(static_cast<int>(weights[i] * 255 + 0.5f), 0, 255));
+            }
+            return;
+        }
+
+        // Largest remainder : round every weight down, then round up the ones closest to their next step
+        // until the sum is 255. Every weight ends up on its floor or ceiling, so the error stays under 1/255.
+        int quantized[4];
+        float remainders[4];
+        int sum = 0;
+        for (int i = 0; i < 4; ++i) {
+            const float scaled = std::clamp(weights[i], 0.0f, 1.0f) * 255;
+            quantized[i] = static_cast<int>(floorf(scaled));
+            remainders[i] = scaled - quantized[i];
+            sum += quantized[i];
+        }
+        for (; sum < 255; ++sum) {
+            const int i = static_cast<int>(std::max_element(remainders, remainders + 4) - remainders);
+            ++quantized[i];
+            remainders[i] = -1.0f;
+        }
+        for (int i = 0; i < 4; ++i) {
+            encoded[i] = static_cast<uint8_t>(std::min(quantized[i], 255));
+        }
+    }
+
+    void Error::add_normal(const XMFLOAT3& source, const int16_t encoded[2]) {
+        if (length(source) > 0) {
+            normalDegrees = std::max(normalDegrees, angle_degrees(source, decode_octahedral(encoded)));
+        }
+    }
+
+    void Error::add_tangent(const XMFLOAT4& source, const int16_t encoded[2]) {
+        const XMFLOAT3 direction(source.x, source.y, source.z);
+        if (length(direction) > 0) {
+            const XMFLOAT4 decoded = decode_tangent(encoded);
+            tangentDegrees = std::max(tangentDegrees, angle_degrees(direction, XMFLOAT3(decoded.x, decoded.y, decoded.z)));
+            if ((source.w < 0) != (decoded.w < 0)) {
+                tangentDegrees = 180.0f;
+            }
+        }
+    }
+
+    void Error::add_texcoord(const XMFLOAT2& source, const uint16_t encoded[2]) {
+        const XMFLOAT2 decoded = decode_texcoord(encoded);
+        texcoord = std::max({ texcoord, fabsf(decoded.x - source.x), fabsf(decoded.y - source.y) });
+    }
+
+    void Error::add_weights(const float source[4], const uint8_t encoded[4]) {
+        for (int i = 0; i < 4; ++i) {
+            weight = std::max(weight, fabsf(encoded[i] / 255.0f - source[i]));
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <directxmath.h>
+#include <cstdint>
+
+// Encoders for the compressed vertex layouts of SkinnedMesh and StaticMesh. Run at cook time; the vertex
+// shaders decode with the matching functions in Shader/vertex_compression.hlsli.
+namespace vertex_compression {
+    // A mesh whose encoding error exceeds any of these is kept in the full float layout.
+    constexpr float MAX_NORMAL_ERROR_DEGREES = 0.05f;
+    constexpr float MAX_TEXCOORD_ERROR = 1.0f / 2048; // half a texel of a 1024 texture
+    constexpr float MAX_WEIGHT_ERROR = 1.0f / 255;
+
+    // Unit vector as octahedral coordinates in two SNORM16 (DXGI_FORMAT_R16G16_SNORM).
+    // The four nearest quantized points are tried and the one decoding closest to 'v' is kept.
+    void encode_octahedral(const DirectX::XMFLOAT3& v, int16_t encoded[2]);
+    DirectX::XMFLOAT3 decode_octahedral(const int16_t encoded[2]);
+
+    // Tangent plus bitangent sign (w = +1/-1) in two SINT16 (DXGI_FORMAT_R16G16_SINT) : octahedral x in 16 bits,
+    // y in the upper 15 bits and the sign in the lowest bit of y.
+    void encode_tangent(const DirectX::XMFLOAT4& tangent, int16_t encoded[2]);
+    DirectX::XMFLOAT4 decode_tangent(const int16_t encoded[2]);
+
+    // DXGI_FORMAT_R16G16_FLOAT
+    void encode_texcoord(const DirectX::XMFLOAT2& texcoord, uint16_t encoded[2]);
+    DirectX::XMFLOAT2 decode_texcoord(const uint16_t encoded[2]);
+
+    // DXGI_FORMAT_R8G8B8A8_UNORM. Weights summing to 1 still sum to exactly 255 after rounding.
+    void encode_weights(const float weights[4], uint8_t encoded[4]);
+
+    // Largest encoding error seen so far. Directions whose source is a zero vector are not measured.
+    struct Error {
+        float normalDegrees = 0;
+        float tangentDegrees = 0;
+        float texcoord = 0;
+        float weight = 0;
+
+        void add_normal(const DirectX::XMFLOAT3& source, const int16_t encoded[2]);
+        void add_tangent(const DirectX::XMFLOAT4& source, const int16_t encoded[2]);
+        void add_texcoord(const DirectX::XMFLOAT2& source, const uint16_t encoded[2]);
+        void add_weights(const float source[4], const uint8_t encoded[4]);
+
+        bool within_bounds() const {
+            return normalDegrees <= MAX_NORMAL_ERROR_DEGREES && tangentDegrees <= MAX_NORMAL_ERROR_DEGREES &&
+                texcoord <= MAX_TEXCOORD_ERROR && weight <= MAX_WEIGHT_ERROR;
+        }
+    };
+}
@@ -0,0 +1,20 @@
+// Graphics/DebugRenderer.cpp の CbMesh
+cbuffer CbMesh : register(b0)
+{
+    row_major float4x4 wvp;
+    float4 color;
+};
+
+struct VS_OUT
+{
+    float4 position : SV_POSITION;
+    float4 color : COLOR;
+};
+
+VS_OUT main(float4 position : POSITION)
+{
+    VS_OUT vout;
+    vout.position = mul(position, wvp);
+    vout.color = color;
+    return vout;
+}
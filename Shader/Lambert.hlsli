@@ -0,0 +1,24 @@
+// Graphics/LambertShader.cpp の定数バッファと頂点 (ModelResource::Vertex) に合わせる
+struct VS_OUT
+{
+    float4 position : SV_POSITION;
+    float2 texcoord : TEXCOORD;
+    float4 color : COLOR;
+};
+
+cbuffer CbScene : register(b0)
+{
+    row_major float4x4 viewProjection;
+    float4 lightDirection;
+};
+
+#define MAX_BONES 128
+cbuffer CbMesh : register(b1)
+{
+    row_major float4x4 boneTransforms[MAX_BONES];
+};
+
+cbuffer CbSubset : register(b2)
+{
+    float4 materialColor;
+};
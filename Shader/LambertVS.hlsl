@@ -0,0 +1,32 @@
+#include "Lambert.hlsli"
+
+// 剛体メッシュはboneTransforms[0]にワールド行列が入っていて、頂点のウェイトは(1,0,0,0)
+VS_OUT main(
+    float4 position : POSITION,
+    float3 normal : NORMAL,
+    float3 tangent : TANGENT,
+    float2 texcoord : TEXCOORD,
+    float4 color : COLOR,
+    float4 boneWeights : WEIGHTS,
+    uint4 boneIndices : BONES)
+{
+    float3 p = { 0, 0, 0 };
+    float3 n = { 0, 0, 0 };
+    for (int i = 0; i < 4; i++)
+    {
+        p += (boneWeights[i] * mul(position, boneTransforms[boneIndices[i]])).xyz;
+        n += (boneWeights[i] * mul(float4(normal.xyz, 0), boneTransforms[boneIndices[i]])).xyz;
+    }
+
+    VS_OUT vout;
+    vout.position = mul(float4(p, 1.0f), viewProjection);
+
+    float3 N = normalize(n);
+    float3 L = normalize(-lightDirection.xyz);
+    float d = dot(L, N);
+    vout.color.xyz = color.xyz * materialColor.xyz * max(0, d);
+    vout.color.w = color.w * materialColor.w;
+    vout.texcoord = texcoord;
+
+    return vout;
+}
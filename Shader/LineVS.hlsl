@@ -0,0 +1,19 @@
+// Graphics/LineRenderer.cpp の ConstantBuffer (頂点はワールド座標)
+cbuffer ConstantBuffer : register(b0)
+{
+    row_major float4x4 wvp;
+};
+
+struct VS_OUT
+{
+    float4 position : SV_POSITION;
+    float4 color : COLOR;
+};
+
+VS_OUT main(float4 position : POSITION, float4 color : COLOR)
+{
+    VS_OUT vout;
+    vout.position = mul(position, wvp);
+    vout.color = color;
+    return vout;
+}
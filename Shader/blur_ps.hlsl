@@ -4,13 +4,11 @@
 #define ANISOTROPIC 2
 SamplerState samplerStates[3] : register(s0);
 Texture2D textureMaps[4] : register(t0);
+// 抽出した輝度をぼかしてブルームの強さを掛ける。合成はcomposite_ps
 float4 main(VS_OUT pin) : SV_TARGET
 {
     uint mipLevel = 0, width, height, numberOfLevels;
-    textureMaps[1].GetDimensions(mipLevel, width, height, numberOfLevels);
-    
-    float4 color = textureMaps[0].Sample(samplerStates[ANISOTROPIC], pin.texcoord);
-    float alpha = color.a;
+    textureMaps[0].GetDimensions(mipLevel, width, height, numberOfLevels);
     
     float3 blurColor = 0;
     float gaussianKernelTotal = 0;
@@ -24,24 +22,12 @@ float4 main(VS_OUT pin) : SV_TARGET
         {
             float gaussianKernel = exp(-(x * x + y * y) / (2.0 * gaussianSigma * gaussianSigma)) /
             (2 * 3.14159265358979 * gaussianSigma * gaussianSigma);
-            blurColor += textureMaps[1].Sample(samplerStates[LINEAR], pin.texcoord +
+            blurColor += textureMaps[0].Sample(samplerStates[LINEAR], pin.texcoord +
             float2(x * 1.0 / width, y * 1.0 / height)).rgb * gaussianKernel;
             gaussianKernelTotal += gaussianKernel;
         }
     }
     blurColor /= gaussianKernelTotal;
-    color.rgb += blurColor * bloomIntensity;
-    
-#if 1
-    // Tone mapping : HDR -> SDR
-    color.rgb = 1 - exp(-color.rgb * exposure);
-#endif
-
-#if 1
-    // Gamma process
-    const float GAMMA = 2.2;
-    color.rgb = pow(color.rgb, 1.0 / GAMMA);
-#endif    
     
-    return float4(color.rgb, alpha);
+    return float4(blurColor * bloomIntensity, 1);
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+#include "fullscreen_quad.hlsli"
+#define POINT 0
+#define LINEAR 1
+#define ANISOTROPIC 2
+SamplerState samplerStates[3] : register(s0);
+Texture2D textureMaps[4] : register(t0);
+// シーンにblur_psのブルームを足してトーンマッピングする
+float4 main(VS_OUT pin) : SV_TARGET
+{
+    float4 color = textureMaps[0].Sample(samplerStates[ANISOTROPIC], pin.texcoord);
+    float alpha = color.a;
+    
+    color.rgb += textureMaps[1].Sample(samplerStates[LINEAR], pin.texcoord).rgb;
+    
+#if 1
+    // Tone mapping : HDR -> SDR
+    color.rgb = 1 - exp(-color.rgb * exposure);
+#endif
+
+#if 1
+    // Gamma process
+    const float GAMMA = 2.2;
+    color.rgb = pow(color.rgb, 1.0 / GAMMA);
+#endif    
+    
+    return float4(color.rgb, alpha);
+}
\ No newline at end of file
@@ -11,7 +11,7 @@ cbuffer LUMINANCE_CONSTANT_BUFFER : register(b0)
 cbuffer BLUR_CONSTANT_BUFFER : register(b1)
 {
     float gaussianSigma;
-    float bloomIntensity; // 
+    float bloomIntensity; // 強さ
 }
 cbuffer TONE_MAPPING_CONSTANT_BUFFER : register(b2)
 {
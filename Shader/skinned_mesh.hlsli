@@ -1,3 +1,4 @@
+#include "vertex_compression.hlsli"
 struct VS_IN
 {
     float4 position : POSITION;
@@ -7,6 +8,16 @@ struct VS_IN
     float4 boneWeights : WEIGHTS;
     uint4 boneIndices : BONES;
 };
+// SkinnedMesh::CompressedVertex
+struct VS_IN_COMPRESSED
+{
+    float3 position : POSITION;
+    float2 normal : NORMAL;         // octahedral
+    int2 tangent : TANGENT;         // see decode_tangent
+    float2 texcoord : TEXCOORD;     // half
+    float4 boneWeights : WEIGHTS;   // UNORM8
+    uint4 boneIndices : BONES;      // UINT8
+};
 struct VS_OUT
 {
     float4 position : SV_POSITION;
@@ -19,13 +30,83 @@ struct VS_OUT
 static const int MAX_BONES = 256;
 cbuffer OBJECT_CONSTANT_BUFFER : register(b0)
 {
-    row_major float4x4 world; // row_major͍sD̈Ӗ
+    row_major float4x4 world; // row_majorは行優先の意味
     float4 materialColor;
-    row_major float4x4 boneTransforms[MAX_BONES];
 };
+// メッシュのボーン数だけの行列 (SkinnedMesh::Mesh::boneBuffer)。メッシュごとに一度だけ更新される
+// t0からはピクセルシェーダーのテクスチャが使うのでずらしておく
+struct Bone
+{
+    row_major float4x4 transform;
+};
+StructuredBuffer<Bone> boneTransforms : register(t8);
 cbuffer SCENE_CONSTANT_BUFFER : register(b1)
 {
     row_major float4x4 viewProjection;
     float4 lightDirection;
     float4 cameraPosition;
-};
\ No newline at end of file
+};
+
+VS_IN decode_vertex(VS_IN_COMPRESSED vin)
+{
+    VS_IN decoded;
+    decoded.position = float4(vin.position, 1);
+    decoded.normal = float4(decode_octahedral(vin.normal), 0);
+    decoded.tangent = decode_tangent(vin.tangent);
+    decoded.texcoord = vin.texcoord;
+    decoded.boneWeights = vin.boneWeights;
+    decoded.boneIndices = vin.boneIndices;
+    return decoded;
+}
+
+// Shared by skinned_mesh_vs.hlsl and skinned_mesh_compressed_vs.hlsl
+VS_OUT skin_vertex(VS_IN vin)
+{
+    // 頂点と法線の変換処理
+    vin.normal.w = 0;
+    float sigma = vin.tangent.w;
+    vin.tangent.w = 0;
+    
+    float4 blendedPosition = { 0, 0, 0, 1 };
+    float4 blendedNormal = { 0, 0, 0, 0 };
+    float4 blendedTangent = { 0, 0, 0, 0 };
+    
+    for (int boneIndex = 0; boneIndex < 4; ++boneIndex)
+    {
+        blendedPosition += vin.boneWeights[boneIndex]
+        * mul(vin.position, boneTransforms[vin.boneIndices[boneIndex]].transform);
+        blendedNormal += vin.boneWeights[boneIndex]
+        * mul(vin.normal, boneTransforms[vin.boneIndices[boneIndex]].transform);
+        blendedTangent += vin.boneWeights[boneIndex]
+        * mul(vin.tangent, boneTransforms[vin.boneIndices[boneIndex]].transform);
+    }
+    vin.position = float4(blendedPosition.xyz, 1.0f);
+    vin.normal = float4(blendedNormal.xyz, 0.0f);
+    vin.tangent = float4(blendedTangent.xyz, 0.0f);
+    
+    VS_OUT vout;
+    vout.position = mul(vin.position, mul(world, viewProjection));
+    vout.worldPosition = mul(vin.position, world);
+    vout.worldNormal = normalize(mul(vin.normal, world));
+    vout.worldTangent = normalize(mul(vin.tangent, world));
+    vout.worldTangent.w = sigma;
+    vout.texcoord = vin.texcoord;
+#if 1
+    vout.color = materialColor;
+#else
+    vout.color = 0;
+    const float4 boneColors[4] = {
+        {1,0,0,1 },
+        {0,1,0,1 },
+        {0,0,1,1 },
+        {1,1,1,1 },
+    };
+    for (int boneIndex = 0; boneIndex < 4; ++boneIndex)
+    {
+        vout.color += boneColors[vin.boneIndices[boneIndex] % 4]
+        * vin.boneWeights[boneIndex];
+    }
+#endif
+    
+    return vout;
+}
\ No newline at end of file
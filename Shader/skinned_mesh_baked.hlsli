@@ -0,0 +1,63 @@
+#include "skinned_mesh.hlsli"
+
+// SkinnedMesh::render_baked : every instance in one draw, skinning matrices read from BakedAnimation's texture
+// SkinnedMesh::BakedInstanceData
+struct BakedInstance
+{
+    row_major float4x4 world;
+    uint2 rows;     // BakedAnimation::FrameAddress
+    float blend;
+    uint padding;
+};
+StructuredBuffer<BakedInstance> bakedInstances : register(t9);
+// 1行が1フレーム、ボーンごとに行列の1～3列目の3テクセル (4列目は常に0,0,0,1)
+Texture2D<float4> bakedPalettes : register(t10);
+// SkinnedMesh::BakedConstants
+cbuffer BAKED_CONSTANT_BUFFER : register(b2)
+{
+    float4 bakedMaterialColor;
+    uint firstBone;     // this mesh's first bone in the palette
+};
+static const uint TEXELS_PER_BONE = 3;
+
+float3x4 baked_bone(uint row, uint bone)
+{
+    int x = (firstBone + bone) * TEXELS_PER_BONE;
+    return float3x4(
+        bakedPalettes.Load(int3(x + 0, row, 0)),
+        bakedPalettes.Load(int3(x + 1, row, 0)),
+        bakedPalettes.Load(int3(x + 2, row, 0)));
+}
+
+// Shared by skinned_mesh_baked_vs.hlsl and skinned_mesh_baked_compressed_vs.hlsl
+VS_OUT skin_baked_vertex(VS_IN vin, uint instanceId)
+{
+    BakedInstance instance = bakedInstances[instanceId];
+    float sigma = vin.tangent.w;
+    float4 position = float4(vin.position.xyz, 1);
+    float4 normal = float4(vin.normal.xyz, 0);
+    float4 tangent = float4(vin.tangent.xyz, 0);
+
+    float3 blendedPosition = 0;
+    float3 blendedNormal = 0;
+    float3 blendedTangent = 0;
+    for (int boneIndex = 0; boneIndex < 4; ++boneIndex)
+    {
+        // 前後のフレームの行列を補間する
+        float3x4 bone = lerp(baked_bone(instance.rows.x, vin.boneIndices[boneIndex]),
+            baked_bone(instance.rows.y, vin.boneIndices[boneIndex]), instance.blend);
+        blendedPosition += vin.boneWeights[boneIndex] * mul(bone, position);
+        blendedNormal += vin.boneWeights[boneIndex] * mul(bone, normal);
+        blendedTangent += vin.boneWeights[boneIndex] * mul(bone, tangent);
+    }
+
+    VS_OUT vout;
+    vout.worldPosition = mul(float4(blendedPosition, 1), instance.world);
+    vout.position = mul(vout.worldPosition, viewProjection);
+    vout.worldNormal = normalize(mul(float4(blendedNormal, 0), instance.world));
+    vout.worldTangent = normalize(mul(float4(blendedTangent, 0), instance.world));
+    vout.worldTangent.w = sigma;
+    vout.texcoord = vin.texcoord;
+    vout.color = bakedMaterialColor;
+    return vout;
+}
@@ -0,0 +1,5 @@
+#include "skinned_mesh_baked.hlsli"
+VS_OUT main(VS_IN_COMPRESSED vin, uint instanceId : SV_InstanceID)
+{
+    return skin_baked_vertex(decode_vertex(vin), instanceId);
+}
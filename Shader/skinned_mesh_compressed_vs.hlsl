@@ -0,0 +1,5 @@
+#include "skinned_mesh.hlsli"
+VS_OUT main(VS_IN_COMPRESSED vin)
+{
+    return skin_vertex(decode_vertex(vin));
+}
@@ -0,0 +1,51 @@
+#include "skinned_mesh.hlsli"
+
+// SkinnedMesh::render_instanced : a batch of instances per draw, each skinned with its own palette
+// SkinnedMesh::InstancedData
+struct Instance
+{
+    row_major float4x4 world;   // メッシュのノード行列込み
+    float4 materialColor;
+    uint firstBone;             // instancedBones内のこのメッシュの先頭ボーン
+    uint3 padding;
+};
+StructuredBuffer<Instance> instances : register(t9);
+// 描画で使う全パレットのボーン行列を並べたもの (同じパレットのインスタンスは共有)
+StructuredBuffer<Bone> instancedBones : register(t10);
+// SkinnedMesh::InstancedConstants
+cbuffer INSTANCED_CONSTANT_BUFFER : register(b2)
+{
+    float4 instancedMaterialColor;
+    uint instanceOffset;    // SV_InstanceIDにStartInstanceLocationは含まれないのでここで足す
+};
+
+// Shared by skinned_mesh_instanced_vs.hlsl and skinned_mesh_instanced_compressed_vs.hlsl
+VS_OUT skin_instanced_vertex(VS_IN vin, uint instanceId)
+{
+    Instance instance = instances[instanceOffset + instanceId];
+    float sigma = vin.tangent.w;
+    float4 position = float4(vin.position.xyz, 1);
+    float4 normal = float4(vin.normal.xyz, 0);
+    float4 tangent = float4(vin.tangent.xyz, 0);
+
+    float3 blendedPosition = 0;
+    float3 blendedNormal = 0;
+    float3 blendedTangent = 0;
+    for (int boneIndex = 0; boneIndex < 4; ++boneIndex)
+    {
+        float4x4 bone = instancedBones[instance.firstBone + vin.boneIndices[boneIndex]].transform;
+        blendedPosition += vin.boneWeights[boneIndex] * mul(position, bone).xyz;
+        blendedNormal += vin.boneWeights[boneIndex] * mul(normal, bone).xyz;
+        blendedTangent += vin.boneWeights[boneIndex] * mul(tangent, bone).xyz;
+    }
+
+    VS_OUT vout;
+    vout.worldPosition = mul(float4(blendedPosition, 1), instance.world);
+    vout.position = mul(vout.worldPosition, viewProjection);
+    vout.worldNormal = normalize(mul(float4(blendedNormal, 0), instance.world));
+    vout.worldTangent = normalize(mul(float4(blendedTangent, 0), instance.world));
+    vout.worldTangent.w = sigma;
+    vout.texcoord = vin.texcoord;
+    vout.color = instance.materialColor * instancedMaterialColor;
+    return vout;
+}
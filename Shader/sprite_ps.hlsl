@@ -1,11 +1,11 @@
 #include "sprite.hlsli"
-// sNZVF[_FF̕`
+// ピクセルシェーダ：色の描画
 Texture2D colorMap : register(t0);
 SamplerState pointSamplerState : register(s0);
 SamplerState linearSamplerState : register(s1);
 SamplerState anisotropicSamplerState : register(s2);
 
-float4 main(VS_OUT pin) : SV_TARGET // SV_TARGETȂǂ̃Z}eBbN = Ӗt
+float4 main(VS_OUT pin) : SV_TARGET // SV_TARGETなどのセマンティック = 意味付け
 {
     float4 color = colorMap.Sample(anisotropicSamplerState, pin.texcoord);
     float alpha = color.a;
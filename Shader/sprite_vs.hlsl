@@ -1,5 +1,5 @@
 #include "sprite.hlsli"
-// _VF[_[
+// 頂点シェーダー
 VS_OUT main( float4 position : POSITION,float4 color : COLOR , float2 texcoord : TEXCOORD)
 {
 	VS_OUT vout;
@@ -0,0 +1,17 @@
+#include "static_mesh.hlsli"
+#include "vertex_compression.hlsli"
+// StaticMesh::CompressedVertex : octahedral normal, half texcoord
+VS_OUT main(float4 position : POSITION, float2 normal : NORMAL, float2 texcoord : TEXCOORD)
+{
+    VS_OUT vout;
+    vout.position = mul(position, mul(world, viewProjection));
+    vout.worldPosition = mul(position, world);
+
+    float4 N = normalize(mul(float4(decode_octahedral(normal), 0), world));
+    vout.worldNormal = N;
+    vout.color = materialColor;
+
+    vout.texcoord = texcoord;
+
+    return vout;
+}
@@ -6,7 +6,7 @@ SamplerState pointSamplerState : register(s0);
 SamplerState linerSamplerState : register(s1);
 SamplerState anisotropicSamplerState : register(s2);
 
-//#define TEST1 // ʔ˃eXgp
+//#define TEST1 // 鏡面反射テスト用
 
 float4 main(VS_OUT pin) : SV_TARGET
 {
@@ -34,7 +34,7 @@ float4 main(VS_OUT pin) : SV_TARGET
 #ifdef TEST1
     float3 specular = pow(max(0, dot(N, normalize(V + L))), 256);
 #else 
-    float3 specular = pow(max(0, dot(N, normalize(V + L))), 128); // ̑Ŕ˂̒l̒
+    float3 specular = pow(max(0, dot(N, normalize(V + L))), 128); // ここの第二引数で反射の値の調整
 #endif
     return float4(diffuse + specular, alpha) * pin.color;
 }
\ No newline at end of file
@@ -0,0 +1,18 @@
+// Decoders for the compressed vertex layouts (Library/vertex_compression.h)
+
+// Octahedral coordinates in [-1,1]^2 -> unit vector
+float3 decode_octahedral(float2 encoded)
+{
+    float3 v = float3(encoded.x, encoded.y, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = saturate(-v.z);
+    v.xy += v.xy >= 0.0 ? -t : t;
+    return normalize(v);
+}
+
+// R16G16_SINT : octahedral x in 16 bits, y in the upper 15 bits, bitangent sign in the lowest bit of y
+float4 decode_tangent(int2 encoded)
+{
+    int negative = encoded.y & 1;
+    float2 octahedral = float2(encoded.x / 32767.0, ((encoded.y - negative) / 2) / 16383.0);
+    return float4(decode_octahedral(octahedral), negative ? -1.0 : 1.0);
+}
@@ -0,0 +1,165 @@
+#include "tests.h"
+
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+#include "baked_animation.h"
+
+using namespace DirectX;
+
+namespace {
+    const uint32_t PALETTE_SIZE = 4;
+    const float FRAMES_PER_SECOND = 30.0f;
+    const float EPSILON = 1e-4f;
+
+    // Stands in for SkinnedMesh::build_palette 'seconds' into a clip : affine matrices whose every element moves
+    // linearly with time, so bone_transform's lerp between two frames lands exactly on the palette in between
+    XMFLOAT4X4 palette_transform(uint32_t clip, uint32_t bone, float seconds) {
+        const float s = seconds + 0.25f * bone + clip;
+        return {
+            1 + 0.5f * s, 0.1f * s, -0.2f * s, 0,
+            0.3f * s, 1 - 0.1f * s, 0.05f * s, 0,
+            -0.4f * s, 0.2f * s, 1 + 0.3f * s, 0,
+            2 * s, -s + bone, 0.5f * s + clip, 1,
+        };
+    }
+
+    // What SkinnedMesh::bake_animations does with build_palette : frame i of every clip at min(i / rate, duration)
+    void bake(BakedAnimation& baked, const std::vector<float>& durations, const std::vector<ClipSampler::WrapMode>& wrapModes) {
+        baked.reset(PALETTE_SIZE, FRAMES_PER_SECOND);
+        std::vector<XMFLOAT4X4> boneTransforms(PALETTE_SIZE);
+        for (size_t clipIndex = 0; clipIndex < durations.size(); ++clipIndex) {
+            const uint32_t clip = baked.add_clip(durations.at(clipIndex), wrapModes.at(clipIndex));
+            const BakedAnimation::Clip& bakedClip = baked.clip(clip);
+            for (uint32_t frame = 0; frame < bakedClip.frameCount; ++frame) {
+                const float seconds = std::min<float>(frame / FRAMES_PER_SECOND, bakedClip.duration);
+                for (uint32_t bone = 0; bone < PALETTE_SIZE; ++bone) {
+                    boneTransforms.at(bone) = palette_transform(clip, bone, seconds);
+                }
+                baked.set_frame(bakedClip.firstRow + frame, boneTransforms.data());
+            }
+        }
+    }
+
+    // bone_transform at 'seconds' into 'clip' against the palette at 'expectedSeconds', over every bone
+    bool matches(const BakedAnimation& baked, uint32_t clip, float seconds, float expectedSeconds) {
+        const BakedAnimation::FrameAddress address = baked.address(clip, seconds);
+        for (uint32_t bone = 0; bone < PALETTE_SIZE; ++bone) {
+            const XMFLOAT4X4 transform = baked.bone_transform(address, bone);
+            const XMFLOAT4X4 expected = palette_transform(clip, bone, expectedSeconds);
+            for (int row = 0; row < 4; ++row) {
+                for (int column = 0; column < 4; ++column) {
+                    if (fabsf(transform.m[row][column] - expected.m[row][column]) > EPSILON) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // Rows of a clip, and the extra frame of a duration that isn't a whole number of frames
+    int test_layout() {
+        int failures = 0;
+        BakedAnimation baked;
+        bake(baked, { 1.0f, 1.01f, 0.0f }, { ClipSampler::WrapMode::LOOP, ClipSampler::WrapMode::LOOP, ClipSampler::WrapMode::LOOP });
+        CHECK(baked.clip_count() == 3);
+        CHECK(baked.clip(0).firstRow == 0);
+        CHECK(baked.clip(0).frameCount == 31);
+        CHECK(baked.clip(1).firstRow == 31);
+        CHECK(baked.clip(1).frameCount == 32);
+        CHECK(baked.clip(2).firstRow == 63);
+        CHECK(baked.clip(2).frameCount == 1);
+        CHECK(baked.width() == PALETTE_SIZE * BakedAnimation::TEXELS_PER_BONE);
+        CHECK(baked.height() == 64);
+        CHECK(baked.size_in_bytes() == sizeof(XMFLOAT4) * baked.width() * baked.height());
+
+        // A single frame clip holds it whatever the time
+        for (float seconds : { -1.0f, 0.0f, 0.5f, 10.0f }) {
+            const BakedAnimation::FrameAddress address = baked.address(2, seconds);
+            CHECK(address.rows[0] == 63 && address.rows[1] == 63);
+            CHECK(matches(baked, 2, seconds, 0));
+        }
+        return failures;
+    }
+
+    // bone_transform reproduces the palettes it was baked from, on the frames and between them
+    int test_bone_transform() {
+        int failures = 0;
+        BakedAnimation baked;
+        bake(baked, { 1.0f, 1.01f }, { ClipSampler::WrapMode::CLAMP, ClipSampler::WrapMode::CLAMP });
+        for (uint32_t clip = 0; clip < 2; ++clip) {
+            const BakedAnimation::Clip& bakedClip = baked.clip(clip);
+            for (uint32_t frame = 0; frame < bakedClip.frameCount; ++frame) {
+                const float seconds = std::min<float>(frame / FRAMES_PER_SECOND, bakedClip.duration);
+                CHECK(matches(baked, clip, seconds, seconds));
+            }
+            for (int step = 0; step <= 1000; ++step) {
+                const float seconds = bakedClip.duration * step / 1000;
+                CHECK(matches(baked, clip, seconds, seconds));
+                const BakedAnimation::FrameAddress address = baked.address(clip, seconds);
+                CHECK(address.rows[1] == address.rows[0] + 1);
+                CHECK(address.rows[0] >= bakedClip.firstRow && address.rows[1] < bakedClip.firstRow + bakedClip.frameCount);
+                CHECK(address.blend >= 0 && address.blend <= 1);
+            }
+        }
+
+        // The last frame of 1.01 seconds is only 0.01 seconds after the one before : blended over that, not 1 / 30
+        const BakedAnimation::Clip& partial = baked.clip(1);
+        const BakedAnimation::FrameAddress end = baked.address(1, partial.duration);
+        CHECK(end.rows[0] == partial.firstRow + partial.frameCount - 2);
+        CHECK(end.rows[1] == partial.firstRow + partial.frameCount - 1);
+        CHECK(fabsf(end.blend - 1) < EPSILON);
+        const BakedAnimation::FrameAddress halfway = baked.address(1, (1.0f + partial.duration) / 2);
+        CHECK(halfway.rows[0] == end.rows[0]);
+        CHECK(fabsf(halfway.blend - 0.5f) < 0.01f);
+
+        // The end of a whole number of frames lands on the last row, not past it
+        const BakedAnimation::FrameAddress wholeEnd = baked.address(0, baked.clip(0).duration);
+        CHECK(wholeEnd.rows[1] == baked.clip(0).frameCount - 1);
+        CHECK(fabsf(wholeEnd.blend - 1) < EPSILON);
+        return failures;
+    }
+
+    // Outside the clip, each wrap mode brings the time back the way ClipSampler does
+    int test_wrap_modes() {
+        int failures = 0;
+        const float duration = 1.01f;
+        BakedAnimation baked;
+        bake(baked, { duration, duration, duration },
+            { ClipSampler::WrapMode::LOOP, ClipSampler::WrapMode::CLAMP, ClipSampler::WrapMode::PING_PONG });
+        const uint32_t loop = 0;
+        const uint32_t clamp = 1;
+        const uint32_t pingPong = 2;
+
+        for (float seconds : { 0.0f, 0.3f, 0.77f, 1.0f }) {
+            CHECK(matches(baked, loop, seconds, seconds));
+            CHECK(matches(baked, loop, seconds + duration, seconds));
+            CHECK(matches(baked, loop, seconds + 3 * duration, seconds));
+            CHECK(matches(baked, loop, seconds - duration, seconds));
+
+            CHECK(matches(baked, clamp, seconds, seconds));
+            CHECK(matches(baked, clamp, duration + seconds + 0.01f, duration));
+            CHECK(matches(baked, clamp, -seconds - 0.01f, 0));
+
+            CHECK(matches(baked, pingPong, seconds, seconds));
+            CHECK(matches(baked, pingPong, 2 * duration - seconds, seconds));
+            CHECK(matches(baked, pingPong, 2 * duration + seconds, seconds));
+            CHECK(matches(baked, pingPong, -seconds, seconds));
+        }
+        // Every mode stays inside its own clip's rows
+        for (uint32_t clip = 0; clip < 3; ++clip) {
+            for (int step = -300; step <= 300; ++step) {
+                const BakedAnimation::FrameAddress address = baked.address(clip, step * 0.0173f);
+                CHECK(address.rows[0] >= baked.clip(clip).firstRow);
+                CHECK(address.rows[1] < baked.clip(clip).firstRow + baked.clip(clip).frameCount);
+            }
+        }
+        return failures;
+    }
+}
+
+int test_baked_animation() {
+    return test_layout() + test_bone_transform() + test_wrap_modes();
+}
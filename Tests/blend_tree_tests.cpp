@@ -0,0 +1,256 @@
+#include "tests.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "blend_tree.h"
+
+namespace {
+    // Two chains of five nodes : 0-4, and 5-9 under node 0 (an upper body)
+    const uint32_t NODE_COUNT = 10;
+    const uint32_t UPPER_BODY = 5;
+    const float SAMPLING_RATE = 30.0f;
+    // Compression error of the clips below
+    const float TOLERANCE = 0.002f;
+
+    Pose::Hierarchy make_hierarchy() {
+        std::vector<int64_t> parents(NODE_COUNT);
+        for (uint32_t nodeIndex = 0; nodeIndex < NODE_COUNT; ++nodeIndex) {
+            parents.at(nodeIndex) = static_cast<int64_t>(nodeIndex) - 1;
+        }
+        parents.at(UPPER_BODY) = 0;
+        Pose::Hierarchy hierarchy;
+        hierarchy.build(parents.data(), NODE_COUNT);
+        return hierarchy;
+    }
+
+    // Every node holds scaling.x = translation.x = 'value' on every frame
+    CompressedAnimation constant_clip(float value) {
+        std::vector<CompressedAnimation::Transform> frames(2 * NODE_COUNT);
+        for (CompressedAnimation::Transform& transform : frames) {
+            transform.scaling.x = value;
+            transform.translation.x = value;
+        }
+        CompressedAnimation clip;
+        clip.compress(frames.data(), 2, NODE_COUNT);
+        return clip;
+    }
+
+    // Every node turns and moves along x by 'speed' a frame, each from its own phase
+    CompressedAnimation moving_clip(float speed, uint32_t frameCount) {
+        std::vector<CompressedAnimation::Transform> frames(frameCount * NODE_COUNT);
+        for (uint32_t frame = 0; frame < frameCount; ++frame) {
+            for (uint32_t nodeIndex = 0; nodeIndex < NODE_COUNT; ++nodeIndex) {
+                CompressedAnimation::Transform& transform = frames.at(frame * NODE_COUNT + nodeIndex);
+                const float angle = 0.5f * sinf(frame * 0.1f + nodeIndex);
+                transform.rotation = { 0, sinf(angle / 2) * 0.6f, sinf(angle / 2) * 0.8f, cosf(angle / 2) };
+                transform.translation = { speed * frame, static_cast<float>(nodeIndex), 0 };
+                transform.scaling = { 1 + 0.01f * nodeIndex, 1, 1 };
+            }
+        }
+        CompressedAnimation clip;
+        clip.compress(frames.data(), frameCount, NODE_COUNT);
+        return clip;
+    }
+
+    // Largest difference over the streams of nodes [first, first + count)
+    float difference(const Pose& a, const Pose& b, uint32_t first = 0, uint32_t count = NODE_COUNT) {
+        float largest = 0;
+        for (int streamIndex = 0; streamIndex < Pose::STREAM_COUNT; ++streamIndex) {
+            const Pose::Stream stream = static_cast<Pose::Stream>(streamIndex);
+            for (uint32_t nodeIndex = first; nodeIndex < first + count; ++nodeIndex) {
+                largest = std::max<float>(largest, fabsf(a.stream(stream)[nodeIndex] - b.stream(stream)[nodeIndex]));
+            }
+        }
+        return largest;
+    }
+
+    // 'clip' alone, 'seconds' into playback
+    Pose sample_clip(const CompressedAnimation& clip, float seconds, float speed = 1.0f) {
+        BlendTree tree;
+        tree.set_root(tree.add_clip(clip, SAMPLING_RATE, ClipSampler::WrapMode::LOOP, speed));
+        tree.prepare(NODE_COUNT);
+        Pose pose;
+        tree.evaluate(seconds, pose);
+        return pose;
+    }
+
+    int test_blend_spaces() {
+        int failures = 0;
+        const CompressedAnimation idle = constant_clip(1.0f);
+        const CompressedAnimation walk = constant_clip(2.0f);
+        const CompressedAnimation run = constant_clip(3.0f);
+
+        BlendTree tree;
+        const uint32_t speed = tree.add_parameter(0);
+        const BlendTree::NodeId children[] = {
+            tree.add_clip(idle, SAMPLING_RATE), tree.add_clip(walk, SAMPLING_RATE), tree.add_clip(run, SAMPLING_RATE),
+        };
+        tree.set_root(tree.add_blend_1d(speed, { children[0], children[1], children[2] }, { 0, 1, 3 }));
+        tree.prepare(NODE_COUNT);
+
+        // Parameter -> expected scaling.x : on a threshold, between two, and clamped outside
+        const float expectations[][2] = {
+            { 0.0f, 1.0f }, { 1.0f, 2.0f }, { 3.0f, 3.0f }, { 0.25f, 1.25f }, { 2.0f, 2.5f }, { -1.0f, 1.0f }, { 5.0f, 3.0f },
+        };
+        Pose pose;
+        for (const float* expectation : expectations) {
+            tree.set_parameter(speed, expectation[0]);
+            tree.evaluate(1 / 60.0f, pose);
+            for (uint32_t nodeIndex = 0; nodeIndex < NODE_COUNT; ++nodeIndex) {
+                CHECK(fabsf(pose.stream(Pose::SCALING_X)[nodeIndex] - expectation[1]) < TOLERANCE);
+                CHECK(fabsf(pose.stream(Pose::TRANSLATION_X)[nodeIndex] - expectation[1]) < TOLERANCE);
+                CHECK(fabsf(pose.stream(Pose::ROTATION_W)[nodeIndex] - 1.0f) < TOLERANCE);
+            }
+        }
+
+        // 2D : a child under the parameter point takes it all, equidistant children share it evenly
+        BlendTree plane;
+        const uint32_t x = plane.add_parameter(1);
+        const uint32_t y = plane.add_parameter(0);
+        const BlendTree::NodeId planeChildren[] = {
+            plane.add_clip(idle, SAMPLING_RATE), plane.add_clip(walk, SAMPLING_RATE), plane.add_clip(run, SAMPLING_RATE),
+        };
+        plane.set_root(plane.add_blend_2d(x, y, { planeChildren[0], planeChildren[1], planeChildren[2] }, { { 0, 0 }, { 1, 0 }, { 0, 1 } }));
+        plane.prepare(NODE_COUNT);
+        plane.evaluate(0, pose);
+        CHECK(fabsf(pose.stream(Pose::SCALING_X)[0] - 2.0f) < TOLERANCE);
+        plane.set_parameter(x, 0.5f);
+        plane.set_parameter(y, 0.5f);
+        plane.evaluate(0, pose);
+        CHECK(fabsf(pose.stream(Pose::SCALING_X)[0] - 2.0f) < TOLERANCE);
+        plane.set_parameter(x, 0.1f);
+        plane.set_parameter(y, 0.05f);
+        plane.evaluate(0, pose);
+        // Closest to idle, and the weights sum to 1
+        CHECK(pose.stream(Pose::SCALING_X)[0] > 1.0f && pose.stream(Pose::SCALING_X)[0] < 1.5f);
+        CHECK(fabsf(pose.stream(Pose::ROTATION_W)[0] - 1.0f) < TOLERANCE);
+        return failures;
+    }
+
+    int test_layers() {
+        int failures = 0;
+        const Pose::Hierarchy hierarchy = make_hierarchy();
+        const CompressedAnimation idle = constant_clip(1.0f);
+        const CompressedAnimation attack = moving_clip(0.1f, 40);
+        const CompressedAnimation nod = moving_clip(0.05f, 45);
+        const float seconds = 0.5f;
+
+        const Pose base = sample_clip(idle, seconds);
+        const Pose attacking = sample_clip(attack, seconds);
+
+        // Override on the upper body : the legs keep the base, the upper body plays the attack
+        BlendTree tree;
+        tree.set_root(tree.add_clip(idle, SAMPLING_RATE));
+        const size_t overrideLayer = tree.add_layer(tree.add_clip(attack, SAMPLING_RATE), BlendTree::LayerMode::OVERRIDE, 1.0f,
+            BoneMask::subtree(hierarchy, UPPER_BODY));
+        tree.prepare(NODE_COUNT);
+        Pose pose;
+        tree.evaluate(seconds, pose);
+        CHECK(difference(pose, base, 0, UPPER_BODY) == 0);
+        CHECK(difference(pose, attacking, UPPER_BODY, NODE_COUNT - UPPER_BODY) < TOLERANCE);
+
+        // Half weight : halfway between them
+        tree.set_layer_weight(overrideLayer, 0.5f);
+        tree.evaluate(0, pose);
+        for (uint32_t nodeIndex = UPPER_BODY; nodeIndex < NODE_COUNT; ++nodeIndex) {
+            const float expected = (base.stream(Pose::TRANSLATION_X)[nodeIndex] + attacking.stream(Pose::TRANSLATION_X)[nodeIndex]) / 2;
+            CHECK(fabsf(pose.stream(Pose::TRANSLATION_X)[nodeIndex] - expected) < TOLERANCE);
+        }
+        // No weight : the base alone
+        tree.set_layer_weight(overrideLayer, 0);
+        tree.evaluate(0, pose);
+        CHECK(difference(pose, base) == 0);
+
+        // Additive : the base plus the nod's difference from its first frame, scaled by the layer weight
+        const float weight = 0.5f;
+        const Pose nodding = sample_clip(nod, seconds);
+        const Pose nodReference = sample_clip(nod, seconds, 0);
+        BlendTree additive;
+        additive.set_root(additive.add_clip(idle, SAMPLING_RATE));
+        const BlendTree::NodeId reference = additive.add_clip(nod, SAMPLING_RATE, ClipSampler::WrapMode::LOOP, 0);
+        additive.add_layer(additive.add_clip(nod, SAMPLING_RATE), BlendTree::LayerMode::ADDITIVE, weight,
+            BoneMask::subtree(hierarchy, UPPER_BODY), reference);
+        additive.prepare(NODE_COUNT);
+        additive.evaluate(seconds, pose);
+        CHECK(difference(pose, base, 0, UPPER_BODY) == 0);
+        for (uint32_t nodeIndex = UPPER_BODY; nodeIndex < NODE_COUNT; ++nodeIndex) {
+            const float expected = base.stream(Pose::TRANSLATION_X)[nodeIndex] +
+                (nodding.stream(Pose::TRANSLATION_X)[nodeIndex] - nodReference.stream(Pose::TRANSLATION_X)[nodeIndex]) * weight;
+            CHECK(fabsf(pose.stream(Pose::TRANSLATION_X)[nodeIndex] - expected) < TOLERANCE);
+            CHECK(fabsf(pose.stream(Pose::SCALING_X)[nodeIndex] - base.stream(Pose::SCALING_X)[nodeIndex]) < TOLERANCE);
+            // A turn on top of the base's identity
+            CHECK(pose.stream(Pose::ROTATION_W)[nodeIndex] < 1.0f);
+        }
+
+        // An additive layer of a clip relative to itself changes nothing
+        BlendTree identity;
+        identity.set_root(identity.add_clip(idle, SAMPLING_RATE));
+        const BlendTree::NodeId self = identity.add_clip(nod, SAMPLING_RATE);
+        identity.add_layer(self, BlendTree::LayerMode::ADDITIVE, 1.0f, {}, self);
+        identity.prepare(NODE_COUNT);
+        identity.evaluate(seconds, pose);
+        CHECK(difference(pose, base) < TOLERANCE);
+        return failures;
+    }
+
+    // The full tree : a locomotion blend space, an upper body override and an additive nod
+    struct Character {
+        BlendTree tree;
+        uint32_t speed = 0;
+
+        Character(const Pose::Hierarchy& hierarchy, const std::vector<CompressedAnimation>& clips) {
+            speed = tree.add_parameter(0);
+            const BlendTree::NodeId idle = tree.add_clip(clips.at(0), SAMPLING_RATE);
+            const BlendTree::NodeId walk = tree.add_clip(clips.at(1), SAMPLING_RATE);
+            const BlendTree::NodeId run = tree.add_clip(clips.at(2), SAMPLING_RATE);
+            tree.set_root(tree.add_blend_1d(speed, { idle, walk, run }, { 0, 1, 3 }));
+            tree.add_layer(tree.add_clip(clips.at(3), SAMPLING_RATE, ClipSampler::WrapMode::CLAMP), BlendTree::LayerMode::OVERRIDE,
+                1.0f, BoneMask::subtree(hierarchy, UPPER_BODY));
+            const BlendTree::NodeId reference = tree.add_clip(clips.at(4), SAMPLING_RATE, ClipSampler::WrapMode::LOOP, 0);
+            tree.add_layer(tree.add_clip(clips.at(4), SAMPLING_RATE), BlendTree::LayerMode::ADDITIVE, 0.5f, {}, reference);
+            tree.prepare(NODE_COUNT);
+        }
+    };
+
+    int test_determinism() {
+        int failures = 0;
+        const Pose::Hierarchy hierarchy = make_hierarchy();
+        std::vector<CompressedAnimation> clips;
+        for (uint32_t clipIndex = 0; clipIndex < 5; ++clipIndex) {
+            clips.push_back(moving_clip(0.02f * (clipIndex + 1), 30 + 7 * clipIndex));
+        }
+        Character first(hierarchy, clips);
+        Character second(hierarchy, clips);
+        Pose firstPose;
+        Pose secondPose;
+        first.tree.evaluate(0, firstPose);
+        second.tree.evaluate(0, secondPose);
+
+        const size_t allocations = allocation_count();
+        bool same = true;
+        for (int frame = 0; frame < 300; ++frame) {
+            const float speed = 3.0f * frame / 300;
+            first.tree.set_parameter(first.speed, speed);
+            second.tree.set_parameter(second.speed, speed);
+            first.tree.evaluate(1 / 60.0f, firstPose);
+            second.tree.evaluate(1 / 60.0f, secondPose);
+            for (int streamIndex = 0; streamIndex < Pose::STREAM_COUNT; ++streamIndex) {
+                const Pose::Stream stream = static_cast<Pose::Stream>(streamIndex);
+                same = same && memcmp(firstPose.stream(stream), secondPose.stream(stream), NODE_COUNT * sizeof(float)) == 0;
+            }
+            // advance keeps the clips where evaluate would have
+            first.tree.advance(1 / 120.0f);
+            second.tree.evaluate(1 / 120.0f, secondPose);
+        }
+        CHECK(allocation_count() == allocations);
+        CHECK(same);
+        return failures;
+    }
+}
+
+int test_blend_tree() {
+    return test_blend_spaces() + test_layers() + test_determinism();
+}
@@ -0,0 +1,284 @@
+#include "tests.h"
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include "frame_graph.h"
+#include "thread_pool.h"
+
+namespace {
+    using PassId = FrameGraph::PassId;
+
+    PassRecord empty_record() {
+        return [](ID3D11DeviceContext*) {};
+    }
+
+    // Position of 'pass' in the graph's order, or -1 when it was culled
+    int position(const FrameGraph& graph, PassId pass) {
+        const std::vector<PassId>& order = graph.order();
+        for (size_t index = 0; index < order.size(); ++index) {
+            if (order.at(index) == pass) {
+                return static_cast<int>(index);
+            }
+        }
+        return -1;
+    }
+
+    // Readers run after the writers, whatever order the passes were added in
+    int test_pass_order() {
+        int failures = 0;
+        FrameGraph graph;
+        const FrameGraph::ResourceId color = graph.create_resource("color");
+        const FrameGraph::ResourceId luminance = graph.create_resource("luminance");
+        const FrameGraph::ResourceId backBuffer = graph.import_resource("back buffer");
+
+        const PassId composite = graph.add_pass("composite", empty_record());
+        const PassId extraction = graph.add_pass("luminance extraction", empty_record());
+        const PassId scene = graph.add_pass("scene", empty_record());
+        graph.read(composite, color);
+        graph.read(composite, luminance);
+        graph.write(composite, backBuffer);
+        graph.read(extraction, color);
+        graph.write(extraction, luminance);
+        graph.write(scene, color);
+        graph.compile();
+
+        CHECK((graph.order() == std::vector<PassId>{ scene, extraction, composite }));
+        CHECK(graph.statistics().passes == 3);
+        CHECK(graph.statistics().culledPasses == 0);
+        CHECK(graph.statistics().dependencies == 3);
+
+        // Nothing orders these two : the one added first runs first
+        FrameGraph independent;
+        const FrameGraph::ResourceId shadow = independent.import_resource("shadow");
+        const FrameGraph::ResourceId reflection = independent.import_resource("reflection");
+        const PassId shadowPass = independent.add_pass("shadow", empty_record());
+        const PassId reflectionPass = independent.add_pass("reflection", empty_record());
+        independent.write(reflectionPass, reflection);
+        independent.write(shadowPass, shadow);
+        independent.compile();
+        CHECK((independent.order() == std::vector<PassId>{ shadowPass, reflectionPass }));
+        CHECK(independent.statistics().dependencies == 0);
+
+        // The writers of one resource run in the order they were added, not the order write was called in
+        FrameGraph writers;
+        const FrameGraph::ResourceId target = writers.import_resource("target");
+        const PassId first = writers.add_pass("first", empty_record());
+        const PassId second = writers.add_pass("second", empty_record());
+        writers.write(second, target);
+        writers.write(first, target);
+        writers.compile();
+        CHECK((writers.order() == std::vector<PassId>{ first, second }));
+        return failures;
+    }
+
+    // Read after write, and passes that read what they write
+    int test_read_write() {
+        int failures = 0;
+        FrameGraph graph;
+        const FrameGraph::ResourceId color = graph.create_resource("color");
+        const FrameGraph::ResourceId backBuffer = graph.import_resource("back buffer");
+
+        const PassId clear = graph.add_pass("clear", empty_record());
+        const PassId opaque = graph.add_pass("opaque", empty_record());      // draws over what clear left
+        const PassId transparent = graph.add_pass("transparent", empty_record());
+        const PassId composite = graph.add_pass("composite", empty_record());
+        graph.write(clear, color);
+        graph.read(opaque, color);
+        graph.write(opaque, color);
+        graph.write(opaque, color);     // twice is once
+        graph.read(transparent, color);
+        graph.write(transparent, color);
+        graph.read(composite, color);
+        graph.write(composite, backBuffer);
+        graph.compile();
+
+        CHECK((graph.order() == std::vector<PassId>{ clear, opaque, transparent, composite }));
+        // opaque -> clear, transparent -> clear and opaque, composite -> the three writers
+        CHECK(graph.statistics().dependencies == 6);
+
+        // A pass reading what it writes only waits for the writers added before it; a later writer waits for it
+        FrameGraph later;
+        const FrameGraph::ResourceId target = later.import_resource("target");
+        const PassId overlay = later.add_pass("overlay", empty_record());
+        const PassId base = later.add_pass("base", empty_record());
+        later.read(overlay, target);
+        later.write(overlay, target);
+        later.write(base, target);
+        later.compile();
+        CHECK((later.order() == std::vector<PassId>{ overlay, base }));
+
+        // Reading a resource nobody writes orders nothing
+        FrameGraph unwritten;
+        const FrameGraph::ResourceId source = unwritten.import_resource("source");
+        const FrameGraph::ResourceId output = unwritten.import_resource("output");
+        const PassId copy = unwritten.add_pass("copy", empty_record());
+        unwritten.read(copy, source);
+        unwritten.write(copy, output);
+        unwritten.compile();
+        CHECK((unwritten.order() == std::vector<PassId>{ copy }));
+        CHECK(unwritten.statistics().dependencies == 0);
+        return failures;
+    }
+
+    // Passes none of the imported resources depend on are culled
+    int test_culling() {
+        int failures = 0;
+        FrameGraph graph;
+        const FrameGraph::ResourceId color = graph.create_resource("color");
+        const FrameGraph::ResourceId debug = graph.create_resource("debug");
+        const FrameGraph::ResourceId history = graph.create_resource("history");
+        const FrameGraph::ResourceId backBuffer = graph.import_resource("back buffer");
+
+        const PassId scene = graph.add_pass("scene", empty_record());
+        const PassId debugView = graph.add_pass("debug view", empty_record());     // nobody reads debug
+        const PassId feedback = graph.add_pass("feedback", empty_record());        // only feeds debugView
+        const PassId composite = graph.add_pass("composite", empty_record());
+        const PassId idle = graph.add_pass("idle", empty_record());                // writes nothing at all
+        graph.write(scene, color);
+        graph.write(feedback, history);
+        graph.read(debugView, color);
+        graph.read(debugView, history);
+        graph.write(debugView, debug);
+        graph.read(composite, color);
+        graph.write(composite, backBuffer);
+        graph.compile();
+
+        CHECK((graph.order() == std::vector<PassId>{ scene, composite }));
+        CHECK(graph.culled(debugView));
+        CHECK(graph.culled(feedback));
+        CHECK(graph.culled(idle));
+        CHECK(!graph.culled(scene));
+        CHECK(!graph.culled(composite));
+        CHECK(graph.statistics().passes == 5);
+        CHECK(graph.statistics().culledPasses == 3);
+        CHECK(graph.statistics().deferredPasses == 2);
+        // Only the live passes' dependencies count
+        CHECK(graph.statistics().dependencies == 1);
+
+        // A culled pass is neither recorded nor played
+        RecordingFrameGraphBackend backend;
+        graph.execute(backend, nullptr);
+        CHECK(backend.events().size() == 2);
+        CHECK(backend.played_in(graph.order()));
+
+        // Reading the debug output from the back buffer's side brings it, and what it reads, back
+        const PassId overlay = graph.add_pass("overlay", empty_record(), false);
+        graph.read(overlay, debug);
+        graph.read(overlay, backBuffer);
+        graph.write(overlay, backBuffer);
+        graph.compile();
+        CHECK(!graph.culled(debugView));
+        CHECK(!graph.culled(feedback));
+        CHECK(graph.culled(idle));
+        CHECK(position(graph, feedback) < position(graph, debugView));
+        CHECK(position(graph, debugView) < position(graph, overlay));
+        CHECK(position(graph, composite) < position(graph, overlay));
+        return failures;
+    }
+
+    // Deferred passes are recorded on the workers, immediate ones on the calling thread, and both are played in
+    // the graph's order
+    int test_deferred_and_immediate() {
+        int failures = 0;
+        ThreadPool threadPool(3);
+        RecordingFrameGraphBackend backend;
+        const std::thread::id mainThread = std::this_thread::get_id();
+
+        for (int frame = 0; frame < 200; ++frame) {
+            FrameGraph graph;
+            std::atomic<int> deferredRecords = 0;
+            std::atomic<int> immediateRecords = 0;
+            std::atomic<int> deferredOnMainThread = 0;
+            const PassRecord deferredRecord = [&](ID3D11DeviceContext*) {
+                ++deferredRecords;
+                if (std::this_thread::get_id() == mainThread) {
+                    ++deferredOnMainThread;
+                }
+                // Long enough for the passes after it to finish recording first
+                std::this_thread::sleep_for(std::chrono::microseconds(frame % 3 == 0 ? 200 : 0));
+            };
+            const PassRecord immediateRecord = [&](ID3D11DeviceContext*) {
+                ++immediateRecords;
+            };
+
+            const FrameGraph::ResourceId color = graph.create_resource("color");
+            const FrameGraph::ResourceId luminance = graph.create_resource("luminance");
+            const FrameGraph::ResourceId backBuffer = graph.import_resource("back buffer");
+            const PassId scene = graph.add_pass("scene", deferredRecord);
+            const PassId lambert = graph.add_pass("lambert", immediateRecord, false);
+            const PassId extraction = graph.add_pass("luminance extraction", deferredRecord);
+            const PassId composite = graph.add_pass("composite", deferredRecord);
+            const PassId ui = graph.add_pass("UI", immediateRecord, false);
+            graph.write(scene, color);
+            graph.read(lambert, color);
+            graph.write(lambert, color);
+            graph.read(extraction, color);
+            graph.write(extraction, luminance);
+            graph.read(composite, color);
+            graph.read(composite, luminance);
+            graph.write(composite, backBuffer);
+            graph.read(ui, backBuffer);
+            graph.write(ui, backBuffer);
+            graph.compile();
+
+            CHECK((graph.order() == std::vector<PassId>{ scene, lambert, extraction, composite, ui }));
+            CHECK(graph.statistics().deferredPasses == 3);
+
+            // Without a thread pool everything is recorded in order on the calling thread
+            ThreadPool* pool = frame % 2 == 0 ? &threadPool : nullptr;
+            graph.execute(backend, pool);
+            CHECK(backend.played_in(graph.order()));
+            CHECK(deferredRecords == 3);
+            CHECK(immediateRecords == 2);
+
+            int records = 0;
+            int immediates = 0;
+            for (const RecordingFrameGraphBackend::Event& event : backend.events()) {
+                switch (event.type) {
+                case RecordingFrameGraphBackend::EventType::RECORD:
+                    ++records;
+                    CHECK(graph.deferred(event.pass));
+                    CHECK(event.thread != mainThread);
+                    break;
+                case RecordingFrameGraphBackend::EventType::RECORD_IMMEDIATE:
+                    ++immediates;
+                    CHECK(event.thread == mainThread);
+                    break;
+                case RecordingFrameGraphBackend::EventType::EXECUTE:
+                    CHECK(event.thread == mainThread);
+                    break;
+                }
+            }
+            if (pool) {
+                CHECK(records == 3);
+                CHECK(immediates == 2);
+                CHECK(deferredOnMainThread == 0);
+            }
+            else {
+                CHECK(records == 0);
+                CHECK(immediates == 5);
+            }
+        }
+
+        // played_in itself : another order, or a pass played twice, is caught
+        FrameGraph graph;
+        const FrameGraph::ResourceId target = graph.import_resource("target");
+        const PassId first = graph.add_pass("first", empty_record());
+        const PassId second = graph.add_pass("second", empty_record(), false);
+        graph.write(first, target);
+        graph.write(second, target);
+        graph.compile();
+        graph.execute(backend, &threadPool);
+        CHECK(backend.played_in({ first, second }));
+        CHECK(!backend.played_in({ second, first }));
+        CHECK(!backend.played_in({ first, second, second }));
+        return failures;
+    }
+}
+
+int test_frame_graph() {
+    return test_pass_order() + test_read_write() + test_culling() + test_deferred_and_immediate();
+}
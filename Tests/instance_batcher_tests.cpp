@@ -0,0 +1,106 @@
+#include "tests.h"
+
+#include <vector>
+
+#include "instance_batcher.h"
+
+namespace {
+    // Every instance lands in exactly one batch, each batch is a contiguous run of order() holding only its own
+    // resource and LOD, and the instances of a batch keep their add order
+    int check_layout(const InstanceBatcher& batcher, const std::vector<const void*>& resources, const std::vector<uint32_t>& lods) {
+        int failures = 0;
+        const std::vector<uint32_t>& order = batcher.order();
+        CHECK(order.size() == resources.size());
+        std::vector<int> seen(resources.size(), 0);
+        uint32_t first = 0;
+        for (const InstanceBatcher::Batch& batch : batcher.batches()) {
+            CHECK(batch.first == first);
+            CHECK(batch.count > 0);
+            for (uint32_t position = batch.first; position < batch.first + batch.count && position < order.size(); ++position) {
+                const uint32_t instance = order.at(position);
+                CHECK(resources.at(instance) == batch.resource);
+                CHECK(lods.at(instance) == batch.lod);
+                CHECK(position == batch.first || order.at(position - 1) < instance);
+                ++seen.at(instance);
+            }
+            first += batch.count;
+        }
+        CHECK(first == order.size());
+        for (int count : seen) {
+            CHECK(count == 1);
+        }
+        return failures;
+    }
+
+    int test_batches() {
+        int failures = 0;
+        int rock = 0;
+        int tree = 0;
+        int grass = 0;
+        InstanceBatcher batcher;
+        const std::vector<const void*> resources = { &tree, &rock, &tree, &tree, &rock, &grass, &tree, &tree };
+        const std::vector<uint32_t> lods = { 0, 0, 1, 0, 0, 2, 1, 0 };
+        for (size_t instance = 0; instance < resources.size(); ++instance) {
+            CHECK(batcher.add(resources.at(instance), lods.at(instance)) == instance);
+        }
+        CHECK(batcher.instance_count() == resources.size());
+        batcher.build();
+        failures += check_layout(batcher, resources, lods);
+
+        // One batch per resource and LOD, in the order their first instance was added
+        const std::vector<InstanceBatcher::Batch>& batches = batcher.batches();
+        CHECK(batches.size() == 4);
+        if (batches.size() == 4) {
+            CHECK(batches.at(0).resource == &tree && batches.at(0).lod == 0 && batches.at(0).count == 3);
+            CHECK(batches.at(1).resource == &rock && batches.at(1).lod == 0 && batches.at(1).count == 2);
+            CHECK(batches.at(2).resource == &tree && batches.at(2).lod == 1 && batches.at(2).count == 2);
+            CHECK(batches.at(3).resource == &grass && batches.at(3).lod == 2 && batches.at(3).count == 1);
+        }
+        CHECK((batcher.order() == std::vector<uint32_t>{ 0, 3, 7, 1, 4, 2, 6, 5 }));
+
+        // Building twice lays the same scene out the same way
+        const std::vector<uint32_t> firstOrder = batcher.order();
+        batcher.build();
+        CHECK(batcher.order() == firstOrder);
+        CHECK(batcher.batches().size() == 4);
+        return failures;
+    }
+
+    int test_rebuild() {
+        int failures = 0;
+        int rock = 0;
+        int tree = 0;
+        InstanceBatcher batcher;
+        batcher.build();
+        CHECK(batcher.batches().empty());
+        CHECK(batcher.order().empty());
+
+        // A new frame after clear starts its indices and batches over
+        for (int frame = 0; frame < 3; ++frame) {
+            batcher.clear();
+            std::vector<const void*> resources;
+            std::vector<uint32_t> lods;
+            for (uint32_t instance = 0; instance < 50 + 10 * static_cast<uint32_t>(frame); ++instance) {
+                resources.push_back(instance % (frame + 2) == 0 ? &rock : &tree);
+                lods.push_back((instance / 3 + frame) % 3);
+                CHECK(batcher.add(resources.back(), lods.back()) == instance);
+            }
+            batcher.build();
+            failures += check_layout(batcher, resources, lods);
+            CHECK(batcher.batches().size() == 6);
+            CHECK(batcher.batches().front().resource == resources.front());
+            CHECK(batcher.batches().front().lod == lods.front());
+        }
+
+        batcher.clear();
+        CHECK(batcher.instance_count() == 0);
+        batcher.build();
+        CHECK(batcher.batches().empty());
+        CHECK(batcher.order().empty());
+        return failures;
+    }
+}
+
+int test_instance_batcher() {
+    return test_batches() + test_rebuild();
+}
@@ -0,0 +1,62 @@
+// Headless tests of the Library modules that run without a device or assets : the frame graph's scheduling,
+// blend tree evaluation and the like. Each module's checks live in <module>_tests.cpp.
+//
+// Usage : Tests
+// Prints the failed checks and one line per module, and returns the number of modules that failed.
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+#include "tests.h"
+
+namespace {
+    std::atomic<size_t> allocations = 0;
+}
+
+void* operator new(size_t size) {
+    ++allocations;
+    if (void* memory = malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+size_t allocation_count() {
+    return allocations;
+}
+
+int main() {
+    struct Test {
+        const char* name;
+        int (*run)();
+    };
+    const Test tests[] = {
+        { "frame_graph", test_frame_graph },
+        { "blend_tree", test_blend_tree },
+        { "baked_animation", test_baked_animation },
+        { "instance_batcher", test_instance_batcher },
+    };
+
+    int failedTests = 0;
+    for (const Test& test : tests) {
+        const int failures = test.run();
+        if (failures == 0) {
+            printf("%s : ok\n", test.name);
+        }
+        else {
+            printf("%s : %d failed\n", test.name, failures);
+            ++failedTests;
+        }
+    }
+    return failedTests;
+}
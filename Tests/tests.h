@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdio>
+#include <cstddef>
+
+// Every test_ function checks one Library module with CHECK and returns how many checks failed
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s(%d) : CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++failures; \
+        } \
+    } while (false)
+
+// Calls to the global operator new so far, to check that a loop doesn't allocate
+size_t allocation_count();
+
+int test_frame_graph();
+int test_blend_tree();
+int test_baked_animation();
+int test_instance_batcher();